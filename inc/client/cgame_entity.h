@@ -149,6 +149,7 @@ typedef struct cgame_entity_import_s {
 
     void (*V_AddEntity)(const entity_t *ent);
     bool (*V_AddParticle)(const particle_t *p);
+    int (*V_AddParticles)(const particle_t *p, int count);
     void (*V_AddLight)(const vec3_t org, float intensity, float r, float g, float b);
     void (*V_AddLightEx)(cl_shadow_light_t *light);
     void (*V_AddLightStyle)(int style, float value);
@@ -190,6 +191,9 @@ typedef struct cgame_entity_export_s {
 #if USE_DEBUG
     void (*CheckEntityPresent)(int entnum, const char *what);
 #endif
+#if USE_TESTS
+    void (*ParticleBench)(int count, int frames);
+#endif
 } cgame_entity_export_t;
 
 const cgame_entity_export_t *CG_GetEntityAPI(void);
@@ -22,9 +22,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 extern "C" {
 #endif
 
-#define CGAME_ENTITY_API_VERSION 2
-#define CGAME_ENTITY_IMPORT_EXT "CGameEntity_Import_v2"
-#define CGAME_ENTITY_EXPORT_EXT "CGameEntity_Export_v2"
+#define CGAME_ENTITY_API_VERSION 3
+#define CGAME_ENTITY_IMPORT_EXT "CGameEntity_Import_v3"
+#define CGAME_ENTITY_EXPORT_EXT "CGameEntity_Export_v3"
 
 typedef struct cgame_entity_import_s cgame_entity_import_t;
 typedef struct cgame_entity_export_s cgame_entity_export_t;
@@ -42,6 +42,9 @@ void S_BeginRegistration(void);
 qhandle_t S_RegisterSound(const char *sample);
 void S_EndRegistration(void);
 
+// decodes sounds queued with FS_PreloadFileEx on workers, takes sample rate
+const fs_decoder_t *S_PreloadDecoder(void);
+
 #define MAX_RAW_SAMPLES     8192
 
 typedef struct sfx_eax_properties_s {
@@ -21,27 +21,31 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #ifdef __cplusplus
 extern "C" {
 #endif
-#if USE_CLIENT
+typedef enum {
+    ASYNC_PRIO_NORMAL,  // bulk I/O, e.g. screenshot encoding
+    ASYNC_PRIO_HIGH,    // latency critical, e.g. map preloading
+
+    ASYNC_PRIO_MAX
+} asyncprio_t;
 
 typedef struct asyncwork_s {
     void (*work_cb)(void *);
     void (*done_cb)(void *);
     void *cb_arg;
+    asyncprio_t priority;
+
+    // private
+    unsigned id;
+    unsigned queued;
     struct asyncwork_s *next;
 } asyncwork_t;
 
-void Com_QueueAsyncWork(asyncwork_t *work);
+void Com_InitAsyncWork(void);
+unsigned Com_QueueAsyncWork(asyncwork_t *work);
+bool Com_CancelAsyncWork(unsigned id);
 void Com_CompleteAsyncWork(void);
 void Com_ShutdownAsyncWork(void);
 
-#else
-
-#define Com_QueueAsyncWork(work)    (void)0
-#define Com_CompleteAsyncWork()     (void)0
-#define Com_ShutdownAsyncWork()     (void)0
-
-#endif
-
 #ifdef __cplusplus
 }
 #endif
@@ -166,7 +166,6 @@ typedef struct {
     int                 contents;
     int                 numsides;
     mbrushside_t        *firstbrushside;
-    unsigned            checkcount;         // to avoid repeated testings
 } mbrush_t;
 
 typedef struct {
@@ -53,7 +53,25 @@ const mleaf_t   *CM_LeafNum(const cm_t *cm, int number);
 #define CM_NumNode(cm, node) ((node) ? ((node) - (cm)->cache->nodes) : -1)
 #define CM_NumLeaf(cm, leaf) ((cm)->cache ? ((leaf) - (cm)->cache->leafs) : 0)
 
-// creates a clipping hull for an arbitrary box
+// per-thread state for collision queries. all CM_* trace and contents
+// functions are safe to call from multiple threads as long as the map
+// isn't being loaded or modified, but box hulls need a context each.
+typedef struct {
+    cplane_t        box_planes[12];
+    mnode_t         box_nodes[6];
+    mbrush_t        box_brush;
+    mbrush_t        *box_leafbrush;
+    mbrushside_t    box_brushsides[6];
+    mleaf_t         box_leaf;
+    mleaf_t         box_emptyleaf;
+} cm_trace_ctx_t;
+
+void        CM_InitTraceCtx(cm_trace_ctx_t *ctx);
+
+// creates a clipping hull for an arbitrary box, valid until next call
+// with the same context. CM_HeadnodeForBox() uses global context and
+// is main thread only.
+const mnode_t   *CM_HeadnodeForBoxCtx(cm_trace_ctx_t *ctx, const vec3_t mins, const vec3_t maxs);
 const mnode_t   *CM_HeadnodeForBox(const vec3_t mins, const vec3_t maxs);
 
 // returns an ORed contents mask
@@ -73,6 +91,13 @@ void        CM_BoxTrace(trace_t *trace,
                         const vec3_t mins, const vec3_t maxs,
                         const mnode_t *headnode, int brushmask,
                         bool extended);
+// traces multiple boxes of the same size, results are identical to
+// calling CM_BoxTrace() for each one. thread safe, like CM_BoxTrace()
+void        CM_BoxTraceBatch(trace_t *traces,
+                             const vec3_t *starts, const vec3_t *ends, int count,
+                             const vec3_t mins, const vec3_t maxs,
+                             const mnode_t *headnode, int brushmask,
+                             bool extended);
 void        CM_TransformedBoxTrace(trace_t *trace,
                                    const vec3_t start, const vec3_t end,
                                    const vec3_t mins, const vec3_t maxs,
@@ -102,6 +127,10 @@ static inline const mleaf_t *CM_PointLeaf(const cm_t *cm, const vec3_t p)
     return BSP_PointLeaf(cm->cache->nodes, p);
 }
 
+#define MAX_FATPVS_CLUSTERS     64
+
+int         CM_FatPVSClusters(const cm_t *cm, const vec3_t org, int *clusters);
+void        CM_ClusterListPVS(const cm_t *cm, visrow_t *mask, const int *clusters, int count);
 void        CM_FatPVS(const cm_t *cm, visrow_t *mask, const vec3_t org);
 
 void        CM_SetAreaPortalState(const cm_t *cm, int portalnum, bool open);
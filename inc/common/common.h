@@ -150,6 +150,7 @@ void        Sys_Printf(const char *fmt, ...) q_printf(1, 2);
 
 #if USE_TESTS
 extern cvar_t   *z_perturb;
+extern cvar_t   *z_pools;
 #endif
 
 #if USE_DEBUG
@@ -41,7 +41,6 @@ extern "C" {
 #define FS_LoadFileFlags(path, buf, flags) \
     FS_LoadFileEx(path, buf, flags, TAG_FILESYSTEM)
 #define FS_LoadFile(path, buf)  FS_LoadFileEx(path, buf, 0, TAG_FILESYSTEM)
-#define FS_FreeFile(buf)        Z_Free(buf)
 
 // just regular malloc for now
 #define FS_AllocTempMem(size)   FS_Malloc(size)
@@ -57,6 +56,25 @@ void    FS_Init(void);
 void    FS_Shutdown(void);
 void    FS_Restart(bool total);
 void    FS_AddConfigFiles(bool init);
+void    FS_Frame(void);
+
+// adds file created on disk without FS_OpenFile to the file index
+void    FS_NotifyNewFile(const char *fullpath);
+
+// decodes preloaded file on worker thread, returns malloc'd result and its
+// size or NULL. must not use zone, print or change any shared state.
+typedef struct {
+    void    *(*decode)(const char *path, const void *data, size_t len, void *arg, size_t *size);
+    void    (*free)(void *decoded);
+} fs_decoder_t;
+
+// reads files on worker threads ahead of FS_LoadFile, until the end of frame
+bool    FS_BeginPreload(void);
+bool    FS_PreloadFileEx(const char *path, const fs_decoder_t *decoder, void *arg);
+void    *FS_ClaimDecoded(const char *path, const fs_decoder_t *decoder);
+void    FS_EndPreload(void);
+
+#define FS_PreloadFile(path)    FS_PreloadFileEx(path, NULL, NULL)
 
 #if USE_CLIENT
 int FS_RenameFile(const char *from, const char *to);
@@ -78,8 +96,20 @@ int FS_LoadFileEx(const char *path, void **buffer, unsigned flags, memtag_t tag)
 // a NULL buffer will just return the file length without loading
 // length < 0 indicates error
 
+void FS_FreeFile(void *buf);
+
 int FS_LastModified(const char *file, uint64_t *last_modified);
 
+typedef struct {
+    char        filename[MAX_OSPATH];   // of pack file
+    int64_t     size;                   // of pack file
+    uint64_t    mtime;                  // of pack file
+    int64_t     filepos;                // of entry
+    int64_t     filelen;                // of entry, uncompressed
+} pack_source_t;
+
+int FS_PackSource(const char *path, pack_source_t *src);
+
 int FS_WriteFile(const char *path, const void *data, size_t len);
 
 bool FS_EasyWriteFile(char *buf, size_t size, unsigned mode,
@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2026
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+//
+// prof.h -- scoped zone profiler
+//
+// Zones are timed with a nanosecond clock and recorded into a ring buffer
+// owned by the calling thread, so worker threads never contend. Recording
+// is enabled by com_profile and only toggles between ticks.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// zones used by the engine itself, game zones are registered at runtime
+typedef enum {
+    PROF_SV_FRAME,
+    PROF_SV_PACKETS,
+    PROF_SV_ANTICHEAT,
+    PROF_SV_MVD_CLIENTS,
+    PROF_SV_ASYNC_PACKETS,
+    PROF_SV_GAME,
+    PROF_SV_NAV,
+    PROF_SV_GAME_FRAME,
+    PROF_SV_MVD_CAPTURE,
+    PROF_SV_SEND,
+    PROF_SV_SNAPSHOT_SETUP,
+    PROF_SV_SNAPSHOT,
+    PROF_SV_WRITE_FRAME,
+
+    PROF_NUM_BUILTIN
+} profzone_t;
+
+#define PROF_MAX_ZONES  128
+
+extern bool prof_active;
+
+void    Prof_Init(void);
+void    Prof_Shutdown(void);
+
+// returns existing zone if name is already registered, -1 if out of zones
+int     Prof_RegisterZone(const char *name);
+
+// threads that record zones should call this before exiting
+void    Prof_ReleaseThread(void);
+
+void    Prof_Begin(int zone);
+void    Prof_End(void);
+
+// marks the end of a server tick, called outside of any zone
+void    Prof_EndTick(void);
+
+#define PROF_BEGIN(zone)    do { if (prof_active) Prof_Begin(zone); } while (0)
+#define PROF_END()          do { if (prof_active) Prof_End(); } while (0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -46,6 +46,11 @@ typedef enum {
     TAG_MAX
 } memtag_t;
 
+typedef struct {
+    uint64_t    allocs;         // zone allocations
+    uint64_t    sysallocs;      // calls to malloc and friends
+} zcounters_t;
+
 void    Z_Init(void);
 void    Z_Free(void *ptr);
 void    Z_Freep(void *ptr);
@@ -64,6 +69,7 @@ char    *Z_TagCopyString(const char *in, memtag_t tag);
 void    Z_FreeTags(memtag_t tag);
 void    Z_LeakTest(memtag_t tag);
 void    Z_Stats_f(void);
+void    Z_GetCounters(zcounters_t *counters);
 
 // may return pointer to static memory
 char    *Z_CvarCopyString(const char *in);
@@ -0,0 +1,100 @@
+/*
+Copyright (C) 2026
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "shared/shared.h"
+
+//
+// Compiled MD5 replacement model, shared by renderers.
+//
+// MD5 meshes and animations are parsed once, with bind pose normals,
+// frame skeletons and md5scale scales baked in, and written under the
+// write dir as a single blob. Later loads map that file and use it in
+// place as long as the source files haven't changed.
+//
+
+#define MD5C_IDENT          MakeLittleLong('M','D','5','C')
+#define MD5C_VERSION        2
+
+#define MD5C_MAX_JOINTS     256
+#define MD5C_MAX_MESHES     32
+#define MD5C_MAX_WEIGHTS    8192
+#define MD5C_MAX_FRAMES     1024
+#define MD5C_MAX_VERTICES   65535
+#define MD5C_MAX_INDICES    (MD5C_MAX_VERTICES * 3)
+
+enum {
+    MD5C_SOURCE_MESH,
+    MD5C_SOURCE_ANIM,
+    MD5C_SOURCE_SCALE,
+    MD5C_NUM_SOURCES
+};
+
+typedef struct {
+    int64_t size;           // -1 if missing
+    uint64_t mtime;         // of the file, or of the pack it is stored in
+    int64_t pack_size;      // 0 if not stored in a pack
+    int64_t filepos;        // of entry in the pack
+    uint8_t pack_digest[16];// MD4 of pack path
+} md5c_source_t;
+
+typedef struct {
+    float normal[3];        // joint-local bind pose normal
+    uint16_t start;         // start weight
+    uint16_t count;         // weight count
+} md5c_vertex_t;
+
+typedef struct {
+    float st[2];
+} md5c_tcoord_t;
+
+typedef struct {
+    float pos[3];
+    float bias;
+} md5c_weight_t;
+
+typedef struct {
+    float pos[3];
+    float scale;
+    float orient[4];
+    float axis[3][3];
+} md5c_joint_t;
+
+typedef struct {
+    char shader[MAX_QPATH];
+    uint32_t num_verts;
+    uint32_t num_indices;
+    uint32_t num_weights;
+    uint32_t ofs_vertices;  // md5c_vertex_t[num_verts]
+    uint32_t ofs_tcoords;   // md5c_tcoord_t[num_verts]
+    uint32_t ofs_indices;   // uint16_t[num_indices]
+    uint32_t ofs_weights;   // md5c_weight_t[num_weights]
+    uint32_t ofs_jointnums; // uint8_t[num_weights]
+} md5c_mesh_t;
+
+typedef struct {
+    uint32_t ident;
+    uint32_t version;
+    uint32_t size;          // of the whole blob
+    uint32_t num_meshes;
+    uint32_t num_joints;
+    uint32_t num_frames;
+    uint32_t ofs_meshes;    // md5c_mesh_t[num_meshes]
+    uint32_t ofs_frames;    // md5c_joint_t[num_frames][num_joints]
+    md5c_source_t sources[MD5C_NUM_SOURCES];
+} md5c_header_t;
+
+#define MD5C_DATA(hdr, ofs) ((const void *)((const byte *)(hdr) + (ofs)))
+
+const md5c_header_t *R_MD5Load(const char *mesh_path, const char *anim_path);
+void R_MD5Free(const md5c_header_t *hdr);
@@ -24,13 +24,14 @@ extern "C" {
 
 #include "common/cvar.h"
 #include "common/error.h"
+#include "common/files.h"
 
 #define VIRTUAL_SCREEN_WIDTH   640
 #define VIRTUAL_SCREEN_HEIGHT  480
 
 #define MAX_DLIGHTS     64
 #define MAX_ENTITIES    2048
-#define MAX_PARTICLES   8192
+#define MAX_PARTICLES   32768
 #define MAX_LIGHTSTYLES 256
 
 #define POWERSUIT_SCALE     4.0f
@@ -242,6 +243,9 @@ typedef struct {
 
 extern refcfg_t r_config;
 
+// decodes images queued with FS_PreloadFileEx on workers, takes imagetype_t
+extern const fs_decoder_t r_image_decoder;
+
 typedef enum {
     IF_NONE             = 0,
     IF_PERMANENT        = BIT(0),   // not freed by R_EndRegistration()
@@ -458,6 +462,7 @@ typedef struct renderer_export_s {
 
     const uint32_t *PaletteTable;
     refcfg_t *Config;
+    const fs_decoder_t *ImageDecoder;   // NULL if not supported
 } renderer_export_t;
 
 #if USE_EXTERNAL_RENDERERS && !defined(RENDERER_DLL)
@@ -65,7 +65,7 @@ typedef struct renderer_import_s {
     void (*Com_SetLastError)(const char *msg);
     const char *(*Com_GetLastError)(void);
     char *(*Com_MakePrintable)(const char *s);
-    void (*Com_QueueAsyncWork)(asyncwork_t *work);
+    unsigned (*Com_QueueAsyncWork)(asyncwork_t *work);
     bool (*Com_WildCmpEx)(const char *filter, const char *string, int term, bool ignorecase);
     void (*Com_Color_g)(genctx_t *ctx);
     void (*Com_PageInMemory)(void *buffer, size_t size);
@@ -97,16 +97,20 @@ typedef struct renderer_import_s {
     void (*Cmd_Option_c)(const cmd_option_t *opt, xgenerator_t g, genctx_t *ctx, int argnum);
 
     int (*FS_LoadFileEx)(const char *path, void **buffer, unsigned flags, memtag_t tag);
+    void (*FS_FreeFile)(void *buf);
+    void *(*FS_ClaimDecoded)(const char *path, const fs_decoder_t *decoder);
     int64_t (*FS_OpenFile)(const char *filename, qhandle_t *f, unsigned mode);
     qhandle_t (*FS_EasyOpenFile)(char *buf, size_t size, unsigned mode,
                                  const char *dir, const char *name, const char *ext);
     int (*FS_Read)(void *buffer, size_t len, qhandle_t f);
     int (*FS_CloseFile)(qhandle_t f);
     int (*FS_FPrintf)(qhandle_t f, const char *format, ...);
+    int (*FS_WriteFile)(const char *path, const void *data, size_t len);
     int64_t (*FS_Length)(qhandle_t f);
     void **(*FS_ListFiles)(const char *path, const char *filter, unsigned flags, int *count_p);
     void (*FS_FreeList)(void **list);
     int (*FS_LastModified)(const char *file, uint64_t *last_modified);
+    int (*FS_PackSource)(const char *path, pack_source_t *src);
     size_t (*FS_NormalizePathBuffer)(char *out, const char *in, size_t size);
     void (*FS_CleanupPath)(char *s);
     int (*FS_CreatePath)(char *path);
@@ -307,15 +311,19 @@ extern renderer_import_t ri;
 #define Cmd_Option_c ri.Cmd_Option_c
 
 #define FS_LoadFileEx ri.FS_LoadFileEx
+#define FS_FreeFile ri.FS_FreeFile
+#define FS_ClaimDecoded ri.FS_ClaimDecoded
 #define FS_OpenFile ri.FS_OpenFile
 #define FS_EasyOpenFile ri.FS_EasyOpenFile
 #define FS_Read ri.FS_Read
 #define FS_CloseFile ri.FS_CloseFile
 #define FS_FPrintf ri.FS_FPrintf
+#define FS_WriteFile ri.FS_WriteFile
 #define FS_Length ri.FS_Length
 #define FS_ListFiles ri.FS_ListFiles
 #define FS_FreeList ri.FS_FreeList
 #define FS_LastModified ri.FS_LastModified
+#define FS_PackSource ri.FS_PackSource
 #define FS_NormalizePathBuffer ri.FS_NormalizePathBuffer
 #define FS_CleanupPath ri.FS_CleanupPath
 #define FS_CreatePath ri.FS_CreatePath
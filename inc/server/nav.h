@@ -147,10 +147,18 @@ typedef struct nav_path_s {
 
     // out
     const nav_node_t            *start, *goal;
+
+    // out, whether region graph is searched first
+    bool                        hierarchical;
 } nav_path_t;
 
 PathInfo Nav_Path(nav_path_t *path);
 
+// asynchronous pathing; results are ready on the next frame
+int Nav_RequestPath(const PathRequest *request);
+int Nav_PollPath(int handle, PathInfo *info);
+void Nav_CancelPath(int handle);
+
 // life cycle stuff
 void Nav_Load(const char *map_name);
 void Nav_Unload(void);
@@ -66,6 +66,10 @@ typedef struct {
 #define FS_FLAG_TEXT            0x00000400  // open in text mode if from disk
 #define FS_FLAG_DEFLATE         0x00000800  // if compressed, read raw deflate data, fail otherwise
 #define FS_FLAG_LOADFILE        0x00001000  // open non-unique handle, must be closed very quickly
+#define FS_FLAG_MMAP            0x00002000  // LoadFile may return read-only view of pack data that is
+                                            // not NUL terminated, must be freed with FS_FreeFile
+#define FS_FLAG_MMAP_DISK       0x00004000  // with FS_FLAG_MMAP, also map files on disk, which must not
+                                            // be written until the view is freed
 #define FS_FLAG_MASK            0x0000ff00
 
 // where to look for a file (basedir vs homedir)
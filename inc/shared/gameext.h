@@ -65,3 +65,41 @@ typedef struct {
     void (*AddDebugText)(const vec3_t origin, const vec3_t angles, const char *text,
                          float size, color_t color, uint32_t time, qboolean depth_test);
 } debug_draw_api_v1_t;
+
+#define TRACE_API_V1 "TRACE_API_V1"
+
+typedef struct {
+    // same as calling trace() for each start and end pair, but world
+    // is traced by all boxes at once
+    void (*TraceBatch)(trace_t *traces, const vec3_t *starts, const vec3_t *ends, int count,
+                       const vec3_t mins, const vec3_t maxs, edict_t *passent, contents_t contentmask);
+} trace_api_v1_t;
+
+#define PROFILE_API_V1 "PROFILE_API_V1"
+
+typedef struct {
+    // returns zone handle, or -1 if there are too many zones. registering
+    // the same name again returns the same handle.
+    int (*RegisterZone)(const char *name);
+
+    // zones must be properly nested, these do nothing unless com_profile
+    // is enabled
+    void (*BeginZone)(int zone);
+    void (*EndZone)(void);
+} profile_api_v1_t;
+
+#define NAV_API_V1 "NAV_API_V1"
+
+typedef struct {
+    // starts finding path on a worker thread; request is copied and path
+    // points are not returned. returns handle, or 0 if too many requests
+    // are pending, in which case GetPathToGoal should be used instead.
+    int (*RequestPath)(const PathRequest *request);
+
+    // returns 1 and fills in info once path is ready, which frees the
+    // handle. returns 0 if still searching, -1 if handle is no longer
+    // valid. results are always ready on the frame after the request.
+    int (*PollPath)(int handle, PathInfo *info);
+
+    void (*CancelPath)(int handle);
+} nav_api_v1_t;
@@ -166,3 +166,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define q_unused
 
 #endif /* !__GNUC__ */
+
+#ifdef _MSC_VER
+#define q_thread_local      __declspec(thread)
+#elif defined(__cplusplus)
+#define q_thread_local      thread_local
+#else
+#define q_thread_local      _Thread_local
+#endif
@@ -37,6 +37,7 @@ void    Sys_FreeLibrary(void *handle);
 void    *Sys_GetProcAddress(void *handle, const char *sym);
 
 unsigned    Sys_Milliseconds(void);
+uint64_t    Sys_Nanoseconds(void);
 void        Sys_Sleep(int msec);
 
 void    Sys_Init(void);
@@ -78,6 +79,9 @@ void    Sys_Quit(void);
 
 void    Sys_ListFiles_r(listfiles_t *list, const char *path, int depth);
 
+void    *Sys_MapFile(FILE *fp, size_t size);
+void    Sys_UnmapFile(void *base, size_t size);
+
 typedef enum {
     RERELEASE_MODE_NO = 0, // use vanilla game
     RERELEASE_MODE_YES = 1, // use re-release game
@@ -588,7 +588,7 @@ static cgame_entity_import_t cg_entity_import = {
     .Z_Freep = Z_Freep,
 
     .FS_LoadFileEx = FS_LoadFileEx,
-    .FS_FreeFile = Z_Free,
+    .FS_FreeFile = FS_FreeFile,
 
     .CM_BoxTrace = CM_BoxTrace,
     .CM_TransformedBoxTrace = CM_TransformedBoxTrace,
@@ -605,6 +605,7 @@ static cgame_entity_import_t cg_entity_import = {
 
     .V_AddEntity = V_AddEntity,
     .V_AddParticle = V_AddParticle,
+    .V_AddParticles = V_AddParticles,
     .V_AddLight = V_AddLight,
     .V_AddLightEx = V_AddLightEx,
     .V_AddLightStyle = V_AddLightStyle,
@@ -291,6 +291,7 @@ void CL_RegisterSounds(void);
 void CL_RegisterBspModels(void);
 void CL_RegisterVWepModels(void);
 void CL_PrepRenderer(void);
+void CL_PreloadAssets(void);
 void CL_UpdateConfigstring(int index);
 
 //
@@ -377,6 +378,7 @@ void V_Shutdown(void);
 void V_RenderView(void);
 void V_AddEntity(const entity_t *ent);
 bool V_AddParticle(const particle_t *p);
+int V_AddParticles(const particle_t *p, int count);
 void V_AddLightEx(cl_shadow_light_t *light);
 void V_AddLightExVis(cl_shadow_light_t *light, bool strict_pvs);
 void V_AddLight(const vec3_t org, float intensity, float r, float g, float b);
@@ -496,6 +498,9 @@ void CL_BfgParticles(const entity_t *ent);
 void CL_ItemRespawnParticles(const vec3_t org);
 void CL_InitEffects(void);
 void CL_ClearEffects(void);
+#if USE_TESTS
+void CL_ParticleBench_f(void);
+#endif
 void CL_BlasterParticles(const vec3_t org, const vec3_t dir);
 void CL_ExplosionParticles(const vec3_t org);
 void CL_BFGExplosionParticles(const vec3_t org);
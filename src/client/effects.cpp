@@ -1993,3 +1993,29 @@ void CL_InitEffects(void)
 
     cgame_entity->InitEffects();
 }
+
+#if USE_TESTS
+/*
+==============
+CL_ParticleBench_f
+
+Spawns and ages particles in a private cgame pool, without drawing them.
+==============
+*/
+void CL_ParticleBench_f(void)
+{
+    int count = 100000, frames = 100;
+
+    if (!cgame_entity || !cgame_entity->ParticleBench) {
+        Com_Printf("Client game not loaded.\n");
+        return;
+    }
+
+    if (Cmd_Argc() > 1)
+        count = Q_clip(Q_atoi(Cmd_Argv(1)), 1, 1 << 18);
+    if (Cmd_Argc() > 2)
+        frames = Q_clip(Q_atoi(Cmd_Argv(2)), 1, 10000);
+
+    cgame_entity->ParticleBench(count, frames);
+}
+#endif
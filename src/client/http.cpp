@@ -860,6 +860,8 @@ fail2:
             if (rename(dl->path, temp))
                 Com_EPrintf("[HTTP] Failed to rename '%s' to '%s': %s\n",
                             dl->path, dl->queue->path, Q_ErrorString(Q_ERRNO));
+            else
+                FS_NotifyNewFile(temp);
             dl->path[0] = 0;
 
             //a pak file is very special...
@@ -1760,9 +1760,11 @@ void CL_Begin(void)
 
     Cvar_FixCheats();
 
+    CL_PreloadAssets();
     CL_PrepRenderer();
     CL_LoadState(LOAD_SOUNDS);
     CL_RegisterSounds();
+    FS_EndPreload();
     LOC_LoadLocations();
     CL_LoadState(LOAD_NONE);
     cls.state = ca_precached;
@@ -1806,9 +1808,11 @@ static void CL_Precache_f(void)
     // demos use different precache sequence
     if (cls.demo.playback) {
         CL_RegisterBspModels();
+        CL_PreloadAssets();
         CL_PrepRenderer();
         CL_LoadState(LOAD_SOUNDS);
         CL_RegisterSounds();
+        FS_EndPreload();
         CL_LoadState(LOAD_NONE);
         cls.state = ca_precached;
         return;
@@ -2826,6 +2830,9 @@ static const cmdreg_t c_client[] = {
     { "writeconfig", CL_WriteConfig_f, CL_WriteConfig_c },
     { "vid_restart", CL_RestartRenderer_f },
     { "r_reload", CL_ReloadRenderer_f },
+#if USE_TESTS
+    { "particlebench", CL_ParticleBench_f },
+#endif
 
     //
     // forward to server commands
@@ -505,6 +505,103 @@ static void CS_LoadShadowLight(int index, const char *s)
     }
 }
 
+/*
+=================
+CL_PreloadImage
+
+Queues the file renderer would find for this image, trying replacement
+formats before the 8-bit original like it does. Renderer decodes it on
+worker if it can.
+=================
+*/
+static void CL_PreloadImage(const char *base, const char *ext, imagetype_t type)
+{
+#if USE_EXTERNAL_RENDERERS
+    const fs_decoder_t *decoder = re.ImageDecoder;
+#else
+    const fs_decoder_t *decoder = &r_image_decoder;
+#endif
+    void        *arg = (void *)(intptr_t)type;
+    char        path[MAX_QPATH];
+    const char  *s;
+    char        *tok;
+
+    if (Cvar_VariableInteger("r_override_textures") > 0) {
+        s = Cvar_VariableString("r_texture_formats");
+        while (s) {
+            tok = COM_Parse(&s);
+            if (strlen(tok) != 3)
+                continue;
+            if (Q_concat(path, sizeof(path), base, ".", tok) >= sizeof(path))
+                return;
+            if (FS_PreloadFileEx(path, decoder, arg))
+                return;
+        }
+    }
+
+    if (Q_concat(path, sizeof(path), base, ext) < sizeof(path))
+        FS_PreloadFileEx(path, decoder, arg);
+}
+
+/*
+=================
+CL_PreloadAssets
+
+Queues files that CL_PrepRenderer and CL_RegisterSounds are going to load
+to be read ahead, in the same order. Call after CL_RegisterBspModels and
+FS_EndPreload after registration is done.
+=================
+*/
+void CL_PreloadAssets(void)
+{
+    const fs_decoder_t *decoder = S_PreloadDecoder();
+    void    *rate = (void *)(intptr_t)S_GetSampleRate();
+    char    path[MAX_QPATH];
+    char    *name;
+    int     i;
+
+    if (!FS_BeginPreload())
+        return;
+
+    if (cls.ref_initialized && cl.bsp) {
+        for (i = 0; i < cl.bsp->numtexinfo; i++) {
+            Q_concat(path, sizeof(path), "textures/", cl.bsp->texinfo[i].name);
+            CL_PreloadImage(path, ".wal", IT_WALL);
+        }
+
+        for (i = 2; i < cl.csr.max_models; i++) {
+            name = cl.configstrings[cl.csr.models + i];
+            if (!name[0] && i != MODELINDEX_PLAYER)
+                break;
+            if (name[0] && name[0] != '*' && name[0] != '#')
+                FS_PreloadFile(name);
+        }
+
+        // only plain pics, skins and sprites are looked up differently
+        for (i = 1; i < cl.csr.max_images; i++) {
+            name = cl.configstrings[cl.csr.images + i];
+            if (!name[0])
+                break;
+            if (name[0] == '/' || name[0] == '\\' || *COM_FileExtension(name))
+                continue;
+            if (Q_concat(path, sizeof(path), "pics/", name) < sizeof(path))
+                CL_PreloadImage(path, ".pcx", IT_PIC);
+        }
+    }
+
+    for (i = 1; i < cl.csr.max_sounds; i++) {
+        name = cl.configstrings[cl.csr.sounds + i];
+        if (!name[0])
+            break;
+        if (name[0] == '*')
+            continue;
+        if (name[0] == '#')
+            FS_PreloadFileEx(name + 1, decoder, rate);
+        else if (Q_concat(path, sizeof(path), "sound/", name) < sizeof(path))
+            FS_PreloadFileEx(path, decoder, rate);
+    }
+}
+
 /*
 =================
 CL_PrepRenderer
@@ -618,15 +618,19 @@ static renderer_import_t R_BuildRendererImports(void)
         .Cmd_Option_c = Cmd_Option_c,
 
         .FS_LoadFileEx = FS_LoadFileEx,
+        .FS_FreeFile = FS_FreeFile,
+        .FS_ClaimDecoded = FS_ClaimDecoded,
         .FS_OpenFile = FS_OpenFile,
         .FS_EasyOpenFile = FS_EasyOpenFile,
         .FS_Read = FS_Read,
         .FS_CloseFile = FS_CloseFile,
         .FS_FPrintf = FS_FPrintf,
+        .FS_WriteFile = FS_WriteFile,
         .FS_Length = FS_Length,
         .FS_ListFiles = FS_ListFiles,
         .FS_FreeList = FS_FreeList,
         .FS_LastModified = FS_LastModified,
+        .FS_PackSource = FS_PackSource,
         .FS_NormalizePathBuffer = FS_NormalizePathBuffer,
         .FS_CleanupPath = FS_CleanupPath,
         .FS_CreatePath = FS_CreatePath,
@@ -910,7 +910,7 @@ static void AddLoopSounds(void)
         float occ = 0.0f;
         float cutoff = S_OCCLUSION_CUTOFF_CLEAR_HZ;
         if (occlusion_enabled && att > 0.0f)
-            occ = S_ComputeOcclusion(origin, &cutoff);
+            occ = S_GetEntityOcclusion(ent->number, origin, &cutoff);
         occlusion_weighted += occ * contribution;
         if (occ > 0.0f) {
             occlusion_cutoff_weighted += cutoff * occ * contribution;
@@ -942,7 +942,7 @@ static void AddLoopSounds(void)
             occ = 0.0f;
             cutoff = S_OCCLUSION_CUTOFF_CLEAR_HZ;
             if (occlusion_enabled && ent_att > 0.0f)
-                occ = S_ComputeOcclusion(origin, &cutoff);
+                occ = S_GetEntityOcclusion(ent->number, origin, &cutoff);
             occlusion_weighted += occ * contribution;
             if (occ > 0.0f) {
                 occlusion_cutoff_weighted += cutoff * occ * contribution;
@@ -69,6 +69,12 @@ cvar_t      *s_occlusion_strength;
 
 static cvar_t   *s_enable;
 static cvar_t   *s_auto_focus;
+static cvar_t   *s_occlusion_stats;
+
+static void S_InitOcclusion(void);
+static void S_LoadOcclusionClasses(void);
+static void S_FreeOcclusionClasses(void);
+static void S_UpdateOcclusion(void);
 
 // =======================================================================
 // Console functions
@@ -164,6 +170,9 @@ void S_Init(void)
     s_num_channels = Cvar_Get("s_num_channels", "64", CVAR_SOUND);
     s_occlusion = Cvar_Get("s_occlusion", "0", CVAR_ARCHIVE);
     s_occlusion_strength = Cvar_Get("s_occlusion_strength", "1.0", CVAR_ARCHIVE);
+    s_occlusion_stats = Cvar_Get("s_occlusion_stats", "0", 0);
+
+    S_InitOcclusion();
 
     s_maxchannels = Cvar_ClampInteger(s_num_channels, 16, 256);
     s_channels = static_cast<channel_t *>(Z_TagMalloc(sizeof(*s_channels) * s_maxchannels, TAG_SOUND));
@@ -258,6 +267,8 @@ void S_Shutdown(void)
     s_channels = NULL;
     s_maxchannels = 0;
 
+    S_FreeOcclusionClasses();
+
     s_api->shutdown();
     s_api = NULL;
 
@@ -546,6 +557,10 @@ void S_EndRegistration(void)
     if (s_started && s_api->end_registration)
         s_api->end_registration();
 
+    // footstep materials have been loaded by now
+    if (s_started)
+        S_LoadOcclusionClasses();
+
     s_registering = false;
 }
 
@@ -944,6 +959,350 @@ void S_SpatializeOrigin(const vec3_t origin, float master_vol, float dist_mult,
         *left_vol = 0;
 }
 
+// =======================================================================
+// Occlusion
+// =======================================================================
+
+// surface classes, bit N of a class mask is s_occlusion_classdefs[N]
+static const char *const s_glass_keys[] = { "glass", "window", NULL };
+static const char *const s_grate_keys[] = { "grate", "grid", "vent", "fence", NULL };
+static const char *const s_soft_keys[] = { "cloth", "fabric", "carpet", "dirt", "mud", "snow", NULL };
+static const char *const s_wood_keys[] = { "wood", NULL };
+static const char *const s_metal_keys[] = { "metal", "steel", "iron", NULL };
+static const char *const s_concrete_keys[] = { "concrete", "cement", "stone", "rock", "brick", NULL };
+
+static const struct {
+    const char          *name;
+    const char *const   *keys;      // material substrings
+    float               weight;
+    float               cutoff_hz;
+} s_occlusion_classdefs[] = {
+    { "glass",      s_glass_keys,       S_OCCLUSION_GLASS_WEIGHT,       S_OCCLUSION_CUTOFF_GLASS_HZ },
+    { "grate",      s_grate_keys,       S_OCCLUSION_GRATE_WEIGHT,       S_OCCLUSION_CUTOFF_GRATE_HZ },
+    { "soft",       s_soft_keys,        S_OCCLUSION_SOFT_WEIGHT,        S_OCCLUSION_CUTOFF_SOFT_HZ },
+    { "wood",       s_wood_keys,        S_OCCLUSION_WOOD_WEIGHT,        S_OCCLUSION_CUTOFF_WOOD_HZ },
+    { "metal",      s_metal_keys,       S_OCCLUSION_METAL_WEIGHT,       S_OCCLUSION_CUTOFF_METAL_HZ },
+    { "concrete",   s_concrete_keys,    S_OCCLUSION_CONCRETE_WEIGHT,    S_OCCLUSION_CUTOFF_CONCRETE_HZ },
+    { "window",     NULL,               S_OCCLUSION_WINDOW_WEIGHT,      S_OCCLUSION_CUTOFF_GLASS_HZ },
+};
+
+// translucent surfaces and window brushes
+#define S_OCC_WINDOW    BIT(6)
+
+#define S_OCC_NUM_MASKS BIT(q_countof(s_occlusion_classdefs))
+
+static_assert(q_countof(s_occlusion_classdefs) == 7, "S_OCC_WINDOW out of sync");
+
+// combined weight and cutoff of each class mask
+static struct {
+    float   weight;
+    float   cutoff_hz;
+} s_occlusion_params[S_OCC_NUM_MASKS];
+
+// class mask of each texinfo of s_occlusion_bsp
+static byte         *s_occlusion_classes;
+static const bsp_t  *s_occlusion_bsp;
+
+// bumped when the listener moves or an area portal changes state, which
+// invalidates all cached traces
+static unsigned     s_occlusion_epoch = 1;
+static vec3_t       s_occlusion_origin;
+static vec3_t       s_occlusion_right;
+static vec3_t       s_occlusion_up;
+static uint32_t     s_occlusion_world;
+
+// looping sounds aren't tied to channels, so their results are kept here
+static occlusion_cache_t    s_entity_occlusion[MAX_EDICTS];
+
+static struct {
+    unsigned    frames;
+    unsigned    lookups;
+    unsigned    traces;
+    unsigned    probes;
+    uint64_t    time_ns;
+    unsigned    start;
+} s_occlusion_perf;
+
+static void S_InitOcclusion(void)
+{
+    for (unsigned mask = 0; mask < S_OCC_NUM_MASKS; mask++) {
+        float weight = 1.0f;
+        float cutoff_hz = S_OCCLUSION_CUTOFF_DEFAULT_HZ;
+
+        for (size_t i = 0; i < q_countof(s_occlusion_classdefs); i++) {
+            if (mask & BIT(i)) {
+                weight = min(weight, s_occlusion_classdefs[i].weight);
+                cutoff_hz = min(cutoff_hz, s_occlusion_classdefs[i].cutoff_hz);
+            }
+        }
+
+        s_occlusion_params[mask].weight = Q_clipf(weight, 0.0f, 1.0f);
+        s_occlusion_params[mask].cutoff_hz = Q_clipf(cutoff_hz, S_OCCLUSION_CUTOFF_MIN_HZ, S_OCCLUSION_CUTOFF_CLEAR_HZ);
+    }
+}
+
+static int S_ClassifySurface(const char *material, int flags)
+{
+    int mask = 0;
+
+    if (material && material[0]) {
+        for (size_t i = 0; i < q_countof(s_occlusion_classdefs); i++) {
+            const char *const *key = s_occlusion_classdefs[i].keys;
+            for (; key && *key; key++) {
+                if (Q_stristr(material, *key)) {
+                    mask |= BIT(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (flags & (SURF_TRANS33 | SURF_TRANS66))
+        mask |= S_OCC_WINDOW;
+
+    return mask;
+}
+
+/*
+=================
+S_LoadOcclusionOverrides
+
+Each line of maps/<mapname>.occlusion is a texture name, which may contain
+wildcards, followed by the classes its surfaces belong to. Later lines take
+precedence.
+=================
+*/
+static void S_LoadOcclusionOverrides(const bsp_t *bsp)
+{
+    char path[MAX_QPATH], pattern[MAX_QPATH];
+    char *raw, *data, *p;
+    const char *line, *tok;
+    int len, linenum, rules;
+
+    if (COM_StripExtension(path, bsp->name, sizeof(path)) >= sizeof(path) ||
+        Q_strlcat(path, ".occlusion", sizeof(path)) >= sizeof(path))
+        return;
+
+    len = FS_LoadFile(path, (void **)&raw);
+    if (!raw) {
+        if (len != Q_ERR(ENOENT))
+            Com_EPrintf("Couldn't load %s: %s\n", path, Q_ErrorString(len));
+        return;
+    }
+
+    rules = 0;
+    linenum = 1;
+    data = raw;
+
+    while (*data) {
+        p = strchr(data, '\n');
+        if (p)
+            *p = 0;
+
+        line = data;
+        tok = COM_Parse(&line);
+        if (*tok) {
+            int mask = 0;
+
+            Q_strlcpy(pattern, tok, sizeof(pattern));
+            while (*(tok = COM_Parse(&line))) {
+                size_t i;
+                for (i = 0; i < q_countof(s_occlusion_classdefs); i++)
+                    if (!Q_stricmp(tok, s_occlusion_classdefs[i].name))
+                        break;
+                if (i < q_countof(s_occlusion_classdefs))
+                    mask |= BIT(i);
+                else if (Q_stricmp(tok, "none"))
+                    Com_WPrintf("%s:%d: unknown occlusion class \"%s\"\n", path, linenum, tok);
+            }
+
+            // translucent surfaces stay see-through
+            for (int i = 0; i < bsp->numtexinfo; i++)
+                if (Com_WildCmpEx(pattern, bsp->texinfo[i].name, 0, true))
+                    s_occlusion_classes[i] = mask | (s_occlusion_classes[i] & S_OCC_WINDOW);
+            rules++;
+        }
+
+        if (!p)
+            break;
+
+        data = p + 1;
+        linenum++;
+    }
+
+    Com_DPrintf("Loaded %d occlusion overrides from %s\n", rules, path);
+
+    FS_FreeFile(raw);
+}
+
+static void S_FreeOcclusionClasses(void)
+{
+    Z_Freep(&s_occlusion_classes);
+    s_occlusion_bsp = NULL;
+}
+
+/*
+=================
+S_LoadOcclusionClasses
+
+Classifies every surface of the current map once, so traces only need
+a table lookup.
+=================
+*/
+static void S_LoadOcclusionClasses(void)
+{
+    const bsp_t *bsp = cl.bsp;
+
+    S_FreeOcclusionClasses();
+
+    memset(s_entity_occlusion, 0, sizeof(s_entity_occlusion));
+    if (!++s_occlusion_epoch)
+        s_occlusion_epoch = 1;
+
+    if (!bsp || bsp->numtexinfo <= 0)
+        return;
+
+    s_occlusion_classes = static_cast<byte *>(S_Malloc(bsp->numtexinfo));
+    for (int i = 0; i < bsp->numtexinfo; i++) {
+        const mtexinfo_t *tex = &bsp->texinfo[i];
+        s_occlusion_classes[i] = S_ClassifySurface(tex->c.material, tex->c.flags);
+    }
+
+    S_LoadOcclusionOverrides(bsp);
+
+    s_occlusion_bsp = bsp;
+}
+
+static int S_SurfaceOcclusionClass(const csurface_t *surf)
+{
+    if (!surf)
+        return 0;
+
+    // csurface_t is the first member of mtexinfo_t
+    if (s_occlusion_bsp && s_occlusion_bsp == cl.bsp) {
+        const mtexinfo_t *tex = reinterpret_cast<const mtexinfo_t *>(surf);
+        const mtexinfo_t *first = s_occlusion_bsp->texinfo;
+
+        if (tex >= first && tex < first + s_occlusion_bsp->numtexinfo)
+            return s_occlusion_classes[tex - first];
+    }
+
+    return S_ClassifySurface(surf->material, surf->flags);
+}
+
+static uint32_t S_HashBytes(uint32_t hash, const void *data, size_t len)
+{
+    const byte *b = static_cast<const byte *>(data);
+
+    while (len--)
+        hash = (hash ^ *b++) * 16777619u;
+
+    return hash;
+}
+
+// changes when an area portal opens or closes
+static uint32_t S_OcclusionWorldKey(void)
+{
+    return S_HashBytes(2166136261u, cl.frame.areabits, cl.frame.areabytes);
+}
+
+// changes when a brush model that may block traces between listener and
+// source moves; moving ones elsewhere in the map don't affect the result
+static uint32_t S_OcclusionBmodelKey(const vec3_t origin)
+{
+    const float pad = S_OCCLUSION_RADIUS_MAX + S_OCCLUSION_MOVE_EPSILON;
+    uint32_t hash = 2166136261u;
+    vec3_t mins, maxs, bmins, bmaxs;
+
+    ClearBounds(mins, maxs);
+    AddPointToBounds(listener_origin, mins, maxs);
+    AddPointToBounds(origin, mins, maxs);
+    for (int i = 0; i < 3; i++) {
+        mins[i] -= pad;
+        maxs[i] += pad;
+    }
+
+    for (int i = 0; i < cl.numSolidEntities; i++) {
+        const centity_t *ent = cl.solidEntities[i];
+
+        if (ent->current.solid != PACKED_BSP)
+            continue;
+
+        const mmodel_t *cmodel = cl.model_clip[ent->current.modelindex];
+        if (!cmodel)
+            continue;
+
+        if (VectorEmpty(ent->current.angles)) {
+            VectorAdd(ent->current.origin, cmodel->mins, bmins);
+            VectorAdd(ent->current.origin, cmodel->maxs, bmaxs);
+        } else {
+            float radius = RadiusFromBounds(cmodel->mins, cmodel->maxs);
+            for (int j = 0; j < 3; j++) {
+                bmins[j] = ent->current.origin[j] - radius;
+                bmaxs[j] = ent->current.origin[j] + radius;
+            }
+        }
+
+        if (!IntersectBounds(mins, maxs, bmins, bmaxs))
+            continue;
+
+        hash = S_HashBytes(hash, &ent->current.number, sizeof(ent->current.number));
+        hash = S_HashBytes(hash, ent->current.origin, sizeof(ent->current.origin));
+        hash = S_HashBytes(hash, ent->current.angles, sizeof(ent->current.angles));
+    }
+
+    return hash;
+}
+
+/*
+=================
+S_UpdateOcclusion
+
+Called once per frame before channels are spatialized.
+=================
+*/
+static void S_UpdateOcclusion(void)
+{
+    if (s_occlusion->integer && cl.bsp && cls.state == ca_active) {
+        uint32_t world = S_OcclusionWorldKey();
+
+        // probes are offset along listener axes, so turning moves them too
+        if (world != s_occlusion_world ||
+            DistanceSquared(listener_origin, s_occlusion_origin) > S_OCCLUSION_MOVE_EPSILON * S_OCCLUSION_MOVE_EPSILON ||
+            DotProduct(listener_right, s_occlusion_right) < S_OCCLUSION_TURN_COS ||
+            DotProduct(listener_up, s_occlusion_up) < S_OCCLUSION_TURN_COS) {
+            if (!++s_occlusion_epoch)
+                s_occlusion_epoch = 1;
+            s_occlusion_world = world;
+            VectorCopy(listener_origin, s_occlusion_origin);
+            VectorCopy(listener_right, s_occlusion_right);
+            VectorCopy(listener_up, s_occlusion_up);
+        }
+    }
+
+    if (!s_occlusion_stats->integer) {
+        s_occlusion_perf.start = 0;
+        return;
+    }
+
+    unsigned now = Sys_Milliseconds();
+    if (!s_occlusion_perf.start) {
+        memset(&s_occlusion_perf, 0, sizeof(s_occlusion_perf));
+        s_occlusion_perf.start = now;
+    }
+
+    if (now - s_occlusion_perf.start >= 1000 && s_occlusion_perf.frames) {
+        float frames = s_occlusion_perf.frames;
+        Com_Printf("occlusion: %.1f lookups, %.1f traced, %.1f probes, %.3f ms per frame\n",
+                   s_occlusion_perf.lookups / frames, s_occlusion_perf.traces / frames,
+                   s_occlusion_perf.probes / frames, s_occlusion_perf.time_ns * 1e-6f / frames);
+        memset(&s_occlusion_perf, 0, sizeof(s_occlusion_perf));
+        s_occlusion_perf.start = now;
+    }
+
+    s_occlusion_perf.frames++;
+}
+
 float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz)
 {
     if (cutoff_hz)
@@ -960,13 +1319,6 @@ float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz)
         { 0.0f, -1.0f, 0.0f }
     };
 
-    static const char *const concrete_keys[] = { "concrete", "cement", "stone", "rock", "brick" };
-    static const char *const metal_keys[] = { "metal", "steel", "iron" };
-    static const char *const wood_keys[] = { "wood" };
-    static const char *const soft_keys[] = { "cloth", "fabric", "carpet", "dirt", "mud", "snow" };
-    static const char *const grate_keys[] = { "grate", "grid", "vent", "fence" };
-    static const char *const glass_keys[] = { "glass", "window" };
-
     vec3_t to_source;
     VectorSubtract(origin, listener_origin, to_source);
     float distance = VectorLength(to_source);
@@ -981,6 +1333,8 @@ float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz)
     float cutoff_weighted = 0.0f;
     float cutoff_weight_total = 0.0f;
 
+    s_occlusion_perf.traces++;
+
     for (size_t i = 0; i < q_countof(probe_offsets); i++) {
         const float ray_weight = (i == 0) ? 1.0f : S_OCCLUSION_DIFFRACTION_WEIGHT;
         total_weight += ray_weight;
@@ -995,64 +1349,16 @@ float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz)
 
         trace_t tr;
         CL_Trace(&tr, start, end, vec3_origin, vec3_origin, NULL, MASK_SOLID);
+        s_occlusion_perf.probes++;
         if (tr.fraction >= 1.0f)
             continue;
 
-        float material_weight = 1.0f;
-        float material_cutoff = S_OCCLUSION_CUTOFF_DEFAULT_HZ;
-
-        bool translucent = (tr.contents & CONTENTS_WINDOW) != 0;
-        if (tr.surface) {
-            translucent = translucent || (tr.surface->flags & (SURF_TRANS33 | SURF_TRANS66));
+        int mask = S_SurfaceOcclusionClass(tr.surface);
+        if (tr.contents & CONTENTS_WINDOW)
+            mask |= S_OCC_WINDOW;
 
-            const char *material = tr.surface->material;
-            if (material && material[0]) {
-                for (size_t k = 0; k < q_countof(glass_keys); k++) {
-                    if (Q_stristr(material, glass_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_GLASS_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_GLASS_HZ);
-                    }
-                }
-                for (size_t k = 0; k < q_countof(grate_keys); k++) {
-                    if (Q_stristr(material, grate_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_GRATE_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_GRATE_HZ);
-                    }
-                }
-                for (size_t k = 0; k < q_countof(soft_keys); k++) {
-                    if (Q_stristr(material, soft_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_SOFT_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_SOFT_HZ);
-                    }
-                }
-                for (size_t k = 0; k < q_countof(wood_keys); k++) {
-                    if (Q_stristr(material, wood_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_WOOD_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_WOOD_HZ);
-                    }
-                }
-                for (size_t k = 0; k < q_countof(metal_keys); k++) {
-                    if (Q_stristr(material, metal_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_METAL_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_METAL_HZ);
-                    }
-                }
-                for (size_t k = 0; k < q_countof(concrete_keys); k++) {
-                    if (Q_stristr(material, concrete_keys[k])) {
-                        material_weight = min(material_weight, S_OCCLUSION_CONCRETE_WEIGHT);
-                        material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_CONCRETE_HZ);
-                    }
-                }
-            }
-        }
-
-        if (translucent) {
-            material_weight = min(material_weight, S_OCCLUSION_WINDOW_WEIGHT);
-            material_cutoff = min(material_cutoff, S_OCCLUSION_CUTOFF_GLASS_HZ);
-        }
-
-        material_weight = Q_clipf(material_weight, 0.0f, 1.0f);
-        material_cutoff = Q_clipf(material_cutoff, S_OCCLUSION_CUTOFF_MIN_HZ, S_OCCLUSION_CUTOFF_CLEAR_HZ);
+        float material_weight = s_occlusion_params[mask].weight;
+        float material_cutoff = s_occlusion_params[mask].cutoff_hz;
 
         float weighted_hit = ray_weight * material_weight;
         blocked_weight += weighted_hit;
@@ -1075,6 +1381,44 @@ float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz)
     return Q_clipf(blocked_weight / total_weight, 0.0f, 1.0f);
 }
 
+// traces again only if the source or a nearby brush model moved or the
+// cache was invalidated, and no more often than every S_OCCLUSION_UPDATE_MS
+static float S_CachedOcclusion(occlusion_cache_t *cache, const vec3_t origin, float *cutoff_hz)
+{
+    uint32_t bmodels = S_OcclusionBmodelKey(origin);
+
+    s_occlusion_perf.lookups++;
+
+    if (cache->epoch != s_occlusion_epoch || cache->bmodels != bmodels ||
+        DistanceSquared(cache->origin, origin) > S_OCCLUSION_MOVE_EPSILON * S_OCCLUSION_MOVE_EPSILON) {
+        if (!cache->epoch || cl.time < cache->time || cl.time - cache->time >= S_OCCLUSION_UPDATE_MS) {
+            uint64_t start = s_occlusion_stats->integer ? Sys_Nanoseconds() : 0;
+
+            cache->occlusion = S_ComputeOcclusion(origin, &cache->cutoff_hz);
+            VectorCopy(origin, cache->origin);
+            cache->epoch = s_occlusion_epoch;
+            cache->bmodels = bmodels;
+            cache->time = cl.time;
+
+            if (start)
+                s_occlusion_perf.time_ns += Sys_Nanoseconds() - start;
+        }
+    }
+
+    if (cutoff_hz)
+        *cutoff_hz = cache->cutoff_hz;
+
+    return cache->occlusion;
+}
+
+float S_GetEntityOcclusion(int entnum, const vec3_t origin, float *cutoff_hz)
+{
+    if (entnum < 0 || entnum >= MAX_EDICTS)
+        return S_ComputeOcclusion(origin, cutoff_hz);
+
+    return S_CachedOcclusion(&s_entity_occlusion[entnum], origin, cutoff_hz);
+}
+
 void S_ResetOcclusion(channel_t *ch)
 {
     if (!ch)
@@ -1082,7 +1426,7 @@ void S_ResetOcclusion(channel_t *ch)
 
     ch->occlusion = 0.0f;
     ch->occlusion_target = 0.0f;
-    ch->occlusion_time = 0;
+    memset(&ch->occlusion_cache, 0, sizeof(ch->occlusion_cache));
     ch->occlusion_mix = 0.0f;
     ch->occlusion_cutoff = S_OCCLUSION_CUTOFF_CLEAR_HZ;
     ch->occlusion_cutoff_target = S_OCCLUSION_CUTOFF_CLEAR_HZ;
@@ -1122,13 +1466,7 @@ float S_GetOcclusion(channel_t *ch, const vec3_t origin)
         return 0.0f;
     }
 
-    if (!ch->occlusion_time || (cl.time - ch->occlusion_time) >= S_OCCLUSION_UPDATE_MS) {
-        float cutoff_hz = S_OCCLUSION_CUTOFF_CLEAR_HZ;
-        float target = S_ComputeOcclusion(origin, &cutoff_hz);
-        ch->occlusion_cutoff_target = cutoff_hz;
-        ch->occlusion_target = target;
-        ch->occlusion_time = cl.time;
-    }
+    ch->occlusion_target = S_CachedOcclusion(&ch->occlusion_cache, origin, &ch->occlusion_cutoff_target);
 
     return S_SmoothOcclusion(ch, ch->occlusion_target);
 }
@@ -1185,6 +1523,8 @@ void S_Update(void)
 
     OGG_Update();
 
+    S_UpdateOcclusion();
+
     s_api->update();
 }
 
@@ -24,6 +24,34 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 wavinfo_t s_info;
 
+// set while decoding on preload worker, where samples are malloc'd and
+// nothing can be printed
+static q_thread_local bool s_on_worker;
+static q_thread_local bool s_warned;
+
+static byte *S_AllocSamples(size_t size)
+{
+    if (s_on_worker)
+        return static_cast<byte *>(malloc(size));
+    return static_cast<byte *>(FS_AllocTempMem(size));
+}
+
+static void S_FreeSamples(byte *data)
+{
+    if (s_on_worker)
+        free(data);
+    else
+        FS_FreeTempMem(data);
+}
+
+// worker result is discarded then, main thread decodes again and prints
+static bool S_DeferWarning(void)
+{
+    if (s_on_worker)
+        s_warned = true;
+    return s_on_worker;
+}
+
 /*
 ===============================================================================
 
@@ -81,7 +109,7 @@ static int64_t sz_seek(void *opaque, int64_t offset, int whence)
     return sz->readcount;
 }
 
-static bool OGG_Load(sizebuf_t *sz)
+static bool OGG_Load(sizebuf_t *sz, wavinfo_t *info, int sample_rate)
 {
     AVFormatContext *fmt_ctx = NULL;
     AVIOContext *avio_ctx = NULL;
@@ -93,7 +121,7 @@ static bool OGG_Load(sizebuf_t *sz)
     AVCodecContext *dec_ctx = NULL;
     AVStream *st;
     bool res = false;
-    int ret, sample_rate;
+    int ret;
     int64_t nb_samples = 0;
     int bufsize = 0;
     int offset = 0;
@@ -193,7 +221,6 @@ static bool OGG_Load(sizebuf_t *sz)
         goto fail;
     }
 
-    sample_rate = S_GetSampleRate();
     if (!sample_rate)
         sample_rate = dec_ctx->sample_rate;
 
@@ -221,11 +248,15 @@ static bool OGG_Load(sizebuf_t *sz)
     offset = 0;
     eof = false;
 
-    s_info.channels = out->ch_layout.nb_channels;
-    s_info.rate = out->sample_rate;
-    s_info.width = 2;
-    s_info.loopstart = -1;
-    s_info.data = static_cast<byte *>(FS_AllocTempMem(bufsize));
+    info->channels = out->ch_layout.nb_channels;
+    info->rate = out->sample_rate;
+    info->width = 2;
+    info->loopstart = -1;
+    info->data = S_AllocSamples(bufsize);
+    if (!info->data) {
+        Com_SetLastError("Failed to allocate memory");
+        goto fail;
+    }
 
     while (!eof) {
         ret = avcodec_receive_frame(dec_ctx, frame);
@@ -259,17 +290,18 @@ static bool OGG_Load(sizebuf_t *sz)
             eof = true;
         }
 
-        memcpy(s_info.data + offset, out->data[0], size);
+        memcpy(info->data + offset, out->data[0], size);
         offset += size;
     }
 
     if (ret < 0) {
         Com_SetLastError(av_err2str(ret));
-        Z_Freep(&s_info.data);
+        S_FreeSamples(info->data);
+        info->data = NULL;
         goto fail;
     }
 
-    s_info.samples = offset >> s_info.channels;
+    info->samples = offset >> info->channels;
     res = true;
 
 fail:
@@ -320,16 +352,16 @@ static int FindChunk(sizebuf_t *sz, uint32_t search)
     return 0;
 }
 
-static bool GetWavinfo(sizebuf_t *sz)
+static bool GetWavinfo(sizebuf_t *sz, wavinfo_t *info, int sample_rate)
 {
     int tag, samples, width, chunk_len, next_chunk;
 
     tag = SZ_ReadLong(sz);
 
 #if USE_AVCODEC
-    if (tag == MakeLittleLong('O','g','g','S') || !COM_CompareExtension(s_info.name, ".ogg")) {
+    if (tag == MakeLittleLong('O','g','g','S') || !COM_CompareExtension(info->name, ".ogg")) {
         sz->readcount = 0;
-        return OGG_Load(sz);
+        return OGG_Load(sz, info, sample_rate);
     }
 #endif
 
@@ -354,20 +386,20 @@ static bool GetWavinfo(sizebuf_t *sz)
         return false;
     }
 
-    s_info.format = SZ_ReadShort(sz);
-    if (s_info.format != FORMAT_PCM) {
+    info->format = SZ_ReadShort(sz);
+    if (info->format != FORMAT_PCM) {
         Com_SetLastError("Unsupported PCM format");
         return false;
     }
 
-    s_info.channels = SZ_ReadShort(sz);
-    if (s_info.channels < 1 || s_info.channels > 2) {
+    info->channels = SZ_ReadShort(sz);
+    if (info->channels < 1 || info->channels > 2) {
         Com_SetLastError("Unsupported number of channels");
         return false;
     }
 
-    s_info.rate = SZ_ReadLong(sz);
-    if (s_info.rate < 6000 || s_info.rate > 48000) {
+    info->rate = SZ_ReadLong(sz);
+    if (info->rate < 6000 || info->rate > 48000) {
         Com_SetLastError("Unsupported sample rate");
         return false;
     }
@@ -378,7 +410,7 @@ static bool GetWavinfo(sizebuf_t *sz)
     case 8:
     case 16:
     case 24:
-        s_info.width = width / 8;
+        info->width = width / 8;
         break;
     default:
         Com_SetLastError("Unsupported number of bits per sample");
@@ -394,19 +426,19 @@ static bool GetWavinfo(sizebuf_t *sz)
     }
 
 // calculate length in samples
-    s_info.samples = chunk_len / (s_info.width * s_info.channels);
-    if (s_info.samples < 1) {
+    info->samples = chunk_len / (info->width * info->channels);
+    if (info->samples < 1) {
         Com_SetLastError("No samples");
         return false;
     }
-    if (s_info.samples > MAX_SFX_SAMPLES) {
+    if (info->samples > MAX_SFX_SAMPLES) {
         Com_SetLastError("Too many samples");
         return false;
     }
 
 // any errors are non-fatal from this point
-    s_info.data = sz->data + sz->readcount;
-    s_info.loopstart = -1;
+    info->data = sz->data + sz->readcount;
+    info->loopstart = -1;
 
 // find "cue " chunk
     sz->readcount = next_chunk;
@@ -420,11 +452,12 @@ static bool GetWavinfo(sizebuf_t *sz)
 
     sz->readcount += 24;
     samples = SZ_ReadLong(sz);
-    if (samples < 0 || samples >= s_info.samples) {
-        Com_DPrintf("%s has bad loop start\n", s_info.name);
+    if (samples < 0 || samples >= info->samples) {
+        if (!S_DeferWarning())
+            Com_DPrintf("%s has bad loop start\n", info->name);
         return true;
     }
-    s_info.loopstart = samples;
+    info->loopstart = samples;
 
 // if the next chunk is a "LIST" chunk, look for a cue length marker
     sz->readcount = next_chunk;
@@ -440,36 +473,107 @@ static bool GetWavinfo(sizebuf_t *sz)
 // this is not a proper parse, but it works with cooledit...
     sz->readcount -= 8;
     samples = SZ_ReadLong(sz);  // samples in loop
-    if (samples < 1 || samples > s_info.samples - s_info.loopstart) {
-        Com_DPrintf("%s has bad loop length\n", s_info.name);
+    if (samples < 1 || samples > info->samples - info->loopstart) {
+        if (!S_DeferWarning())
+            Com_DPrintf("%s has bad loop length\n", info->name);
         return true;
     }
-    s_info.samples = s_info.loopstart + samples;
+    info->samples = info->loopstart + samples;
 
     return true;
 }
 
-static void ConvertSamples(void)
+static void ConvertSamples(wavinfo_t *info)
 {
-    uint16_t *data = (uint16_t *)s_info.data;
-    int count = s_info.samples * s_info.channels;
+    uint16_t *data = (uint16_t *)info->data;
+    int count = info->samples * info->channels;
 
 // sigh. truncate 24 bit to 16
-    if (s_info.width == 3) {
+    if (info->width == 3) {
         for (int i = 0; i < count; i++)
-            data[i] = RL32(&s_info.data[i * 3]) >> 8;
-        s_info.width = 2;
+            data[i] = RL32(&info->data[i * 3]) >> 8;
+        info->width = 2;
         return;
     }
 
 #if USE_BIG_ENDIAN
-    if (s_info.width == 2) {
+    if (info->width == 2) {
         for (int i = 0; i < count; i++)
             data[i] = LittleShort(data[i]);
     }
 #endif
 }
 
+/*
+==============
+S_DecodeAhead
+
+Runs on preload worker for sounds client queued with S_PreloadDecoder, with
+output sample rate passed as argument. Result is wavinfo_t with samples
+copied and converted, anything that would print is decoded again on main
+thread.
+==============
+*/
+static void *S_DecodeAhead(const char *path, const void *data, size_t len,
+                           void *arg, size_t *size)
+{
+    wavinfo_t   info{};
+    wavinfo_t   *d;
+    sizebuf_t   sz;
+    bool        ok;
+
+    info.name = const_cast<char *>(path);
+    SZ_InitRead(&sz, data, len);
+
+    s_on_worker = true;
+    s_warned = false;
+    ok = GetWavinfo(&sz, &info, (int)(intptr_t)arg);
+
+    // samples point into file, which may be mapped read only
+    if (ok && info.format == FORMAT_PCM) {
+        size_t bytes = (size_t)info.samples * info.width * info.channels;
+        byte *copy = S_AllocSamples(bytes);
+        if (copy) {
+            memcpy(copy, info.data, bytes);
+            ConvertSamples(&info);
+        }
+        info.data = copy;
+        ok = copy != NULL;
+    }
+
+    d = ok && !s_warned ? static_cast<wavinfo_t *>(malloc(sizeof(*d))) : NULL;
+    if (!d) {
+        if (ok)
+            S_FreeSamples(info.data);
+        s_on_worker = false;
+        return NULL;
+    }
+    s_on_worker = false;
+
+    *d = info;
+    d->name = NULL;
+    *size = sizeof(*d) + (size_t)info.samples * info.width * info.channels;
+    return d;
+}
+
+static void S_FreeDecoded(void *decoded)
+{
+    wavinfo_t *d = static_cast<wavinfo_t *>(decoded);
+
+    free(d->data);
+    free(d);
+}
+
+static const fs_decoder_t s_decoder = {
+    S_DecodeAhead,
+    S_FreeDecoded,
+};
+
+const fs_decoder_t *S_PreloadDecoder(void)
+{
+    return s_started ? &s_decoder : NULL;
+}
+
 // ===============================================================================
 
 /*
@@ -482,6 +586,7 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     sizebuf_t   sz;
     byte        *data;
     sfxcache_t  *sc;
+    wavinfo_t   *decoded;
     int         len;
     char        *name;
 
@@ -503,6 +608,18 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     else
         name = s->name;
 
+    // upload only if preload worker decoded it already
+    decoded = static_cast<wavinfo_t *>(FS_ClaimDecoded(name, &s_decoder));
+    if (decoded) {
+        s_info = *decoded;
+        s_info.name = name;
+        sc = s_api->upload_sfx(s);
+        if (!sc)
+            Com_EPrintf("Couldn't load %s: %s\n", Com_MakePrintable(name), Com_GetLastError());
+        S_FreeDecoded(decoded);
+        return sc;
+    }
+
     len = FS_LoadFile(name, (void **)&data);
     if (!data) {
         if (len != Q_ERR(ENOENT))
@@ -516,13 +633,13 @@ sfxcache_t *S_LoadSound(sfx_t *s)
 
     SZ_InitRead(&sz, data, len);
 
-    if (!GetWavinfo(&sz)) {
+    if (!GetWavinfo(&sz, &s_info, S_GetSampleRate())) {
         s->error = Q_ERR_INVALID_FORMAT;
         goto fail;
     }
 
     if (s_info.format == FORMAT_PCM)
-        ConvertSamples();
+        ConvertSamples(&s_info);
 
     sc = s_api->upload_sfx(s);
 
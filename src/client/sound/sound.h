@@ -33,6 +33,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define S_OCCLUSION_LOWPASS_Q       0.707f
 #define S_OCCLUSION_AL_GAINHF       0.08f
 #define S_OCCLUSION_UPDATE_MS       50
+#define S_OCCLUSION_MOVE_EPSILON    8.0f
+#define S_OCCLUSION_TURN_COS        0.95f
 #define S_OCCLUSION_CLEAR_MARGIN    0.1f
 #define S_OCCLUSION_ATTACK_RATE     25.0f
 #define S_OCCLUSION_RELEASE_RATE    8.0f
@@ -105,6 +107,17 @@ typedef struct {
     int         begin;          // begin on this sample
 } playsound_t;
 
+// result of the last occlusion trace for one source, reused until the
+// source, the listener or a door between them moves
+typedef struct {
+    vec3_t      origin;         // source origin when last traced
+    unsigned    epoch;          // s_occlusion_epoch when last traced, 0 if never
+    uint32_t    bmodels;        // brush models near the traces when last traced
+    int         time;           // cl.time when last traced
+    float       occlusion;
+    float       cutoff_hz;
+} occlusion_cache_t;
+
 #if USE_SNDDMA
 typedef struct {
     float   b0, b1, b2;
@@ -128,7 +141,7 @@ typedef struct {
     bool        no_merge;       // bypass loop merging for this channel
     float       occlusion;      // 0.0-1.0 smoothed occlusion factor
     float       occlusion_target;
-    int         occlusion_time;
+    occlusion_cache_t occlusion_cache;
     float       occlusion_mix;
     float       occlusion_cutoff;
     float       occlusion_cutoff_target;
@@ -251,6 +264,7 @@ void S_SpatializeOrigin(const vec3_t origin, float master_vol, float dist_mult,
 const qboolean S_SetEAXEnvironmentProperties(const sfx_eax_properties_t *properties);
 float S_GetEntityLoopDistMult(const entity_state_t *ent);
 float S_GetOcclusion(channel_t *ch, const vec3_t origin);
+float S_GetEntityOcclusion(int entnum, const vec3_t origin, float *cutoff_hz);
 float S_SmoothOcclusion(channel_t *ch, float target);
 float S_ComputeOcclusion(const vec3_t origin, float *cutoff_hz);
 float S_MapOcclusion(float occlusion);
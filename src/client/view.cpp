@@ -270,6 +270,23 @@ bool V_AddParticle(const particle_t *p)
     return true;
 }
 
+/*
+=====================
+V_AddParticles
+
+Adds as many of count particles as fit, returns how many did.
+=====================
+*/
+int V_AddParticles(const particle_t *p, int count)
+{
+    count = min(count, MAX_PARTICLES - r_numparticles);
+    if (count <= 0)
+        return 0;
+    memcpy(r_particles + r_numparticles, p, sizeof(*p) * count);
+    r_numparticles += count;
+    return count;
+}
+
 static void cone_to_bounding_sphere(const vec3_t origin, const vec3_t forward, float size, float angle_radians, float c, float s, vec4_t out)
 {
     if(angle_radians > M_PI/4.0f)
@@ -18,66 +18,240 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "shared/shared.h"
 #include "common/async.h"
+#include "common/cmd.h"
+#include "common/common.h"
+#include "common/cvar.h"
 #include "common/zone.h"
+#include "system/system.h"
 #include "system/pthread.h"
 
+#define MAX_ASYNC_THREADS   16
+
+typedef struct {
+    asyncwork_t *head;
+    asyncwork_t **tail;
+} workqueue_t;
+
+typedef struct {
+    unsigned queued;        // current queue depth
+    unsigned peak;          // maximum queue depth
+    unsigned completed;
+    unsigned cancelled;
+    unsigned wait_msec;     // total time spent in queue
+    unsigned wait_max;
+    unsigned run_msec;      // total time spent running
+    unsigned run_max;
+} workstats_t;
+
+static cvar_t *com_async_threads;
+
 static bool work_initialized;
 static bool work_terminate;
 static pthread_mutex_t work_lock;
 static pthread_cond_t work_cond;
-static pthread_t work_thread;
-static asyncwork_t *pend_head;
-static asyncwork_t *done_head;
+static pthread_t work_threads[MAX_ASYNC_THREADS];
+static int work_num_threads;
+static int work_normal_busy;    // workers running normal priority jobs
+static int work_normal_max;     // limit on the above
+static unsigned work_id;
+static workqueue_t pend_queues[ASYNC_PRIO_MAX];
+static workqueue_t done_queue;
+static workstats_t work_stats[ASYNC_PRIO_MAX];
+
+static const char *const work_prio_names[ASYNC_PRIO_MAX] = { "normal", "high" };
 
-static void append_work(asyncwork_t **head, asyncwork_t *work)
+static void init_queue(workqueue_t *q)
+{
+    q->head = NULL;
+    q->tail = &q->head;
+}
+
+static void append_work(workqueue_t *q, asyncwork_t *work)
 {
-    asyncwork_t *c, **p;
-    for (p = head, c = *head; c; p = &c->next, c = c->next)
-        ;
     work->next = NULL;
-    *p = work;
+    *q->tail = work;
+    q->tail = &work->next;
+}
+
+static asyncwork_t *remove_work(workqueue_t *q)
+{
+    asyncwork_t *work = q->head;
+
+    if (work) {
+        q->head = work->next;
+        if (!q->head)
+            q->tail = &q->head;
+    }
+
+    return work;
+}
+
+// high priority work is always taken first. normal priority work never
+// occupies all workers, so that high priority work doesn't have to wait for
+// long running bulk jobs to finish.
+static asyncwork_t *dequeue_work(void)
+{
+    asyncwork_t *work;
+
+    work = remove_work(&pend_queues[ASYNC_PRIO_HIGH]);
+    if (!work && work_normal_busy < work_normal_max) {
+        work = remove_work(&pend_queues[ASYNC_PRIO_NORMAL]);
+        if (work)
+            work_normal_busy++;
+    }
+
+    if (work)
+        work_stats[work->priority].queued--;
+
+    return work;
 }
 
 static void *work_func(void *arg)
 {
+    asyncwork_t *work;
+    workstats_t *s;
+    unsigned start, msec;
+
     pthread_mutex_lock(&work_lock);
     while (1) {
-        while (!pend_head && !work_terminate)
+        while (!(work = dequeue_work()) && !work_terminate)
             pthread_cond_wait(&work_cond, &work_lock);
 
-        asyncwork_t *work = pend_head;
         if (!work)
             break;
-        pend_head = work->next;
 
         pthread_mutex_unlock(&work_lock);
+        start = Sys_Milliseconds();
         work->work_cb(work->cb_arg);
+        msec = Sys_Milliseconds() - start;
         pthread_mutex_lock(&work_lock);
 
-        append_work(&done_head, work);
+        if (work->priority == ASYNC_PRIO_NORMAL)
+            work_normal_busy--;
+
+        s = &work_stats[work->priority];
+        s->completed++;
+        s->wait_msec += start - work->queued;
+        s->wait_max = max(s->wait_max, start - work->queued);
+        s->run_msec += msec;
+        s->run_max = max(s->run_max, msec);
+
+        append_work(&done_queue, work);
     }
     pthread_mutex_unlock(&work_lock);
 
     return NULL;
 }
 
-void Com_QueueAsyncWork(asyncwork_t *work)
+static void start_workers(void)
 {
-    if (!work_initialized) {
-        pthread_mutex_init(&work_lock, NULL);
-        pthread_cond_init(&work_cond, NULL);
-        if (pthread_create(&work_thread, NULL, work_func, NULL))
-            Com_Error(ERR_FATAL, "Couldn't create async work thread");
-        work_initialized = true;
-    }
+    int i, count = 2;
+
+    if (com_async_threads)
+        count = Cvar_ClampInteger(com_async_threads, 1, MAX_ASYNC_THREADS);
+
+    pthread_mutex_init(&work_lock, NULL);
+    pthread_cond_init(&work_cond, NULL);
+    for (i = 0; i < ASYNC_PRIO_MAX; i++)
+        init_queue(&pend_queues[i]);
+    init_queue(&done_queue);
+
+    work_terminate = false;
+    for (work_num_threads = 0; work_num_threads < count; work_num_threads++)
+        if (pthread_create(&work_threads[work_num_threads], NULL, work_func, NULL))
+            break;
+
+    if (!work_num_threads)
+        Com_Error(ERR_FATAL, "Couldn't create async work thread");
+
+    work_normal_busy = 0;
+    work_normal_max = max(work_num_threads - 1, 1);
+    work_initialized = true;
+}
+
+/*
+=================
+Com_QueueAsyncWork
+
+Copies work description and queues it for execution on a worker thread.
+Returns handle that can be passed to Com_CancelAsyncWork.
+=================
+*/
+unsigned Com_QueueAsyncWork(asyncwork_t *work)
+{
+    asyncwork_t *copy;
+    workstats_t *s;
+    unsigned id;
+
+    Q_assert(work->priority < ASYNC_PRIO_MAX);
+
+    if (!work_initialized)
+        start_workers();
+
+    copy = Z_CopyStruct(work);
 
     pthread_mutex_lock(&work_lock);
-    append_work(&pend_head, Z_CopyStruct(work));
+    if (!++work_id)
+        work_id++;
+    id = copy->id = work_id;
+    copy->queued = Sys_Milliseconds();
+    append_work(&pend_queues[copy->priority], copy);
+
+    s = &work_stats[copy->priority];
+    s->queued++;
+    s->peak = max(s->peak, s->queued);
     pthread_mutex_unlock(&work_lock);
 
     pthread_cond_signal(&work_cond);
+
+    return id;
+}
+
+/*
+=================
+Com_CancelAsyncWork
+
+Removes work from the queue if it hasn't started yet. Neither work nor
+completion callbacks are called for cancelled work, caller is responsible
+for freeing callback argument. Returns false if work is already running or
+has finished, completion callback will be called as usual in this case.
+=================
+*/
+bool Com_CancelAsyncWork(unsigned id)
+{
+    asyncwork_t *work, **p;
+    workqueue_t *q;
+    int i;
+
+    if (!work_initialized || !id)
+        return false;
+
+    pthread_mutex_lock(&work_lock);
+    for (i = 0, q = pend_queues; i < ASYNC_PRIO_MAX; i++, q++) {
+        for (p = &q->head; (work = *p) != NULL; p = &work->next) {
+            if (work->id != id)
+                continue;
+            if (!(*p = work->next))
+                q->tail = p;
+            work_stats[i].queued--;
+            work_stats[i].cancelled++;
+            pthread_mutex_unlock(&work_lock);
+            Z_Free(work);
+            return true;
+        }
+    }
+    pthread_mutex_unlock(&work_lock);
+
+    return false;
 }
 
+/*
+=================
+Com_CompleteAsyncWork
+
+Calls completion callbacks of finished work on the main thread.
+=================
+*/
 void Com_CompleteAsyncWork(void)
 {
     asyncwork_t *work, *next;
@@ -86,20 +260,23 @@ void Com_CompleteAsyncWork(void)
         return;
     if (pthread_mutex_trylock(&work_lock))
         return;
-    if (q_unlikely(done_head)) {
-        for (work = done_head; work; work = next) {
-            next = work->next;
-            if (work->done_cb)
-                work->done_cb(work->cb_arg);
-            Z_Free(work);
-        }
-        done_head = NULL;
-    }
+    work = done_queue.head;
+    init_queue(&done_queue);
     pthread_mutex_unlock(&work_lock);
+
+    // callbacks may queue more work
+    for (; work; work = next) {
+        next = work->next;
+        if (work->done_cb)
+            work->done_cb(work->cb_arg);
+        Z_Free(work);
+    }
 }
 
 void Com_ShutdownAsyncWork(void)
 {
+    int i;
+
     if (!work_initialized)
         return;
 
@@ -107,12 +284,54 @@ void Com_ShutdownAsyncWork(void)
     work_terminate = true;
     pthread_mutex_unlock(&work_lock);
 
-    pthread_cond_signal(&work_cond);
+    pthread_cond_broadcast(&work_cond);
 
-    Q_assert(!pthread_join(work_thread, NULL));
+    for (i = 0; i < work_num_threads; i++)
+        Q_assert(!pthread_join(work_threads[i], NULL));
     Com_CompleteAsyncWork();
 
     pthread_mutex_destroy(&work_lock);
     pthread_cond_destroy(&work_cond);
+    work_num_threads = 0;
     work_initialized = false;
 }
+
+static void Com_AsyncStats_f(void)
+{
+    workstats_t *s;
+    int i;
+
+    if (!strcmp(Cmd_Argv(1), "reset")) {
+        if (work_initialized)
+            pthread_mutex_lock(&work_lock);
+        for (i = 0, s = work_stats; i < ASYNC_PRIO_MAX; i++, s++) {
+            s->peak = s->queued;
+            s->completed = s->cancelled = 0;
+            s->wait_msec = s->wait_max = 0;
+            s->run_msec = s->run_max = 0;
+        }
+        if (work_initialized)
+            pthread_mutex_unlock(&work_lock);
+        return;
+    }
+
+    Com_Printf("%d worker threads%s\n", work_num_threads,
+               work_initialized ? "" : " (not started)");
+    Com_Printf("prio   queued peak done   cancel avg wait max wait avg run max run\n"
+               "------ ------ ---- ------ ------ -------- -------- ------- -------\n");
+
+    for (i = 0, s = work_stats; i < ASYNC_PRIO_MAX; i++, s++) {
+        unsigned done = max(s->completed, 1);
+        Com_Printf("%-6s %6u %4u %6u %6u %8u %8u %7u %7u\n",
+                   work_prio_names[i], s->queued, s->peak, s->completed,
+                   s->cancelled, s->wait_msec / done, s->wait_max,
+                   s->run_msec / done, s->run_max);
+    }
+}
+
+void Com_InitAsyncWork(void)
+{
+    com_async_threads = Cvar_Get("com_async_threads", "2", 0);
+
+    Cmd_AddCommand("async_stats", Com_AsyncStats_f);
+}
@@ -995,7 +995,8 @@ int BSP_Load(const char *name, bsp_t **bsp_p)
     //
     // load the file
     //
-    filelen = FS_LoadFile(name, (void **)&buf);
+    // lumps are copied into hunk, so file can be used in place
+    filelen = FS_LoadFileFlags(name, (void **)&buf, FS_FLAG_MMAP);
     if (!buf) {
         return filelen;
     }
@@ -30,12 +30,26 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/zone.h"
 #include "system/hunk.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2    1
+#include <emmintrin.h>
+#else
+#define USE_SSE2    0
+#endif
+
+// vector divide is only available on AArch64
+#if !USE_SSE2 && defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define USE_NEON    1
+#include <arm_neon.h>
+#else
+#define USE_NEON    0
+#endif
+
 mtexinfo_t nulltexinfo;
 
 const mleaf_t       nullleaf = { .cluster = -1 };
 
 static unsigned     floodvalid;
-static unsigned     checkcount;
 
 static cvar_t       *map_noareas;
 static cvar_t       *map_override_path;
@@ -257,24 +271,18 @@ const mleaf_t *CM_LeafNum(const cm_t *cm, int number)
 
 //=======================================================================
 
-static cplane_t box_planes[12];
-static mnode_t  box_nodes[6];
-static mnode_t  *box_headnode;
-static mbrush_t box_brush;
-static mbrush_t *box_leafbrush;
-static mbrushside_t box_brushsides[6];
-static mleaf_t  box_leaf;
-static mleaf_t  box_emptyleaf;
+// context used by single threaded callers
+static cm_trace_ctx_t   cm_ctx;
 
 /*
 ===================
-CM_InitBoxHull
+CM_InitTraceCtx
 
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
 ===================
 */
-static void CM_InitBoxHull(void)
+void CM_InitTraceCtx(cm_trace_ctx_t *ctx)
 {
     int         i;
     int         side;
@@ -282,45 +290,53 @@ static void CM_InitBoxHull(void)
     cplane_t    *p;
     mbrushside_t    *s;
 
-    box_headnode = &box_nodes[0];
+    memset(ctx, 0, sizeof(*ctx));
 
-    box_brush.numsides = 6;
-    box_brush.firstbrushside = &box_brushsides[0];
-    box_brush.contents = CONTENTS_MONSTER;
+    ctx->box_brush.numsides = 6;
+    ctx->box_brush.firstbrushside = &ctx->box_brushsides[0];
+    ctx->box_brush.contents = CONTENTS_MONSTER;
 
-    box_leaf.contents[0] = box_leaf.contents[1] = CONTENTS_MONSTER;
-    box_leaf.firstleafbrush = &box_leafbrush;
-    box_leaf.numleafbrushes = 1;
+    ctx->box_leaf.contents[0] = ctx->box_leaf.contents[1] = CONTENTS_MONSTER;
+    ctx->box_leaf.firstleafbrush = &ctx->box_leafbrush;
+    ctx->box_leaf.numleafbrushes = 1;
 
-    box_leafbrush = &box_brush;
+    ctx->box_leafbrush = &ctx->box_brush;
 
     for (i = 0; i < 6; i++) {
         side = i & 1;
 
         // brush sides
-        s = &box_brushsides[i];
-        s->plane = &box_planes[i * 2 + side];
+        s = &ctx->box_brushsides[i];
+        s->plane = &ctx->box_planes[i * 2 + side];
         s->texinfo = &nulltexinfo;
 
         // nodes
-        c = &box_nodes[i];
-        c->plane = &box_planes[i * 2];
-        c->children[side] = (mnode_t *)&box_emptyleaf;
+        c = &ctx->box_nodes[i];
+        c->plane = &ctx->box_planes[i * 2];
+        c->children[side] = (mnode_t *)&ctx->box_emptyleaf;
         if (i != 5)
-            c->children[side ^ 1] = &box_nodes[i + 1];
+            c->children[side ^ 1] = &ctx->box_nodes[i + 1];
         else
-            c->children[side ^ 1] = (mnode_t *)&box_leaf;
+            c->children[side ^ 1] = (mnode_t *)&ctx->box_leaf;
 
         // planes
-        p = &box_planes[i * 2];
+        p = &ctx->box_planes[i * 2];
         p->type = i >> 1;
         p->normal[i >> 1] = 1;
 
-        p = &box_planes[i * 2 + 1];
+        p = &ctx->box_planes[i * 2 + 1];
         p->type = 3 + (i >> 1);
         p->signbits = 1 << (i >> 1);
         p->normal[i >> 1] = -1;
     }
+
+    // headnode of a box hull is its own parent, no BSP node can be
+    ctx->box_nodes[0].parent = &ctx->box_nodes[0];
+}
+
+static inline bool CM_IsBoxHull(const mnode_t *headnode)
+{
+    return headnode->parent == headnode;
 }
 
 /*
@@ -331,22 +347,29 @@ To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 ===================
 */
+const mnode_t *CM_HeadnodeForBoxCtx(cm_trace_ctx_t *ctx, const vec3_t mins, const vec3_t maxs)
+{
+    cplane_t *p = ctx->box_planes;
+
+    p[0].dist = maxs[0];
+    p[1].dist = -maxs[0];
+    p[2].dist = mins[0];
+    p[3].dist = -mins[0];
+    p[4].dist = maxs[1];
+    p[5].dist = -maxs[1];
+    p[6].dist = mins[1];
+    p[7].dist = -mins[1];
+    p[8].dist = maxs[2];
+    p[9].dist = -maxs[2];
+    p[10].dist = mins[2];
+    p[11].dist = -mins[2];
+
+    return &ctx->box_nodes[0];
+}
+
 const mnode_t *CM_HeadnodeForBox(const vec3_t mins, const vec3_t maxs)
 {
-    box_planes[0].dist = maxs[0];
-    box_planes[1].dist = -maxs[0];
-    box_planes[2].dist = mins[0];
-    box_planes[3].dist = -mins[0];
-    box_planes[4].dist = maxs[1];
-    box_planes[5].dist = -maxs[1];
-    box_planes[6].dist = mins[1];
-    box_planes[7].dist = -mins[1];
-    box_planes[8].dist = maxs[2];
-    box_planes[9].dist = -maxs[2];
-    box_planes[10].dist = mins[2];
-    box_planes[11].dist = -mins[2];
-
-    return box_headnode;
+    return CM_HeadnodeForBoxCtx(&cm_ctx, mins, maxs);
 }
 
 /*
@@ -356,31 +379,33 @@ CM_BoxLeafnums
 Fills in a list of all the leafs touched
 =============
 */
-static int              leaf_count, leaf_maxcount;
-static const mleaf_t    **leaf_list;
-static const vec_t      *leaf_mins, *leaf_maxs;
-static const mnode_t    *leaf_topnode;
-
-static void CM_BoxLeafs_r(const mnode_t *node)
+typedef struct {
+    int             count, maxcount;
+    const mleaf_t   **list;
+    const vec_t     *mins, *maxs;
+    const mnode_t   *topnode;
+} leaf_work_t;
+
+static void CM_BoxLeafs_r(leaf_work_t *lw, const mnode_t *node)
 {
     while (node->plane) {
-        box_plane_t s = BoxOnPlaneSideFast(leaf_mins, leaf_maxs, node->plane);
+        box_plane_t s = BoxOnPlaneSideFast(lw->mins, lw->maxs, node->plane);
         if (s == BOX_INFRONT) {
             node = node->children[0];
         } else if (s == BOX_BEHIND) {
             node = node->children[1];
         } else {
             // go down both
-            if (!leaf_topnode) {
-                leaf_topnode = node;
+            if (!lw->topnode) {
+                lw->topnode = node;
             }
-            CM_BoxLeafs_r(node->children[0]);
+            CM_BoxLeafs_r(lw, node->children[0]);
             node = node->children[1];
         }
     }
 
-    if (leaf_count < leaf_maxcount) {
-        leaf_list[leaf_count++] = (const mleaf_t *)node;
+    if (lw->count < lw->maxcount) {
+        lw->list[lw->count++] = (const mleaf_t *)node;
     }
 }
 
@@ -388,20 +413,19 @@ int CM_BoxLeafs_headnode(const vec3_t mins, const vec3_t maxs,
                          const mleaf_t **list, int listsize,
                          const mnode_t *headnode, const mnode_t **topnode)
 {
-    leaf_list = list;
-    leaf_count = 0;
-    leaf_maxcount = listsize;
-    leaf_mins = mins;
-    leaf_maxs = maxs;
+    leaf_work_t lw = {
+        .list = list,
+        .maxcount = listsize,
+        .mins = mins,
+        .maxs = maxs,
+    };
 
-    leaf_topnode = NULL;
-
-    CM_BoxLeafs_r(headnode);
+    CM_BoxLeafs_r(&lw, headnode);
 
     if (topnode)
-        *topnode = leaf_topnode;
+        *topnode = lw.topnode;
 
-    return leaf_count;
+    return lw.count;
 }
 
 /*
@@ -426,7 +450,7 @@ int CM_TransformedPointContents(const vec3_t p, const mnode_t *headnode,
     VectorSubtract(p, origin, p_l);
 
     // rotate start and end into the models frame of reference
-    if (headnode != box_headnode && !VectorEmpty(angles)) {
+    if (!CM_IsBoxHull(headnode) && !VectorEmpty(angles)) {
         AnglesToAxis(angles, axis);
         RotatePoint(p_l, axis);
     }
@@ -439,27 +463,87 @@ int CM_TransformedPointContents(const vec3_t p, const mnode_t *headnode,
 
 BOX TRACING
 
+All trace state lives in trace_work_t on the caller's stack, so traces
+against a map that isn't being modified can run on multiple threads.
+Box hulls for tracing against entities need a cm_trace_ctx_t per thread.
+
 ===============================================================================
 */
 
 // 1/32 epsilon to keep floating point happy
 #define DIST_EPSILON    (1 / 32.f)
 
-static vec3_t   trace_start, trace_end;
-static vec3_t   trace_offsets[8];
-static vec3_t   trace_extents;
+// recently checked brushes, to avoid repeated testing of brushes spanning
+// multiple leafs. testing a brush twice gives the same result, so
+// evicted entries only cost time.
+#define TRACE_CHECKED_SIZE  64
+
+typedef struct {
+    vec3_t      start, end;
+    vec3_t      offsets[8];
+    vec3_t      extents;
+
+    trace_t     *trace;
+    int         contents;
+    bool        ispoint;        // optimized case
+    bool        extended;       // remaster fixes
+
+    const mbrush_t  *checked[TRACE_CHECKED_SIZE];
+} trace_work_t;
+
+static void CM_InitTraceWork(trace_work_t *tw, const vec3_t start, const vec3_t end,
+                             const vec3_t mins, const vec3_t maxs,
+                             int brushmask, bool extended)
+{
+    const vec_t *bounds[2] = { mins, maxs };
+    int i, j;
 
-static trace_t  *trace_trace;
-static int      trace_contents;
-static bool     trace_ispoint;      // optimized case
-static bool     trace_extended;     // remaster fixes
+    tw->contents = brushmask;
+    tw->extended = extended;
+    VectorCopy(start, tw->start);
+    VectorCopy(end, tw->end);
+    for (i = 0; i < 8; i++)
+        for (j = 0; j < 3; j++)
+            tw->offsets[i][j] = bounds[(i >> j) & 1][j];
+
+    if (VectorEmpty(mins) && VectorEmpty(maxs)) {
+        tw->ispoint = true;
+        VectorClear(tw->extents);
+    } else {
+        tw->ispoint = false;
+        tw->extents[0] = max(-mins[0], maxs[0]);
+        tw->extents[1] = max(-mins[1], maxs[1]);
+        tw->extents[2] = max(-mins[2], maxs[2]);
+    }
+
+    memset(tw->checked, 0, sizeof(tw->checked));
+}
+
+static void CM_InitTrace(trace_t *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+    trace->fraction = 1;
+    trace->surface = &(nulltexinfo.c);
+}
+
+// returns true if brush was already checked during this trace
+static bool CM_BrushChecked(trace_work_t *tw, const mbrush_t *brush)
+{
+    unsigned hash = ((uintptr_t)brush / sizeof(*brush)) & (TRACE_CHECKED_SIZE - 1);
+
+    if (tw->checked[hash] == brush)
+        return true;
+
+    tw->checked[hash] = brush;
+    return false;
+}
 
 /*
 ================
 CM_ClipBoxToBrush
 ================
 */
-static void CM_ClipBoxToBrush(const vec3_t p1, const vec3_t p2, trace_t *trace, const mbrush_t *brush)
+static void CM_ClipBoxToBrush(const trace_work_t *tw, const vec3_t p1, const vec3_t p2, trace_t *trace, const mbrush_t *brush)
 {
     int         i;
     const cplane_t  *plane, *clipplane[2];
@@ -486,10 +570,10 @@ static void CM_ClipBoxToBrush(const vec3_t p1, const vec3_t p2, trace_t *trace,
         plane = side->plane;
 
         // FIXME: special case for axial
-        if (!trace_ispoint) {
+        if (!tw->ispoint) {
             // general box case
             // push the plane out appropriately for mins/maxs
-            dist = DotProduct(trace_offsets[plane->signbits], plane->normal);
+            dist = DotProduct(tw->offsets[plane->signbits], plane->normal);
             dist = plane->dist - dist;
         } else {
             // special point case
@@ -509,7 +593,7 @@ static void CM_ClipBoxToBrush(const vec3_t p1, const vec3_t p2, trace_t *trace,
         if (d1 > 0 && (d2 >= DIST_EPSILON || d2 >= d1))
         // Paril
             return;
-        
+
 		// if it doesn't cross the plane, the plane isn't relevent
         if (d1 <= 0 && d2 <= 0)
             continue;
@@ -546,7 +630,7 @@ static void CM_ClipBoxToBrush(const vec3_t p1, const vec3_t p2, trace_t *trace,
         trace->startsolid = true;
         if (!getout) {
             trace->allsolid = true;
-            if (trace_extended) {
+            if (tw->extended) {
                 // original Q2 didn't set these
                 trace->fraction = 0;
                 trace->contents = brush->contents;
@@ -575,7 +659,7 @@ static void CM_ClipBoxToBrush(const vec3_t p1, const vec3_t p2, trace_t *trace,
 CM_TestBoxInBrush
 ================
 */
-static void CM_TestBoxInBrush(const vec3_t p1, trace_t *trace, const mbrush_t *brush)
+static void CM_TestBoxInBrush(const trace_work_t *tw, const vec3_t p1, trace_t *trace, const mbrush_t *brush)
 {
     int         i;
     const cplane_t  *plane;
@@ -593,7 +677,7 @@ static void CM_TestBoxInBrush(const vec3_t p1, trace_t *trace, const mbrush_t *b
         // FIXME: special case for axial
         // general box case
         // push the plane out appropriately for mins/maxs
-        dist = DotProduct(trace_offsets[plane->signbits], plane->normal);
+        dist = DotProduct(tw->offsets[plane->signbits], plane->normal);
         dist = plane->dist - dist;
 
         d1 = DotProduct(p1, plane->normal) - dist;
@@ -614,25 +698,24 @@ static void CM_TestBoxInBrush(const vec3_t p1, trace_t *trace, const mbrush_t *b
 CM_TraceToLeaf
 ================
 */
-static void CM_TraceToLeaf(const mleaf_t *leaf)
+static void CM_TraceToLeaf(trace_work_t *tw, const mleaf_t *leaf)
 {
     int         k;
     mbrush_t    *b, **leafbrush;
 
-    if (!(leaf->contents[trace_extended] & trace_contents))
+    if (!(leaf->contents[tw->extended] & tw->contents))
         return;
     // trace line against all brushes in the leaf
     leafbrush = leaf->firstleafbrush;
     for (k = 0; k < leaf->numleafbrushes; k++, leafbrush++) {
         b = *leafbrush;
-        if (b->checkcount == checkcount)
+        if (CM_BrushChecked(tw, b))
             continue;   // already checked this brush in another leaf
-        b->checkcount = checkcount;
 
-        if (!(b->contents & trace_contents))
+        if (!(b->contents & tw->contents))
             continue;
-        CM_ClipBoxToBrush(trace_start, trace_end, trace_trace, b);
-        if (!trace_trace->fraction)
+        CM_ClipBoxToBrush(tw, tw->start, tw->end, tw->trace, b);
+        if (!tw->trace->fraction)
             return;
     }
 }
@@ -642,25 +725,24 @@ static void CM_TraceToLeaf(const mleaf_t *leaf)
 CM_TestInLeaf
 ================
 */
-static void CM_TestInLeaf(const mleaf_t *leaf)
+static void CM_TestInLeaf(trace_work_t *tw, const mleaf_t *leaf)
 {
     int         k;
     mbrush_t    *b, **leafbrush;
 
-    if (!(leaf->contents[trace_extended] & trace_contents))
+    if (!(leaf->contents[tw->extended] & tw->contents))
         return;
     // trace line against all brushes in the leaf
     leafbrush = leaf->firstleafbrush;
     for (k = 0; k < leaf->numleafbrushes; k++, leafbrush++) {
         b = *leafbrush;
-        if (b->checkcount == checkcount)
+        if (CM_BrushChecked(tw, b))
             continue;   // already checked this brush in another leaf
-        b->checkcount = checkcount;
 
-        if (!(b->contents & trace_contents))
+        if (!(b->contents & tw->contents))
             continue;
-        CM_TestBoxInBrush(trace_start, trace_trace, b);
-        if (!trace_trace->fraction)
+        CM_TestBoxInBrush(tw, tw->start, tw->trace, b);
+        if (!tw->trace->fraction)
             return;
     }
 }
@@ -671,7 +753,7 @@ CM_RecursiveHullCheck
 
 ==================
 */
-static void CM_RecursiveHullCheck(const mnode_t *node, float p1f, float p2f, const vec3_t p1, const vec3_t p2)
+static void CM_RecursiveHullCheck(trace_work_t *tw, const mnode_t *node, float p1f, float p2f, const vec3_t p1, const vec3_t p2)
 {
     const cplane_t  *plane;
     float       t1, t2, offset;
@@ -681,14 +763,14 @@ static void CM_RecursiveHullCheck(const mnode_t *node, float p1f, float p2f, con
     int         side;
     float       midf;
 
-    if (trace_trace->fraction <= p1f)
+    if (tw->trace->fraction <= p1f)
         return;     // already hit something nearer
 
 recheck:
     // if plane is NULL, we are in a leaf node
     plane = node->plane;
     if (!plane) {
-        CM_TraceToLeaf((const mleaf_t *)node);
+        CM_TraceToLeaf(tw, (const mleaf_t *)node);
         return;
     }
 
@@ -699,16 +781,16 @@ recheck:
     if (plane->type < 3) {
         t1 = p1[plane->type] - plane->dist;
         t2 = p2[plane->type] - plane->dist;
-        offset = trace_extents[plane->type];
+        offset = tw->extents[plane->type];
     } else {
         t1 = PlaneDiff(p1, plane);
         t2 = PlaneDiff(p2, plane);
-        if (trace_ispoint)
+        if (tw->ispoint)
             offset = 0;
         else
-            offset = fabsf(trace_extents[0] * plane->normal[0]) +
-                     fabsf(trace_extents[1] * plane->normal[1]) +
-                     fabsf(trace_extents[2] * plane->normal[2]);
+            offset = fabsf(tw->extents[0] * plane->normal[0]) +
+                     fabsf(tw->extents[1] * plane->normal[1]) +
+                     fabsf(tw->extents[2] * plane->normal[2]);
     }
 
     // see which sides we need to consider
@@ -745,13 +827,13 @@ recheck:
     midf = p1f + (p2f - p1f) * frac;
     LerpVector(p1, p2, frac, mid);
 
-    CM_RecursiveHullCheck(node->children[side], p1f, midf, p1, mid);
+    CM_RecursiveHullCheck(tw, node->children[side], p1f, midf, p1, mid);
 
     // go past the node
     midf = p1f + (p2f - p1f) * frac2;
     LerpVector(p1, p2, frac2, mid);
 
-    CM_RecursiveHullCheck(node->children[side ^ 1], midf, p2f, mid, p2);
+    CM_RecursiveHullCheck(tw, node->children[side ^ 1], midf, p2f, mid, p2);
 }
 
 //======================================================================
@@ -767,27 +849,17 @@ void CM_BoxTrace(trace_t *trace,
                  const mnode_t *headnode, int brushmask,
                  bool extended)
 {
-    const vec_t *bounds[2] = { mins, maxs };
-    int i, j;
-
-    checkcount++;       // for multi-check avoidance
+    trace_work_t tw;
+    int i;
 
     // fill in a default trace
-    trace_trace = trace;
-    memset(trace_trace, 0, sizeof(*trace_trace));
-    trace_trace->fraction = 1;
-    trace_trace->surface = &(nulltexinfo.c);
+    CM_InitTrace(trace);
 
     if (!headnode)
         return;
 
-    trace_contents = brushmask;
-    trace_extended = extended;
-    VectorCopy(start, trace_start);
-    VectorCopy(end, trace_end);
-    for (i = 0; i < 8; i++)
-        for (j = 0; j < 3; j++)
-            trace_offsets[i][j] = bounds[(i >> j) & 1][j];
+    CM_InitTraceWork(&tw, start, end, mins, maxs, brushmask, extended);
+    tw.trace = trace;
 
     //
     // check for position test special case
@@ -804,36 +876,592 @@ void CM_BoxTrace(trace_t *trace,
 
         numleafs = CM_BoxLeafs_headnode(c1, c2, leafs, q_countof(leafs), headnode, NULL);
         for (i = 0; i < numleafs; i++) {
-            CM_TestInLeaf(leafs[i]);
-            if (trace_trace->allsolid)
+            CM_TestInLeaf(&tw, leafs[i]);
+            if (trace->allsolid)
                 break;
         }
-        VectorCopy(start, trace_trace->endpos);
+        VectorCopy(start, trace->endpos);
         return;
     }
 
-    //
-    // check for point special case
-    //
-    if (VectorEmpty(mins) && VectorEmpty(maxs)) {
-        trace_ispoint = true;
-        VectorClear(trace_extents);
-    } else {
-        trace_ispoint = false;
-        trace_extents[0] = max(-mins[0], maxs[0]);
-        trace_extents[1] = max(-mins[1], maxs[1]);
-        trace_extents[2] = max(-mins[2], maxs[2]);
-    }
-
     //
     // general sweeping through world
     //
-    CM_RecursiveHullCheck(headnode, 0, 1, start, end);
+    CM_RecursiveHullCheck(&tw, headnode, 0, 1, start, end);
 
-    if (trace_trace->fraction == 1)
-        VectorCopy(end, trace_trace->endpos);
+    if (trace->fraction == 1)
+        VectorCopy(end, trace->endpos);
     else
-        LerpVector(start, end, trace_trace->fraction, trace_trace->endpos);
+        LerpVector(start, end, trace->fraction, trace->endpos);
+}
+
+/*
+===============================================================================
+
+BATCHED TRACING
+
+Rays sharing headnode, box size and contents mask descend the tree
+together as a packet. Each ray visits leafs in the same order as it
+would when traced alone, and brushes in a leaf are clipped against up
+to 4 rays at once, so results are identical to CM_BoxTrace().
+
+===============================================================================
+*/
+
+#define MAX_TRACE_BATCH     16
+
+typedef struct {
+    int         ray;
+    float       p1f, p2f;
+    vec3_t      p1, p2;
+} trace_seg_t;
+
+typedef struct {
+    trace_work_t    tw;         // start, end, trace and checked are unused
+    trace_t         *traces;
+    const vec3_t    *starts;
+    const vec3_t    *ends;
+    int             first;      // first ray of current group
+    const mbrush_t  *checked[MAX_TRACE_BATCH][TRACE_CHECKED_SIZE];
+} batch_work_t;
+
+#if USE_SSE2 || USE_NEON
+
+// per lane results of clipping a brush against 4 rays
+typedef struct {
+    float       enterfrac0[4], enterfrac1[4], leavefrac[4];
+    int32_t     side0[4], side1[4];
+    int32_t     getout[4], startout[4], done[4];
+} clip4_t;
+
+static void CM_ClipBoxToBrush4Results(const batch_work_t *bw, const int *rays,
+                                      const mbrush_t *brush, const clip4_t *c)
+{
+    const trace_work_t *tw = &bw->tw;
+    const mbrushside_t *sides = brush->firstbrushside;
+    int j;
+
+    for (j = 0; j < 4; j++) {
+        trace_t *trace;
+
+        if (c->done[j])
+            continue;
+
+        trace = &bw->traces[rays[j]];
+        if (!c->startout[j]) {
+            // original point was inside brush
+            trace->startsolid = true;
+            if (!c->getout[j]) {
+                trace->allsolid = true;
+                if (tw->extended) {
+                    // original Q2 didn't set these
+                    trace->fraction = 0;
+                    trace->contents = brush->contents;
+                }
+            }
+            continue;
+        }
+        if (c->enterfrac0[j] < c->leavefrac[j] && c->enterfrac0[j] > -1 &&
+            c->enterfrac0[j] < trace->fraction) {
+            trace->fraction = c->enterfrac0[j];
+            trace->plane = *sides[c->side0[j]].plane;
+            trace->surface = &(sides[c->side0[j]].texinfo->c);
+            trace->contents = brush->contents;
+
+            if (c->side1[j] >= 0) {
+                trace->plane2 = *sides[c->side1[j]].plane;
+                trace->surface2 = &(sides[c->side0[j]].texinfo->c);
+            }
+        }
+    }
+}
+
+#endif
+
+#if USE_SSE2
+
+// clips brush against 4 rays, rays with negative index are ignored
+static void CM_ClipBoxToBrush4(const batch_work_t *bw, const int *rays, const mbrush_t *brush)
+{
+    const trace_work_t *tw = &bw->tw;
+    const mbrushside_t *sides = brush->firstbrushside;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 epsilon = _mm_set1_ps(DIST_EPSILON);
+    __m128 p1[3], p2[3];
+    __m128 enterfrac0, enterfrac1, leavefrac;
+    __m128 getout, startout, done;
+    __m128i side0, side1;
+    float v1[3][4], v2[3][4];
+    clip4_t c;
+    int i, j;
+
+    if (!brush->numsides)
+        return;
+
+    for (j = 0; j < 4; j++) {
+        int r = rays[j] < 0 ? rays[0] : rays[j];
+        for (i = 0; i < 3; i++) {
+            v1[i][j] = bw->starts[r][i];
+            v2[i][j] = bw->ends[r][i];
+        }
+        c.done[j] = rays[j] < 0 ? -1 : 0;
+    }
+
+    for (i = 0; i < 3; i++) {
+        p1[i] = _mm_loadu_ps(v1[i]);
+        p2[i] = _mm_loadu_ps(v2[i]);
+    }
+
+    enterfrac0 = enterfrac1 = minus_one;
+    leavefrac = one;
+    getout = startout = zero;
+    done = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)c.done));
+    side0 = side1 = _mm_set1_epi32(-1);
+
+    for (i = 0; i < brush->numsides; i++) {
+        const cplane_t *plane = sides[i].plane;
+        float dist;
+
+        if (!tw->ispoint)
+            dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
+        else
+            dist = plane->dist;
+
+        __m128 nx = _mm_set1_ps(plane->normal[0]);
+        __m128 ny = _mm_set1_ps(plane->normal[1]);
+        __m128 nz = _mm_set1_ps(plane->normal[2]);
+        __m128 d = _mm_set1_ps(dist);
+
+        // same order of operations as DotProduct() to get identical results
+        __m128 d1 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p1[0], nx), _mm_mul_ps(p1[1], ny)), _mm_mul_ps(p1[2], nz)), d);
+        __m128 d2 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p2[0], nx), _mm_mul_ps(p2[1], ny)), _mm_mul_ps(p2[2], nz)), d);
+
+        __m128 live = _mm_andnot_ps(done, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+        __m128 d1_out = _mm_cmpgt_ps(d1, zero);
+
+        getout = _mm_or_ps(getout, _mm_and_ps(live, _mm_cmpgt_ps(d2, zero)));
+        startout = _mm_or_ps(startout, _mm_and_ps(live, d1_out));
+
+        // if completely in front of face, no intersection with the entire brush
+        __m128 front = _mm_and_ps(d1_out, _mm_or_ps(_mm_cmpge_ps(d2, epsilon), _mm_cmpge_ps(d2, d1)));
+        done = _mm_or_ps(done, front);
+        live = _mm_andnot_ps(front, live);
+
+        // if it doesn't cross the plane, the plane isn't relevent
+        __m128 cross = _mm_andnot_ps(_mm_and_ps(_mm_cmple_ps(d1, zero), _mm_cmple_ps(d2, zero)), live);
+        if (!_mm_movemask_ps(cross))
+            continue;
+
+        __m128 denom = _mm_sub_ps(d1, d2);
+        __m128 enter = _mm_and_ps(cross, _mm_cmpgt_ps(d1, d2));
+        __m128 leave = _mm_andnot_ps(enter, cross);
+        __m128i index = _mm_set1_epi32(i);
+
+        // enter
+        __m128 f = _mm_max_ps(zero, _mm_div_ps(_mm_sub_ps(d1, epsilon), denom));
+        __m128 m0 = _mm_and_ps(enter, _mm_cmpgt_ps(f, enterfrac0));
+        __m128 m1 = _mm_andnot_ps(m0, _mm_and_ps(enter, _mm_cmpgt_ps(f, enterfrac1)));
+        __m128i m0i = _mm_castps_si128(m0);
+        __m128i m1i = _mm_castps_si128(m1);
+
+        enterfrac0 = _mm_or_ps(_mm_and_ps(m0, f), _mm_andnot_ps(m0, enterfrac0));
+        enterfrac1 = _mm_or_ps(_mm_and_ps(m1, f), _mm_andnot_ps(m1, enterfrac1));
+        side0 = _mm_or_si128(_mm_and_si128(m0i, index), _mm_andnot_si128(m0i, side0));
+        side1 = _mm_or_si128(_mm_and_si128(m1i, index), _mm_andnot_si128(m1i, side1));
+
+        // leave
+        f = _mm_min_ps(one, _mm_div_ps(_mm_add_ps(d1, epsilon), denom));
+        __m128 ml = _mm_and_ps(leave, _mm_cmplt_ps(f, leavefrac));
+        leavefrac = _mm_or_ps(_mm_and_ps(ml, f), _mm_andnot_ps(ml, leavefrac));
+    }
+
+    _mm_storeu_ps(c.enterfrac0, enterfrac0);
+    _mm_storeu_ps(c.enterfrac1, enterfrac1);
+    _mm_storeu_ps(c.leavefrac, leavefrac);
+    _mm_storeu_si128((__m128i *)c.side0, side0);
+    _mm_storeu_si128((__m128i *)c.side1, side1);
+    _mm_storeu_si128((__m128i *)c.getout, _mm_castps_si128(getout));
+    _mm_storeu_si128((__m128i *)c.startout, _mm_castps_si128(startout));
+    _mm_storeu_si128((__m128i *)c.done, _mm_castps_si128(done));
+
+    CM_ClipBoxToBrush4Results(bw, rays, brush, &c);
+}
+
+#elif USE_NEON
+
+// clips brush against 4 rays, rays with negative index are ignored
+static void CM_ClipBoxToBrush4(const batch_work_t *bw, const int *rays, const mbrush_t *brush)
+{
+    const trace_work_t *tw = &bw->tw;
+    const mbrushside_t *sides = brush->firstbrushside;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+    const float32x4_t epsilon = vdupq_n_f32(DIST_EPSILON);
+    float32x4_t p1[3], p2[3];
+    float32x4_t enterfrac0, enterfrac1, leavefrac;
+    uint32x4_t getout, startout, done;
+    int32x4_t side0, side1;
+    float v1[3][4], v2[3][4];
+    clip4_t c;
+    int i, j;
+
+    if (!brush->numsides)
+        return;
+
+    for (j = 0; j < 4; j++) {
+        int r = rays[j] < 0 ? rays[0] : rays[j];
+        for (i = 0; i < 3; i++) {
+            v1[i][j] = bw->starts[r][i];
+            v2[i][j] = bw->ends[r][i];
+        }
+        c.done[j] = rays[j] < 0 ? -1 : 0;
+    }
+
+    for (i = 0; i < 3; i++) {
+        p1[i] = vld1q_f32(v1[i]);
+        p2[i] = vld1q_f32(v2[i]);
+    }
+
+    enterfrac0 = enterfrac1 = minus_one;
+    leavefrac = one;
+    getout = startout = vdupq_n_u32(0);
+    done = vreinterpretq_u32_s32(vld1q_s32(c.done));
+    side0 = side1 = vdupq_n_s32(-1);
+
+    for (i = 0; i < brush->numsides; i++) {
+        const cplane_t *plane = sides[i].plane;
+        float dist;
+
+        if (!tw->ispoint)
+            dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
+        else
+            dist = plane->dist;
+
+        float32x4_t nx = vdupq_n_f32(plane->normal[0]);
+        float32x4_t ny = vdupq_n_f32(plane->normal[1]);
+        float32x4_t nz = vdupq_n_f32(plane->normal[2]);
+        float32x4_t d = vdupq_n_f32(dist);
+
+        // same order of operations as DotProduct() to get identical results
+        float32x4_t d1 = vsubq_f32(vaddq_f32(vaddq_f32(vmulq_f32(p1[0], nx), vmulq_f32(p1[1], ny)), vmulq_f32(p1[2], nz)), d);
+        float32x4_t d2 = vsubq_f32(vaddq_f32(vaddq_f32(vmulq_f32(p2[0], nx), vmulq_f32(p2[1], ny)), vmulq_f32(p2[2], nz)), d);
+
+        uint32x4_t live = vmvnq_u32(done);
+        uint32x4_t d1_out = vcgtq_f32(d1, zero);
+
+        getout = vorrq_u32(getout, vandq_u32(live, vcgtq_f32(d2, zero)));
+        startout = vorrq_u32(startout, vandq_u32(live, d1_out));
+
+        // if completely in front of face, no intersection with the entire brush
+        uint32x4_t front = vandq_u32(d1_out, vorrq_u32(vcgeq_f32(d2, epsilon), vcgeq_f32(d2, d1)));
+        done = vorrq_u32(done, front);
+        live = vbicq_u32(live, front);
+
+        // if it doesn't cross the plane, the plane isn't relevent
+        uint32x4_t cross = vbicq_u32(live, vandq_u32(vcleq_f32(d1, zero), vcleq_f32(d2, zero)));
+        if (!vmaxvq_u32(cross))
+            continue;
+
+        float32x4_t denom = vsubq_f32(d1, d2);
+        uint32x4_t enter = vandq_u32(cross, vcgtq_f32(d1, d2));
+        uint32x4_t leave = vbicq_u32(cross, enter);
+        int32x4_t index = vdupq_n_s32(i);
+
+        // enter
+        float32x4_t f = vmaxq_f32(zero, vdivq_f32(vsubq_f32(d1, epsilon), denom));
+        uint32x4_t m0 = vandq_u32(enter, vcgtq_f32(f, enterfrac0));
+        uint32x4_t m1 = vbicq_u32(vandq_u32(enter, vcgtq_f32(f, enterfrac1)), m0);
+
+        enterfrac0 = vbslq_f32(m0, f, enterfrac0);
+        enterfrac1 = vbslq_f32(m1, f, enterfrac1);
+        side0 = vbslq_s32(m0, index, side0);
+        side1 = vbslq_s32(m1, index, side1);
+
+        // leave
+        f = vminq_f32(one, vdivq_f32(vaddq_f32(d1, epsilon), denom));
+        uint32x4_t ml = vandq_u32(leave, vcltq_f32(f, leavefrac));
+        leavefrac = vbslq_f32(ml, f, leavefrac);
+    }
+
+    vst1q_f32(c.enterfrac0, enterfrac0);
+    vst1q_f32(c.enterfrac1, enterfrac1);
+    vst1q_f32(c.leavefrac, leavefrac);
+    vst1q_s32(c.side0, side0);
+    vst1q_s32(c.side1, side1);
+    vst1q_s32(c.getout, vreinterpretq_s32_u32(getout));
+    vst1q_s32(c.startout, vreinterpretq_s32_u32(startout));
+    vst1q_s32(c.done, vreinterpretq_s32_u32(done));
+
+    CM_ClipBoxToBrush4Results(bw, rays, brush, &c);
+}
+
+#else
+
+static void CM_ClipBoxToBrush4(const batch_work_t *bw, const int *rays, const mbrush_t *brush)
+{
+    for (int j = 0; j < 4; j++)
+        if (rays[j] >= 0)
+            CM_ClipBoxToBrush(&bw->tw, bw->starts[rays[j]], bw->ends[rays[j]], &bw->traces[rays[j]], brush);
+}
+
+#endif
+
+// returns true if brush was already checked for this ray
+static bool CM_BrushCheckedBatch(batch_work_t *bw, int ray, const mbrush_t *brush)
+{
+    const mbrush_t **checked = bw->checked[ray - bw->first];
+    unsigned hash = ((uintptr_t)brush / sizeof(*brush)) & (TRACE_CHECKED_SIZE - 1);
+
+    if (checked[hash] == brush)
+        return true;
+
+    checked[hash] = brush;
+    return false;
+}
+
+static void CM_TraceToLeafBatch(batch_work_t *bw, const mleaf_t *leaf, const trace_seg_t *segs, int numsegs)
+{
+    const trace_work_t *tw = &bw->tw;
+    int         i, j, k, n, numrays;
+    int         rays[MAX_TRACE_BATCH];
+    int         lanes[MAX_TRACE_BATCH + 3];
+    mbrush_t    *b, **leafbrush;
+
+    if (!(leaf->contents[tw->extended] & tw->contents))
+        return;
+
+    for (i = 0; i < numsegs; i++)
+        rays[i] = segs[i].ray;
+    numrays = numsegs;
+
+    // trace lines against all brushes in the leaf
+    leafbrush = leaf->firstleafbrush;
+    for (k = 0; k < leaf->numleafbrushes && numrays; k++, leafbrush++) {
+        b = *leafbrush;
+        if (!(b->contents & tw->contents))
+            continue;
+
+        // skip rays that already checked this brush in another leaf
+        for (i = n = 0; i < numrays; i++)
+            if (!CM_BrushCheckedBatch(bw, rays[i], b))
+                lanes[n++] = rays[i];
+        if (!n)
+            continue;
+
+        for (i = n; i < ((n + 3) & ~3); i++)
+            lanes[i] = -1;
+        for (i = 0; i < n; i += 4)
+            CM_ClipBoxToBrush4(bw, &lanes[i], b);
+
+        // rays that hit at start stop checking this leaf
+        for (i = j = 0; i < numrays; i++)
+            if (bw->traces[rays[i]].fraction)
+                rays[j++] = rays[i];
+        numrays = j;
+    }
+}
+
+static void CM_RecursiveHullCheckBatch(batch_work_t *bw, const mnode_t *node, const trace_seg_t *in, int numin)
+{
+    const trace_work_t *tw = &bw->tw;
+    const cplane_t  *plane;
+    trace_seg_t segs[MAX_TRACE_BATCH];
+    trace_seg_t out[MAX_TRACE_BATCH * 2];
+    float       fracs[MAX_TRACE_BATCH][2];
+    int         sides[MAX_TRACE_BATCH];
+    int         counts[4], starts[4];
+    float       t1, t2, offset;
+    float       frac, frac2;
+    float       idist;
+    int         i, n, side;
+
+    n = 0;
+    for (i = 0; i < numin; i++)
+        if (bw->traces[in[i].ray].fraction > in[i].p1f)
+            segs[n++] = in[i];
+    if (!n)
+        return;     // already hit something nearer
+
+recheck:
+    // if plane is NULL, we are in a leaf node
+    plane = node->plane;
+    if (!plane) {
+        CM_TraceToLeafBatch(bw, (const mleaf_t *)node, segs, n);
+        return;
+    }
+
+    // segments are sorted into 4 lists: near pieces going to child 0
+    // and child 1, then far pieces going to child 1 and child 0
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+
+    for (i = 0; i < n; i++) {
+        const trace_seg_t *s = &segs[i];
+
+        if (plane->type < 3) {
+            t1 = s->p1[plane->type] - plane->dist;
+            t2 = s->p2[plane->type] - plane->dist;
+            offset = tw->extents[plane->type];
+        } else {
+            t1 = PlaneDiff(s->p1, plane);
+            t2 = PlaneDiff(s->p2, plane);
+            if (tw->ispoint)
+                offset = 0;
+            else
+                offset = fabsf(tw->extents[0] * plane->normal[0]) +
+                         fabsf(tw->extents[1] * plane->normal[1]) +
+                         fabsf(tw->extents[2] * plane->normal[2]);
+        }
+
+        // see which sides we need to consider
+        if (t1 >= offset && t2 >= offset) {
+            sides[i] = 0;
+            counts[0]++;
+            continue;
+        }
+        if (t1 < -offset && t2 < -offset) {
+            sides[i] = 1;
+            counts[1]++;
+            continue;
+        }
+
+        // put the crosspoint DIST_EPSILON pixels on the near side
+        if (t1 < t2) {
+            idist = 1.0f / (t1 - t2);
+            side = 1;
+            frac2 = (t1 + offset + DIST_EPSILON) * idist;
+            frac = (t1 - offset + DIST_EPSILON) * idist;
+        } else if (t1 > t2) {
+            idist = 1.0f / (t1 - t2);
+            side = 0;
+            frac2 = (t1 - offset - DIST_EPSILON) * idist;
+            frac = (t1 + offset + DIST_EPSILON) * idist;
+        } else {
+            side = 0;
+            frac = 1;
+            frac2 = 0;
+        }
+
+        fracs[i][0] = Q_clipf(frac, 0, 1);
+        fracs[i][1] = Q_clipf(frac2, 0, 1);
+        sides[i] = side | 2;
+        counts[side]++;
+        counts[2 + side]++;
+    }
+
+    // nothing was split, keep going down without recursion
+    if (!counts[2] && !counts[3] && !(counts[0] && counts[1])) {
+        node = node->children[counts[1] > 0];
+        goto recheck;
+    }
+
+    starts[0] = 0;
+    for (i = 1; i < 4; i++)
+        starts[i] = starts[i - 1] + counts[i - 1];
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+
+    for (i = 0; i < n; i++) {
+        const trace_seg_t *s = &segs[i];
+        trace_seg_t *o;
+
+        side = sides[i] & 1;
+        if (!(sides[i] & 2)) {
+            out[starts[side] + counts[side]++] = *s;
+            continue;
+        }
+
+        // move up to the node
+        o = &out[starts[side] + counts[side]++];
+        o->ray = s->ray;
+        o->p1f = s->p1f;
+        o->p2f = s->p1f + (s->p2f - s->p1f) * fracs[i][0];
+        VectorCopy(s->p1, o->p1);
+        LerpVector(s->p1, s->p2, fracs[i][0], o->p2);
+
+        // go past the node
+        o = &out[starts[2 + side] + counts[2 + side]++];
+        o->ray = s->ray;
+        o->p1f = s->p1f + (s->p2f - s->p1f) * fracs[i][1];
+        o->p2f = s->p2f;
+        LerpVector(s->p1, s->p2, fracs[i][1], o->p1);
+        VectorCopy(s->p2, o->p2);
+    }
+
+    // every ray visits near side before far side, same as in single trace
+    if (counts[0])
+        CM_RecursiveHullCheckBatch(bw, node->children[0], &out[starts[0]], counts[0]);
+    if (counts[1])
+        CM_RecursiveHullCheckBatch(bw, node->children[1], &out[starts[1]], counts[1]);
+    if (counts[2])
+        CM_RecursiveHullCheckBatch(bw, node->children[1], &out[starts[2]], counts[2]);
+    if (counts[3])
+        CM_RecursiveHullCheckBatch(bw, node->children[0], &out[starts[3]], counts[3]);
+}
+
+/*
+==================
+CM_BoxTraceBatch
+
+Traces multiple boxes of the same size through the same model. Position
+tests (start equals end) are handed off to CM_BoxTrace().
+==================
+*/
+void CM_BoxTraceBatch(trace_t *traces,
+                      const vec3_t *starts, const vec3_t *ends, int count,
+                      const vec3_t mins, const vec3_t maxs,
+                      const mnode_t *headnode, int brushmask,
+                      bool extended)
+{
+    batch_work_t bw;
+    trace_seg_t segs[MAX_TRACE_BATCH];
+    int i, j, n;
+
+    if (count <= 0)
+        return;
+
+    if (!headnode) {
+        for (i = 0; i < count; i++)
+            CM_InitTrace(&traces[i]);
+        return;
+    }
+
+    CM_InitTraceWork(&bw.tw, vec3_origin, vec3_origin, mins, maxs, brushmask, extended);
+    bw.traces = traces;
+    bw.starts = starts;
+    bw.ends = ends;
+
+    for (i = 0; i < count; i += MAX_TRACE_BATCH) {
+        bw.first = i;
+        memset(bw.checked, 0, sizeof(bw.checked));
+
+        n = 0;
+        for (j = i; j < count && j < i + MAX_TRACE_BATCH; j++) {
+            if (VectorCompare(starts[j], ends[j])) {
+                CM_BoxTrace(&traces[j], starts[j], ends[j], mins, maxs, headnode, brushmask, extended);
+                continue;
+            }
+            CM_InitTrace(&traces[j]);
+            segs[n].ray = j;
+            segs[n].p1f = 0;
+            segs[n].p2f = 1;
+            VectorCopy(starts[j], segs[n].p1);
+            VectorCopy(ends[j], segs[n].p2);
+            n++;
+        }
+
+        if (n)
+            CM_RecursiveHullCheckBatch(&bw, headnode, segs, n);
+
+        for (j = 0; j < n; j++) {
+            trace_t *trace = &traces[segs[j].ray];
+            if (trace->fraction == 1)
+                VectorCopy(ends[segs[j].ray], trace->endpos);
+            else
+                LerpVector(starts[segs[j].ray], ends[segs[j].ray], trace->fraction, trace->endpos);
+        }
+    }
 }
 
 /*
@@ -860,7 +1488,7 @@ void CM_TransformedBoxTrace(trace_t *trace,
     VectorSubtract(end, origin, end_l);
 
     // rotate start and end into the models frame of reference
-    rotated = headnode != box_headnode && !VectorEmpty(angles);
+    rotated = !CM_IsBoxHull(headnode) && !VectorEmpty(angles);
     if (rotated) {
         AnglesToAxis(angles, axis);
         RotatePoint(start_l, axis);
@@ -1101,29 +1729,21 @@ bool CM_HeadnodeVisible(const mnode_t *node, const byte *visbits)
 
 /*
 ============
-CM_FatPVS
+CM_FatPVSClusters
 
-The client will interpolate the view position,
-so we can't use a single PVS point
+Fills in a list of unique clusters touched by the fat PVS box around
+origin. Returns -1 if map is not loaded or has no visibility info.
 ===========
 */
-void CM_FatPVS(const cm_t *cm, visrow_t *mask, const vec3_t org)
+int CM_FatPVSClusters(const cm_t *cm, const vec3_t org, int *clusters)
 {
     const bsp_t     *bsp = cm->cache;
-    const mleaf_t   *leafs[64];
-    int             clusters[64];
-    visrow_t        temp;
-    int             i, j, count, longs;
+    const mleaf_t   *leafs[MAX_FATPVS_CLUSTERS];
+    int             i, j, count, numclusters;
     vec3_t          mins, maxs;
 
-    if (!bsp) {   // map not loaded
-        memset(mask, 0, sizeof(*mask));
-        return;
-    }
-    if (!bsp->vis) {
-        memset(mask, 0xff, sizeof(*mask));
-        return;
-    }
+    if (!bsp || !bsp->vis)
+        return -1;
 
     for (i = 0; i < 3; i++) {
         mins[i] = org[i] - 8;
@@ -1134,29 +1754,75 @@ void CM_FatPVS(const cm_t *cm, visrow_t *mask, const vec3_t org)
     Q_assert(count > 0);
 
     // convert leafs to clusters
+    numclusters = 0;
     for (i = 0; i < count; i++) {
-        clusters[i] = leafs[i]->cluster;
+        for (j = 0; j < numclusters; j++) {
+            if (leafs[i]->cluster == clusters[j]) {
+                break; // already have the cluster we want
+            }
+        }
+        if (j == numclusters) {
+            clusters[numclusters++] = leafs[i]->cluster;
+        }
     }
 
+    return numclusters;
+}
+
+/*
+============
+CM_ClusterListPVS
+
+Combines PVS rows of all clusters in the list.
+===========
+*/
+void CM_ClusterListPVS(const cm_t *cm, visrow_t *mask, const int *clusters, int count)
+{
+    const bsp_t     *bsp = cm->cache;
+    visrow_t        temp;
+    int             i, j, longs;
+
+    Q_assert(count > 0);
+
     BSP_ClusterVis(bsp, mask, clusters[0], DVIS_PVS);
     longs = VIS_FAST_LONGS(bsp->visrowsize);
 
     // or in all the other leaf bits
     for (i = 1; i < count; i++) {
-        for (j = 0; j < i; j++) {
-            if (clusters[i] == clusters[j]) {
-                break; // already have the cluster we want
-            }
-        }
-        if (j == i) {
-            BSP_ClusterVis(bsp, &temp, clusters[i], DVIS_PVS);
-            for (j = 0; j < longs; j++) {
-                mask->l[j] |= temp.l[j];
-            }
+        BSP_ClusterVis(bsp, &temp, clusters[i], DVIS_PVS);
+        for (j = 0; j < longs; j++) {
+            mask->l[j] |= temp.l[j];
         }
     }
 }
 
+/*
+============
+CM_FatPVS
+
+The client will interpolate the view position,
+so we can't use a single PVS point
+===========
+*/
+void CM_FatPVS(const cm_t *cm, visrow_t *mask, const vec3_t org)
+{
+    int clusters[MAX_FATPVS_CLUSTERS];
+    int count;
+
+    if (!cm->cache) {   // map not loaded
+        memset(mask, 0, sizeof(*mask));
+        return;
+    }
+
+    count = CM_FatPVSClusters(cm, org, clusters);
+    if (count < 0) {
+        memset(mask, 0xff, sizeof(*mask));
+        return;
+    }
+
+    CM_ClusterListPVS(cm, mask, clusters, count);
+}
+
 /*
 =============
 CM_Init
@@ -1164,7 +1830,7 @@ CM_Init
 */
 void CM_Init(void)
 {
-    CM_InitBoxHull();
+    CM_InitTraceCtx(&cm_ctx);
 
     map_noareas = Cvar_Get("map_noareas", "0", 0);
     map_override_path = Cvar_Get("map_override_path", "", 0);
@@ -39,6 +39,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/net/chan.h"
 #include "common/net/net.h"
 #include "common/pmove.h"
+#include "common/prof.h"
 #include "common/prompt.h"
 #include "common/protocol.h"
 #include "common/tests.h"
@@ -64,7 +65,7 @@ static void     (*com_abort_func)(void *);
 static void     *com_abort_arg;
 
 static bool     com_errorEntered;
-static char     com_errorMsg[MAXERRORMSG]; // from Com_Printf/Com_Error
+static q_thread_local char com_errorMsg[MAXERRORMSG]; // from Com_Printf/Com_Error, per thread for async decoders
 
 static int      com_printEntered;
 
@@ -79,6 +80,7 @@ static int      com_argc;
 
 #if USE_TESTS
 cvar_t  *z_perturb;
+cvar_t  *z_pools;
 #endif
 
 #if USE_DEBUG
@@ -654,6 +656,7 @@ void Com_Quit(const char *reason, error_type_t type)
     logfile_close();
     FS_Shutdown();
     Com_ShutdownAsyncWork();
+    Prof_Shutdown();
 
     Sys_Quit();
     // doesn't get there
@@ -920,6 +923,7 @@ void Qcommon_Init(int argc, char **argv)
     //
 #if USE_TESTS
     z_perturb = Cvar_Get("z_perturb", "0", 0);
+    z_pools = Cvar_Get("z_pools", "1", 0);
 #endif
 #if USE_CLIENT
     host_speeds = Cvar_Get("host_speeds", "0", 0);
@@ -982,6 +986,9 @@ void Qcommon_Init(int argc, char **argv)
 
     Cmd_AddCommand("z_stats", Z_Stats_f);
 
+    Com_InitAsyncWork();
+    Prof_Init();
+
     //Cmd_AddCommand("setenv", Com_Setenv_f);
 
     Cmd_AddMacro("com_date", Com_Date_m);
@@ -1098,6 +1105,8 @@ void Qcommon_Frame(void)
 
     Com_CompleteAsyncWork();
 
+    FS_Frame();
+
 #if USE_CLIENT
     time_before = time_event = time_between = time_after = 0;
 
@@ -1169,6 +1178,8 @@ void Qcommon_Frame(void)
 
     remaining = SV_Frame(msec);
 
+    NET_FlushPackets();
+
 #if USE_CLIENT
     if (host_speeds->integer)
         time_between = Sys_Milliseconds();
@@ -18,6 +18,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "shared/shared.h"
 #include "shared/list.h"
+#include "common/async.h"
 #include "common/common.h"
 #include "common/cvar.h"
 #include "common/error.h"
@@ -25,6 +26,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/prompt.h"
 #include "common/intreadwrite.h"
 #include "common/mapdb.h"
+#include "system/hunk.h"
+#include "system/pthread.h"
 #include "system/system.h"
 #include "client/client.h"
 #include "server/server.h"
@@ -36,6 +39,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <zlib.h>
 #endif
 
+#if HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "common/loc.h"
 
 /*
@@ -198,6 +206,9 @@ typedef struct {
     filetype_t  type;       // FS_PAK, FS_ZIP or FS_BUILTIN
     unsigned    refcount;   // for tracking pack users
     FILE        *fp;
+    list_t      mapped_entry;
+    const byte  *mapped;    // entire file mapped read-only, or NULL
+    int64_t     mapped_size;
     unsigned    num_files;
     unsigned    hash_size;
     packfile_t  *files;
@@ -210,6 +221,12 @@ typedef struct searchpath_s {
     struct searchpath_s *next;
     pack_t      *pack;        // only one of filename / pack will be used
     unsigned    mode;
+    unsigned    rank;         // position in search order, for file index
+    void        **files;      // cached directory listing, for file index
+    int         num_files;
+    bool        listed;       // files is valid, but may be stale
+    bool        rescan;       // files must be listed again on next build
+    bool        unlisted;     // directory didn't exist, always check on disk
     char        filename[1];
 } searchpath_t;
 
@@ -251,7 +268,21 @@ static int          fs_num_files;
 
 static bool         fs_non_uniq_open;
 
+// loose file mapped into memory by FS_LoadFile
+typedef struct {
+    list_t      entry;
+    void        *base;
+    size_t      size;
+} mapped_file_t;
+
+// packs and loose files mapped into memory, and number of views handed out
+static list_t       fs_mapped_packs;
+static list_t       fs_mapped_files;
+static unsigned     fs_num_views;
+
 #if USE_DEBUG
+static unsigned     fs_count_views;
+static uint64_t     fs_count_view_bytes;
 static unsigned     fs_count_read;
 static unsigned     fs_count_open;
 static unsigned     fs_count_strcmp;
@@ -268,6 +299,7 @@ static unsigned     fs_count_strlwr;
 #endif
 
 static cvar_t       *fs_autoexec;
+static cvar_t       *fs_mmap;
 
 #if USE_DEBUG
 static cvar_t       *fs_debug;
@@ -290,6 +322,9 @@ static int seek_zip_file(file_t *file, int64_t offset, int whence);
 static pack_t *pack_get(pack_t *pack);
 static void pack_put(pack_t *pack);
 
+// for keeping file index up to date with files written
+static void index_add_path(const char *fullpath);
+
 /*
 
 All of Quake's data access is through a hierchal file system,
@@ -1010,6 +1045,8 @@ static int64_t open_file_write(file_t *file, const char *name)
         goto fail;
     }
 
+    index_add_path(fullpath);
+
     FS_DPrintf("%s: %s: %"PRId64" bytes\n", __func__, fullpath, pos);
     return pos;
 
@@ -1414,539 +1451,1921 @@ fail:
     return ret;
 }
 
-// Finds the file in the search path.
-// Fills file_t and returns file length.
-// Used for streaming data out of either a pak file or a separate file.
-static int64_t open_file_read(file_t *file, const char *normalized, size_t namelen)
-{
-    char            fullpath[MAX_OSPATH];
-    searchpath_t    *search;
-    pack_t          *pak;
-    unsigned        hash;
-    packfile_t      *entry;
-    int64_t         ret;
-    path_valid_t    valid;
+/*
+=============================================================================
 
-    FS_COUNT_READ;
+FILE INDEX
 
-    if (!namelen)
-        return Q_ERR_INVALID_PATH;
+Every search path is merged into a single hash table keyed by file name,
+with the places each file can be found kept in search order. Directories
+are listed once when search paths are set up, so that opening a file
+doesn't need to probe each directory on disk in turn. Files created
+through the filesystem are added as they are written, others are picked
+up by inotify where available, or by the fs_rescan command.
 
-    hash = FS_HashPath(normalized, 0);
+=============================================================================
+*/
 
-    valid = PATH_NOT_CHECKED;
+#define MAX_INDEX_PROBES    16
+#define INDEX_RESERVE       0x10000     // room for files added after build
+
+typedef struct fssource_s {
+    struct fssource_s   *next;      // next place file can be found
+    searchpath_t        *search;
+    packfile_t          *entry;     // NULL for loose files
+    const char          *name;      // name on disk for loose files
+} fssource_t;
+
+typedef struct fsentry_s {
+    struct fsentry_s    *hash_next;
+    fssource_t          *sources;   // in search order
+    const char          *name;
+    unsigned            namelen;
+    unsigned            hash;
+} fsentry_t;
+
+#if HAVE_INOTIFY
+typedef struct {
+    int             wd;
+    searchpath_t    *search;
+    char            *dir;       // relative to search path, with trailing slash
+} fswatch_t;
+#endif
 
-// search through the path, one element at a time
-    for (search = fs_searchpaths; search; search = search->next) {
-        if ((file->mode & search->mode & FS_PATH_MASK) == 0 ||
-            (file->mode & search->mode & FS_DIR_MASK ) == 0) {
-            continue;
-        }
+static struct {
+    memhunk_t       hunk;
+    fsentry_t       **hash;         // NULL if index is not built
+    unsigned        hash_size;
+    unsigned        num_entries;
+    unsigned        num_sources;
+
+    // directories that didn't exist when listed are always checked on disk
+    searchpath_t    *probes[MAX_INDEX_PROBES];
+    int             num_probes;
+
+#if HAVE_INOTIFY
+    int             inotify_fd;
+    fswatch_t       *watches;
+    int             num_watches;
+    bool            watch_failed;
+#endif
+} fs_index;
 
-        // is the element a pak file?
-        if (search->pack) {
-            if ((file->mode & FS_TYPE_MASK) == FS_TYPE_REAL) {
-                continue;
-            }
-            // don't bother searching in paks if length exceedes MAX_QPATH
-            if (namelen >= MAX_QPATH) {
-                continue;
-            }
-            pak = search->pack;
-            // look through all the pak file elements
-            entry = pak->file_hash[hash & (pak->hash_size - 1)];
-            for (; entry; entry = entry->hash_next) {
-                if (entry->namelen != namelen) {
-                    continue;
-                }
-                FS_COUNT_STRCMP;
-                if (!FS_pathcmp(pak->names + entry->nameofs, normalized)) {
-                    // found it!
-                    return open_from_pack(file, pak, entry);
-                }
-            }
-        } else {
-            if ((file->mode & FS_TYPE_MASK) == FS_TYPE_PAK) {
-                continue;
-            }
-            // don't error out immediately if the path is found to be invalid,
-            // just stop looking for it in directory tree but continue to search
-            // for it in packs, to give broken maps or mods a chance to work
-            if (valid == PATH_NOT_CHECKED) {
-                valid = FS_ValidatePath(normalized);
-            }
-            if (valid == PATH_INVALID) {
-                continue;
-            }
-            // check a file in the directory tree
-            if (Q_concat(fullpath, sizeof(fullpath), search->filename,
-                         "/", normalized) >= sizeof(fullpath)) {
-                ret = Q_ERR(ENAMETOOLONG);
-                goto fail;
-            }
+static cvar_t       *fs_index_enable;
 
-            ret = open_from_disk(file, fullpath);
-            if (ret != Q_ERR(ENOENT))
-                return ret;
+static void index_build(void);
 
-#ifndef _WIN32
-            if (valid == PATH_MIXED_CASE) {
-                // convert to lower case and retry
-                FS_COUNT_STRLWR;
-                Q_strlwr(fullpath + strlen(search->filename) + 1);
-                ret = open_from_disk(file, fullpath);
-                if (ret != Q_ERR(ENOENT))
-                    return ret;
-            }
-#endif
+#if HAVE_INOTIFY
+
+static void index_add_watch(searchpath_t *search, const char *path, const char *dir)
+{
+    fswatch_t *w;
+    int wd;
+
+    wd = inotify_add_watch(fs_index.inotify_fd, path, IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd == -1) {
+        if (!fs_index.watch_failed) {
+            Com_WPrintf("Couldn't watch %s: %s. Use fs_rescan after adding files.\n",
+                        path, strerror(errno));
+            fs_index.watch_failed = true;
         }
+        return;
     }
 
-    // return error if path was checked and found to be invalid
-    ret = valid ? Q_ERR(ENOENT) : Q_ERR_INVALID_PATH;
+    // watching the same directory again returns the same descriptor
+    for (int i = 0; i < fs_index.num_watches; i++) {
+        if (fs_index.watches[i].wd == wd && fs_index.watches[i].search == search) {
+            return;
+        }
+    }
 
-fail:
-    FS_DPrintf("%s: %s: %s\n", __func__, normalized, Q_ErrorString(ret));
-    return ret;
+    fs_index.watches = Z_Realloc(fs_index.watches, sizeof(*w) * Q_ALIGN(fs_index.num_watches + 1, 64));
+    w = &fs_index.watches[fs_index.num_watches++];
+    w->wd = wd;
+    w->search = search;
+    w->dir = FS_CopyString(dir);
 }
 
-// Normalizes quake path, expands symlinks
-static int64_t expand_open_file_read(file_t *file, const char *name)
+static void index_watch_dir(searchpath_t *search)
 {
-    char        normalized[MAX_OSPATH];
-    int64_t     ret;
-    size_t      namelen;
+    char path[MAX_OSPATH], dir[MAX_OSPATH];
+    listfiles_t list;
+    int i;
 
-// normalize path
-    namelen = FS_NormalizePathBuffer(normalized, name, MAX_OSPATH);
-    if (namelen >= MAX_OSPATH) {
-        return Q_ERR(ENAMETOOLONG);
+    if (fs_index.inotify_fd == -1) {
+        fs_index.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fs_index.inotify_fd == -1) {
+            Com_WPrintf("Couldn't initialize inotify: %s. Use fs_rescan after adding files.\n",
+                        strerror(errno));
+            fs_index.inotify_fd = -2;
+        }
+    }
+    if (fs_index.inotify_fd < 0) {
+        return;
     }
 
-// expand hard symlinks
-    if (expand_links(&fs_hard_links, normalized, &namelen) && namelen >= MAX_OSPATH) {
-        return Q_ERR(ENAMETOOLONG);
+    // watch subdirectories before files are listed, so that nothing created
+    // in between is missed
+    memset(&list, 0, sizeof(list));
+    list.flags = FS_SEARCH_RECURSIVE | FS_SEARCH_DIRSONLY;
+    list.baselen = strlen(search->filename) + 1;
+    Sys_ListFiles_r(&list, search->filename, 0);
+
+    index_add_watch(search, search->filename, "");
+    for (i = 0; i < list.count; i++) {
+        if (Q_concat(path, sizeof(path), search->filename, "/", list.files[i]) < sizeof(path) &&
+            Q_concat(dir, sizeof(dir), list.files[i], "/") < sizeof(dir)) {
+            index_add_watch(search, path, dir);
+        }
+        Z_Free(list.files[i]);
     }
+    Z_Free(list.files);
+}
 
-    ret = open_file_read(file, normalized, namelen);
-    if (ret == Q_ERR(ENOENT)) {
-// expand soft symlinks
-        if (expand_links(&fs_soft_links, normalized, &namelen)) {
-            if (namelen >= MAX_OSPATH) {
-                return Q_ERR(ENAMETOOLONG);
+static void index_unwatch_dir(const searchpath_t *search)
+{
+    fswatch_t *w;
+    int i, j;
+
+    for (i = j = 0, w = fs_index.watches; i < fs_index.num_watches; i++, w++) {
+        if (w->search != search) {
+            fs_index.watches[j++] = *w;
+            continue;
+        }
+        // descriptor may be shared with another search path
+        for (int k = 0; k < fs_index.num_watches; k++) {
+            if (k != i && fs_index.watches[k].wd == w->wd) {
+                goto keep;
             }
-            ret = open_file_read(file, normalized, namelen);
         }
+        inotify_rm_watch(fs_index.inotify_fd, w->wd);
+keep:
+        Z_Free(w->dir);
     }
-
-    return ret;
+    fs_index.num_watches = j;
 }
 
-static int read_pak_file(file_t *file, void *buf, size_t len)
+#endif // HAVE_INOTIFY
+
+// frees cached directory listing
+static void index_free_listing(searchpath_t *search)
 {
-    size_t result;
+    int i;
 
-    Q_assert(file->position <= file->length);
+#if HAVE_INOTIFY
+    index_unwatch_dir(search);
+#endif
 
-    len = min(len, file->length - file->position);
-    if (!len) {
-        return 0;
+    for (i = 0; i < search->num_files; i++) {
+        Z_Free(search->files[i]);
     }
+    Z_Free(search->files);
+    search->files = NULL;
+    search->num_files = 0;
+    search->listed = false;
+}
 
-    result = fread(buf, 1, len, file->fp);
-    if (result != len) {
-        file->error = FS_ERR_READ(file->fp);
-        if (!result) {
-            return file->error;
-        }
+static void index_list_dir(searchpath_t *search)
+{
+    listfiles_t list;
+
+    index_free_listing(search);
+
+    search->listed = true;
+    search->rescan = false;
+    search->unlisted = os_access(search->filename, F_OK) == -1;
+    if (search->unlisted) {
+        return;
     }
 
-    file->position += result;
-    return result;
-}
+#if HAVE_INOTIFY
+    index_watch_dir(search);
+#endif
 
-static int read_builtin_file(file_t *file, void *buf, size_t len)
-{
-    Q_assert(file->position <= file->length);
+    memset(&list, 0, sizeof(list));
+    list.flags = FS_SEARCH_RECURSIVE;
+    list.baselen = strlen(search->filename) + 1;
+    Sys_ListFiles_r(&list, search->filename, 0);
 
-    len = min(len, file->length - file->position);
-    if (!len) {
-        return 0;
+#ifdef _WIN32
+    for (int i = 0; i < list.count; i++) {
+        FS_ReplaceSeparators(list.files[i], '/');
     }
+#endif
 
-    memcpy(buf, (const void *) (intptr_t) (file->entry->filepos + file->position), len);
+    search->files = list.files;
+    search->num_files = list.count;
+}
 
-    file->position += len;
+static void index_free(void)
+{
+    if (!fs_index.hash) {
+        return;
+    }
 
-    return len;
+    Z_Free(fs_index.hash);
+    Hunk_Free(&fs_index.hunk);
+    fs_index.hash = NULL;
+    fs_index.hash_size = 0;
+    fs_index.num_entries = 0;
+    fs_index.num_sources = 0;
+    fs_index.num_probes = 0;
 }
 
-static int read_phys_file(file_t *file, void *buf, size_t len)
+static fsentry_t *index_find(const char *name, size_t namelen, unsigned hash)
 {
-    size_t result;
+    fsentry_t *entry;
 
-    result = fread(buf, 1, len, file->fp);
-    if (result != len && ferror(file->fp)) {
-        file->error = Q_ERR_FAILURE;
-        if (!result) {
-            return file->error;
+    for (entry = fs_index.hash[hash & (fs_index.hash_size - 1)]; entry; entry = entry->hash_next) {
+        if (entry->hash != hash || entry->namelen != namelen) {
+            continue;
+        }
+        FS_COUNT_STRCMP;
+        if (!FS_pathcmp(entry->name, name)) {
+            return entry;
         }
     }
 
-    return result;
+    return NULL;
 }
 
-/*
-=================
-FS_Read
-=================
-*/
-int FS_Read(void *buf, size_t len, qhandle_t f)
+static bool index_insert(searchpath_t *search, packfile_t *file, const char *name, size_t namelen)
 {
-    file_t *file = file_for_handle(f);
-#if USE_ZLIB
-    int ret;
-#endif
+    unsigned hash = FS_HashPathLen(name, namelen, 0);
+    fsentry_t *entry = index_find(name, namelen, hash);
+    fssource_t *src, **p;
 
-    if (!file)
-        return Q_ERR(EBADF);
+    if (!entry) {
+        entry = Hunk_TryAlloc(&fs_index.hunk, sizeof(*entry), q_alignof(fsentry_t));
+        if (!entry) {
+            return false;
+        }
+        entry->sources = NULL;
+        entry->name = name;
+        entry->namelen = namelen;
+        entry->hash = hash;
+        entry->hash_next = fs_index.hash[hash & (fs_index.hash_size - 1)];
+        fs_index.hash[hash & (fs_index.hash_size - 1)] = entry;
+        fs_index.num_entries++;
+    }
 
-    if ((file->mode & FS_MODE_MASK) != FS_MODE_READ)
-        return Q_ERR(EBADF);
+    src = Hunk_TryAlloc(&fs_index.hunk, sizeof(*src), q_alignof(fssource_t));
+    if (!src) {
+        return false;
+    }
+    src->search = search;
+    src->entry = file;
+    src->name = name;
 
-    // can't continue after error
-    if (file->error)
-        return file->error;
+    for (p = &entry->sources; *p && (*p)->search->rank <= search->rank; p = &(*p)->next)
+        ;
+    src->next = *p;
+    *p = src;
+    fs_index.num_sources++;
+    return true;
+}
 
-    if (len > INT_MAX)
-        return Q_ERR(EINVAL);
+// (re)builds the index, listing only directories that aren't cached yet
+static void index_build(void)
+{
+    searchpath_t *search;
+    unsigned rank = 0;
+    size_t count = 0;
+    pack_t *pack;
+    int i;
 
-    if (len == 0)
-        return 0;
+    index_free();
 
-    switch (file->type) {
-    case FS_REAL:
-        return read_phys_file(file, buf, len);
-    case FS_PAK:
-        return read_pak_file(file, buf, len);
-    case FS_BUILTIN:
-        return read_builtin_file(file, buf, len);
-#if USE_ZLIB
-    case FS_GZ:
-        ret = gzread(file->zfp, buf, len);
-        if (ret < 0) {
-            return Q_ERR_LIBRARY_ERROR;
-        }
-        return ret;
-    case FS_ZIP:
-        return read_zip_file(file, buf, len);
-#endif
-    default:
-        Q_assert(!"bad file type");
-        return 0;
+    if (!fs_index_enable || !fs_index_enable->integer) {
+        return;
     }
-}
 
-int FS_ReadLine(qhandle_t f, char *buffer, size_t size)
-{
-    file_t *file = file_for_handle(f);
-    char *s;
+    for (search = fs_searchpaths; search; search = search->next) {
+        search->rank = rank++;
+        if (search->pack) {
+            count += search->pack->num_files;
+            continue;
+        }
+        if (!search->listed || search->rescan) {
+            index_list_dir(search);
+        }
+        if (search->unlisted) {
+            if (fs_index.num_probes == MAX_INDEX_PROBES) {
+                Com_WPrintf("Too many missing directories in search path, file index disabled\n");
+                fs_index.num_probes = 0;
+                return;
+            }
+            fs_index.probes[fs_index.num_probes++] = search;
+        }
+        count += search->num_files;
+    }
 
-    if (!file)
-        return Q_ERR(EBADF);
+    fs_index.hash_size = Q_npot32(max(count, MIN_LISTED_FILES));
+    fs_index.hash = FS_Mallocz(sizeof(fs_index.hash[0]) * fs_index.hash_size);
+    Hunk_Begin(&fs_index.hunk, (count + INDEX_RESERVE) * (sizeof(fsentry_t) + sizeof(fssource_t)));
 
-    if ((file->mode & FS_MODE_MASK) != FS_MODE_READ)
-        return Q_ERR(EBADF);
+    for (search = fs_searchpaths; search; search = search->next) {
+        if ((pack = search->pack)) {
+            for (i = 0; i < pack->num_files; i++) {
+                packfile_t *file = &pack->files[i];
+                if (!index_insert(search, file, pack->names + file->nameofs, file->namelen)) {
+                    goto oom;
+                }
+            }
+        } else {
+            for (i = 0; i < search->num_files; i++) {
+                if (!index_insert(search, NULL, search->files[i], strlen(search->files[i]))) {
+                    goto oom;
+                }
+            }
+        }
+    }
 
-    if (size < 1 || size > INT_MAX)
-        return Q_ERR(EINVAL);
+    FS_DPrintf("%s: %u files from %u sources\n", __func__,
+               fs_index.num_entries, fs_index.num_sources);
+    return;
 
-    *buffer = 0;
+oom:
+    Com_EPrintf("%s: out of reserved memory\n", __func__);
+    index_free();
+}
 
-    switch (file->type) {
-    case FS_REAL:
-        s = fgets(buffer, size, file->fp);
-        if (!s)
-            return ferror(file->fp) ? Q_ERR_FAILURE : 0;
-        break;
-#if USE_ZLIB
-    case FS_GZ:
-        s = gzgets(file->zfp, buffer, size);
-        if (!s)
-            return 0;
-        break;
-#endif
-    default:
-        return Q_ERR(ENOSYS);
+// adds file just created on disk, name is relative to search path
+static void index_add_loose(searchpath_t *search, const char *name)
+{
+    size_t namelen = strlen(name);
+    fsentry_t *entry;
+    fssource_t *src;
+    char *copy;
+
+    if (!search->listed || search->unlisted) {
+        return;
     }
 
-    return strlen(s);
+    if (!fs_index.hash) {
+        // pick it up when index is built again
+        search->rescan = true;
+        return;
+    }
+
+    entry = index_find(name, namelen, FS_HashPathLen(name, namelen, 0));
+    if (entry) {
+        for (src = entry->sources; src; src = src->next) {
+            if (src->search == search && !strcmp(src->name, name)) {
+                return;
+            }
+        }
+    }
+
+    copy = FS_CopyString(name);
+    search->files = FS_ReallocList(search->files, search->num_files + 1);
+    search->files[search->num_files++] = copy;
+
+    // out of reserved space, start over
+    if (!index_insert(search, NULL, copy, namelen)) {
+        index_build();
+    }
 }
 
-int FS_Flush(qhandle_t f)
+// adds file just created on disk, given full OS path
+static void index_add_path(const char *fullpath)
 {
-    file_t *file = file_for_handle(f);
-    int ret = Q_ERR_SUCCESS;
+    searchpath_t *search;
+    size_t len;
 
-    if (!file)
-        return Q_ERR(EBADF);
+    for (search = fs_searchpaths; search; search = search->next) {
+        if (search->pack) {
+            continue;
+        }
+        len = strlen(search->filename);
+        if (!strncmp(fullpath, search->filename, len) && fullpath[len] == '/') {
+            index_add_loose(search, fullpath + len + 1);
+        }
+    }
+}
 
-    if ((file->mode & FS_MODE_MASK) == FS_MODE_READ)
-        return Q_ERR(EBADF);
+// checks if file can be looked up in the index, the rest goes to disk
+static bool index_covers(const file_t *file, const char *normalized)
+{
+    const char *s;
+    int depth = 0;
 
-    switch (file->type) {
-    case FS_REAL:
-        if (fflush(file->fp))
-            ret = Q_ERRNO;
-        break;
-#if USE_ZLIB
-    case FS_GZ:
-        if (gzflush(file->zfp, Z_SYNC_FLUSH))
-            ret = Q_ERR_LIBRARY_ERROR;
-        break;
+    if (!fs_index.hash) {
+        return false;
+    }
+
+    // loose files only, these are rare (savegames, configs)
+    if ((file->mode & FS_TYPE_MASK) == FS_TYPE_REAL) {
+        return false;
+    }
+
+    // directory listing skips hidden files and limits depth
+    if (*normalized == '.') {
+        return false;
+    }
+    for (s = normalized; *s; s++) {
+        if (*s == '/') {
+            if (s[1] == '.' || ++depth > MAX_LISTED_DEPTH) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+#ifndef _WIN32
+// checks if name is lower case version of normalized
+static bool is_lower_name(const char *name, const char *normalized, size_t namelen)
+{
+    for (size_t i = 0; i < namelen; i++) {
+        if (name[i] != Q_tolower(normalized[i])) {
+            return false;
+        }
+    }
+    return true;
+}
 #endif
-    default:
-        Q_assert(!"bad file type");
+
+#if USE_DEBUG
+static unsigned     fs_count_index_hits;
+static unsigned     fs_count_index_misses;
+static unsigned     fs_count_index_stale;
+static uint64_t     fs_count_index_saved;
+
+// counts failed opens the full path walk would have done before finding the
+// file, minus the ones actually done
+static void index_count_saved(const file_t *file, const searchpath_t *found,
+                              const char *normalized, unsigned opened)
+{
+    const searchpath_t *search;
+    path_valid_t valid = FS_ValidatePath(normalized);
+    unsigned tries = 1, total = 0;
+
+    if (valid == PATH_INVALID) {
+        tries = 0;
+    }
+#ifndef _WIN32
+    if (valid == PATH_MIXED_CASE) {
+        tries = 2;
+    }
+#endif
+
+    for (search = fs_searchpaths; search && search != found; search = search->next) {
+        if ((file->mode & search->mode & FS_PATH_MASK) == 0 ||
+            (file->mode & search->mode & FS_DIR_MASK ) == 0) {
+            continue;
+        }
+        if (!search->pack && (file->mode & FS_TYPE_MASK) != FS_TYPE_PAK) {
+            total += tries;
+        }
+    }
+
+    if (total > opened) {
+        fs_count_index_saved += total - opened;
+    }
+}
+#endif
+
+// checks a file in the directory tree
+static int64_t open_from_dir(file_t *file, const searchpath_t *search,
+                             const char *normalized, path_valid_t valid)
+{
+    char        fullpath[MAX_OSPATH];
+    int64_t     ret;
+
+    if (Q_concat(fullpath, sizeof(fullpath), search->filename,
+                 "/", normalized) >= sizeof(fullpath)) {
+        return Q_ERR(ENAMETOOLONG);
+    }
+
+    ret = open_from_disk(file, fullpath);
+
+#ifndef _WIN32
+    if (ret == Q_ERR(ENOENT) && valid == PATH_MIXED_CASE) {
+        // convert to lower case and retry
+        FS_COUNT_STRLWR;
+        Q_strlwr(fullpath + strlen(search->filename) + 1);
+        ret = open_from_disk(file, fullpath);
     }
+#endif
 
     return ret;
 }
 
-/*
-=================
-FS_Write
-=================
-*/
-int FS_Write(const void *buf, size_t len, qhandle_t f)
+// Same as open_file_read, but only tries places the file is known to exist.
+static int64_t open_file_indexed(file_t *file, const char *normalized, size_t namelen, unsigned hash)
 {
-    file_t  *file = file_for_handle(f);
+    char            fullpath[MAX_OSPATH];
+    searchpath_t    *search;
+    fsentry_t       *entry;
+    fssource_t      *src, *next;
+    int64_t         ret;
+    path_valid_t    valid;
+    int             probe;
+#if USE_DEBUG
+    unsigned        opened = fs_count_open;
+#endif
 
-    if (!file)
-        return Q_ERR(EBADF);
+    entry = index_find(normalized, namelen, hash);
+    next = entry ? entry->sources : NULL;
+    probe = 0;
 
-    if ((file->mode & FS_MODE_MASK) == FS_MODE_READ)
-        return Q_ERR(EBADF);
+    valid = PATH_NOT_CHECKED;
 
-    // can't continue after error
-    if (file->error)
-        return file->error;
+    // merge known sources with directories that must be probed
+    while (next || probe < fs_index.num_probes) {
+        if (probe < fs_index.num_probes &&
+            (!next || fs_index.probes[probe]->rank < next->search->rank)) {
+            search = fs_index.probes[probe++];
+            src = NULL;
+        } else {
+            src = next;
+            next = src->next;
+            search = src->search;
+        }
 
-    if (len > INT_MAX)
-        return Q_ERR(EINVAL);
+        if ((file->mode & search->mode & FS_PATH_MASK) == 0 ||
+            (file->mode & search->mode & FS_DIR_MASK ) == 0) {
+            continue;
+        }
 
-    if (len == 0)
-        return 0;
+        if (src && src->entry) {
+            // don't bother searching in paks if length exceedes MAX_QPATH
+            if (namelen >= MAX_QPATH) {
+                continue;
+            }
+#if USE_DEBUG
+            fs_count_index_hits++;
+            index_count_saved(file, search, normalized, fs_count_open - opened);
+#endif
+            return open_from_pack(file, search->pack, src->entry);
+        }
 
-    switch (file->type) {
-    case FS_REAL:
-        if (fwrite(buf, 1, len, file->fp) != len) {
-            file->error = Q_ERR_FAILURE;
-            return file->error;
+        if ((file->mode & FS_TYPE_MASK) == FS_TYPE_PAK) {
+            continue;
         }
-        break;
-#if USE_ZLIB
-    case FS_GZ:
-        if (gzwrite(file->zfp, buf, len) != len) {
-            file->error = Q_ERR_LIBRARY_ERROR;
-            return file->error;
+        if (valid == PATH_NOT_CHECKED) {
+            valid = FS_ValidatePath(normalized);
+        }
+        if (valid == PATH_INVALID) {
+            continue;
+        }
+
+        if (!src) {
+            ret = open_from_dir(file, search, normalized, valid);
+        } else {
+#ifndef _WIN32
+            // host filesystem is case sensitive, the name on disk must match
+            // either exactly, or lower case version for mixed case paths
+            if (strcmp(src->name, normalized)) {
+                const fssource_t *other;
+
+                if (valid != PATH_MIXED_CASE || !is_lower_name(src->name, normalized, namelen)) {
+                    continue;
+                }
+                // exact match is tried first
+                for (other = next; other && other->search == search; other = other->next) {
+                    if (!other->entry && !strcmp(other->name, normalized)) {
+                        break;
+                    }
+                }
+                if (other && other->search == search) {
+                    continue;
+                }
+            }
+#endif
+            if (Q_concat(fullpath, sizeof(fullpath), search->filename,
+                         "/", src->name) >= sizeof(fullpath)) {
+                continue;
+            }
+            ret = open_from_disk(file, fullpath);
+        }
+
+        if (ret != Q_ERR(ENOENT)) {
+#if USE_DEBUG
+            if (ret >= 0) {
+                fs_count_index_hits++;
+                index_count_saved(file, search, normalized, fs_count_open - opened - 1);
+            }
+#endif
+            return ret;
+        }
+
+#if USE_DEBUG
+        if (src) {
+            fs_count_index_stale++;
         }
-        break;
 #endif
-    default:
-        Q_assert(!"bad file type");
     }
 
-    return len;
+#if USE_DEBUG
+    fs_count_index_misses++;
+    index_count_saved(file, NULL, normalized, fs_count_open - opened);
+#endif
+
+    // full path walk would have validated it in the first directory
+    if (valid == PATH_NOT_CHECKED && (file->mode & FS_TYPE_MASK) != FS_TYPE_PAK) {
+        valid = FS_ValidatePath(normalized);
+    }
+
+    // return error if path was checked and found to be invalid
+    ret = valid ? Q_ERR(ENOENT) : Q_ERR_INVALID_PATH;
+
+    FS_DPrintf("%s: %s: %s\n", __func__, normalized, Q_ErrorString(ret));
+    return ret;
 }
 
-static unsigned default_lookup_flags(unsigned flags)
+#if HAVE_INOTIFY
+
+static void index_poll(void)
 {
-    if (!(flags & FS_PATH_MASK) || !fs_game->string[0])
-        flags |= FS_PATH_MASK;
+    union {
+        struct inotify_event    ev;
+        char                    buf[4096];
+    } data;
+    const struct inotify_event *ev;
+    char name[MAX_OSPATH];
+    bool rebuild = false;
+    searchpath_t *search;
+    ssize_t len;
+    int i;
 
-    if (!(flags & FS_DIR_MASK) || !sys_homedir->string[0])
-        flags |= FS_DIR_MASK;
+    while ((len = read(fs_index.inotify_fd, data.buf, sizeof(data.buf))) > 0) {
+        for (i = 0; i < len; i += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *)(data.buf + i);
 
-    return flags;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                for (search = fs_searchpaths; search; search = search->next) {
+                    search->rescan = !search->pack;
+                }
+                rebuild = true;
+                continue;
+            }
+
+            if (!ev->len || ev->name[0] == '.') {
+                continue;
+            }
+
+            for (int j = 0; j < fs_index.num_watches; j++) {
+                fswatch_t *w = &fs_index.watches[j];
+                if (w->wd != ev->wd) {
+                    continue;
+                }
+                if (ev->mask & IN_ISDIR) {
+                    // new subdirectory may already have files in it
+                    w->search->rescan = true;
+                    rebuild = true;
+                } else if (Q_concat(name, sizeof(name), w->dir, ev->name) < sizeof(name)) {
+                    index_add_loose(w->search, name);
+                }
+            }
+        }
+    }
+
+    if (rebuild) {
+        index_build();
+    }
 }
 
+#endif // HAVE_INOTIFY
+
 /*
-============
-FS_OpenFile
-============
+================
+FS_Frame
+
+Picks up files created outside of the filesystem.
+================
 */
-int64_t FS_OpenFile(const char *name, qhandle_t *f, unsigned mode)
+void FS_Frame(void)
 {
-    file_t *file;
-    qhandle_t handle;
-    int64_t ret;
+    // preloaded files are only claimed in the frame they were planned
+    FS_EndPreload();
 
-    Q_assert(name);
-    Q_assert(f);
-
-    *f = 0;
+#if HAVE_INOTIFY
+    if (fs_index.inotify_fd >= 0) {
+        index_poll();
+    }
+#endif
+}
+
+/*
+================
+FS_NotifyNewFile
+
+Adds file just created on disk by other means than FS_OpenFile.
+================
+*/
+void FS_NotifyNewFile(const char *fullpath)
+{
+    index_add_path(fullpath);
+}
+
+static void FS_Rescan_f(void)
+{
+    searchpath_t *search;
+
+    for (search = fs_searchpaths; search; search = search->next) {
+        search->rescan = !search->pack;
+    }
+
+    index_build();
+
+    if (fs_index.hash) {
+        Com_Printf("%u files indexed\n", fs_index.num_entries);
+    }
+}
+
+static void fs_index_changed(cvar_t *self)
+{
+    FS_Rescan_f();
+}
+
+// Finds the file in the search path.
+// Fills file_t and returns file length.
+// Used for streaming data out of either a pak file or a separate file.
+static int64_t open_file_read(file_t *file, const char *normalized, size_t namelen)
+{
+    searchpath_t    *search;
+    pack_t          *pak;
+    unsigned        hash;
+    packfile_t      *entry;
+    int64_t         ret;
+    path_valid_t    valid;
+
+    FS_COUNT_READ;
+
+    if (!namelen)
+        return Q_ERR_INVALID_PATH;
+
+    hash = FS_HashPath(normalized, 0);
+
+    if (index_covers(file, normalized))
+        return open_file_indexed(file, normalized, namelen, hash);
+
+    valid = PATH_NOT_CHECKED;
+
+// search through the path, one element at a time
+    for (search = fs_searchpaths; search; search = search->next) {
+        if ((file->mode & search->mode & FS_PATH_MASK) == 0 ||
+            (file->mode & search->mode & FS_DIR_MASK ) == 0) {
+            continue;
+        }
+
+        // is the element a pak file?
+        if (search->pack) {
+            if ((file->mode & FS_TYPE_MASK) == FS_TYPE_REAL) {
+                continue;
+            }
+            // don't bother searching in paks if length exceedes MAX_QPATH
+            if (namelen >= MAX_QPATH) {
+                continue;
+            }
+            pak = search->pack;
+            // look through all the pak file elements
+            entry = pak->file_hash[hash & (pak->hash_size - 1)];
+            for (; entry; entry = entry->hash_next) {
+                if (entry->namelen != namelen) {
+                    continue;
+                }
+                FS_COUNT_STRCMP;
+                if (!FS_pathcmp(pak->names + entry->nameofs, normalized)) {
+                    // found it!
+                    return open_from_pack(file, pak, entry);
+                }
+            }
+        } else {
+            if ((file->mode & FS_TYPE_MASK) == FS_TYPE_PAK) {
+                continue;
+            }
+            // don't error out immediately if the path is found to be invalid,
+            // just stop looking for it in directory tree but continue to search
+            // for it in packs, to give broken maps or mods a chance to work
+            if (valid == PATH_NOT_CHECKED) {
+                valid = FS_ValidatePath(normalized);
+            }
+            if (valid == PATH_INVALID) {
+                continue;
+            }
+            ret = open_from_dir(file, search, normalized, valid);
+            if (ret == Q_ERR(ENAMETOOLONG))
+                goto fail;
+            if (ret != Q_ERR(ENOENT))
+                return ret;
+        }
+    }
+
+    // return error if path was checked and found to be invalid
+    ret = valid ? Q_ERR(ENOENT) : Q_ERR_INVALID_PATH;
+
+fail:
+    FS_DPrintf("%s: %s: %s\n", __func__, normalized, Q_ErrorString(ret));
+    return ret;
+}
+
+// Normalizes quake path, expands symlinks
+static int64_t expand_open_file_read(file_t *file, const char *name)
+{
+    char        normalized[MAX_OSPATH];
+    int64_t     ret;
+    size_t      namelen;
+
+// normalize path
+    namelen = FS_NormalizePathBuffer(normalized, name, MAX_OSPATH);
+    if (namelen >= MAX_OSPATH) {
+        return Q_ERR(ENAMETOOLONG);
+    }
+
+// expand hard symlinks
+    if (expand_links(&fs_hard_links, normalized, &namelen) && namelen >= MAX_OSPATH) {
+        return Q_ERR(ENAMETOOLONG);
+    }
+
+    ret = open_file_read(file, normalized, namelen);
+    if (ret == Q_ERR(ENOENT)) {
+// expand soft symlinks
+        if (expand_links(&fs_soft_links, normalized, &namelen)) {
+            if (namelen >= MAX_OSPATH) {
+                return Q_ERR(ENAMETOOLONG);
+            }
+            ret = open_file_read(file, normalized, namelen);
+        }
+    }
+
+    return ret;
+}
+
+static int read_pak_file(file_t *file, void *buf, size_t len)
+{
+    size_t result;
+
+    Q_assert(file->position <= file->length);
+
+    len = min(len, file->length - file->position);
+    if (!len) {
+        return 0;
+    }
+
+    result = fread(buf, 1, len, file->fp);
+    if (result != len) {
+        file->error = FS_ERR_READ(file->fp);
+        if (!result) {
+            return file->error;
+        }
+    }
+
+    file->position += result;
+    return result;
+}
+
+static int read_builtin_file(file_t *file, void *buf, size_t len)
+{
+    Q_assert(file->position <= file->length);
+
+    len = min(len, file->length - file->position);
+    if (!len) {
+        return 0;
+    }
+
+    memcpy(buf, (const void *) (intptr_t) (file->entry->filepos + file->position), len);
+
+    file->position += len;
+
+    return len;
+}
+
+static int read_phys_file(file_t *file, void *buf, size_t len)
+{
+    size_t result;
+
+    result = fread(buf, 1, len, file->fp);
+    if (result != len && ferror(file->fp)) {
+        file->error = Q_ERR_FAILURE;
+        if (!result) {
+            return file->error;
+        }
+    }
+
+    return result;
+}
+
+/*
+=================
+FS_Read
+=================
+*/
+int FS_Read(void *buf, size_t len, qhandle_t f)
+{
+    file_t *file = file_for_handle(f);
+#if USE_ZLIB
+    int ret;
+#endif
+
+    if (!file)
+        return Q_ERR(EBADF);
+
+    if ((file->mode & FS_MODE_MASK) != FS_MODE_READ)
+        return Q_ERR(EBADF);
+
+    // can't continue after error
+    if (file->error)
+        return file->error;
+
+    if (len > INT_MAX)
+        return Q_ERR(EINVAL);
+
+    if (len == 0)
+        return 0;
+
+    switch (file->type) {
+    case FS_REAL:
+        return read_phys_file(file, buf, len);
+    case FS_PAK:
+        return read_pak_file(file, buf, len);
+    case FS_BUILTIN:
+        return read_builtin_file(file, buf, len);
+#if USE_ZLIB
+    case FS_GZ:
+        ret = gzread(file->zfp, buf, len);
+        if (ret < 0) {
+            return Q_ERR_LIBRARY_ERROR;
+        }
+        return ret;
+    case FS_ZIP:
+        return read_zip_file(file, buf, len);
+#endif
+    default:
+        Q_assert(!"bad file type");
+        return 0;
+    }
+}
+
+int FS_ReadLine(qhandle_t f, char *buffer, size_t size)
+{
+    file_t *file = file_for_handle(f);
+    char *s;
+
+    if (!file)
+        return Q_ERR(EBADF);
+
+    if ((file->mode & FS_MODE_MASK) != FS_MODE_READ)
+        return Q_ERR(EBADF);
+
+    if (size < 1 || size > INT_MAX)
+        return Q_ERR(EINVAL);
+
+    *buffer = 0;
+
+    switch (file->type) {
+    case FS_REAL:
+        s = fgets(buffer, size, file->fp);
+        if (!s)
+            return ferror(file->fp) ? Q_ERR_FAILURE : 0;
+        break;
+#if USE_ZLIB
+    case FS_GZ:
+        s = gzgets(file->zfp, buffer, size);
+        if (!s)
+            return 0;
+        break;
+#endif
+    default:
+        return Q_ERR(ENOSYS);
+    }
+
+    return strlen(s);
+}
+
+int FS_Flush(qhandle_t f)
+{
+    file_t *file = file_for_handle(f);
+    int ret = Q_ERR_SUCCESS;
+
+    if (!file)
+        return Q_ERR(EBADF);
+
+    if ((file->mode & FS_MODE_MASK) == FS_MODE_READ)
+        return Q_ERR(EBADF);
+
+    switch (file->type) {
+    case FS_REAL:
+        if (fflush(file->fp))
+            ret = Q_ERRNO;
+        break;
+#if USE_ZLIB
+    case FS_GZ:
+        if (gzflush(file->zfp, Z_SYNC_FLUSH))
+            ret = Q_ERR_LIBRARY_ERROR;
+        break;
+#endif
+    default:
+        Q_assert(!"bad file type");
+    }
+
+    return ret;
+}
+
+/*
+=================
+FS_Write
+=================
+*/
+int FS_Write(const void *buf, size_t len, qhandle_t f)
+{
+    file_t  *file = file_for_handle(f);
+
+    if (!file)
+        return Q_ERR(EBADF);
+
+    if ((file->mode & FS_MODE_MASK) == FS_MODE_READ)
+        return Q_ERR(EBADF);
+
+    // can't continue after error
+    if (file->error)
+        return file->error;
+
+    if (len > INT_MAX)
+        return Q_ERR(EINVAL);
+
+    if (len == 0)
+        return 0;
+
+    switch (file->type) {
+    case FS_REAL:
+        if (fwrite(buf, 1, len, file->fp) != len) {
+            file->error = Q_ERR_FAILURE;
+            return file->error;
+        }
+        break;
+#if USE_ZLIB
+    case FS_GZ:
+        if (gzwrite(file->zfp, buf, len) != len) {
+            file->error = Q_ERR_LIBRARY_ERROR;
+            return file->error;
+        }
+        break;
+#endif
+    default:
+        Q_assert(!"bad file type");
+    }
+
+    return len;
+}
+
+static unsigned default_lookup_flags(unsigned flags)
+{
+    if (!(flags & FS_PATH_MASK) || !fs_game->string[0])
+        flags |= FS_PATH_MASK;
+
+    if (!(flags & FS_DIR_MASK) || !sys_homedir->string[0])
+        flags |= FS_DIR_MASK;
+
+    return flags;
+}
+
+/*
+============
+FS_OpenFile
+============
+*/
+int64_t FS_OpenFile(const char *name, qhandle_t *f, unsigned mode)
+{
+    file_t *file;
+    qhandle_t handle;
+    int64_t ret;
+
+    Q_assert(name);
+    Q_assert(f);
+
+    *f = 0;
+
+    if (!fs_searchpaths) {
+        return Q_ERR(EAGAIN); // not yet initialized
+    }
+
+    // allocate new file handle
+    file = alloc_handle(&handle);
+    if (!file) {
+        return Q_ERR(EMFILE);
+    }
+
+    file->mode = default_lookup_flags(mode);
+
+    if ((mode & FS_MODE_MASK) == FS_MODE_READ) {
+        ret = expand_open_file_read(file, name);
+    } else {
+        ret = open_file_write(file, name);
+    }
+
+    if (ret >= 0) {
+        *f = handle;
+    }
+
+    return ret;
+}
+
+// reading from outside of source directory is allowed, extension is optional
+static qhandle_t easy_open_read(char *buf, size_t size, unsigned mode,
+                                const char *dir, const char *name, const char *ext)
+{
+    int64_t ret = Q_ERR(ENAMETOOLONG);
+    qhandle_t f;
+
+    if (*name == '/') {
+        // full path is given, ignore directory and extension
+        if (Q_strlcpy(buf, name + 1, size) >= size) {
+            goto fail;
+        }
+    } else {
+        // first try without extension
+        if (Q_concat(buf, size, dir, name) >= size) {
+            goto fail;
+        }
+
+        // print normalized path in case of error
+        FS_NormalizePath(buf);
+
+        ret = FS_OpenFile(buf, &f, mode);
+        if (f) {
+            return f; // succeeded
+        }
+        if (ret != Q_ERR(ENOENT)) {
+            goto fail; // fatal error
+        }
+        if (!COM_CompareExtension(buf, ext)) {
+            goto fail; // name already has the extension
+        }
+
+        // now try to append extension
+        if (Q_strlcat(buf, ext, size) >= size) {
+            ret = Q_ERR(ENAMETOOLONG);
+            goto fail;
+        }
+    }
+
+    ret = FS_OpenFile(buf, &f, mode);
+    if (f) {
+        return f;
+    }
+
+fail:
+    Com_Printf("Couldn't open %s: %s\n", buf, Q_ErrorString(ret));
+    return 0;
+}
+
+// writing to outside of destination directory is disallowed, extension is forced
+static qhandle_t easy_open_write(char *buf, size_t size, unsigned mode,
+                                 const char *dir, const char *name, const char *ext)
+{
+    char normalized[MAX_OSPATH];
+    int64_t ret = Q_ERR(ENAMETOOLONG);
+    qhandle_t f;
+
+    // make it impossible to escape the destination directory when writing files
+    if (FS_NormalizePathBuffer(normalized, name, sizeof(normalized)) >= sizeof(normalized)) {
+        goto fail;
+    }
+
+    // reject empty filenames
+    if (normalized[0] == 0) {
+        ret = Q_ERR_INVALID_PATH;
+        goto fail;
+    }
+
+    // in case of error, print full path from this point
+    name = buf;
+
+    // replace any bad characters with underscores to make automatic commands happy
+    FS_CleanupPath(normalized);
+
+    if (Q_concat(buf, size, dir, normalized) >= size) {
+        goto fail;
+    }
+
+    // append the extension unless name already has it
+    if (COM_CompareExtension(normalized, ext) && Q_strlcat(buf, ext, size) >= size) {
+        goto fail;
+    }
+
+    if ((mode & FS_FLAG_GZIP) && Q_strlcat(buf, ".gz", size) >= size) {
+        goto fail;
+    }
+
+    ret = FS_OpenFile(buf, &f, mode);
+    if (f) {
+        return f;
+    }
+
+fail:
+    Com_EPrintf("Couldn't open %s: %s\n", name, Q_ErrorString(ret));
+    return 0;
+}
+
+/*
+============
+FS_EasyOpenFile
+
+Helper function for various console commands. Concatenates
+the arguments, checks for path buffer overflow, and attempts
+to open the file, printing an error message in case of failure.
+============
+*/
+qhandle_t FS_EasyOpenFile(char *buf, size_t size, unsigned mode,
+                          const char *dir, const char *name, const char *ext)
+{
+    if ((mode & FS_MODE_MASK) == FS_MODE_READ) {
+        return easy_open_read(buf, size, mode, dir, name, ext);
+    }
+
+    return easy_open_write(buf, size, mode, dir, name, ext);
+}
+
+#if USE_TESTS
+static cvar_t *fs_fuzz_factor;
+static cvar_t *fs_fuzz_filter;
+
+static bool fuzz_wanted(const char *path)
+{
+    if (fs_fuzz_factor->value <= 0)
+        return false;
+    if (!strcmp(path, "pics/colormap.pcx") || !strncmp(path, CONST_STR_LEN("pics/conchars.")))
+        return false;
+    return FS_WildCmp(fs_fuzz_filter->string, path);
+}
+
+static void fuzz_data(const char *path, byte *buf, int size)
+{
+    if (!fuzz_wanted(path))
+        return;
+    int nbits = size * 8;
+    int ncorrupt = nbits * Cvar_ClampValue(fs_fuzz_factor, 0, 1);
+    for (int i = 0; i < ncorrupt; i++) {
+        int pos = Q_rand_uniform(nbits);
+        buf[pos >> 3] ^= 1 << (pos & 7);
+    }
+}
+#else
+#define fuzz_wanted(path)   false
+#endif
+
+// returns pointer into mapped pack if file can be used in place
+static const byte *map_pack_file(const file_t *file, int64_t len)
+{
+    const pack_t *pack = file->pack;
+    const packfile_t *entry = file->entry;
+
+    if (file->type != FS_PAK || !pack || !pack->mapped)
+        return NULL;
+
+    // compressed data requested for download
+    if (file->mode & FS_FLAG_DEFLATE)
+        return NULL;
+
+    // views of empty files could point past the mapping
+    if (len <= 0 || len > pack->mapped_size || entry->filepos < 0 ||
+        entry->filepos > pack->mapped_size - len)
+        return NULL;
+
+    // callers cast buffer to structs, heap buffers are always aligned
+    if ((uintptr_t)(pack->mapped + entry->filepos) & 15)
+        return NULL;
+
+    return pack->mapped + entry->filepos;
+}
+
+// maps file on disk, view is unmapped by FS_FreeFile
+static void *map_real_file(const file_t *file, int64_t len)
+{
+    mapped_file_t *mapped;
+    void *view;
+
+    if (file->type != FS_REAL || !fs_mmap->integer || len <= 0)
+        return NULL;
+
+    view = Sys_MapFile(file->fp, len);
+    if (!view)
+        return NULL;
+
+    mapped = FS_Malloc(sizeof(*mapped));
+    mapped->base = view;
+    mapped->size = len;
+    List_Append(&fs_mapped_files, &mapped->entry);
+    return view;
+}
+
+/*
+=============================================================================
+
+PRELOADING
+
+Files known to be needed soon, such as everything a new map registers, are
+read on async worker threads in the order given, so that disk access and
+inflating overlap with decoding on the main thread. FS_LoadFile hands out
+finished buffers and waits for ones still being read. Stored entries of
+mapped packs are used in place anyway, for those workers only touch the
+pages to get them from disk.
+
+Workers never allocate from the zone: files are looked up and buffers are
+allocated on the main thread, workers open packs by themselves and inflate
+using their own stream with default zlib allocators. Buffers held at once
+are limited by fs_preload. Loose files are opened on the main thread and
+closed once read, so that only a few handles are open at once.
+
+Files can be queued with a decoder, which workers run on the data once it
+is read. The malloc'd result is handed out by FS_ClaimDecoded and counts
+against fs_preload as well. If decoding fails, the file is still there for
+FS_LoadFile and caller decodes it as usual.
+
+=============================================================================
+*/
+
+#define MAX_PRELOADS        4096
+#define MAX_PRELOAD_JOBS    64      // queued or running at once
+#define MAX_PRELOAD_HANDLES 32      // loose files open at once
+#define PRELOAD_HASH_SIZE   256
+#define PRELOAD_PAGE_SIZE   4096
+
+typedef struct preload_s {
+    struct preload_s    *hash_next;
+    char            name[MAX_QPATH];
+    unsigned        hash;
+    unsigned        work;       // async work id, 0 if not queued
+    bool            started;
+    bool            released;   // handed out or dropped
+    bool            done;       // set by worker, protected by lock
+    bool            deflated;   // inflate compressed zip entry
+    pack_t          *pack;      // held until released, NULL for loose files
+    int64_t         filepos;
+    int64_t         complen;
+    const byte      *mapped;    // stored entry of mapped pack
+    qhandle_t       handle;     // unique handle for loose files
+    FILE            *fp;
+    byte            *data;
+    int64_t         len;
+    int             ret;        // bytes read or error
+    unsigned        touched;
+    const fs_decoder_t  *decoder;
+    void            *decoder_arg;
+    void            *decoded;   // set by worker
+    size_t          decoded_size;
+} preload_t;
+
+static struct {
+    preload_t       *files;     // NULL if not preloading
+    int             num_files;
+    int             next;       // next planned file to start
+    int             started;    // jobs queued
+    int             finished;   // jobs done, protected by lock
+    int             handles;    // loose files open
+    int64_t         held;       // bytes in buffers not yet claimed
+    int64_t         decoded;    // bytes in decoded results, protected by lock
+    preload_t       *hash[PRELOAD_HASH_SIZE];
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+
+    // stats of current session
+    unsigned        start;
+    int             reads, touches, claims, decodes, inline_reads, waits, unused;
+    int64_t         read_bytes, touch_bytes;
+    uint64_t        wait_nsec;
+} fs_preload;
+
+static cvar_t       *fs_preload_size;
+
+static preload_t *preload_find(const char *name, unsigned hash)
+{
+    preload_t *p;
+
+    for (p = fs_preload.hash[hash & (PRELOAD_HASH_SIZE - 1)]; p; p = p->hash_next) {
+        if (p->hash == hash && !FS_pathcmp(p->name, name)) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+#if USE_ZLIB
+// runs on worker thread, zone allocator can't be used
+static int preload_inflate(preload_t *p, FILE *fp)
+{
+    byte in[ZIP_BUFSIZE];
+    z_stream z = { 0 };
+    int64_t rest = p->complen;
+    size_t block, result;
+    int ret;
+
+    if (inflateInit2(&z, -MAX_WBITS) != Z_OK) {
+        return Q_ERR_INFLATE_FAILED;
+    }
+
+    z.next_out = p->data;
+    z.avail_out = (uInt)p->len;
+
+    do {
+        if (!z.avail_in) {
+            if (!rest) {
+                break;
+            }
+            block = min(rest, ZIP_BUFSIZE);
+            result = fread(in, 1, block, fp);
+            if (result != block) {
+                inflateEnd(&z);
+                return FS_ERR_READ(fp);
+            }
+            rest -= result;
+            z.next_in = in;
+            z.avail_in = result;
+        }
+
+        ret = inflate(&z, Z_SYNC_FLUSH);
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        if (ret != Z_OK) {
+            inflateEnd(&z);
+            return Q_ERR_INFLATE_FAILED;
+        }
+    } while (z.avail_out);
+
+    inflateEnd(&z);
+    return p->len - z.avail_out;
+}
+#endif
+
+static int preload_read(preload_t *p, FILE *fp)
+{
+#if USE_ZLIB
+    if (p->deflated) {
+        return preload_inflate(p, fp);
+    }
+#endif
+    if (fread(p->data, 1, p->len, fp) != p->len) {
+        return FS_ERR_READ(fp);
+    }
+    return p->len;
+}
+
+static int preload_read_pack(preload_t *p)
+{
+    FILE *fp;
+    int ret;
+
+    fp = fopen(p->pack->filename, "rb");
+    if (!fp) {
+        return Q_ERRNO;
+    }
+
+    if (os_fseek(fp, p->filepos, SEEK_SET)) {
+        ret = Q_ERRNO;
+    } else {
+        ret = preload_read(p, fp);
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+static void preload_work(void *arg)
+{
+    preload_t *p = arg;
+    unsigned sum = 0;
+
+    if (p->mapped) {
+        // decoder reads the pages anyway
+        if (!p->decoder) {
+            for (int64_t i = 0; i < p->len; i += PRELOAD_PAGE_SIZE) {
+                sum += p->mapped[i];
+            }
+        }
+        p->touched = sum;   // keep reads from being optimized out
+        p->ret = p->len;
+    } else if (p->pack) {
+        p->ret = preload_read_pack(p);
+    } else {
+        p->ret = preload_read(p, p->fp);
+    }
+
+    if (p->decoder && p->ret == p->len) {
+        p->decoded = p->decoder->decode(p->name, p->mapped ? p->mapped : p->data,
+                                        p->len, p->decoder_arg, &p->decoded_size);
+    }
+
+    pthread_mutex_lock(&fs_preload.lock);
+    if (p->decoded) {
+        fs_preload.decoded += p->decoded_size;
+    }
+    p->done = true;
+    fs_preload.finished++;
+    pthread_cond_broadcast(&fs_preload.cond);
+    pthread_mutex_unlock(&fs_preload.lock);
+}
+
+// allocates buffer, reading happens on worker
+static bool preload_start(preload_t *p)
+{
+    asyncwork_t work = {
+        .work_cb = preload_work,
+        .cb_arg = p,
+        .priority = ASYNC_PRIO_HIGH,
+    };
+
+    if (!p->mapped) {
+        // loose files need unique handle opened here
+        if (!p->pack) {
+            if (FS_OpenFile(p->name, &p->handle, FS_MODE_READ | FS_TYPE_REAL) != p->len) {
+                return false;
+            }
+            p->fp = file_for_handle(p->handle)->fp;
+            fs_preload.handles++;
+        }
+        p->data = FS_Malloc(p->len + 1);
+        fs_preload.held += p->len;
+        fs_preload.reads++;
+        fs_preload.read_bytes += p->len;
+    } else {
+        fs_preload.touches++;
+        fs_preload.touch_bytes += p->len;
+    }
+
+    p->started = true;
+    p->work = Com_QueueAsyncWork(&work);
+    fs_preload.started++;
+    return true;
+}
+
+static void preload_close(preload_t *p)
+{
+    if (p->handle) {
+        FS_CloseFile(p->handle);
+        p->handle = 0;
+        p->fp = NULL;
+        fs_preload.handles--;
+    }
+}
+
+static void preload_drop_decoded(preload_t *p)
+{
+    pthread_mutex_lock(&fs_preload.lock);
+    fs_preload.decoded -= p->decoded_size;
+    pthread_mutex_unlock(&fs_preload.lock);
+    p->decoded = NULL;
+}
+
+static void preload_release(preload_t *p)
+{
+    if (p->decoded) {
+        p->decoder->free(p->decoded);
+        preload_drop_decoded(p);
+    }
+    if (p->data) {
+        fs_preload.held -= p->len;
+        Z_Free(p->data);
+        p->data = NULL;
+    }
+    preload_close(p);
+    if (p->pack) {
+        pack_put(p->pack);
+        p->pack = NULL;
+    }
+    p->released = true;
+}
+
+// closes loose files already read, but not claimed yet
+static void preload_reap(void)
+{
+    preload_t *p;
+    int i;
+
+    pthread_mutex_lock(&fs_preload.lock);
+    for (i = 0, p = fs_preload.files; i < fs_preload.next; i++, p++) {
+        if (p->handle && p->done) {
+            preload_close(p);
+        }
+    }
+    pthread_mutex_unlock(&fs_preload.lock);
+}
+
+// starts planned files while there is room for them
+static void preload_pump(void)
+{
+    int64_t budget = (int64_t)Cvar_ClampInteger(fs_preload_size, 0, 4096) << 20;
+    int running;
+    preload_t *p;
+
+    pthread_mutex_lock(&fs_preload.lock);
+    running = fs_preload.started - fs_preload.finished;
+    budget -= fs_preload.decoded;
+    pthread_mutex_unlock(&fs_preload.lock);
+
+    while (fs_preload.next < fs_preload.num_files && running < MAX_PRELOAD_JOBS) {
+        p = &fs_preload.files[fs_preload.next];
+        if (p->released) {
+            fs_preload.next++;
+            continue;
+        }
+        // always allow one buffer, even if it's larger than budget
+        if (!p->mapped && fs_preload.held && fs_preload.held + p->len > budget) {
+            break;
+        }
+        // loose files keep handle until read, don't run out of them
+        if (!p->pack && fs_preload.handles >= MAX_PRELOAD_HANDLES) {
+            preload_reap();
+            if (fs_preload.handles >= MAX_PRELOAD_HANDLES) {
+                break;
+            }
+        }
+        fs_preload.next++;
+        if (preload_start(p)) {
+            running++;
+        } else {
+            preload_release(p);
+        }
+    }
+}
+
+static void preload_wait(preload_t *p)
+{
+    uint64_t start = Sys_Nanoseconds();
+
+    pthread_mutex_lock(&fs_preload.lock);
+    if (!p->done) {
+        fs_preload.waits++;
+        do {
+            pthread_cond_wait(&fs_preload.cond, &fs_preload.lock);
+        } while (!p->done);
+    }
+    pthread_mutex_unlock(&fs_preload.lock);
+
+    fs_preload.wait_nsec += Sys_Nanoseconds() - start;
+}
+
+// waits for queued file, reading it here if worker hasn't started yet
+static void preload_finish(preload_t *p)
+{
+    if (!p->work) {
+        return;
+    }
+
+    if (Com_CancelAsyncWork(p->work)) {
+        fs_preload.inline_reads++;
+        preload_work(p);
+    } else {
+        preload_wait(p);
+    }
+    p->work = 0;
+}
+
+// called by FS_LoadFile, returns false if file should be loaded as usual
+static bool preload_claim(const char *path, void **buffer, memtag_t tag, int *len_p)
+{
+    char normalized[MAX_QPATH];
+    preload_t *p;
+    byte *buf;
 
-    if (!fs_searchpaths) {
-        return Q_ERR(EAGAIN); // not yet initialized
+    if (FS_NormalizePathBuffer(normalized, path, sizeof(normalized)) >= sizeof(normalized)) {
+        return false;
     }
 
-    // allocate new file handle
-    file = alloc_handle(&handle);
-    if (!file) {
-        return Q_ERR(EMFILE);
+    p = preload_find(normalized, FS_HashPath(normalized, 0));
+    if (!p || p->mapped || p->released) {
+        preload_pump();
+        return false;
     }
 
-    file->mode = default_lookup_flags(mode);
+    preload_finish(p);
 
-    if ((mode & FS_MODE_MASK) == FS_MODE_READ) {
-        ret = expand_open_file_read(file, name);
-    } else {
-        ret = open_file_write(file, name);
+    if (!p->started || p->ret != p->len || fuzz_wanted(normalized)) {
+        preload_release(p);
+        preload_pump();
+        return false;
     }
 
-    if (ret >= 0) {
-        *f = handle;
+    // buffer is taken over if tag matches, copied otherwise
+    buf = p->data;
+    if (tag != TAG_FILESYSTEM) {
+        buf = Z_TagMalloc(p->len + 1, tag);
+        memcpy(buf, p->data, p->len);
+    } else {
+        fs_preload.held -= p->len;
+        p->data = NULL;
     }
+    buf[p->len] = 0;
 
-    return ret;
+    *buffer = buf;
+    *len_p = p->len;
+    fs_preload.claims++;
+
+    preload_release(p);
+    preload_pump();
+    return true;
 }
 
-// reading from outside of source directory is allowed, extension is optional
-static qhandle_t easy_open_read(char *buf, size_t size, unsigned mode,
-                                const char *dir, const char *name, const char *ext)
+/*
+================
+FS_ClaimDecoded
+
+Returns result of decoding the file on worker, waiting for it if needed.
+Caller frees it with decoder->free. Returns NULL if file wasn't queued with
+this decoder or decoding failed, file should be loaded as usual then.
+================
+*/
+void *FS_ClaimDecoded(const char *path, const fs_decoder_t *decoder)
 {
-    int64_t ret = Q_ERR(ENAMETOOLONG);
-    qhandle_t f;
+    char normalized[MAX_QPATH];
+    preload_t *p;
+    void *decoded;
 
-    if (*name == '/') {
-        // full path is given, ignore directory and extension
-        if (Q_strlcpy(buf, name + 1, size) >= size) {
-            goto fail;
-        }
-    } else {
-        // first try without extension
-        if (Q_concat(buf, size, dir, name) >= size) {
-            goto fail;
-        }
+    if (!fs_preload.files) {
+        return NULL;
+    }
 
-        // print normalized path in case of error
-        FS_NormalizePath(buf);
+    if (FS_NormalizePathBuffer(normalized, path, sizeof(normalized)) >= sizeof(normalized)) {
+        return NULL;
+    }
 
-        ret = FS_OpenFile(buf, &f, mode);
-        if (f) {
-            return f; // succeeded
-        }
-        if (ret != Q_ERR(ENOENT)) {
-            goto fail; // fatal error
-        }
-        if (!COM_CompareExtension(buf, ext)) {
-            goto fail; // name already has the extension
-        }
+    p = preload_find(normalized, FS_HashPath(normalized, 0));
+    if (!p || p->released || p->decoder != decoder || fuzz_wanted(normalized)) {
+        return NULL;
+    }
 
-        // now try to append extension
-        if (Q_strlcat(buf, ext, size) >= size) {
-            ret = Q_ERR(ENAMETOOLONG);
-            goto fail;
-        }
+    preload_finish(p);
+
+    // keep the raw file for FS_LoadFile
+    if (!p->decoded) {
+        return NULL;
     }
 
-    ret = FS_OpenFile(buf, &f, mode);
-    if (f) {
-        return f;
+    decoded = p->decoded;
+    preload_drop_decoded(p);
+    fs_preload.decodes++;
+
+    preload_release(p);
+    preload_pump();
+    return decoded;
+}
+
+/*
+================
+FS_BeginPreload
+
+Starts collecting files to read ahead. Returns false if preloading is
+disabled, caller may skip planning then.
+================
+*/
+bool FS_BeginPreload(void)
+{
+    if (fs_preload.files) {
+        FS_EndPreload();
+    }
+
+    memset(fs_preload.hash, 0, sizeof(fs_preload.hash));
+    fs_preload.num_files = fs_preload.next = 0;
+    fs_preload.started = fs_preload.finished = 0;
+    fs_preload.handles = 0;
+    fs_preload.held = fs_preload.decoded = 0;
+    fs_preload.reads = fs_preload.touches = fs_preload.claims = fs_preload.decodes = 0;
+    fs_preload.inline_reads = fs_preload.waits = fs_preload.unused = 0;
+    fs_preload.read_bytes = fs_preload.touch_bytes = 0;
+    fs_preload.wait_nsec = 0;
+    fs_preload.start = Sys_Milliseconds();
+
+    if (fs_preload_size->integer <= 0 || !fs_searchpaths) {
+        return false;
     }
 
-fail:
-    Com_Printf("Couldn't open %s: %s\n", buf, Q_ErrorString(ret));
-    return 0;
+    fs_preload.files = FS_Malloc(sizeof(fs_preload.files[0]) * MAX_PRELOADS);
+    return true;
 }
 
-// writing to outside of destination directory is disallowed, extension is forced
-static qhandle_t easy_open_write(char *buf, size_t size, unsigned mode,
-                                 const char *dir, const char *name, const char *ext)
+/*
+================
+FS_PreloadFileEx
+
+Queues file to be read ahead, and decoded on worker if decoder is given.
+Returns true if file exists, so that alternative names can be tried in order.
+================
+*/
+bool FS_PreloadFileEx(const char *path, const fs_decoder_t *decoder, void *arg)
 {
-    char normalized[MAX_OSPATH];
-    int64_t ret = Q_ERR(ENAMETOOLONG);
+    char normalized[MAX_QPATH];
+    preload_t *p;
     qhandle_t f;
+    file_t *file;
+    unsigned hash;
+    int64_t len;
+    bool ok;
 
-    // make it impossible to escape the destination directory when writing files
-    if (FS_NormalizePathBuffer(normalized, name, sizeof(normalized)) >= sizeof(normalized)) {
-        goto fail;
+    if (!fs_preload.files) {
+        return FS_FileExists(path);
     }
 
-    // reject empty filenames
-    if (normalized[0] == 0) {
-        ret = Q_ERR_INVALID_PATH;
-        goto fail;
+    if (FS_NormalizePathBuffer(normalized, path, sizeof(normalized)) >= sizeof(normalized)) {
+        return false;
     }
 
-    // in case of error, print full path from this point
-    name = buf;
-
-    // replace any bad characters with underscores to make automatic commands happy
-    FS_CleanupPath(normalized);
+    hash = FS_HashPath(normalized, 0);
+    if (preload_find(normalized, hash)) {
+        return true;
+    }
 
-    if (Q_concat(buf, size, dir, normalized) >= size) {
-        goto fail;
+    // find out where it is, see FS_LoadFile
+    file = alloc_handle(&f);
+    if (!file) {
+        return false;
     }
 
-    // append the extension unless name already has it
-    if (COM_CompareExtension(normalized, ext) && Q_strlcat(buf, ext, size) >= size) {
-        goto fail;
+    file->mode = default_lookup_flags(0) | FS_MODE_READ | FS_FLAG_LOADFILE;
+    len = expand_open_file_read(file, normalized);
+    if (len < 0) {
+        return false;
     }
 
-    if ((mode & FS_FLAG_GZIP) && Q_strlcat(buf, ".gz", size) >= size) {
-        goto fail;
+    ok = fs_preload.num_files < MAX_PRELOADS && len > 0 && len <= MAX_LOADFILE;
+    if (ok) {
+        p = &fs_preload.files[fs_preload.num_files];
+        memset(p, 0, sizeof(*p));
+        if (file->type == FS_REAL) {
+            // opened again when started
+        } else if (file->pack && file->pack->type != FS_BUILTIN) {
+            p->pack = pack_get(file->pack);
+            p->filepos = file->entry->filepos;
+            p->mapped = map_pack_file(file, len);
+#if USE_ZLIB
+            p->deflated = file->type == FS_ZIP;
+            p->complen = file->entry->complen;
+#endif
+        } else {
+            ok = false;
+        }
     }
 
-    ret = FS_OpenFile(buf, &f, mode);
-    if (f) {
-        return f;
+    FS_CloseFile(f);
+
+    if (ok) {
+        Q_strlcpy(p->name, normalized, sizeof(p->name));
+        p->hash = hash;
+        p->len = len;
+        p->decoder = decoder;
+        p->decoder_arg = arg;
+        p->hash_next = fs_preload.hash[hash & (PRELOAD_HASH_SIZE - 1)];
+        fs_preload.hash[hash & (PRELOAD_HASH_SIZE - 1)] = p;
+        fs_preload.num_files++;
+        preload_pump();
     }
 
-fail:
-    Com_EPrintf("Couldn't open %s: %s\n", name, Q_ErrorString(ret));
-    return 0;
+    return true;
 }
 
 /*
-============
-FS_EasyOpenFile
+================
+FS_EndPreload
 
-Helper function for various console commands. Concatenates
-the arguments, checks for path buffer overflow, and attempts
-to open the file, printing an error message in case of failure.
-============
+Drops files that were never loaded and prints time taken since
+FS_BeginPreload, with or without preloading.
+================
 */
-qhandle_t FS_EasyOpenFile(char *buf, size_t size, unsigned mode,
-                          const char *dir, const char *name, const char *ext)
+void FS_EndPreload(void)
 {
-    if ((mode & FS_MODE_MASK) == FS_MODE_READ) {
-        return easy_open_read(buf, size, mode, dir, name, ext);
+    char buffer[16];
+    preload_t *p;
+    int i;
+
+    if (!fs_preload.files) {
+        if (fs_preload.start) {
+            Com_DPrintf("Loaded in %u ms without preloading\n",
+                        Sys_Milliseconds() - fs_preload.start);
+            fs_preload.start = 0;
+        }
+        return;
     }
 
-    return easy_open_write(buf, size, mode, dir, name, ext);
-}
+    for (i = 0, p = fs_preload.files; i < fs_preload.num_files; i++, p++) {
+        if (p->released) {
+            continue;
+        }
+        if (p->started && !p->mapped) {
+            fs_preload.unused++;
+        }
+        if (p->work && !Com_CancelAsyncWork(p->work)) {
+            preload_wait(p);
+        }
+        preload_release(p);
+    }
 
-#if USE_TESTS
-static cvar_t *fs_fuzz_factor;
-static cvar_t *fs_fuzz_filter;
+    Com_FormatSize(buffer, sizeof(buffer), fs_preload.read_bytes);
+    Com_DPrintf("Loaded in %u ms, read %d files (%s) ahead, %d used, %d decoded, %d unused, "
+                "%d read inline, waited %"PRIu64" ms for %d\n",
+                Sys_Milliseconds() - fs_preload.start, fs_preload.reads, buffer,
+                fs_preload.claims, fs_preload.decodes, fs_preload.unused, fs_preload.inline_reads,
+                fs_preload.wait_nsec / 1000000, fs_preload.waits);
+    Com_FormatSize(buffer, sizeof(buffer), fs_preload.touch_bytes);
+    Com_DPrintf("Touched %d mapped files (%s)\n", fs_preload.touches, buffer);
 
-static void fuzz_data(const char *path, byte *buf, int size)
-{
-    if (fs_fuzz_factor->value <= 0)
-        return;
-    if (!strcmp(path, "pics/colormap.pcx") || !strncmp(path, CONST_STR_LEN("pics/conchars.")))
-        return;
-    if (!FS_WildCmp(fs_fuzz_filter->string, path))
-        return;
-    int nbits = size * 8;
-    int ncorrupt = nbits * Cvar_ClampValue(fs_fuzz_factor, 0, 1);
-    for (int i = 0; i < ncorrupt; i++) {
-        int pos = Q_rand_uniform(nbits);
-        buf[pos >> 3] ^= 1 << (pos & 7);
-    }
+    Z_Free(fs_preload.files);
+    fs_preload.files = NULL;
+    fs_preload.start = 0;
 }
-#endif
 
 /*
 ============
@@ -1978,6 +3397,13 @@ int FS_LoadFileEx(const char *path, void **buffer, unsigned flags, memtag_t tag)
         return Q_ERR(EINVAL);
     }
 
+    // take buffer read ahead by worker
+    if (fs_preload.files && buffer && !(flags & ~FS_FLAG_MMAP)) {
+        if (preload_claim(path, buffer, tag, &read)) {
+            return read;
+        }
+    }
+
     // allocate new file handle
     file = alloc_handle(&f);
     if (!file) {
@@ -2003,6 +3429,29 @@ int FS_LoadFileEx(const char *path, void **buffer, unsigned flags, memtag_t tag)
         goto done;
     }
 
+    // hand out read-only view of stored pack entry without copying
+    if ((flags & FS_FLAG_MMAP) && !fuzz_wanted(path)) {
+        const byte *view = map_pack_file(file, len);
+        if (view) {
+            pack_get(file->pack);
+            fs_num_views++;
+#if USE_DEBUG
+            fs_count_views++;
+            fs_count_view_bytes += len;
+#endif
+            *buffer = (void *)view;
+            goto done;
+        }
+        if (flags & FS_FLAG_MMAP_DISK) {
+            void *real = map_real_file(file, len);
+            if (real) {
+                fs_num_views++;
+                *buffer = real;
+                goto done;
+            }
+        }
+    }
+
     // allocate chunk of memory, +1 for NUL
     buf = Z_TagMalloc(len + 1, tag);
 
@@ -2026,6 +3475,46 @@ done:
     return len;
 }
 
+/*
+================
+FS_FreeFile
+
+Frees buffer returned by FS_LoadFile, which may be a view of mapped pack
+or file.
+================
+*/
+void FS_FreeFile(void *buf)
+{
+    mapped_file_t *mapped;
+    pack_t *pack;
+
+    if (!buf) {
+        return;
+    }
+
+    if (fs_num_views) {
+        LIST_FOR_EACH(pack_t, pack, &fs_mapped_packs, mapped_entry) {
+            if ((const byte *)buf >= pack->mapped &&
+                (const byte *)buf < pack->mapped + pack->mapped_size) {
+                fs_num_views--;
+                pack_put(pack);
+                return;
+            }
+        }
+        LIST_FOR_EACH(mapped_file_t, mapped, &fs_mapped_files, entry) {
+            if (buf == mapped->base) {
+                fs_num_views--;
+                Sys_UnmapFile(mapped->base, mapped->size);
+                List_Remove(&mapped->entry);
+                Z_Free(mapped);
+                return;
+            }
+        }
+    }
+
+    Z_Free(buf);
+}
+
 int FS_LastModified(const char *file, uint64_t *last_modified)
 {
 #ifndef NO_TEXTURE_RELOADS
@@ -2061,6 +3550,56 @@ int FS_LastModified(const char *file, uint64_t *last_modified)
     return Q_ERR_INVALID_PATH;
 }
 
+/*
+================
+FS_PackSource
+
+Finds out which pack file would be loaded from, without reading it.
+Returns Q_ERR_INVALID_PATH if file is not stored in a pack.
+================
+*/
+int FS_PackSource(const char *path, pack_source_t *src)
+{
+    qhandle_t f;
+    file_t *file;
+    int64_t len;
+    int ret = Q_ERR_INVALID_PATH;
+
+    memset(src, 0, sizeof(*src));
+
+    if (!fs_searchpaths) {
+        return Q_ERR(EAGAIN);
+    }
+
+    file = alloc_handle(&f);
+    if (!file) {
+        return Q_ERR(EMFILE);
+    }
+
+    file->mode = default_lookup_flags(0) | FS_MODE_READ | FS_FLAG_LOADFILE;
+    len = expand_open_file_read(file, path);
+    if (len < 0) {
+        return len;
+    }
+
+    if (file->pack) {
+        Q_strlcpy(src->filename, file->pack->filename, sizeof(src->filename));
+        src->filepos = file->entry->filepos;
+        src->filelen = len;
+
+        // builtin packs don't exist on disk, leave size and mtime zero
+        Q_STATBUF st;
+        if (file->pack->type != FS_BUILTIN && os_stat(file->pack->filename, &st) == 0) {
+            src->size = st.st_size;
+            src->mtime = (uint64_t)st.st_mtime;
+        }
+        ret = Q_ERR_SUCCESS;
+    }
+
+    FS_CloseFile(f);
+    return ret;
+}
+
 static int write_and_close(const void *data, size_t len, qhandle_t f)
 {
     int ret1 = FS_Write(data, len, f);
@@ -2153,6 +3692,7 @@ int FS_RenameFile(const char *from, const char *to)
     if (rename(frompath, topath))
         return Q_ERRNO;
 
+    index_add_path(topath);
     return Q_ERR_SUCCESS;
 }
 
@@ -2182,6 +3722,10 @@ int FS_FPrintf(qhandle_t f, const char *format, ...)
 
 static void pack_free(pack_t *pack)
 {
+    if (pack->mapped) {
+        Sys_UnmapFile((void *)pack->mapped, pack->mapped_size);
+        List_Remove(&pack->mapped_entry);
+    }
     if (pack->fp)
         fclose(pack->fp);
     Z_Free(pack->names);
@@ -2214,6 +3758,7 @@ static void pack_put(pack_t *pack)
 static pack_t *pack_alloc(FILE *fp, filetype_t type, const char *name,
                           unsigned num_files, size_t names_len)
 {
+    file_info_t info;
     pack_t *pack;
     size_t len;
 
@@ -2228,6 +3773,17 @@ static pack_t *pack_alloc(FILE *fp, filetype_t type, const char *name,
     pack->file_hash = NULL;
     pack->names = FS_Malloc(names_len);
     memcpy(pack->filename, name, len + 1);
+    pack->mapped = NULL;
+    pack->mapped_size = 0;
+
+    // map the whole file so that stored entries can be loaded in place
+    if (fp && fs_mmap->integer && !get_fp_info(fp, &info) && info.size == (size_t)info.size) {
+        pack->mapped = Sys_MapFile(fp, info.size);
+        if (pack->mapped) {
+            pack->mapped_size = info.size;
+            List_Append(&fs_mapped_packs, &pack->mapped_entry);
+        }
+    }
 
     return pack;
 }
@@ -2805,7 +4361,7 @@ static void add_game_dir(unsigned mode, const char *base, const char *game, bool
 #endif
 
     // add the directory to the search path
-    search = FS_Malloc(sizeof(*search) + len);
+    search = FS_Mallocz(sizeof(*search) + len);
     search->mode = mode;
     search->pack = NULL;
     memcpy(search->filename, fs_gamedir, len + 1);
@@ -2844,7 +4400,7 @@ static void add_game_dir(unsigned mode, const char *base, const char *game, bool
             Com_EPrintf("Couldn't load %s: %s\n", path, Com_GetLastError());
             continue;
         }
-        search = FS_Malloc(sizeof(*search));
+        search = FS_Mallocz(sizeof(*search));
         search->mode = mode;
         search->filename[0] = 0;
         search->pack = pack_get(pack);
@@ -3547,6 +5103,18 @@ static void FS_Stats_f(void)
     Com_Printf("Total path comparisons: %u\n", fs_count_strcmp);
     Com_Printf("Total calls to open_from_disk: %u\n", fs_count_open);
     Com_Printf("Total mixed-case reopens: %u\n", fs_count_strlwr);
+    Com_Printf("Total loads from mapped packs: %u (%"PRIu64" bytes), %u in use\n",
+               fs_count_views, fs_count_view_bytes, fs_num_views);
+
+    if (fs_index.hash) {
+        Com_Printf("Indexed files: %u from %u sources, %u buckets\n",
+                   fs_index.num_entries, fs_index.num_sources, fs_index.hash_size);
+        Com_Printf("Index hits: %u, misses: %u, stale entries: %u\n",
+                   fs_count_index_hits, fs_count_index_misses, fs_count_index_stale);
+        Com_Printf("Disk opens avoided: %"PRIu64"\n", fs_count_index_saved);
+    } else {
+        Com_Printf("File index is disabled\n");
+    }
 
     if (!totalHashSize) {
         Com_Printf("No stats to display\n");
@@ -3716,6 +5284,7 @@ update:
 
 static void free_search_path(searchpath_t *path)
 {
+    index_free_listing(path);
     pack_put(path->pack);
     Z_Free(path);
 }
@@ -3753,7 +5322,7 @@ static void add_builtin_content(void)
     pack = load_builtin_file();
     if (!pack)
         return;
-    search = FS_Malloc(sizeof(*search));
+    search = FS_Mallocz(sizeof(*search));
     search->mode = FS_PATH_BASE | FS_DIR_BASE;
     search->filename[0] = 0;
     search->pack = pack_get(pack);
@@ -3776,7 +5345,7 @@ static void add_game_kpf(unsigned mode, const char *dir)
     if (!pack)
         return;
 
-    search = FS_Malloc(sizeof(*search));
+    search = FS_Mallocz(sizeof(*search));
     search->mode = mode;
     search->filename[0] = 0;
     search->pack = pack_get(pack);
@@ -3862,6 +5431,9 @@ void FS_Restart(bool total)
 {
     Com_Printf("----- FS_Restart -----\n");
 
+    FS_EndPreload();
+    index_free();
+
     if (total) {
         // perform full reset
         free_all_paths();
@@ -3876,6 +5448,8 @@ void FS_Restart(bool total)
 
     setup_game_paths();
 
+    index_build();
+
     SV_RestartFilesystem();
 
     MapDB_Init();
@@ -3910,6 +5484,7 @@ static const cmdreg_t c_fs[] = {
     { "softlink", FS_Link_f, FS_Link_c },
     { "softunlink", FS_UnLink_f, FS_Link_c },
     { "fs_restart", FS_Restart_f },
+    { "fs_rescan", FS_Rescan_f },
 
     { NULL }
 };
@@ -3928,6 +5503,8 @@ void FS_Shutdown(void)
         return;
     }
 
+    FS_EndPreload();
+
     // close file handles
     for (i = 0, file = fs_files; i < fs_num_files; i++, file++) {
         if (file->type != FS_FREE) {
@@ -3942,8 +5519,19 @@ void FS_Shutdown(void)
     free_all_links(&fs_soft_links);
 
     // free search paths
+    index_free();
     free_all_paths();
 
+#if HAVE_INOTIFY
+    if (fs_index.inotify_fd >= 0) {
+        close(fs_index.inotify_fd);
+    }
+    fs_index.inotify_fd = -1;
+    fs_index.watch_failed = false;
+    Z_Free(fs_index.watches);
+    fs_index.watches = NULL;
+#endif
+
 #if USE_ZLIB
     inflateEnd(&fs_zipstream.stream);
 #endif
@@ -4005,6 +5593,8 @@ static void fs_game_changed(cvar_t *self)
         // check for game override
         setup_game_paths();
 
+        index_build();
+
         MapDB_Init();
 
         FS_Path_f();
@@ -4107,10 +5697,23 @@ void FS_Init(void)
 
     List_Init(&fs_hard_links);
     List_Init(&fs_soft_links);
+    List_Init(&fs_mapped_packs);
+    List_Init(&fs_mapped_files);
 
     Cmd_Register(c_fs);
 
     fs_autoexec = Cvar_Get("fs_autoexec", "1", 0);
+    fs_mmap = Cvar_Get("fs_mmap", "1", 0);
+    fs_preload_size = Cvar_Get("fs_preload", "64", 0);
+
+    pthread_mutex_init(&fs_preload.lock, NULL);
+    pthread_cond_init(&fs_preload.cond, NULL);
+
+    fs_index_enable = Cvar_Get("fs_index", "1", 0);
+    fs_index_enable->changed = fs_index_changed;
+#if HAVE_INOTIFY
+    fs_index.inotify_fd = -1;
+#endif
 
 #if USE_DEBUG
     fs_debug = Cvar_Get("fs_debug", "0", 0);
@@ -107,6 +107,10 @@ static cvar_t   *net_enable_ipv6;
 static cvar_t   *net_ignore_icmp;
 #endif
 
+#if HAVE_SENDMMSG
+static cvar_t   *net_batch;
+#endif
+
 static netflag_t    net_active;
 static int          net_error;
 
@@ -142,6 +146,30 @@ static uint64_t     net_bytes_rcvd;
 static uint64_t     net_bytes_sent;
 static uint64_t     net_packets_rcvd;
 static uint64_t     net_packets_sent;
+static uint64_t     net_recv_calls;
+static uint64_t     net_send_calls;
+
+#if HAVE_SENDMMSG
+
+// packets received in one syscall
+#define MAX_RECV_BATCH  32
+
+// packets queued for sending at the end of server frame
+#define MAX_SEND_BATCH  64
+
+// socket is looked up again when sending, it may have been reopened
+typedef struct {
+    netsrc_t        sock;
+    netadr_t        to;
+    size_t          len;
+    byte            data[MAX_PACKETLEN];
+} sendqueue_t;
+
+static byte         net_recv_buffers[MAX_RECV_BATCH][MAX_PACKETLEN];
+static sendqueue_t  net_send_queue[MAX_SEND_BATCH];
+static int          net_send_queued;
+
+#endif
 
 //=============================================================================
 
@@ -514,6 +542,9 @@ static void NET_Stats_f(void)
                net_packets_sent, net_packets_sent / diff);
     Com_Printf("Packets rcvd: %"PRIu64" (%"PRIu64" packets/sec)\n",
                net_packets_rcvd, net_packets_rcvd / diff);
+    Com_Printf("Packets per syscall: %.2f/%.2f (send/recv)\n",
+               net_send_calls ? (double)net_packets_sent / net_send_calls : 0.0,
+               net_recv_calls ? (double)net_packets_rcvd / net_recv_calls : 0.0);
 #if USE_ICMP
     Com_Printf("Total errors: %"PRIu64"/%"PRIu64"/%"PRIu64" (send/recv/icmp)\n",
                net_send_errors, net_recv_errors, net_icmp_errors);
@@ -748,6 +779,73 @@ int NET_Sleep1(int msec, struct pollfd *e)
 
 //=============================================================================
 
+static void NET_UdpPacket(int len, void (*packet_cb)(void))
+{
+    NET_LogPacket(&net_from, "UDP recv", msg_read_buffer, len);
+
+    net_rate_rcvd += len;
+    net_bytes_rcvd += len;
+    net_packets_rcvd++;
+
+    SZ_InitRead(&msg_read, msg_read_buffer, len);
+
+    (*packet_cb)();
+}
+
+#if HAVE_SENDMMSG
+
+// returns false if error occured and socket should be drained the slow way
+static bool NET_GetUdpPacketsBatch(struct pollfd *sock, void (*packet_cb)(void))
+{
+    struct mmsghdr msgs[MAX_RECV_BATCH];
+    struct iovec iovs[MAX_RECV_BATCH];
+    struct sockaddr_storage addrs[MAX_RECV_BATCH];
+    qsocket_t fd = sock->fd;
+    int i, ret;
+
+    while (1) {
+        memset(msgs, 0, sizeof(msgs));
+        memset(addrs, 0, sizeof(addrs));
+        for (i = 0; i < MAX_RECV_BATCH; i++) {
+            iovs[i].iov_base = net_recv_buffers[i];
+            iovs[i].iov_len = MAX_PACKETLEN;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        ret = os_udp_recv_batch(fd, msgs, MAX_RECV_BATCH);
+        net_recv_calls++;
+        if (ret == NET_AGAIN) {
+            sock->revents = 0;
+            return true;
+        }
+
+        // let os_udp_recv deal with the error queue
+        if (ret == NET_ERROR)
+            return false;
+
+        for (i = 0; i < ret; i++) {
+            NET_SockadrToNetadr(&addrs[i], &net_from);
+            memcpy(msg_read_buffer, net_recv_buffers[i], msgs[i].msg_len);
+            NET_UdpPacket(msgs[i].msg_len, packet_cb);
+
+            // socket may have been closed by callback
+            if (sock->fd != fd)
+                return true;
+        }
+
+        // partial batch means socket is drained, don't waste another syscall
+        if (ret < MAX_RECV_BATCH) {
+            sock->revents = 0;
+            return true;
+        }
+    }
+}
+
+#endif // HAVE_SENDMMSG
+
 static void NET_GetUdpPackets(struct pollfd *sock, void (*packet_cb)(void))
 {
     int ret;
@@ -760,8 +858,14 @@ static void NET_GetUdpPackets(struct pollfd *sock, void (*packet_cb)(void))
     if (!(sock->revents & (POLLIN | POLLERR)))
         return;
 
+#if HAVE_SENDMMSG
+    if (net_batch->integer && NET_GetUdpPacketsBatch(sock, packet_cb))
+        return;
+#endif
+
     while (1) {
         ret = os_udp_recv(sock->fd, msg_read_buffer, MAX_PACKETLEN, &net_from);
+        net_recv_calls++;
         if (ret == NET_AGAIN) {
             sock->revents = 0;
             break;
@@ -774,15 +878,7 @@ static void NET_GetUdpPackets(struct pollfd *sock, void (*packet_cb)(void))
             break;
         }
 
-        NET_LogPacket(&net_from, "UDP recv", msg_read_buffer, ret);
-
-        net_rate_rcvd += ret;
-        net_bytes_rcvd += ret;
-        net_packets_rcvd++;
-
-        SZ_InitRead(&msg_read, msg_read_buffer, ret);
-
-        (*packet_cb)();
+        NET_UdpPacket(ret, packet_cb);
     }
 }
 
@@ -811,16 +907,89 @@ void NET_GetPackets(netsrc_t sock, void (*packet_cb)(void))
     NET_GetUdpPackets(udp6_sockets[sock], packet_cb);
 }
 
+static void NET_UdpPacketSent(const netadr_t *to, const void *data,
+                              size_t len, size_t sent)
+{
+    if (sent < len)
+        Com_WPrintf("%s: short send to %s\n", __func__,
+                    NET_AdrToString(to));
+
+    NET_LogPacket(to, "UDP send", data, sent);
+
+    net_rate_sent += sent;
+    net_bytes_sent += sent;
+    net_packets_sent++;
+}
+
+static struct pollfd *NET_UdpSocket(netsrc_t sock, const netadr_t *to)
+{
+    switch (to->type) {
+#if USE_CLIENT
+    case NA_BROADCAST:
+#endif
+    case NA_IP:
+        return udp_sockets[sock];
+    case NA_IP6:
+        return udp6_sockets[sock];
+    default:
+        return NULL;
+    }
+}
+
+static bool NET_SendUdpPacket(struct pollfd *s, const void *data,
+                              size_t len, const netadr_t *to)
+{
+    int ret;
+
+    ret = os_udp_send(s->fd, data, len, to);
+    net_send_calls++;
+    if (ret == NET_AGAIN)
+        return false;
+
+    if (ret == NET_ERROR) {
+        Com_DPrintf("%s: %s to %s\n", __func__,
+                    NET_ErrorString(), NET_AdrToString(to));
+        net_send_errors++;
+        return false;
+    }
+
+    NET_UdpPacketSent(to, data, len, ret);
+    return true;
+}
+
+#if HAVE_SENDMMSG
+static bool NET_QueueUdpPacket(netsrc_t sock, const void *data,
+                               size_t len, const netadr_t *to)
+{
+    sendqueue_t *q;
+
+    if (net_send_queued == MAX_SEND_BATCH)
+        NET_FlushPackets();
+
+    // socket buffer is still full, drop it like an unqueued send would
+    if (net_send_queued == MAX_SEND_BATCH)
+        return false;
+
+    q = &net_send_queue[net_send_queued++];
+    q->sock = sock;
+    q->to = *to;
+    q->len = len;
+    memcpy(q->data, data, len);
+    return true;
+}
+#endif
+
 /*
 =============
 NET_SendPacket
 
+Server packets are queued until NET_FlushPackets when net_batch is set, in
+which case true only means the packet was queued.
 =============
 */
 bool NET_SendPacket(netsrc_t sock, const void *data,
                     size_t len, const netadr_t *to)
 {
-    int ret;
     struct pollfd *s;
 
     if (len == 0)
@@ -841,10 +1010,8 @@ bool NET_SendPacket(netsrc_t sock, const void *data,
     case NA_BROADCAST:
 #endif
     case NA_IP:
-        s = udp_sockets[sock];
-        break;
     case NA_IP6:
-        s = udp6_sockets[sock];
+        s = NET_UdpSocket(sock, to);
         break;
     default:
         Q_assert(!"bad address type");
@@ -853,28 +1020,104 @@ bool NET_SendPacket(netsrc_t sock, const void *data,
     if (!s)
         return false;
 
-    ret = os_udp_send(s->fd, data, len, to);
-    if (ret == NET_AGAIN)
-        return false;
+#if HAVE_SENDMMSG
+    // server packets are sent in one go at the end of frame
+    if (sock == NS_SERVER && net_batch->integer)
+        return NET_QueueUdpPacket(sock, data, len, to);
+#endif
 
-    if (ret == NET_ERROR) {
-        Com_DPrintf("%s: %s to %s\n", __func__,
-                    NET_ErrorString(), NET_AdrToString(to));
-        net_send_errors++;
-        return false;
+    return NET_SendUdpPacket(s, data, len, to);
+}
+
+#if HAVE_SENDMMSG
+
+// returns number of packets sent or dropped; the rest are left for the
+// next flush when the socket buffer is full
+static int NET_SendQueueBatch(struct pollfd *s, sendqueue_t *queue, int count)
+{
+    struct mmsghdr msgs[MAX_SEND_BATCH];
+    struct iovec iovs[MAX_SEND_BATCH];
+    struct sockaddr_storage addrs[MAX_SEND_BATCH];
+    int i, ret;
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (i = 0; i < count; i++) {
+        iovs[i].iov_base = queue[i].data;
+        iovs[i].iov_len = queue[i].len;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = NET_NetadrToSockadr(&queue[i].to, &addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for (i = 0; i < count; ) {
+        ret = os_udp_send_batch(s->fd, msgs + i, count - i);
+        net_send_calls++;
+
+        // socket buffer is full, try again next frame
+        if (ret == NET_AGAIN)
+            break;
+
+        // first packet failed, let os_udp_send deal with the error queue
+        if (ret <= 0) {
+            NET_SendUdpPacket(s, queue[i].data, queue[i].len, &queue[i].to);
+            i++;
+            continue;
+        }
+
+        for (ret += i; i < ret; i++)
+            NET_UdpPacketSent(&queue[i].to, queue[i].data, queue[i].len, msgs[i].msg_len);
     }
 
-    if (ret < len)
-        Com_WPrintf("%s: short send to %s\n", __func__,
-                    NET_AdrToString(to));
+    return i;
+}
 
-    NET_LogPacket(to, "UDP send", data, ret);
+#endif // HAVE_SENDMMSG
 
-    net_rate_sent += ret;
-    net_bytes_sent += ret;
-    net_packets_sent++;
+/*
+=============
+NET_FlushPackets
 
-    return true;
+Sends queued server packets, grouped by socket. Packets that don't fit in
+the socket buffer stay queued, in order, and are retried on the next call.
+Packets for sockets that have been closed are dropped.
+=============
+*/
+void NET_FlushPackets(void)
+{
+#if HAVE_SENDMMSG
+    struct pollfd *s;
+    bool blocked[2] = { false, false };
+    int i, j, v6, sent, kept = 0;
+
+    // only server sockets are queued, one per address family
+    for (i = 0; i < net_send_queued; i = j) {
+        s = NET_UdpSocket(net_send_queue[i].sock, &net_send_queue[i].to);
+        for (j = i + 1; j < net_send_queued; j++)
+            if (NET_UdpSocket(net_send_queue[j].sock, &net_send_queue[j].to) != s)
+                break;
+
+        // keep packets in order behind those already left queued
+        v6 = net_send_queue[i].to.type == NA_IP6;
+        if (!s)
+            sent = j - i;
+        else if (blocked[v6])
+            sent = 0;
+        else
+            sent = NET_SendQueueBatch(s, &net_send_queue[i], j - i);
+
+        if (sent < j - i)
+            blocked[v6] = true;
+
+        // move unsent packets to the front of the queue
+        if (kept != i + sent)
+            memmove(&net_send_queue[kept], &net_send_queue[i + sent],
+                    sizeof(net_send_queue[0]) * (j - i - sent));
+        kept += j - i - sent;
+    }
+
+    net_send_queued = kept;
+#endif
 }
 
 //=============================================================================
@@ -1227,6 +1470,11 @@ void NET_Config(netflag_t flag)
     }
 
     if (flag == NET_NONE) {
+        NET_FlushPackets();
+#if HAVE_SENDMMSG
+        net_send_queued = 0;
+#endif
+
         // shut down any existing sockets
         for (sock = 0; sock < NS_COUNT; sock++) {
             if (udp_sockets[sock]) {
@@ -1855,6 +2103,10 @@ void NET_Init(void)
     net_ignore_icmp = Cvar_Get("net_ignore_icmp", "0", 0);
 #endif
 
+#if HAVE_SENDMMSG
+    net_batch = Cvar_Get("net_batch", "1", 0);
+#endif
+
 #if USE_DEBUG
     net_log_enable_changed(net_log_enable);
 #endif
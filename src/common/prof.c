@@ -0,0 +1,442 @@
+/*
+Copyright (C) 2026
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "shared/shared.h"
+#include "common/cmd.h"
+#include "common/common.h"
+#include "common/cvar.h"
+#include "common/files.h"
+#include "common/prof.h"
+#include "common/zone.h"
+#include "system/system.h"
+#include "system/pthread.h"
+
+#define PROF_MAX_THREADS    64
+#define PROF_MAX_DEPTH      32
+#define PROF_MAX_NAME       32
+
+// 1.5 MiB per thread, enough for several hundred ticks of a busy server
+#define PROF_RING_SIZE      (1 << 16)
+#define PROF_RING_MASK      (PROF_RING_SIZE - 1)
+
+#define PROF_DEFAULT_TICKS  100
+
+typedef struct {
+    uint64_t    start;      // nanoseconds since Prof_Init
+    uint32_t    duration;   // nanoseconds
+    uint16_t    zone;
+    uint16_t    depth;
+    unsigned    tick;
+} profevent_t;
+
+typedef struct {
+    uint64_t    start;
+    int         zone;
+} profscope_t;
+
+typedef struct {
+    unsigned    head;       // total number of events recorded
+    int         index;
+    int         depth;
+    bool        released;
+    profscope_t stack[PROF_MAX_DEPTH];
+    profevent_t events[PROF_RING_SIZE];
+} profthread_t;
+
+bool prof_active;
+
+static cvar_t   *com_profile;
+
+static pthread_mutex_t  prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static char             prof_zones[PROF_MAX_ZONES][PROF_MAX_NAME];
+static int              prof_num_zones;
+static profthread_t     *prof_threads[PROF_MAX_THREADS];
+static int              prof_num_threads;
+static uint64_t         prof_base;
+static unsigned         prof_tick;
+static unsigned         prof_first_tick;
+
+static q_thread_local profthread_t *prof_thread;
+
+static const char *const prof_builtin_zones[PROF_NUM_BUILTIN] = {
+    "sv:frame",
+    "sv:packets",
+    "sv:anticheat",
+    "sv:mvd_clients",
+    "sv:async_packets",
+    "sv:game",
+    "sv:nav",
+    "sv:game_frame",
+    "sv:mvd_capture",
+    "sv:send",
+    "sv:snapshot_setup",
+    "sv:snapshot",
+    "sv:write_frame",
+};
+
+// rings are never freed while the profiler is running, released ones are
+// reused by the next thread that starts recording and keep their events
+static profthread_t *get_thread(void)
+{
+    profthread_t *t = NULL;
+    int i;
+
+    pthread_mutex_lock(&prof_lock);
+    for (i = 0; i < prof_num_threads; i++) {
+        if (prof_threads[i]->released) {
+            t = prof_threads[i];
+            t->released = false;
+            t->depth = 0;
+            break;
+        }
+    }
+    if (!t && prof_num_threads < PROF_MAX_THREADS) {
+        // zone allocator isn't thread safe
+        t = calloc(1, sizeof(*t));
+        if (t) {
+            t->index = prof_num_threads;
+            prof_threads[prof_num_threads++] = t;
+        }
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    return t;
+}
+
+void Prof_ReleaseThread(void)
+{
+    if (!prof_thread)
+        return;
+
+    pthread_mutex_lock(&prof_lock);
+    prof_thread->released = true;
+    pthread_mutex_unlock(&prof_lock);
+
+    prof_thread = NULL;
+}
+
+/*
+=================
+Prof_RegisterZone
+=================
+*/
+int Prof_RegisterZone(const char *name)
+{
+    char buffer[PROF_MAX_NAME];
+    int i, zone = -1;
+
+    for (i = 0; name[i] && i < PROF_MAX_NAME - 1; i++) {
+        int c = name[i];
+        buffer[i] = Q_isalnum(c) || strchr(":_-./ ", c) ? c : '_';
+    }
+    buffer[i] = 0;
+
+    pthread_mutex_lock(&prof_lock);
+    for (i = 0; i < prof_num_zones; i++) {
+        if (!strcmp(prof_zones[i], buffer)) {
+            zone = i;
+            break;
+        }
+    }
+    if (zone == -1 && prof_num_zones < PROF_MAX_ZONES) {
+        zone = prof_num_zones++;
+        Q_strlcpy(prof_zones[zone], buffer, PROF_MAX_NAME);
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    return zone;
+}
+
+/*
+=================
+Prof_Begin
+
+Zones nested deeper than PROF_MAX_DEPTH are counted but not recorded.
+=================
+*/
+void Prof_Begin(int zone)
+{
+    profthread_t *t = prof_thread;
+
+    if (!t && !(t = prof_thread = get_thread()))
+        return;
+
+    if (t->depth < PROF_MAX_DEPTH) {
+        profscope_t *s = &t->stack[t->depth];
+        s->zone = zone;
+        s->start = Sys_Nanoseconds();
+    }
+    t->depth++;
+}
+
+void Prof_End(void)
+{
+    profthread_t *t = prof_thread;
+    profscope_t *s;
+    profevent_t *e;
+    uint64_t end;
+
+    if (!t || !t->depth)
+        return;
+
+    end = Sys_Nanoseconds();
+    if (--t->depth >= PROF_MAX_DEPTH)
+        return;
+
+    s = &t->stack[t->depth];
+    if (s->zone < 0 || s->zone >= PROF_MAX_ZONES)
+        return;
+
+    e = &t->events[t->head & PROF_RING_MASK];
+    e->start = s->start - prof_base;
+    e->duration = min(end - s->start, UINT32_MAX);
+    e->zone = s->zone;
+    e->depth = t->depth;
+    e->tick = prof_tick;
+    t->head++;
+}
+
+/*
+=================
+Prof_EndTick
+
+Worker threads only record zones while the main thread waits for them,
+so recording state can be changed here without locking.
+=================
+*/
+void Prof_EndTick(void)
+{
+    int i;
+
+    if (prof_thread)
+        prof_thread->depth = 0;    // in case of error longjmp out of a zone
+
+    // stop counting while disabled so the last recording can still be dumped
+    if (prof_active)
+        prof_tick++;
+
+    if (prof_active == !!com_profile->integer)
+        return;
+
+    prof_active = com_profile->integer;
+    if (prof_active) {
+        for (i = 0; i < prof_num_threads; i++)
+            prof_threads[i]->head = 0;
+        prof_first_tick = prof_tick;
+    }
+}
+
+// returns number of complete ticks available, up to the requested count
+static unsigned window_ticks(unsigned count)
+{
+    unsigned ticks = prof_tick - prof_first_tick;
+    int i;
+
+    for (i = 0; i < prof_num_threads; i++) {
+        profthread_t *t = prof_threads[i];
+        if (t->head > PROF_RING_SIZE) {
+            // oldest retained tick may be partially overwritten
+            unsigned oldest = t->events[t->head & PROF_RING_MASK].tick + 1;
+            ticks = min(ticks, prof_tick - oldest);
+        }
+    }
+
+    return min(ticks, count);
+}
+
+static bool in_window(const profevent_t *e, unsigned ticks)
+{
+    return e->tick < prof_tick && prof_tick - e->tick <= ticks;
+}
+
+static void Prof_Dump_f(void)
+{
+    char buffer[MAX_OSPATH];
+    unsigned ticks, count = 0, j, first;
+    qhandle_t f;
+    int i;
+
+    if (Cmd_Argc() > 3) {
+        Com_Printf("Usage: %s [ticks] [name]\n", Cmd_Argv(0));
+        return;
+    }
+
+    ticks = PROF_DEFAULT_TICKS;
+    if (Cmd_Argc() > 1)
+        ticks = max(Q_atoi(Cmd_Argv(1)), 1);
+    ticks = window_ticks(ticks);
+    if (!ticks) {
+        Com_Printf("No ticks recorded. Set com_profile to 1 to start profiling.\n");
+        return;
+    }
+
+    f = FS_EasyOpenFile(buffer, sizeof(buffer), FS_MODE_WRITE | FS_FLAG_TEXT,
+                        "profiles/", Cmd_Argc() > 2 ? Cmd_Argv(2) : "trace", ".json");
+    if (!f)
+        return;
+
+    FS_FPrintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (i = 0; i < prof_num_threads; i++) {
+        profthread_t *t = prof_threads[i];
+
+        if (i)
+            FS_FPrintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                       "\"args\":{\"name\":\"worker %d\"}},\n", t->index, t->index);
+        else
+            FS_FPrintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                       "\"args\":{\"name\":\"main\"}},\n");
+
+        first = t->head > PROF_RING_SIZE ? t->head - PROF_RING_SIZE : 0;
+        for (j = first; j < t->head; j++) {
+            const profevent_t *e = &t->events[j & PROF_RING_MASK];
+            if (!in_window(e, ticks))
+                continue;
+            // zone names are sanitized on registration
+            FS_FPrintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                       "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"tick\":%u}},\n",
+                       prof_zones[e->zone], t->index, e->start * 1e-3,
+                       e->duration * 1e-3, e->tick);
+            count++;
+        }
+    }
+
+    // terminating metadata event avoids trailing comma
+    FS_FPrintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"args\":{\"name\":\"%s\"}}\n]}\n", COM_DEDICATED ? "server" : "client");
+
+    if (FS_CloseFile(f))
+        Com_EPrintf("Error writing %s\n", buffer);
+    else
+        Com_Printf("Wrote %u events from %u ticks to %s.\n", count, ticks, buffer);
+}
+
+static int durcmp(const void *p1, const void *p2)
+{
+    uint32_t a = *(const uint32_t *)p1;
+    uint32_t b = *(const uint32_t *)p2;
+    return (a > b) - (a < b);
+}
+
+static void Prof_Stats_f(void)
+{
+    unsigned counts[PROF_MAX_ZONES] = { 0 };
+    unsigned offsets[PROF_MAX_ZONES];
+    uint64_t totals[PROF_MAX_ZONES] = { 0 };
+    unsigned ticks, total = 0, j, first;
+    uint32_t *durations;
+    int i;
+
+    ticks = PROF_DEFAULT_TICKS;
+    if (Cmd_Argc() > 1)
+        ticks = max(Q_atoi(Cmd_Argv(1)), 1);
+    ticks = window_ticks(ticks);
+    if (!ticks) {
+        Com_Printf("No ticks recorded. Set com_profile to 1 to start profiling.\n");
+        return;
+    }
+
+    // first pass counts events per zone, second one sorts them into buckets
+    for (i = 0; i < prof_num_threads; i++) {
+        profthread_t *t = prof_threads[i];
+        first = t->head > PROF_RING_SIZE ? t->head - PROF_RING_SIZE : 0;
+        for (j = first; j < t->head; j++) {
+            const profevent_t *e = &t->events[j & PROF_RING_MASK];
+            if (in_window(e, ticks)) {
+                counts[e->zone]++;
+                total++;
+            }
+        }
+    }
+
+    if (!total) {
+        Com_Printf("No zones recorded in last %u ticks.\n", ticks);
+        return;
+    }
+
+    for (i = 0, j = 0; i < prof_num_zones; i++) {
+        offsets[i] = j;
+        j += counts[i];
+    }
+
+    durations = Z_Malloc(sizeof(durations[0]) * total);
+
+    for (i = 0; i < prof_num_threads; i++) {
+        profthread_t *t = prof_threads[i];
+        first = t->head > PROF_RING_SIZE ? t->head - PROF_RING_SIZE : 0;
+        for (j = first; j < t->head; j++) {
+            const profevent_t *e = &t->events[j & PROF_RING_MASK];
+            if (in_window(e, ticks)) {
+                durations[offsets[e->zone]++] = e->duration;
+                totals[e->zone] += e->duration;
+            }
+        }
+    }
+
+    Com_Printf("Last %u ticks, times in microseconds:\n", ticks);
+    Com_Printf("zone                     calls/tick time/tick      p50      p99      max\n"
+               "------------------------ ---------- --------- -------- -------- --------\n");
+
+    for (i = 0; i < prof_num_zones; i++) {
+        unsigned n = counts[i];
+        uint32_t *d;
+
+        if (!n)
+            continue;
+
+        d = durations + offsets[i] - n;
+        qsort(d, n, sizeof(d[0]), durcmp);
+
+        Com_Printf("%-24s %10.1f %9.1f %8.1f %8.1f %8.1f\n", prof_zones[i],
+                   (double)n / ticks, totals[i] * 1e-3 / ticks,
+                   d[(n - 1) / 2] * 1e-3, d[(n - 1) * 99 / 100] * 1e-3,
+                   d[n - 1] * 1e-3);
+    }
+
+    Z_Free(durations);
+}
+
+void Prof_Init(void)
+{
+    int i;
+
+    com_profile = Cvar_Get("com_profile", "0", 0);
+
+    prof_base = Sys_Nanoseconds();
+
+    for (i = 0; i < PROF_NUM_BUILTIN; i++)
+        Q_assert(Prof_RegisterZone(prof_builtin_zones[i]) == i);
+
+    // main thread always comes first
+    prof_thread = get_thread();
+
+    Cmd_AddCommand("profile_dump", Prof_Dump_f);
+    Cmd_AddCommand("profile_stats", Prof_Stats_f);
+}
+
+void Prof_Shutdown(void)
+{
+    int i;
+
+    prof_active = false;
+    prof_thread = NULL;
+
+    for (i = 0; i < prof_num_threads; i++)
+        free(prof_threads[i]);
+    prof_num_threads = 0;
+}
@@ -19,14 +19,17 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "shared/shared.h"
 #include "common/bsp.h"
 #include "common/cmd.h"
+#include "common/cmodel.h"
 #include "common/common.h"
 #include "common/files.h"
 #include "common/mdfour.h"
+#include "common/prof.h"
 #include "common/tests.h"
 #include "common/utils.h"
 #include "renderer/renderer.h"
 #include "../rend_gl/images.h"
 #include "system/system.h"
+#include "system/pthread.h"
 #include "client/client.h"
 #include "client/sound/sound.h"
 
@@ -197,6 +200,469 @@ static void BSP_Test_f(void)
     FS_FreeList(list);
 }
 
+// loads files both in place and copied, and checks that contents match
+static void Com_LoadTest_f(void)
+{
+    const char *filter = Cmd_Argc() > 1 ? Cmd_Argv(1) : "*";
+    void **list, *mapped, *copied;
+    int i, count, len, errors;
+    uint64_t start, mapped_time, copied_time, total;
+
+    list = FS_ListFiles(NULL, filter, FS_SEARCH_BYFILTER | FS_TYPE_PAK, &count);
+    if (!list) {
+        Com_Printf("No files found\n");
+        return;
+    }
+
+    errors = 0;
+    total = mapped_time = copied_time = 0;
+    for (i = 0; i < count; i++) {
+        start = Sys_Nanoseconds();
+        len = FS_LoadFileFlags(list[i], &mapped, FS_FLAG_MMAP);
+        mapped_time += Sys_Nanoseconds() - start;
+
+        start = Sys_Nanoseconds();
+        FS_LoadFile(list[i], &copied);
+        copied_time += Sys_Nanoseconds() - start;
+
+        if (!mapped || !copied || memcmp(mapped, copied, len)) {
+            Com_EPrintf("%s differs\n", (char *)list[i]);
+            errors++;
+        } else {
+            total += len;
+        }
+
+        FS_FreeFile(mapped);
+        FS_FreeFile(copied);
+    }
+
+    Com_Printf("%d files, %"PRIu64" bytes, %d failures\n", count, total, errors);
+    Com_Printf("mapped: %.3f msec, copied: %.3f msec\n",
+               mapped_time * 1e-6, copied_time * 1e-6);
+
+    FS_FreeList(list);
+}
+
+// checksum stands in for decoding, done on worker when read ahead
+static void *preload_test_decode(const char *path, const void *data, size_t len,
+                                 void *arg, size_t *size)
+{
+    uint32_t *sum = malloc(sizeof(*sum));
+
+    if (sum)
+        *sum = Com_BlockChecksum(data, len);
+    *size = sizeof(*sum);
+    return sum;
+}
+
+static const fs_decoder_t preload_test_decoder = {
+    .decode = preload_test_decode,
+    .free = free,
+};
+
+// loads files one by one, then read ahead, then read and decoded ahead, and
+// checks that contents match
+static void Com_PreloadTest_f(void)
+{
+    const char *filter = Cmd_Argc() > 1 ? Cmd_Argv(1) : "*";
+    void **list, *data;
+    uint32_t *sums, *sum, check;
+    int i, count, len, errors, decoded;
+    uint64_t start, serial_time, preload_time, decode_time, total;
+
+    list = FS_ListFiles(NULL, filter, FS_SEARCH_BYFILTER, &count);
+    if (!list) {
+        Com_Printf("No files found\n");
+        return;
+    }
+
+    sums = Z_Malloc(sizeof(sums[0]) * count);
+    total = 0;
+
+    start = Sys_Nanoseconds();
+    for (i = 0; i < count; i++) {
+        len = FS_LoadFile(list[i], &data);
+        sums[i] = data ? Com_BlockChecksum(data, len) : 0;
+        total += max(len, 0);
+        FS_FreeFile(data);
+    }
+    serial_time = Sys_Nanoseconds() - start;
+
+    errors = 0;
+    start = Sys_Nanoseconds();
+    if (FS_BeginPreload()) {
+        for (i = 0; i < count; i++)
+            FS_PreloadFile(list[i]);
+    }
+    for (i = 0; i < count; i++) {
+        len = FS_LoadFile(list[i], &data);
+        if ((data ? Com_BlockChecksum(data, len) : 0) != sums[i]) {
+            Com_EPrintf("%s differs\n", (char *)list[i]);
+            errors++;
+        }
+        FS_FreeFile(data);
+    }
+    FS_EndPreload();
+    preload_time = Sys_Nanoseconds() - start;
+
+    decoded = 0;
+    start = Sys_Nanoseconds();
+    if (FS_BeginPreload()) {
+        for (i = 0; i < count; i++)
+            FS_PreloadFileEx(list[i], &preload_test_decoder, NULL);
+    }
+    for (i = 0; i < count; i++) {
+        sum = FS_ClaimDecoded(list[i], &preload_test_decoder);
+        if (sum) {
+            check = *sum;
+            free(sum);
+            decoded++;
+        } else {
+            len = FS_LoadFile(list[i], &data);
+            check = data ? Com_BlockChecksum(data, len) : 0;
+            FS_FreeFile(data);
+        }
+        if (check != sums[i]) {
+            Com_EPrintf("%s differs when decoded\n", (char *)list[i]);
+            errors++;
+        }
+    }
+    FS_EndPreload();
+    decode_time = Sys_Nanoseconds() - start;
+
+    Com_Printf("%d files, %"PRIu64" bytes, %d decoded ahead, %d failures\n",
+               count, total, decoded, errors);
+    Com_Printf("serial: %.3f msec, preloaded: %.3f msec, decoded ahead: %.3f msec\n",
+               serial_time * 1e-6, preload_time * 1e-6, decode_time * 1e-6);
+
+    Z_Free(sums);
+    FS_FreeList(list);
+}
+
+// rays are traced in groups of 16 of the same kind
+enum {
+    TRACE_TEST_POINT,
+    TRACE_TEST_BOX,
+    TRACE_TEST_ENTITY,  // against box hull from thread context
+
+    TRACE_TEST_KINDS
+};
+
+typedef struct {
+    const bsp_t     *bsp;
+    const vec3_t    *starts;
+    const vec3_t    *ends;
+    const trace_t   *expect;    // NULL when computing reference
+    trace_t         *results;
+    int             count;
+    bool            batch;
+    int             mismatches;
+    cm_trace_ctx_t  ctx;
+} tracetest_t;
+
+static const vec3_t trace_test_mins = { -16, -16, -24 };
+static const vec3_t trace_test_maxs = { 16, 16, 32 };
+
+static void TraceTest_Run(tracetest_t *t)
+{
+    const mnode_t *headnode = t->bsp->nodes;
+    const float *mins, *maxs;
+    vec3_t origin;
+    int i, j, n, kind;
+
+    for (i = 0; i < t->count; i += 16) {
+        n = min(16, t->count - i);
+        kind = (i / 16) % TRACE_TEST_KINDS;
+
+        if (kind == TRACE_TEST_ENTITY) {
+            // box sitting halfway along the ray
+            for (j = i; j < i + n; j++) {
+                LerpVector(t->starts[j], t->ends[j], 0.5f, origin);
+                CM_TransformedBoxTrace(&t->results[j], t->starts[j], t->ends[j],
+                                       vec3_origin, vec3_origin,
+                                       CM_HeadnodeForBoxCtx(&t->ctx, trace_test_mins, trace_test_maxs),
+                                       MASK_SOLID, origin, vec3_origin, true);
+            }
+            continue;
+        }
+
+        mins = kind == TRACE_TEST_BOX ? trace_test_mins : vec3_origin;
+        maxs = kind == TRACE_TEST_BOX ? trace_test_maxs : vec3_origin;
+
+        if (t->batch) {
+            CM_BoxTraceBatch(&t->results[i], &t->starts[i], &t->ends[i], n,
+                             mins, maxs, headnode, MASK_SOLID, true);
+            continue;
+        }
+
+        for (j = i; j < i + n; j++)
+            CM_BoxTrace(&t->results[j], t->starts[j], t->ends[j],
+                        mins, maxs, headnode, MASK_SOLID, true);
+    }
+
+    if (!t->expect)
+        return;
+
+    for (i = 0; i < t->count; i++)
+        if (memcmp(&t->results[i], &t->expect[i], sizeof(t->expect[0])))
+            t->mismatches++;
+}
+
+static void *TraceTest_Thread(void *arg)
+{
+    TraceTest_Run(arg);
+    return NULL;
+}
+
+// trace random rays from multiple threads, check that results match
+// single threaded execution
+static void Com_TraceTest_f(void)
+{
+    tracetest_t *tests;
+    pthread_t *threads;
+    vec3_t *starts, *ends;
+    trace_t *expect;
+    const mmodel_t *world;
+    bsp_t *bsp;
+    int i, j, ret, numthreads, count, started, mismatches;
+    unsigned start, reference;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <map> [threads] [count]\n", Cmd_Argv(0));
+        return;
+    }
+
+    ret = BSP_Load(va("maps/%s.bsp", Cmd_Argv(1)), &bsp);
+    if (!bsp) {
+        Com_EPrintf("Couldn't load %s: %s\n", Cmd_Argv(1), BSP_ErrorString(ret));
+        return;
+    }
+
+    numthreads = 4;
+    if (Cmd_Argc() > 2)
+        numthreads = Q_clip(Q_atoi(Cmd_Argv(2)), 1, 64);
+
+    count = 1000000;
+    if (Cmd_Argc() > 3)
+        count = Q_clip(Q_atoi(Cmd_Argv(3)), 16, 100000000);
+
+    starts = Z_Malloc(sizeof(starts[0]) * count);
+    ends = Z_Malloc(sizeof(ends[0]) * count);
+    expect = Z_Malloc(sizeof(expect[0]) * count);
+    tests = Z_Mallocz(sizeof(tests[0]) * (numthreads + 1));
+    threads = Z_Malloc(sizeof(threads[0]) * numthreads);
+
+    // rays in a group share start point, with some position tests
+    world = &bsp->models[0];
+    for (i = 0; i < count; i++) {
+        if (i % 16 == 0) {
+            for (j = 0; j < 3; j++)
+                starts[i][j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+        } else {
+            VectorCopy(starts[i - 1], starts[i]);
+        }
+        if (Q_rand() % 64 == 0)
+            VectorCopy(starts[i], ends[i]);
+        else
+            for (j = 0; j < 3; j++)
+                ends[i][j] = starts[i][j] + crand() * 2048;
+    }
+
+    for (i = 0; i <= numthreads; i++) {
+        tests[i].bsp = bsp;
+        tests[i].starts = (const vec3_t *)starts;
+        tests[i].ends = (const vec3_t *)ends;
+        tests[i].count = count;
+        tests[i].batch = i & 1;     // odd threads use batched traces
+        CM_InitTraceCtx(&tests[i].ctx);
+        if (i < numthreads) {
+            tests[i].expect = expect;
+            tests[i].results = Z_Malloc(sizeof(trace_t) * count);
+        }
+    }
+
+    // reference run
+    tests[numthreads].results = expect;
+    tests[numthreads].batch = false;
+    start = Sys_Milliseconds();
+    TraceTest_Run(&tests[numthreads]);
+    reference = Sys_Milliseconds() - start;
+
+    start = Sys_Milliseconds();
+    for (started = 0; started < numthreads; started++)
+        if (pthread_create(&threads[started], NULL, TraceTest_Thread, &tests[started]))
+            break;
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    Com_Printf("%d traces: %u msec single threaded, %u msec on %d threads\n",
+               count, reference, Sys_Milliseconds() - start, started);
+
+    mismatches = 0;
+    for (i = 0; i < numthreads; i++) {
+        mismatches += tests[i].mismatches;
+        Z_Free(tests[i].results);
+    }
+    Com_Printf("%d mismatches\n", mismatches);
+
+    Z_Free(starts);
+    Z_Free(ends);
+    Z_Free(expect);
+    Z_Free(tests);
+    Z_Free(threads);
+    BSP_Free(bsp);
+}
+
+// allocates and frees small blocks the way map loading and cvar/cmd
+// changes do, with or without zone pools
+static unsigned ZoneBench_Churn(int count)
+{
+    void **blocks = Z_Mallocz(sizeof(blocks[0]) * 1024);
+    unsigned start = Sys_Milliseconds();
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        j = Q_rand() % 1024;
+        Z_Free(blocks[j]);
+        blocks[j] = Z_TagMalloc(8 + Q_rand() % 256, (i & 1) ? TAG_CMODEL : TAG_GENERAL);
+    }
+
+    for (i = 0; i < 1024; i++)
+        Z_Free(blocks[i]);
+    Z_Free(blocks);
+
+    return Sys_Milliseconds() - start;
+}
+
+// loads and frees each map in turn. a map that is already loaded elsewhere
+// would come straight from the BSP cache, so those are skipped.
+static unsigned ZoneBench_Map(int first, int count)
+{
+    char name[MAX_QPATH];
+    unsigned start, msec = 0;
+    cm_t cm;
+    int i, j, ret;
+
+    for (i = 0; i < count; i++) {
+        for (j = first; j < Cmd_Argc(); j++) {
+            Q_concat(name, sizeof(name), "maps/", Cmd_Argv(j), ".bsp");
+
+            memset(&cm, 0, sizeof(cm));
+            start = Sys_Milliseconds();
+            ret = CM_LoadMap(&cm, name);
+            if (ret) {
+                Com_EPrintf("Couldn't load %s: %s\n", name, BSP_ErrorString(ret));
+                return msec;
+            }
+            if (cm.cache->refcount > 1) {
+                Com_WPrintf("%s is in use, not timing cached loads\n", name);
+                CM_FreeMap(&cm);
+                return msec;
+            }
+            CM_FreeMap(&cm);
+            msec += Sys_Milliseconds() - start;
+        }
+    }
+
+    return msec;
+}
+
+static void Com_ZoneBench_f(void)
+{
+    zcounters_t before, after;
+    int i, count, pools;
+    unsigned msec;
+
+    count = 10;
+    if (Cmd_Argc() > 1)
+        count = Q_clip(Q_atoi(Cmd_Argv(1)), 1, 10000);
+
+    pools = z_pools->integer;
+    for (i = 0; i < 2; i++) {
+        Cvar_SetInteger(z_pools, i, FROM_CODE);
+
+        Z_GetCounters(&before);
+        msec = ZoneBench_Churn(count * 100000);
+        Z_GetCounters(&after);
+        Com_Printf("%s churn: %u msec, %"PRIu64" allocations, %"PRIu64" system allocations\n",
+                   i ? "pools" : "malloc", msec, after.allocs - before.allocs,
+                   after.sysallocs - before.sysallocs);
+
+        if (Cmd_Argc() < 3)
+            continue;
+
+        Z_GetCounters(&before);
+        msec = ZoneBench_Map(2, count);
+        Z_GetCounters(&after);
+        Com_Printf("%s map load: %u msec, %"PRIu64" allocations, %"PRIu64" system allocations\n",
+                   i ? "pools" : "malloc", msec, after.allocs - before.allocs,
+                   after.sysallocs - before.sysallocs);
+    }
+    Cvar_SetInteger(z_pools, pools, FROM_CODE);
+}
+
+static void ProfTest_Spin(unsigned usec)
+{
+    uint64_t end = Sys_Nanoseconds() + usec * 1000ULL;
+
+    while (Sys_Nanoseconds() < end)
+        ;
+}
+
+static void *ProfTest_Thread(void *arg)
+{
+    PROF_BEGIN(PROF_SV_SNAPSHOT);
+    ProfTest_Spin(*(unsigned *)arg);
+    PROF_END();
+
+    Prof_ReleaseThread();
+    return NULL;
+}
+
+// records fake ticks with nested zones on the main thread and short lived
+// workers, results can be inspected with profile_stats and profile_dump
+static void Com_ProfTest_f(void)
+{
+    pthread_t threads[16];
+    unsigned usec[16];
+    int i, j, ticks, numthreads, started, zone;
+
+    ticks = 100;
+    if (Cmd_Argc() > 1)
+        ticks = Q_clip(Q_atoi(Cmd_Argv(1)), 1, 10000);
+
+    numthreads = 2;
+    if (Cmd_Argc() > 2)
+        numthreads = Q_clip(Q_atoi(Cmd_Argv(2)), 0, q_countof(threads));
+
+    // recording only starts on tick boundary
+    Cvar_Set("com_profile", "1");
+    Prof_EndTick();
+
+    zone = Prof_RegisterZone("test:inner");
+
+    for (i = 0; i < ticks; i++) {
+        PROF_BEGIN(PROF_SV_FRAME);
+
+        PROF_BEGIN(zone);
+        ProfTest_Spin(50 + Q_rand() % 100);
+        PROF_END();
+
+        for (started = 0; started < numthreads; started++) {
+            usec[started] = 100 + Q_rand() % 200;
+            if (pthread_create(&threads[started], NULL, ProfTest_Thread, &usec[started]))
+                break;
+        }
+        for (j = 0; j < started; j++)
+            pthread_join(threads[j], NULL);
+
+        PROF_END();
+        Prof_EndTick();
+    }
+
+    Com_Printf("Recorded %d ticks with %d threads.\n", ticks, numthreads);
+}
+
 typedef struct {
     const char *filter;
     const char *string;
@@ -902,6 +1368,11 @@ static const cmdreg_t c_test[] = {
     { "doublefree", Com_DoubleFree_f },
     { "printjunk", Com_PrintJunk_f },
     { "bsptest", BSP_Test_f },
+    { "loadtest", Com_LoadTest_f },
+    { "preloadtest", Com_PreloadTest_f },
+    { "tracetest", Com_TraceTest_f },
+    { "zonebench", Com_ZoneBench_f },
+    { "proftest", Com_ProfTest_f },
     { "wildtest", Com_TestWild_f },
     { "normtest", Com_TestNorm_f },
     { "infotest", Com_TestInfo_f },
@@ -28,10 +28,26 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #define Z_MAGIC     0x1d0d
 
+// blocks are linked into one of these chains depending on their tag, this
+// keeps Z_FreeTags proportional to number of blocks in tag
+#define Z_TAG_CHAINS    64
+#define Z_TAG_CHAIN(tag)    ((tag) & (Z_TAG_CHAINS - 1))
+
+// small blocks are carved from slab pages, one page per size class
+#define Z_SLAB_PAGE     0x10000
+#define Z_SLAB_MAX      512
+#define Z_SLAB_CLASSES  (Z_SLAB_MAX / 16 + 1)
+
+// blocks of arena tags are bump allocated from chunks shared by that tag
+#define Z_ARENA_CHUNK   0x40000
+#define Z_ARENA_MAX     0x8000
+
 typedef struct {
     uint16_t        magic;
     uint16_t        tag;        // for group free
-    size_t          size;
+    uint32_t        size;
+    uint32_t        offset;     // from start of page, 0 if allocated with malloc
+    uint32_t        pad;
     list_t          entry;
 #if USE_MEMORY_TRACES
     void            *trace[MAX_TRACE_SIZE];
@@ -48,8 +64,36 @@ typedef struct {
     size_t      bytes;
 } zstats_t;
 
-static list_t       z_chain;
+typedef struct zfree_s {
+    struct zfree_s  *next;
+} zfree_t;
+
+typedef struct {
+    list_t      entry;      // partial slab list or arena chunk list
+    zfree_t     *free;      // freed slab blocks
+    uint32_t    used;       // bump offset
+    uint32_t    size;
+    uint32_t    live;       // allocated blocks
+    int         cls;        // slab size class, -1 for arena chunk
+    uint16_t    tag;        // arena tag
+} zpage_t;
+
+// keeps blocks 16 byte aligned
+#define Z_PAGE_HEADER   Q_ALIGN(sizeof(zpage_t), 16)
+
+typedef struct {
+    list_t      chunks;
+    zpage_t     *current;
+} zarena_t;
+
+static list_t       z_chains[Z_TAG_CHAINS];
 static zstats_t     z_stats[TAG_MAX];
+static zcounters_t  z_counters;
+
+static list_t       z_slabs[Z_SLAB_CLASSES];
+static zarena_t     z_arenas[TAG_MAX];
+static size_t       z_slab_bytes;
+static size_t       z_arena_bytes;
 
 #define S(d) \
     { .z = { .magic = Z_MAGIC, .tag = TAG_STATIC, .size = sizeof(zstatic_t) }, .data = d }
@@ -72,11 +116,17 @@ static const char *const z_tagnames[TAG_MAX] = {
     "server",
     "mvd",
     "sound",
-    "cmodel"
+    "cmodel",
+    "nav",
+    "mapdb"
 };
 
 #define TAG_INDEX(tag)  ((tag) < TAG_MAX ? (tag) : TAG_FREE)
 
+// tags whose blocks mostly live until map change
+#define Z_ARENA_TAG(tag) \
+    ((tag) == TAG_CMODEL || (tag) == TAG_RENDERER || (tag) == TAG_MAPDB)
+
 static inline void Z_CountFree(const zhead_t *z)
 {
     zstats_t *s = &z_stats[TAG_INDEX(z->tag)];
@@ -94,16 +144,147 @@ static inline void Z_CountAlloc(const zhead_t *z)
 #define Z_Validate(z) \
     Q_assert((z)->magic == Z_MAGIC && (z)->tag != TAG_FREE)
 
+static void *Z_SysAlloc(size_t size, bool init)
+{
+    void *ptr = init ? calloc(1, size) : malloc(size);
+    if (!ptr) {
+        Com_Error(ERR_FATAL, "%s: couldn't allocate %zu bytes", __func__, size);
+    }
+    z_counters.sysallocs++;
+    return ptr;
+}
+
+static inline zpage_t *Z_PageForBlock(const zhead_t *z)
+{
+    return (zpage_t *)((byte *)z - z->offset);
+}
+
+static zpage_t *Z_AllocPage(uint32_t size, int cls, uint16_t tag)
+{
+    zpage_t *page = Z_SysAlloc(size, false);
+
+    page->free = NULL;
+    page->used = Z_PAGE_HEADER;
+    page->size = size;
+    page->live = 0;
+    page->cls = cls;
+    page->tag = tag;
+    return page;
+}
+
+static zhead_t *Z_SlabAlloc(size_t size)
+{
+    int cls = (size + 15) >> 4;
+    list_t *list = &z_slabs[cls];
+    zpage_t *page;
+    zhead_t *z;
+
+    if (LIST_EMPTY(list)) {
+        page = Z_AllocPage(Z_SLAB_PAGE, cls, 0);
+        List_Insert(list, &page->entry);
+        z_slab_bytes += Z_SLAB_PAGE;
+    } else {
+        page = LIST_FIRST(zpage_t, list, entry);
+    }
+
+    if (page->free) {
+        z = (zhead_t *)page->free;
+        page->free = page->free->next;
+    } else {
+        z = (zhead_t *)((byte *)page + page->used);
+        page->used += cls << 4;
+    }
+
+    // page is full, take it off partial list
+    if (!page->free && page->used + (cls << 4) > page->size) {
+        List_Delete(&page->entry);
+    }
+
+    page->live++;
+    z->offset = (byte *)z - (byte *)page;
+    return z;
+}
+
+static void Z_SlabFree(zhead_t *z)
+{
+    zpage_t *page = Z_PageForBlock(z);
+    list_t *list = &z_slabs[page->cls];
+    zfree_t *f = (zfree_t *)z;
+    bool full = !page->free && page->used + (page->cls << 4) > page->size;
+
+    f->next = page->free;
+    page->free = f;
+
+    if (full) {
+        List_Insert(list, &page->entry);
+    }
+
+    // release empty page unless it's the last one for this class
+    if (!--page->live && !LIST_SINGLE(list)) {
+        List_Remove(&page->entry);
+        z_slab_bytes -= page->size;
+        free(page);
+    }
+}
+
+static zhead_t *Z_ArenaAlloc(size_t size, memtag_t tag)
+{
+    zarena_t *arena = &z_arenas[tag];
+    zpage_t *page = arena->current;
+    zhead_t *z;
+
+    size = Q_ALIGN(size, 16);
+
+    if (!page || page->used + size > page->size) {
+        page = Z_AllocPage(Z_ARENA_CHUNK, -1, tag);
+        List_Append(&arena->chunks, &page->entry);
+        arena->current = page;
+        z_arena_bytes += Z_ARENA_CHUNK;
+    }
+
+    z = (zhead_t *)((byte *)page + page->used);
+    page->used += size;
+    page->live++;
+    z->offset = (byte *)z - (byte *)page;
+    return z;
+}
+
+static void Z_ArenaFree(zhead_t *z)
+{
+    zpage_t *page = Z_PageForBlock(z);
+    zarena_t *arena = &z_arenas[page->tag];
+
+    if (--page->live) {
+        return;
+    }
+
+    // current chunk is reused from start, others are released
+    if (page == arena->current) {
+        page->used = Z_PAGE_HEADER;
+        return;
+    }
+
+    List_Remove(&page->entry);
+    z_arena_bytes -= page->size;
+    free(page);
+}
+
 void Z_LeakTest(memtag_t tag)
 {
     zhead_t *z;
     size_t numLeaks = 0, numBytes = 0;
+    int i;
 
-    LIST_FOR_EACH(zhead_t, z, &z_chain, entry) {
-        Z_Validate(z);
-        if (z->tag == tag || (tag == TAG_FREE && z->tag >= TAG_MAX)) {
-            numLeaks++;
-            numBytes += z->size;
+    for (i = 0; i < Z_TAG_CHAINS; i++) {
+        if (tag != TAG_FREE && i != Z_TAG_CHAIN(tag)) {
+            continue;
+        }
+        LIST_FOR_EACH(zhead_t, z, &z_chains[i], entry) {
+            Z_Validate(z);
+            if (z->tag == tag || (tag == TAG_FREE && z->tag >= TAG_MAX)) {
+                numLeaks++;
+                numBytes += z->size;
+            }
         }
     }
 
@@ -139,7 +320,13 @@ void Z_Free(void *ptr)
         List_Remove(&z->entry);
         z->magic = 0xdead;
         z->tag = TAG_FREE;
-        free(z);
+        if (!z->offset) {
+            free(z);
+        } else if (Z_PageForBlock(z)->cls < 0) {
+            Z_ArenaFree(z);
+        } else {
+            Z_SlabFree(z);
+        }
     }
 }
 
@@ -167,6 +354,7 @@ Z_Realloc
 void *Z_Realloc(void *ptr, size_t size)
 {
     zhead_t *z;
+    void *copy;
 
     if (!ptr) {
         return Z_Malloc(size);
@@ -190,12 +378,21 @@ void *Z_Realloc(void *ptr, size_t size)
 
     Q_assert(z->tag != TAG_STATIC);
 
+    // pooled blocks can't be resized in place
+    if (z->offset) {
+        copy = Z_TagMalloc(size - sizeof(*z), z->tag);
+        memcpy(copy, z + 1, min(size, z->size) - sizeof(*z));
+        Z_Free(z + 1);
+        return copy;
+    }
+
     Z_CountFree(z);
 
     z = realloc(z, size);
     if (!z) {
         Com_Error(ERR_FATAL, "%s: couldn't realloc %zu bytes", __func__, size);
     }
+    z_counters.sysallocs++;
 
     z->size = size;
 #if USE_MEMORY_TRACES
@@ -243,6 +440,21 @@ void Z_Stats_f(void)
     Com_Printf("--------- ------ -------\n"
                "%9zu %6zu total\n",
                bytes, count);
+
+    Com_Printf("%zu bytes in slab pages, %zu bytes in arena chunks\n"
+               "%"PRIu64" allocations, %"PRIu64" system allocations\n",
+               z_slab_bytes, z_arena_bytes,
+               z_counters.allocs, z_counters.sysallocs);
+}
+
+/*
+========================
+Z_GetCounters
+========================
+*/
+void Z_GetCounters(zcounters_t *counters)
+{
+    *counters = z_counters;
 }
 
 /*
@@ -254,7 +466,7 @@ void Z_FreeTags(memtag_t tag)
 {
     zhead_t *z, *n;
 
-    LIST_FOR_EACH_SAFE(zhead_t, z, n, &z_chain, entry) {
+    LIST_FOR_EACH_SAFE(zhead_t, z, n, &z_chains[Z_TAG_CHAIN(tag)], entry) {
         Z_Validate(z);
         if (z->tag == tag) {
             Z_Free(z + 1);
@@ -270,6 +482,7 @@ Z_TagMalloc
 static void *Z_TagMallocInternal(size_t size, memtag_t tag, bool init)
 {
     zhead_t *z;
+    bool pools;
 
     if (!size) {
         return NULL;
@@ -279,20 +492,36 @@ static void *Z_TagMallocInternal(size_t size, memtag_t tag, bool init)
     Q_assert(tag > TAG_FREE && tag <= UINT16_MAX);
 
     size += sizeof(*z);
-    z = init ? calloc(1, size) : malloc(size);
-    if (!z) {
-        Com_Error(ERR_FATAL, "%s: couldn't allocate %zu bytes", __func__, size);
+
+    // blocks record where they came from, so z_pools can be toggled any time
+#if USE_TESTS
+    pools = !z_pools || z_pools->integer;
+#else
+    pools = true;
+#endif
+    if (pools && Z_ARENA_TAG(tag) && size <= Z_ARENA_MAX) {
+        z = Z_ArenaAlloc(size, tag);
+        if (init)
+            memset(z + 1, 0, size - sizeof(*z));
+    } else if (pools && size <= Z_SLAB_MAX) {
+        z = Z_SlabAlloc(size);
+        if (init)
+            memset(z + 1, 0, size - sizeof(*z));
+    } else {
+        z = Z_SysAlloc(size, init);
+        z->offset = 0;
     }
+    z_counters.allocs++;
+
     z->magic = Z_MAGIC;
     z->tag = tag;
     z->size = size;
 #if USE_MEMORY_TRACES
-    if (!init)
-        memset(z->trace, 0, sizeof(z->trace));
+    memset(z->trace, 0, sizeof(z->trace));
     Sys_BackTrace(z->trace, q_countof(z->trace), 3);
 #endif
 
-    List_Insert(&z_chain, &z->entry);
+    List_Insert(&z_chains[Z_TAG_CHAIN(tag)], &z->entry);
 
 #if USE_TESTS
     if (!init && z_perturb && z_perturb->integer) {
@@ -332,7 +561,17 @@ Z_Init
 */
 void Z_Init(void)
 {
-    List_Init(&z_chain);
+    int i;
+
+    for (i = 0; i < Z_TAG_CHAINS; i++) {
+        List_Init(&z_chains[i]);
+    }
+    for (i = 0; i < Z_SLAB_CLASSES; i++) {
+        List_Init(&z_slabs[i]);
+    }
+    for (i = 0; i < TAG_MAX; i++) {
+        List_Init(&z_arenas[i].chunks);
+    }
 }
 
 /*
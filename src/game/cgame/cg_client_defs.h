@@ -32,8 +32,6 @@
 #define INSTANT_PARTICLE    -10000.0f
 
 typedef struct cparticle_s {
-    struct cparticle_s    *next;
-
     int     time;
     vec3_t  org;
     vec3_t  vel;
@@ -3486,808 +3486,725 @@ static void CG_DrawTable(int x, int y, uint32_t width, uint32_t height, int32_t
 
 /*
 ================
-CG_ExecuteLayoutString
+Compiled layouts
 
+Layout strings are tokenized once into a flat list of commands and kept
+in a small cache keyed by content hash. Stat values, configstrings,
+client names and localization stay late bound, so running a compiled
+layout each frame only reads those and issues draw calls.
 ================
 */
-static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hud_safe, int32_t scale, int32_t playernum, const player_state_t *ps)
+
+enum class layout_op_t : uint8_t {
+    XL, XR, XV, YT, YB, YV,
+    PIC, CLIENT, CTF, PICN,
+    NUM, LIVES_NUM, HNUM, ANUM, RNUM,
+    STAT_STRING, CSTRING, STRING, CSTRING2, STRING2,
+    IF, IFGEF, ENDIF,
+    LOC_STAT_STRING, LOC_STAT_RSTRING, LOC_STAT_CSTRING, LOC_STAT_CSTRING2,
+    LOC_CSTRING, LOC_CSTRING2, LOC_STRING,
+    TIME_LIMIT, DOGTAG,
+    START_TABLE, TABLE_ROW, DRAW_TABLE,
+    STAT_PNAME, HEALTH_BARS, STORY
+};
+
+struct layout_keyword_t {
+    const char  *name;
+    layout_op_t op;
+    int32_t     num_ints = 0;   // integer operands that follow
+    bool        green = false;  // loc_string variants
+    bool        right = false;
+};
+
+static constexpr layout_keyword_t layout_keywords[] = {
+    { "xl", layout_op_t::XL, 1 },
+    { "xr", layout_op_t::XR, 1 },
+    { "xv", layout_op_t::XV, 1 },
+    { "yt", layout_op_t::YT, 1 },
+    { "yb", layout_op_t::YB, 1 },
+    { "yv", layout_op_t::YV, 1 },
+    { "pic", layout_op_t::PIC, 1 },
+    { "client", layout_op_t::CLIENT, 5 },
+    { "ctf", layout_op_t::CTF, 5 },
+    { "picn", layout_op_t::PICN, 0 },
+    { "num", layout_op_t::NUM, 2 },
+    { "lives_num", layout_op_t::LIVES_NUM, 1 },
+    { "hnum", layout_op_t::HNUM, 0 },
+    { "anum", layout_op_t::ANUM, 0 },
+    { "rnum", layout_op_t::RNUM, 0 },
+    { "stat_string", layout_op_t::STAT_STRING, 1 },
+    { "cstring", layout_op_t::CSTRING, 0 },
+    { "string", layout_op_t::STRING, 0 },
+    { "cstring2", layout_op_t::CSTRING2, 0 },
+    { "string2", layout_op_t::STRING2, 0 },
+    { "if", layout_op_t::IF, 1 },
+    { "ifgef", layout_op_t::IFGEF, 1 },
+    { "endif", layout_op_t::ENDIF, 0 },
+    { "loc_stat_string", layout_op_t::LOC_STAT_STRING, 1 },
+    { "loc_stat_rstring", layout_op_t::LOC_STAT_RSTRING, 1 },
+    { "loc_stat_cstring", layout_op_t::LOC_STAT_CSTRING, 1 },
+    { "loc_stat_cstring2", layout_op_t::LOC_STAT_CSTRING2, 1 },
+    { "loc_cstring", layout_op_t::LOC_CSTRING, 0 },
+    { "loc_cstring2", layout_op_t::LOC_CSTRING2, 0 },
+    { "loc_string", layout_op_t::LOC_STRING, 0, false, false },
+    { "loc_string2", layout_op_t::LOC_STRING, 0, true, false },
+    { "loc_rstring", layout_op_t::LOC_STRING, 0, false, true },
+    { "loc_rstring2", layout_op_t::LOC_STRING, 0, true, true },
+    { "time_limit", layout_op_t::TIME_LIMIT, 1 },
+    { "dogtag", layout_op_t::DOGTAG, 1 },
+    { "start_table", layout_op_t::START_TABLE, 0 },
+    { "table_row", layout_op_t::TABLE_ROW, 0 },
+    { "draw_table", layout_op_t::DRAW_TABLE, 0 },
+    { "stat_pname", layout_op_t::STAT_PNAME, 1 },
+    { "health_bars", layout_op_t::HEALTH_BARS, 0 },
+    { "story", layout_op_t::STORY, 0 },
+};
+
+struct layout_cmd_t {
+    layout_op_t op;
+    bool        green;
+    bool        right;
+    int32_t     args[5];    // if/ifgef: args[1] is the command after endif, -1 if missing
+    uint32_t    first_str;  // index into str_ofs
+    uint32_t    num_strs;
+};
+
+struct cg_layout_t {
+    std::string source;
+    uint64_t    hash = 0;
+    uint64_t    last_used = 0;
+
+    std::vector<layout_cmd_t> cmds;
+    std::vector<uint32_t> str_ofs;
+    std::string str_data;
+
+    const char *str(uint32_t i) const { return str_data.data() + str_ofs[i]; }
+};
+
+constexpr size_t LAYOUT_CACHE_SIZE = 8;
+
+static std::array<cg_layout_t, LAYOUT_CACHE_SIZE> cg_layouts;
+static uint64_t cg_layout_tick;
+
+static uint64_t CG_HashLayout(const char *s, size_t *len)
 {
-    int     x, y;
-    int     w, h;
-    int     hx, hy;
-    int     value;
-    const char *token;
-    int     width;
-    int     index;
+    uint64_t hash = 14695981039346656037ull;
+    const char *p;
 
-    if (!s[0])
-        return;
+    for (p = s; *p; p++)
+        hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ull;
 
-    x = hud_vrect.x;
-    y = hud_vrect.y;
-    width = 3;
+    *len = p - s;
+    return hash;
+}
 
-    hx = 320 / 2;
-    hy = 240 / 2;
+/*
+================
+CG_CompileLayout
 
-    bool flash_frame = (cgi.CL_ClientTime() % 1000) < 500;
+Errors that don't depend on stat values are raised here, the rest when
+the offending command is run, like the old interpreter did.
+================
+*/
+static void CG_CompileLayout(cg_layout_t &layout, const char *s)
+{
+    static std::vector<uint32_t> if_stack;
+
+    layout.cmds.clear();
+    layout.str_ofs.clear();
+    layout.str_data.clear();
+    if_stack.clear();
 
-    // if non-zero, parse but don't affect state
-    int32_t if_depth = 0; // current if statement depth
-    int32_t endif_depth = 0; // at this depth, toggle skip_depth
-    bool skip_depth = false; // whether we're in a dead stmt or not
+    auto add_string = [&layout](const char *token) {
+        layout.str_ofs.push_back(static_cast<uint32_t>(layout.str_data.size()));
+        layout.str_data.append(token);
+        layout.str_data.push_back('\0');
+    };
 
     while (s)
     {
-        token = COM_Parse (&s);
-        if (!strcmp(token, "xl"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                x = ((hud_vrect.x + atoi(token)) * scale) + hud_safe.x;
-            continue;
-        }
-        if (!strcmp(token, "xr"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                x = ((hud_vrect.x + hud_vrect.width + atoi(token)) * scale) - hud_safe.x;
-            continue;
-        }
-        if (!strcmp(token, "xv"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                x = (hud_vrect.x + hud_vrect.width/2 + (atoi(token) - hx)) * scale;
-            continue;
-        }
+        const char *token = COM_Parse (&s);
+        const layout_keyword_t *kw = nullptr;
 
-        if (!strcmp(token, "yt"))
+        for (const layout_keyword_t &k : layout_keywords)
         {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                y = ((hud_vrect.y + atoi(token)) * scale) + hud_safe.y;
-            continue;
+            if (!strcmp(token, k.name))
+            {
+                kw = &k;
+                break;
+            }
         }
-        if (!strcmp(token, "yb"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                y = ((hud_vrect.y + hud_vrect.height + atoi(token)) * scale) - hud_safe.y;
+
+        // unknown tokens are ignored
+        if (!kw)
             continue;
-        }
-        if (!strcmp(token, "yv"))
+
+        if (kw->op == layout_op_t::ENDIF)
         {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                y = (hud_vrect.y + hud_vrect.height/2 + (atoi(token) - hy)) * scale;
+            if (if_stack.empty())
+                cgi.Com_Error("endif without matching if");
+
+            layout.cmds[if_stack.back()].args[1] = static_cast<int32_t>(layout.cmds.size());
+            if_stack.pop_back();
             continue;
         }
 
-        if (!strcmp(token, "pic"))
-        {   // draw a pic from a stat number
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                value = ps->stats[atoi(token)];
-                if (value >= MAX_IMAGES)
-                    cgi.Com_Error("Pic >= MAX_IMAGES");
+        layout_cmd_t cmd {};
+        cmd.op = kw->op;
+        cmd.green = kw->green;
+        cmd.right = kw->right;
+        cmd.first_str = static_cast<uint32_t>(layout.str_ofs.size());
 
-                const char *const pic = cgi.get_configString(CS_IMAGES + value);
+        for (int32_t i = 0; i < kw->num_ints; i++)
+            cmd.args[i] = atoi(COM_Parse (&s));
 
-                if (pic && *pic)
-                {
-                    cgi.Draw_GetPicSize (&w, &h, pic);
-                    cgi.SCR_DrawPic (x, y, w * scale, h * scale, pic);
-                }
-            }
+        switch (cmd.op)
+        {
+        case layout_op_t::IF:
+        case layout_op_t::IFGEF:
+            cmd.args[1] = -1;
+            if_stack.push_back(static_cast<uint32_t>(layout.cmds.size()));
+            break;
 
-            continue;
-        }
+        case layout_op_t::CTF:
+        case layout_op_t::PICN:
+        case layout_op_t::CSTRING:
+        case layout_op_t::STRING:
+        case layout_op_t::CSTRING2:
+        case layout_op_t::STRING2:
+            add_string(COM_Parse (&s));
+            break;
 
-        if (!strcmp(token, "client"))
-        {   // draw a deathmatch client block
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                x = (hud_vrect.x + hud_vrect.width/2 + (atoi(token) - hx)) * scale;
-                x += 8 * scale;
-            }
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                y = (hud_vrect.y + hud_vrect.height/2 + (atoi(token) - hy)) * scale;
-                y += 7 * scale;
-            }
+        case layout_op_t::LOC_CSTRING:
+        case layout_op_t::LOC_CSTRING2:
+        case layout_op_t::LOC_STRING:
+            cmd.args[0] = atoi(COM_Parse (&s));
 
-            token = COM_Parse (&s);
+            if (cmd.args[0] < 0 || cmd.args[0] >= MAX_LOCALIZATION_ARGS)
+                cgi.Com_Error("Bad loc string");
 
-            if (!skip_depth)
-            {
-                value = atoi(token);
-                if (value >= MAX_CLIENTS || value < 0)
-                    cgi.Com_Error("client >= MAX_CLIENTS");
-            }
+            // base and arguments
+            for (int32_t i = 0; i <= cmd.args[0]; i++)
+                add_string(COM_Parse (&s));
+            break;
 
-            int score, ping;
+        case layout_op_t::START_TABLE:
+        case layout_op_t::TABLE_ROW:
+            cmd.args[0] = atoi(COM_Parse (&s));
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                score = atoi(token);
+            for (int32_t i = 0; i < cmd.args[0]; i++)
+                add_string(COM_Parse (&s));
+            break;
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                ping = atoi(token);
+        default:
+            break;
+        }
 
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x + 32 * scale, y, scale, cgi.CL_GetClientName(value));
-                else
-                    cgi.SCR_DrawFontString(cgi.CL_GetClientName(value), x + 32 * scale, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
-                
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x + 32 * scale, y + 10 * scale, scale, G_Fmt("{}", score).data(), true);
-                else
-                    cgi.SCR_DrawFontString(G_Fmt("{}", score).data(), x + 32 * scale, y + (10 - font_y_offset) * scale, scale, rgba_white, true, text_align_t::LEFT);
+        cmd.num_strs = static_cast<uint32_t>(layout.str_ofs.size()) - cmd.first_str;
+        layout.cmds.push_back(cmd);
+    }
+}
 
-                cgi.SCR_DrawPic(x + 96 * scale, y + 10 * scale, 9 * scale, 9 * scale, "ping");
-                
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x + 73 * scale + 32 * scale, y + 10 * scale, scale, G_Fmt("{}", ping).data());
-                else
-                    cgi.SCR_DrawFontString (G_Fmt("{}", ping).data(), x + 107 * scale, y + (10 - font_y_offset) * scale, scale, rgba_white, true, text_align_t::LEFT);
-            }
-            continue;
-        }
+/*
+================
+CG_FindLayout
 
-        if (!strcmp(token, "ctf"))
-        {   // draw a ctf client block
-            int     score, ping;
+Returns the compiled form of s, compiling it into the least recently
+used slot if it isn't cached.
+================
+*/
+static const cg_layout_t &CG_FindLayout(const char *s)
+{
+    size_t len;
+    uint64_t hash = CG_HashLayout(s, &len);
+    cg_layout_t *oldest = &cg_layouts[0];
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                x = (hud_vrect.x + hud_vrect.width/2 - hx + atoi(token)) * scale;
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                y = (hud_vrect.y + hud_vrect.height/2 - hy + atoi(token)) * scale;
+    cg_layout_tick++;
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                value = atoi(token);
-                if (value >= MAX_CLIENTS || value < 0)
-                    cgi.Com_Error("client >= MAX_CLIENTS");
-            }
+    for (cg_layout_t &layout : cg_layouts)
+    {
+        if (layout.hash == hash && layout.source.size() == len && !memcmp(layout.source.data(), s, len))
+        {
+            layout.last_used = cg_layout_tick;
+            return layout;
+        }
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                score = atoi(token);
+        if (layout.last_used < oldest->last_used)
+            oldest = &layout;
+    }
 
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                ping = atoi(token);
-                if (ping > 999)
-                    ping = 999;
-            }
+    // not valid until compiled without errors
+    oldest->source.clear();
+    oldest->hash = 0;
 
-            token = COM_Parse (&s);
+    CG_CompileLayout(*oldest, s);
 
-            if (!skip_depth)
-            {
+    oldest->source.assign(s, len);
+    oldest->hash = hash;
+    oldest->last_used = cg_layout_tick;
+    return *oldest;
+}
 
-                cgi.SCR_DrawFontString (G_Fmt("{}", score).data(), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
-                x += 3 * 9 * scale;
-                cgi.SCR_DrawFontString (G_Fmt("{}", ping).data(), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
-                x += 3 * 9 * scale;
-                cgi.SCR_DrawFontString (cgi.CL_GetClientName(value), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
+static const char *CG_LayoutStatString(const player_state_t *ps, int32_t index)
+{
+    if (index < 0 || index >= MAX_STATS)
+        cgi.Com_Error("Bad stat_string index");
+    index = ps->stats[index];
 
-                if (*token)
-                {
-                    cgi.Draw_GetPicSize(&w, &h, token);
-                    cgi.SCR_DrawPic(x - ((w + 2) * scale), y, w * scale, h * scale, token);
-                }
-            }
-            continue;
-        }
+    if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
+        index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
 
-        if (!strcmp(token, "picn"))
-        {   // draw a pic from a name
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                cgi.Draw_GetPicSize(&w, &h, token);
-                cgi.SCR_DrawPic(x, y, w * scale, h * scale, token);
-            }
-            continue;
-        }
+    if (index < 0 || index >= MAX_CONFIGSTRINGS)
+        cgi.Com_Error("Bad stat_string index");
 
-        if (!strcmp(token, "num"))
-        {   // draw a number
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                width = atoi(token);
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                value = ps->stats[atoi(token)];
-                CG_DrawField (x, y, 0, width, value, scale);
-            }
-            continue;
-        }
-        // [Paril-KEX] special handling for the lives number
-        else if (!strcmp(token, "lives_num"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                value = ps->stats[atoi(token)];
-                CG_DrawField(x, y, value <= 2 ? flash_frame : 0, 1, max(0, value - 2), scale);
-            }
-        }
+    return cgi.get_configString(index);
+}
 
-        if (!strcmp(token, "hnum"))
-        {
-            // health number
-            if (!skip_depth)
-            {
-                int     color;
-
-                width = 3;
-                value = ps->stats[STAT_HEALTH];
-                if (value > 25)
-                    color = 0;  // green
-                else if (value > 0)
-                    color = flash_frame;      // flash
-                else
-                    color = 1;
-                if (ps->stats[STAT_FLASHES] & 1)
-                {
-                    cgi.Draw_GetPicSize(&w, &h, "field_3");
-                    cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
-                }
+/*
+================
+CG_ExecuteLayoutString
 
-                CG_DrawField (x, y, color, width, value, scale);
-            }
-            continue;
-        }
+================
+*/
+static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hud_safe, int32_t scale, int32_t playernum, const player_state_t *ps)
+{
+    int     x, y;
+    int     w, h;
+    int     hx, hy;
+    int     value;
 
-        if (!strcmp(token, "anum"))
-        {
-            // ammo number
-            if (!skip_depth)
-            {
-                int     color;
+    if (!s[0])
+        return;
 
-                width = 3;
-                value = ps->stats[STAT_AMMO];
+    const cg_layout_t &layout = CG_FindLayout(s);
+    const size_t num_cmds = layout.cmds.size();
 
-                int32_t min_ammo = CG_Wheel_GetWarnAmmoCount(ps->stats[STAT_ACTIVE_WEAPON]);
+    x = hud_vrect.x;
+    y = hud_vrect.y;
 
-                if (!min_ammo)
-                    min_ammo = 5; // back compat
+    hx = 320 / 2;
+    hy = 240 / 2;
 
-                if (value > min_ammo)
-                    color = 0;  // green
-                else if (value >= 0)
-                    color = flash_frame;      // flash
-                else
-                    continue;   // negative number = don't show
-                if (ps->stats[STAT_FLASHES] & 4)
-                {
-                    cgi.Draw_GetPicSize(&w, &h, "field_3");
-                    cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
-                }
+    bool flash_frame = (cgi.CL_ClientTime() % 1000) < 500;
 
-                CG_DrawField (x, y, color, width, value, scale);
-            }
-            continue;
-        }
+    for (size_t pc = 0; pc < num_cmds; )
+    {
+        const layout_cmd_t &cmd = layout.cmds[pc++];
+        const int32_t *args = cmd.args;
 
-        if (!strcmp(token, "rnum"))
+        switch (cmd.op)
         {
-            // armor number
-            if (!skip_depth)
-            {
-                int     color;
-
-                width = 3;
-                value = ps->stats[STAT_ARMOR];
-                if (value < 0)
-                    continue;
+        case layout_op_t::XL:
+            x = ((hud_vrect.x + args[0]) * scale) + hud_safe.x;
+            break;
+        case layout_op_t::XR:
+            x = ((hud_vrect.x + hud_vrect.width + args[0]) * scale) - hud_safe.x;
+            break;
+        case layout_op_t::XV:
+            x = (hud_vrect.x + hud_vrect.width/2 + (args[0] - hx)) * scale;
+            break;
 
-                color = 0;  // green
-                if (ps->stats[STAT_FLASHES] & 2)
-                {
-                    cgi.Draw_GetPicSize(&w, &h, "field_3");
-                    cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
-                }
+        case layout_op_t::YT:
+            y = ((hud_vrect.y + args[0]) * scale) + hud_safe.y;
+            break;
+        case layout_op_t::YB:
+            y = ((hud_vrect.y + hud_vrect.height + args[0]) * scale) - hud_safe.y;
+            break;
+        case layout_op_t::YV:
+            y = (hud_vrect.y + hud_vrect.height/2 + (args[0] - hy)) * scale;
+            break;
 
-                CG_DrawField (x, y, color, width, value, scale);
-            }
-            continue;
-        }
+        case layout_op_t::PIC:
+        {   // draw a pic from a stat number
+            value = ps->stats[args[0]];
+            if (value >= MAX_IMAGES)
+                cgi.Com_Error("Pic >= MAX_IMAGES");
 
-        if (!strcmp(token, "stat_string"))
-        {
-            token = COM_Parse (&s);
+            const char *const pic = cgi.get_configString(CS_IMAGES + value);
 
-            if (!skip_depth)
+            if (pic && *pic)
             {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index];
-
-                if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
-                    index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
-
-                if (index < 0 || index >= MAX_CONFIGSTRINGS)
-                    cgi.Com_Error("Bad stat_string index");
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x, y, scale, cgi.get_configString(index));
-                else
-                    cgi.SCR_DrawFontString(cgi.get_configString(index), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+                cgi.Draw_GetPicSize (&w, &h, pic);
+                cgi.SCR_DrawPic (x, y, w * scale, h * scale, pic);
             }
-            continue;
+            break;
         }
 
-        if (!strcmp(token, "cstring"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                CG_DrawHUDString (token, x, y, hx*2*scale, 0, scale);
-            continue;
-        }
+        case layout_op_t::CLIENT:
+        {   // draw a deathmatch client block
+            x = (hud_vrect.x + hud_vrect.width/2 + (args[0] - hx)) * scale;
+            x += 8 * scale;
+            y = (hud_vrect.y + hud_vrect.height/2 + (args[1] - hy)) * scale;
+            y += 7 * scale;
 
-        if (!strcmp(token, "string"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x, y, scale, token);
-                else
-                    cgi.SCR_DrawFontString(token, x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
-            }
-            continue;
-        }
+            value = args[2];
+            if (value >= MAX_CLIENTS || value < 0)
+                cgi.Com_Error("client >= MAX_CLIENTS");
 
-        if (!strcmp(token, "cstring2"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-                CG_DrawHUDString (token, x, y, hx*2*scale, 0x80, scale);
-            continue;
-        }
-
-        if (!strcmp(token, "string2"))
-        {
-            token = COM_Parse (&s);
-            if (!skip_depth)
-            {
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x, y, scale, token, true);
-                else
-                    cgi.SCR_DrawFontString(token, x, y - (font_y_offset * scale), scale, alt_color, true, text_align_t::LEFT);
-            }
-            continue;
-        }
+            int score = args[3];
+            int ping = args[4];
 
-        if (!strcmp(token, "if"))
-        {
-            // if stmt
-            token = COM_Parse (&s);
+            if (!cg_usekfont->integer)
+                CG_DrawString (x + 32 * scale, y, scale, cgi.CL_GetClientName(value));
+            else
+                cgi.SCR_DrawFontString(cgi.CL_GetClientName(value), x + 32 * scale, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
 
-            if_depth++;
+            if (!cg_usekfont->integer)
+                CG_DrawString (x + 32 * scale, y + 10 * scale, scale, G_Fmt("{}", score).data(), true);
+            else
+                cgi.SCR_DrawFontString(G_Fmt("{}", score).data(), x + 32 * scale, y + (10 - font_y_offset) * scale, scale, rgba_white, true, text_align_t::LEFT);
 
-            // skip to endif
-            if (!skip_depth && !ps->stats[atoi(token)])
-            {
-                skip_depth = true;
-                endif_depth = if_depth;
-            }
+            cgi.SCR_DrawPic(x + 96 * scale, y + 10 * scale, 9 * scale, 9 * scale, "ping");
 
-            continue;
+            if (!cg_usekfont->integer)
+                CG_DrawString (x + 73 * scale + 32 * scale, y + 10 * scale, scale, G_Fmt("{}", ping).data());
+            else
+                cgi.SCR_DrawFontString (G_Fmt("{}", ping).data(), x + 107 * scale, y + (10 - font_y_offset) * scale, scale, rgba_white, true, text_align_t::LEFT);
+            break;
         }
 
-        if (!strcmp(token, "ifgef"))
-        {
-            // if stmt
-            token = COM_Parse (&s);
+        case layout_op_t::CTF:
+        {   // draw a ctf client block
+            x = (hud_vrect.x + hud_vrect.width/2 - hx + args[0]) * scale;
+            y = (hud_vrect.y + hud_vrect.height/2 - hy + args[1]) * scale;
 
-            if_depth++;
+            value = args[2];
+            if (value >= MAX_CLIENTS || value < 0)
+                cgi.Com_Error("client >= MAX_CLIENTS");
 
-            // skip to endif
-            if (!skip_depth && cgi.CL_ServerFrame() < atoi(token))
+            int score = args[3];
+            int ping = min(args[4], 999);
+            const char *pic = layout.str(cmd.first_str);
+
+            cgi.SCR_DrawFontString (G_Fmt("{}", score).data(), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
+            x += 3 * 9 * scale;
+            cgi.SCR_DrawFontString (G_Fmt("{}", ping).data(), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
+            x += 3 * 9 * scale;
+            cgi.SCR_DrawFontString (cgi.CL_GetClientName(value), x, y - (font_y_offset * scale), scale, value == playernum ? alt_color : rgba_white, true, text_align_t::LEFT);
+
+            if (*pic)
             {
-                skip_depth = true;
-                endif_depth = if_depth;
+                cgi.Draw_GetPicSize(&w, &h, pic);
+                cgi.SCR_DrawPic(x - ((w + 2) * scale), y, w * scale, h * scale, pic);
             }
-
-            continue;
+            break;
         }
 
-        if (!strcmp(token, "endif"))
-        {
-            if (skip_depth && (if_depth == endif_depth))
-                skip_depth = false;
-
-            if_depth--;
+        case layout_op_t::PICN:
+        {   // draw a pic from a name
+            const char *pic = layout.str(cmd.first_str);
+            cgi.Draw_GetPicSize(&w, &h, pic);
+            cgi.SCR_DrawPic(x, y, w * scale, h * scale, pic);
+            break;
+        }
 
-            if (if_depth < 0)
-                cgi.Com_Error("endif without matching if");
+        case layout_op_t::NUM:
+            // draw a number
+            value = ps->stats[args[1]];
+            CG_DrawField (x, y, 0, args[0], value, scale);
+            break;
 
-            continue;
-        }
+        // [Paril-KEX] special handling for the lives number
+        case layout_op_t::LIVES_NUM:
+            value = ps->stats[args[0]];
+            CG_DrawField(x, y, value <= 2 ? flash_frame : 0, 1, max(0, value - 2), scale);
+            break;
 
-        // localization stuff
-        if (!strcmp(token, "loc_stat_string"))
+        case layout_op_t::HNUM:
         {
-            token = COM_Parse (&s);
+            // health number
+            int     color;
 
-            if (!skip_depth)
+            value = ps->stats[STAT_HEALTH];
+            if (value > 25)
+                color = 0;  // green
+            else if (value > 0)
+                color = flash_frame;      // flash
+            else
+                color = 1;
+            if (ps->stats[STAT_FLASHES] & 1)
             {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index];
-
-                if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
-                    index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
-
-                if (index < 0 || index >= MAX_CONFIGSTRINGS)
-                    cgi.Com_Error("Bad stat_string index");
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x, y, scale, cgi.Localize(cgi.get_configString(index), nullptr, 0));
-                else
-                    cgi.SCR_DrawFontString(cgi.Localize(cgi.get_configString(index), nullptr, 0), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+                cgi.Draw_GetPicSize(&w, &h, "field_3");
+                cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
             }
-            continue;
+
+            CG_DrawField (x, y, color, 3, value, scale);
+            break;
         }
 
-        if (!strcmp(token, "loc_stat_rstring"))
+        case layout_op_t::ANUM:
         {
-            token = COM_Parse (&s);
+            // ammo number
+            int     color;
 
-            if (!skip_depth)
-            {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index];
-
-                if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
-                    index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
-
-                if (index < 0 || index >= MAX_CONFIGSTRINGS)
-                    cgi.Com_Error("Bad stat_string index");
-                const char *s = cgi.Localize(cgi.get_configString(index), nullptr, 0);
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x - (static_cast<int>(CG_StrlenNoColor(s, strlen(s))) * CONCHAR_WIDTH * scale), y, scale, s);
-                else
-                {
-                    vec2_t size = cgi.SCR_MeasureFontString(s, scale);
-                    cgi.SCR_DrawFontString(s, x - size.x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
-                }
-            }
-            continue;
-        }
-        
-        if (!strcmp(token, "loc_stat_cstring"))
-        {
-            token = COM_Parse (&s);
+            value = ps->stats[STAT_AMMO];
 
-            if (!skip_depth)
-            {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index];
+            int32_t min_ammo = CG_Wheel_GetWarnAmmoCount(ps->stats[STAT_ACTIVE_WEAPON]);
 
-                if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
-                    index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
+            if (!min_ammo)
+                min_ammo = 5; // back compat
 
-                if (index < 0 || index >= MAX_CONFIGSTRINGS)
-                    cgi.Com_Error("Bad stat_string index");
-                CG_DrawHUDString (cgi.Localize(cgi.get_configString(index), nullptr, 0), x, y, hx*2*scale, 0, scale);
+            if (value > min_ammo)
+                color = 0;  // green
+            else if (value >= 0)
+                color = flash_frame;      // flash
+            else
+                break;   // negative number = don't show
+            if (ps->stats[STAT_FLASHES] & 4)
+            {
+                cgi.Draw_GetPicSize(&w, &h, "field_3");
+                cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
             }
-            continue;
+
+            CG_DrawField (x, y, color, 3, value, scale);
+            break;
         }
 
-        if (!strcmp(token, "loc_stat_cstring2"))
-        {
-            token = COM_Parse (&s);
+        case layout_op_t::RNUM:
+            // armor number
+            value = ps->stats[STAT_ARMOR];
+            if (value < 0)
+                break;
 
-            if (!skip_depth)
+            if (ps->stats[STAT_FLASHES] & 2)
             {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index];
-
-                if (cgi.CL_ServerProtocol() <= PROTOCOL_VERSION_3XX)
-                    index = CS_REMAP(index).start / CS_MAX_STRING_LENGTH;
-
-                if (index < 0 || index >= MAX_CONFIGSTRINGS)
-                    cgi.Com_Error("Bad stat_string index");
-                CG_DrawHUDString (cgi.Localize(cgi.get_configString(index), nullptr, 0), x, y, hx*2*scale, 0x80, scale);
+                cgi.Draw_GetPicSize(&w, &h, "field_3");
+                cgi.SCR_DrawPic(x, y, w * scale, h * scale, "field_3");
             }
-            continue;
-        }
 
-        static char arg_tokens[MAX_LOCALIZATION_ARGS + 1][MAX_TOKEN_CHARS];
-        static const char *arg_buffers[MAX_LOCALIZATION_ARGS];
+            CG_DrawField (x, y, 0, 3, value, scale);
+            break;
 
-        if (!strcmp(token, "loc_cstring"))
+        case layout_op_t::STAT_STRING:
         {
-            int32_t num_args = atoi(COM_Parse (&s));
+            const char *str = CG_LayoutStatString(ps, args[0]);
 
-            if (num_args < 0 || num_args >= MAX_LOCALIZATION_ARGS)
-                cgi.Com_Error("Bad loc string");
-
-            // parse base
-            token = COM_Parse (&s);
-            Q_strlcpy(arg_tokens[0], token, sizeof(arg_tokens[0]));
+            if (!cg_usekfont->integer)
+                CG_DrawString (x, y, scale, str);
+            else
+                cgi.SCR_DrawFontString(str, x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+            break;
+        }
 
-            // parse args
-            for (int32_t i = 0; i < num_args; i++)
-            {
-                token = COM_Parse (&s);
-                Q_strlcpy(arg_tokens[1 + i], token, sizeof(arg_tokens[0]));
-                arg_buffers[i] = arg_tokens[1 + i];
-            }
+        case layout_op_t::CSTRING:
+            CG_DrawHUDString (layout.str(cmd.first_str), x, y, hx*2*scale, 0, scale);
+            break;
 
-            if (!skip_depth)
-                CG_DrawHUDString (cgi.Localize(arg_tokens[0], arg_buffers, num_args), x, y, hx*2*scale, 0, scale);
-            continue;
-        }
+        case layout_op_t::STRING:
+            if (!cg_usekfont->integer)
+                CG_DrawString (x, y, scale, layout.str(cmd.first_str));
+            else
+                cgi.SCR_DrawFontString(layout.str(cmd.first_str), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+            break;
 
-        if (!strcmp(token, "loc_string"))
-        {
-            int32_t num_args = atoi(COM_Parse (&s));
+        case layout_op_t::CSTRING2:
+            CG_DrawHUDString (layout.str(cmd.first_str), x, y, hx*2*scale, 0x80, scale);
+            break;
 
-            if (num_args < 0 || num_args >= MAX_LOCALIZATION_ARGS)
-                cgi.Com_Error("Bad loc string");
+        case layout_op_t::STRING2:
+            if (!cg_usekfont->integer)
+                CG_DrawString (x, y, scale, layout.str(cmd.first_str), true);
+            else
+                cgi.SCR_DrawFontString(layout.str(cmd.first_str), x, y - (font_y_offset * scale), scale, alt_color, true, text_align_t::LEFT);
+            break;
 
-            // parse base
-            token = COM_Parse (&s);
-            Q_strlcpy(arg_tokens[0], token, sizeof(arg_tokens[0]));
+        case layout_op_t::IF:
+        case layout_op_t::IFGEF:
+        {
+            bool skip = cmd.op == layout_op_t::IF ? !ps->stats[args[0]] : cgi.CL_ServerFrame() < args[0];
 
-            // parse args
-            for (int32_t i = 0; i < num_args; i++)
-            {
-                token = COM_Parse (&s);
-                Q_strlcpy(arg_tokens[1 + i], token, sizeof(arg_tokens[0]));
-                arg_buffers[i] = arg_tokens[1 + i];
-            }
-            
-            if (!skip_depth)
+            // skip to endif
+            if (skip)
             {
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x, y, scale, cgi.Localize(arg_tokens[0], arg_buffers, num_args));
-                else
-                    cgi.SCR_DrawFontString(cgi.Localize(arg_tokens[0], arg_buffers, num_args), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+                if (args[1] < 0)
+                    cgi.Com_Error("if with no matching endif");
+                pc = args[1];
             }
-            continue;
+            break;
         }
 
-        if (!strcmp(token, "loc_cstring2"))
+        // localization stuff
+        case layout_op_t::LOC_STAT_STRING:
         {
-            int32_t num_args = atoi(COM_Parse (&s));
+            const char *str = cgi.Localize(CG_LayoutStatString(ps, args[0]), nullptr, 0);
 
-            if (num_args < 0 || num_args >= MAX_LOCALIZATION_ARGS)
-                cgi.Com_Error("Bad loc string");
+            if (!cg_usekfont->integer)
+                CG_DrawString (x, y, scale, str);
+            else
+                cgi.SCR_DrawFontString(str, x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+            break;
+        }
 
-            // parse base
-            token = COM_Parse (&s);
-            Q_strlcpy(arg_tokens[0], token, sizeof(arg_tokens[0]));
+        case layout_op_t::LOC_STAT_RSTRING:
+        {
+            const char *str = cgi.Localize(CG_LayoutStatString(ps, args[0]), nullptr, 0);
 
-            // parse args
-            for (int32_t i = 0; i < num_args; i++)
+            if (!cg_usekfont->integer)
+                CG_DrawString (x - (static_cast<int>(CG_StrlenNoColor(str, strlen(str))) * CONCHAR_WIDTH * scale), y, scale, str);
+            else
             {
-                token = COM_Parse (&s);
-                Q_strlcpy(arg_tokens[1 + i], token, sizeof(arg_tokens[0]));
-                arg_buffers[i] = arg_tokens[1 + i];
+                vec2_t size = cgi.SCR_MeasureFontString(str, scale);
+                cgi.SCR_DrawFontString(str, x - size.x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
             }
-            
-            if (!skip_depth)
-                CG_DrawHUDString (cgi.Localize(arg_tokens[0], arg_buffers, num_args), x, y, hx*2*scale, 0x80, scale);
-            continue;
+            break;
         }
 
-        if (!strcmp(token, "loc_string2") || !strcmp(token, "loc_rstring2") ||
-            !strcmp(token, "loc_string") || !strcmp(token, "loc_rstring"))
-        {
-            bool green = token[strlen(token) - 1] == '2';
-            bool rightAlign = !Q_strncasecmp(token, "loc_rstring", strlen("loc_rstring"));
-            int32_t num_args = atoi(COM_Parse (&s));
+        case layout_op_t::LOC_STAT_CSTRING:
+            CG_DrawHUDString (cgi.Localize(CG_LayoutStatString(ps, args[0]), nullptr, 0), x, y, hx*2*scale, 0, scale);
+            break;
 
-            if (num_args < 0 || num_args >= MAX_LOCALIZATION_ARGS)
-                cgi.Com_Error("Bad loc string");
+        case layout_op_t::LOC_STAT_CSTRING2:
+            CG_DrawHUDString (cgi.Localize(CG_LayoutStatString(ps, args[0]), nullptr, 0), x, y, hx*2*scale, 0x80, scale);
+            break;
 
-            // parse base
-            token = COM_Parse (&s);
-            Q_strlcpy(arg_tokens[0], token, sizeof(arg_tokens[0]));
+        case layout_op_t::LOC_CSTRING:
+        case layout_op_t::LOC_CSTRING2:
+        case layout_op_t::LOC_STRING:
+        {
+            const char *loc_args[MAX_LOCALIZATION_ARGS];
+            int32_t num_args = args[0];
 
-            // parse args
             for (int32_t i = 0; i < num_args; i++)
+                loc_args[i] = layout.str(cmd.first_str + 1 + i);
+
+            const char *locStr = cgi.Localize(layout.str(cmd.first_str), loc_args, num_args);
+
+            if (cmd.op == layout_op_t::LOC_CSTRING)
             {
-                token = COM_Parse (&s);
-                Q_strlcpy(arg_tokens[1 + i], token, sizeof(arg_tokens[0]));
-                arg_buffers[i] = arg_tokens[1 + i];
+                CG_DrawHUDString (locStr, x, y, hx*2*scale, 0, scale);
+                break;
             }
-            
-            if (!skip_depth)
+            if (cmd.op == layout_op_t::LOC_CSTRING2)
             {
-                const char *locStr = cgi.Localize(arg_tokens[0], arg_buffers, num_args);
-                int xOffs = 0;
-                if (rightAlign)
-                {
-                    xOffs = cg_usekfont->integer ? cgi.SCR_MeasureFontString(locStr, scale).x : (static_cast<int>(CG_StrlenNoColor(locStr, strlen(locStr))) * CONCHAR_WIDTH * scale);
-                }
+                CG_DrawHUDString (locStr, x, y, hx*2*scale, 0x80, scale);
+                break;
+            }
 
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x - xOffs, y, scale, locStr, green);
-                else
-                    cgi.SCR_DrawFontString(locStr, x - xOffs, y - (font_y_offset * scale), scale, green ? alt_color : rgba_white, true, text_align_t::LEFT);
+            int xOffs = 0;
+            if (cmd.right)
+            {
+                xOffs = cg_usekfont->integer ? cgi.SCR_MeasureFontString(locStr, scale).x : (static_cast<int>(CG_StrlenNoColor(locStr, strlen(locStr))) * CONCHAR_WIDTH * scale);
             }
-            continue;
+
+            if (!cg_usekfont->integer)
+                CG_DrawString (x - xOffs, y, scale, locStr, cmd.green);
+            else
+                cgi.SCR_DrawFontString(locStr, x - xOffs, y - (font_y_offset * scale), scale, cmd.green ? alt_color : rgba_white, true, text_align_t::LEFT);
+            break;
         }
 
         // draw time remaining
-        if (!strcmp(token, "time_limit"))
+        case layout_op_t::TIME_LIMIT:
         {
-            // end frame
-            token = COM_Parse (&s);
-
-            if (!skip_depth)
-            {
-                int32_t end_frame = atoi(token);
+            int32_t end_frame = args[0];
 
-                if (end_frame < cgi.CL_ServerFrame())
-                    continue;
+            if (end_frame < cgi.CL_ServerFrame())
+                break;
 
-                uint64_t remaining_ms = (end_frame - cgi.CL_ServerFrame()) * cgi.frameTimeMs;
+            uint64_t remaining_ms = (end_frame - cgi.CL_ServerFrame()) * cgi.frameTimeMs;
 
-                const bool green = true;
-                arg_buffers[0] = G_Fmt("{:02}:{:02}", (remaining_ms / 1000) / 60, (remaining_ms / 1000) % 60).data();
+            const bool green = true;
+            const char *time_arg = G_Fmt("{:02}:{:02}", (remaining_ms / 1000) / 60, (remaining_ms / 1000) % 60).data();
 
-                const char *locStr = cgi.Localize("$g_score_time", arg_buffers, 1);
-                int xOffs = cg_usekfont->integer ? cgi.SCR_MeasureFontString(locStr, scale).x : (static_cast<int>(CG_StrlenNoColor(locStr, strlen(locStr))) * CONCHAR_WIDTH * scale);
-                if (!cg_usekfont->integer)
-                    CG_DrawString (x - xOffs, y, scale, locStr, green);
-                else
-                    cgi.SCR_DrawFontString(locStr, x - xOffs, y - (font_y_offset * scale), scale, green ? alt_color : rgba_white, true, text_align_t::LEFT);
-            }
+            const char *locStr = cgi.Localize("$g_score_time", &time_arg, 1);
+            int xOffs = cg_usekfont->integer ? cgi.SCR_MeasureFontString(locStr, scale).x : (static_cast<int>(CG_StrlenNoColor(locStr, strlen(locStr))) * CONCHAR_WIDTH * scale);
+            if (!cg_usekfont->integer)
+                CG_DrawString (x - xOffs, y, scale, locStr, green);
+            else
+                cgi.SCR_DrawFontString(locStr, x - xOffs, y - (font_y_offset * scale), scale, green ? alt_color : rgba_white, true, text_align_t::LEFT);
+            break;
         }
 
         // draw client dogtag
-        if (!strcmp(token, "dogtag"))
+        case layout_op_t::DOGTAG:
         {
-            token = COM_Parse (&s);
-            
-            if (!skip_depth)
-            {
-                value = atoi(token);
-                if (value >= MAX_CLIENTS || value < 0)
-                    cgi.Com_Error("client >= MAX_CLIENTS");
+            value = args[0];
+            if (value >= MAX_CLIENTS || value < 0)
+                cgi.Com_Error("client >= MAX_CLIENTS");
 
-                const std::string_view path = G_Fmt("/tags/{}", cgi.CL_GetClientDogtag(value));
-                cgi.SCR_DrawPic(x, y, 198 * scale, 32 * scale, path.data());
-            }
+            const std::string_view path = G_Fmt("/tags/{}", cgi.CL_GetClientDogtag(value));
+            cgi.SCR_DrawPic(x, y, 198 * scale, 32 * scale, path.data());
+            break;
         }
 
-        if (!strcmp(token, "start_table"))
-        {
-            token = COM_Parse (&s);
-            value = atoi(token);
-
-            if (!skip_depth)
-            {
-                if (value >= q_countof(hud_temp.table_rows[0].table_cells))
-                    cgi.Com_Error("table too big");
+        case layout_op_t::START_TABLE:
+            value = args[0];
 
-                hud_temp.num_columns = value;
-                hud_temp.num_rows = 1;
+            if (value >= q_countof(hud_temp.table_rows[0].table_cells))
+                cgi.Com_Error("table too big");
 
-                for (int i = 0; i < value; i++)
-                    hud_temp.column_widths[i] = 0;
-            }
+            hud_temp.num_columns = value;
+            hud_temp.num_rows = 1;
 
             for (int i = 0; i < value; i++)
             {
-                token = COM_Parse (&s);
-                if (!skip_depth)
-                {
-                    token = cgi.Localize(token, nullptr, 0);
-                    Q_strlcpy(hud_temp.table_rows[0].table_cells[i].text, token, sizeof(hud_temp.table_rows[0].table_cells[i].text));
-                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) cgi.SCR_MeasureFontString(hud_temp.table_rows[0].table_cells[i].text, scale).x);
-                }
+                auto &cell = hud_temp.table_rows[0].table_cells[i];
+
+                Q_strlcpy(cell.text, cgi.Localize(layout.str(cmd.first_str + i), nullptr, 0), sizeof(cell.text));
+                hud_temp.column_widths[i] = (size_t) cgi.SCR_MeasureFontString(cell.text, scale).x;
             }
-        }
+            break;
 
-        if (!strcmp(token, "table_row"))
+        case layout_op_t::TABLE_ROW:
         {
-            token = COM_Parse (&s);
-            value = atoi(token);
+            value = args[0];
 
-            if (!skip_depth)
+            if (hud_temp.num_rows >= q_countof(hud_temp.table_rows))
             {
-                if (hud_temp.num_rows >= q_countof(hud_temp.table_rows))
-                {
-                    cgi.Com_Error("table too big");
-                    return;
-                }
+                cgi.Com_Error("table too big");
+                return;
             }
-            
+
             auto &row = hud_temp.table_rows[hud_temp.num_rows];
 
             for (int i = 0; i < value; i++)
             {
-                token = COM_Parse (&s);
-                if (!skip_depth)
-                {
-                    Q_strlcpy(row.table_cells[i].text, token, sizeof(row.table_cells[i].text));
-                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) cgi.SCR_MeasureFontString(row.table_cells[i].text, scale).x);
-                }
+                Q_strlcpy(row.table_cells[i].text, layout.str(cmd.first_str + i), sizeof(row.table_cells[i].text));
+                hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) cgi.SCR_MeasureFontString(row.table_cells[i].text, scale).x);
             }
-            
-            if (!skip_depth)
-            {
-                for (int i = value; i < hud_temp.num_columns; i++)
-                    row.table_cells[i].text[0] = '\0';
 
-                hud_temp.num_rows++;
-            }
+            for (int i = value; i < hud_temp.num_columns; i++)
+                row.table_cells[i].text[0] = '\0';
+
+            hud_temp.num_rows++;
+            break;
         }
 
-        if (!strcmp(token, "draw_table"))
+        case layout_op_t::DRAW_TABLE:
         {
-            if (!skip_depth)
-            {
-                // in scaled pixels, incl padding between elements
-                uint32_t total_inner_table_width = 0;
+            // in scaled pixels, incl padding between elements
+            uint32_t total_inner_table_width = 0;
 
-                for (int i = 0; i < hud_temp.num_columns; i++)
-                {
-                    if (i != 0)
-                        total_inner_table_width += cgi.SCR_MeasureFontString(" ", scale).x;
+            for (int i = 0; i < hud_temp.num_columns; i++)
+            {
+                if (i != 0)
+                    total_inner_table_width += cgi.SCR_MeasureFontString(" ", scale).x;
 
-                    total_inner_table_width += hud_temp.column_widths[i];
-                }
+                total_inner_table_width += hud_temp.column_widths[i];
+            }
 
-                // in scaled pixels
-                uint32_t total_table_height = hud_temp.num_rows * (CONCHAR_WIDTH + font_y_offset) * scale;
+            // in scaled pixels
+            uint32_t total_table_height = hud_temp.num_rows * (CONCHAR_WIDTH + font_y_offset) * scale;
 
-                CG_DrawTable(x, y, total_inner_table_width, total_table_height, scale);
-            }
+            CG_DrawTable(x, y, total_inner_table_width, total_table_height, scale);
+            break;
         }
 
-        if (!strcmp(token, "stat_pname"))
+        case layout_op_t::STAT_PNAME:
         {
-            token = COM_Parse(&s);
-
-            if (!skip_depth)
-            {
-                index = atoi(token);
-                if (index < 0 || index >= MAX_STATS)
-                    cgi.Com_Error("Bad stat_string index");
-                index = ps->stats[index] - 1;
+            if (args[0] < 0 || args[0] >= MAX_STATS)
+                cgi.Com_Error("Bad stat_string index");
+            int index = ps->stats[args[0]] - 1;
 
-                if (!cg_usekfont->integer)
-                    CG_DrawString(x, y, scale, cgi.CL_GetClientName(index));
-                else
-                    cgi.SCR_DrawFontString(cgi.CL_GetClientName(index), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
-            }
-            continue;
+            if (!cg_usekfont->integer)
+                CG_DrawString(x, y, scale, cgi.CL_GetClientName(index));
+            else
+                cgi.SCR_DrawFontString(cgi.CL_GetClientName(index), x, y - (font_y_offset * scale), scale, rgba_white, true, text_align_t::LEFT);
+            break;
         }
 
-        if (!strcmp(token, "health_bars"))
+        case layout_op_t::HEALTH_BARS:
         {
-            if (skip_depth)
-                continue;
-
             const byte *stat = reinterpret_cast<const byte *>(&ps->stats[STAT_HEALTH_BARS]);
             const char *name = cgi.Localize(CG_Hud_GetHealthBarName(), nullptr, 0);
 
@@ -4317,14 +4234,15 @@ static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hu
 
                 y += bar_height * 3;
             }
+            break;
         }
 
-        if (!strcmp(token, "story"))
+        case layout_op_t::STORY:
         {
             const char *story_str = CG_Hud_GetStory();
 
             if (!*story_str)
-                continue;
+                break;
 
             const char *localized = cgi.Localize(story_str, nullptr, 0);
             vec2_t size = cgi.SCR_MeasureFontString(localized, scale);
@@ -4332,11 +4250,13 @@ static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hu
             float centery = ((hud_vrect.y + (hud_vrect.height * 0.5f)) * scale) - (size.y * 0.5f);
 
             cgi.SCR_DrawFontString(localized, centerx, centery, scale, rgba_white, true, text_align_t::CENTER);
+            break;
         }
-    }
 
-    if (skip_depth)
-        cgi.Com_Error("if with no matching endif");
+        default:
+            break;
+        }
+    }
 }
 
 static cvar_t *cg_skip_hud;
@@ -4643,6 +4563,11 @@ static void CG_Statusbar_AddPowerupsAndTech(cg_statusbar_builder_t &sb)
         .endifstat();
 }
 
+static int CG_Statusbar_NumChars(int value)
+{
+    return value > 99 ? 3 : value > 9 ? 2 : 1;
+}
+
 static void CG_Statusbar_AddCoopStatus(cg_statusbar_builder_t &sb, const player_state_t *ps)
 {
     sb.ifstat(STAT_COOP_RESPAWN).xv(0).yt(0).loc_stat_cstring2(STAT_COOP_RESPAWN).endifstat();
@@ -4657,7 +4582,7 @@ static void CG_Statusbar_AddCoopStatus(cg_statusbar_builder_t &sb, const player_
 
     int rounds = ps->stats[STAT_ROUND_NUMBER];
     if (rounds > 0) {
-        int chars = rounds > 99 ? 3 : rounds > 9 ? 2 : 1;
+        int chars = CG_Statusbar_NumChars(rounds);
         y += 10;
         sb.ifstat(STAT_ROUND_NUMBER)
             .xr(-32 - (16 * chars)).yt(y).num(3, STAT_ROUND_NUMBER)
@@ -4668,7 +4593,7 @@ static void CG_Statusbar_AddCoopStatus(cg_statusbar_builder_t &sb, const player_
 
     int monsters = ps->stats[STAT_MONSTER_COUNT];
     if (monsters > 0) {
-        int chars = monsters > 99 ? 3 : monsters > 9 ? 2 : 1;
+        int chars = CG_Statusbar_NumChars(monsters);
         y += 10;
         sb.ifstat(STAT_MONSTER_COUNT)
             .xr(-32 - (16 * chars)).yt(y).num(3, STAT_MONSTER_COUNT)
@@ -4746,6 +4671,43 @@ static std::string CG_BuildStatusbarLayout(const player_state_t *ps)
     return sb.sb;
 }
 
+struct cg_statusbar_cache_t {
+    bool valid = false;
+    uint32_t key = 0;
+    std::string layout;
+};
+
+static std::array<cg_statusbar_cache_t, MAX_SPLIT_PLAYERS> cg_statusbar_cache;
+
+/*
+================
+CG_GetStatusbarLayout
+
+The built layout only changes with the inputs packed into the key, so it
+is rebuilt when they do instead of every frame.
+================
+*/
+static const std::string &CG_GetStatusbarLayout(int32_t isplit, const player_state_t *ps)
+{
+    cg_statusbar_cache_t &cache = cg_statusbar_cache[isplit];
+    int rounds = ps->stats[STAT_ROUND_NUMBER];
+    int monsters = ps->stats[STAT_MONSTER_COUNT];
+
+    uint32_t key = ((CG_Hud_GetFlags() & HUD_FLAG_MINHUD) ? 1 : 0) |
+                   (static_cast<uint32_t>(CG_GetGameStyle()) << 1) |
+                   ((ps->stats[STAT_LIVES] > 0 ? 1 : 0) << 8) |
+                   ((rounds > 0 ? CG_Statusbar_NumChars(rounds) : 0) << 9) |
+                   ((monsters > 0 ? CG_Statusbar_NumChars(monsters) : 0) << 11);
+
+    if (!cache.valid || cache.key != key) {
+        cache.layout = CG_BuildStatusbarLayout(ps);
+        cache.key = key;
+        cache.valid = true;
+    }
+
+    return cache.layout;
+}
+
 static std::string CG_Scoreboard_EscapeText(const char *text)
 {
     if (!text || !*text)
@@ -5151,7 +5113,7 @@ void CG_DrawHUD (int32_t isplit, const cg_server_data_t *data, vrect_t hud_vrect
     // draw HUD
     if (!cg_skip_hud->integer && !(ps->stats[STAT_LAYOUTS] & LAYOUTS_HIDE_HUD)) {
         if (cg_hud_cgame && cg_hud_cgame->integer) {
-            const std::string layout = CG_BuildStatusbarLayout(ps);
+            const std::string &layout = CG_GetStatusbarLayout(isplit, ps);
             CG_ExecuteLayoutString(layout.c_str(), hud_vrect, hud_safe, scale, playernum, ps);
         } else {
             CG_ExecuteLayoutString(cgi.get_configString(CS_STATUSBAR), hud_vrect, hud_safe, scale, playernum, ps);
@@ -19,6 +19,21 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "cg_entity_local.h"
 #include "shared/m_flash.h"
+#include "system/system.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2    1
+#include <emmintrin.h>
+#else
+#define USE_SSE2    0
+#endif
+
+#if !USE_SSE2 && defined(__ARM_NEON)
+#define USE_NEON    1
+#include <arm_neon.h>
+#else
+#define USE_NEON    0
+#endif
 
 static void CL_LogoutEffect(const vec3_t org, int color);
 
@@ -942,37 +957,369 @@ PARTICLE MANAGEMENT
 ==============================================================
 */
 
-static cparticle_t  *active_particles, *free_particles;
+#define MIN_PARTICLES       1024
+#define MAX_POOL_PARTICLES  (1 << 18)
 
-static cparticle_t  particles[MAX_PARTICLES];
+// int and float fields of a live particle, each in its own array
+#define PARTICLE_FIELDS     15
 
-static void CL_ClearParticles(void)
+// Live particles are packed at the front of a structure of arrays, so they
+// can be aged four at a time and passed to the renderer in one call. One
+// that fades out is overwritten by the last.
+//
+// CL_AllocParticle hands out records from a staging buffer instead; they
+// are moved into the arrays by the next CL_AddParticles.
+typedef struct {
+    int         max;        // multiple of 4, arrays are padded to it
+    int         num_live;
+    int         num_spawned;
+    cparticle_t *spawned;
+    particle_t  *out;
+
+    int         *time;
+    float       *org[3];
+    float       *vel[3];
+    float       *accel[3];
+    float       *alpha;
+    float       *alphavel;
+    float       *scale;
+    int         *color;
+    color_t     *rgba;
+
+    void        *base;
+} cparticle_pool_t;
+
+static cparticle_pool_t cl_particles;
+
+static cvar_t *cl_maxparticles;
+
+static void CL_FreeParticlePool(cparticle_pool_t *pool)
+{
+    Z_Freep(&pool->base);
+    memset(pool, 0, sizeof(*pool));
+}
+
+static void CL_AllocParticlePool(cparticle_pool_t *pool, int max)
 {
+    size_t  n = (max + 3) & ~3;
+    size_t  size = n * (sizeof(cparticle_t) + sizeof(particle_t) + PARTICLE_FIELDS * sizeof(float));
+    float   *f;
     int     i;
 
-    free_particles = &particles[0];
-    active_particles = NULL;
+    static_assert(sizeof(int) == sizeof(float) && sizeof(color_t) == sizeof(float),
+                  "particle fields must be 32-bit");
+
+    CL_FreeParticlePool(pool);
+
+    pool->base = Z_Malloc(size);
+    memset(pool->base, 0, size);
+    pool->max = static_cast<int>(n);
 
-    for (i = 0; i < MAX_PARTICLES - 1; i++)
-        particles[i].next = &particles[i + 1];
-    particles[i].next = NULL;
+    pool->spawned = static_cast<cparticle_t *>(pool->base);
+    pool->out = reinterpret_cast<particle_t *>(pool->spawned + n);
+
+    f = reinterpret_cast<float *>(pool->out + n);
+    pool->time = reinterpret_cast<int *>(f); f += n;
+    for (i = 0; i < 3; i++) {
+        pool->org[i] = f; f += n;
+        pool->vel[i] = f; f += n;
+        pool->accel[i] = f; f += n;
+    }
+    pool->alpha = f; f += n;
+    pool->alphavel = f; f += n;
+    pool->scale = f; f += n;
+    pool->color = reinterpret_cast<int *>(f); f += n;
+    pool->rgba = reinterpret_cast<color_t *>(f);
 }
 
-cparticle_t *CL_AllocParticle(void)
+static void CL_ClearParticles(void)
+{
+    int max = MAX_PARTICLES;
+
+    if (cl_maxparticles)
+        max = Cvar_ClampInteger(cl_maxparticles, MIN_PARTICLES, MAX_POOL_PARTICLES);
+
+    // pool is only resized here, while nothing points into it
+    if (((max + 3) & ~3) != cl_particles.max)
+        CL_AllocParticlePool(&cl_particles, max);
+
+    cl_particles.num_live = 0;
+    cl_particles.num_spawned = 0;
+}
+
+static cparticle_t *CL_SpawnParticle(cparticle_pool_t *pool)
 {
     cparticle_t *p;
 
-    if (!free_particles)
+    if (pool->num_live + pool->num_spawned >= pool->max)
         return NULL;
-    p = free_particles;
-    free_particles = p->next;
-    p->next = active_particles;
-    active_particles = p;
+    p = &pool->spawned[pool->num_spawned++];
 
     p->scale = 1.0f;
     return p;
 }
 
+cparticle_t *CL_AllocParticle(void)
+{
+    return CL_SpawnParticle(&cl_particles);
+}
+
+// appends particles spawned since the last call to the live arrays
+static void CL_CommitParticles(cparticle_pool_t *pool)
+{
+    const cparticle_t *p = pool->spawned;
+    int i, j;
+
+    for (i = 0; i < pool->num_spawned; i++, p++) {
+        j = pool->num_live++;
+        pool->time[j] = p->time;
+        pool->org[0][j] = p->org[0];
+        pool->org[1][j] = p->org[1];
+        pool->org[2][j] = p->org[2];
+        pool->vel[0][j] = p->vel[0];
+        pool->vel[1][j] = p->vel[1];
+        pool->vel[2][j] = p->vel[2];
+        pool->accel[0][j] = p->accel[0];
+        pool->accel[1][j] = p->accel[1];
+        pool->accel[2][j] = p->accel[2];
+        pool->alpha[j] = p->alpha;
+        pool->alphavel[j] = p->alphavel;
+        pool->scale[j] = p->scale;
+        pool->color[j] = p->color;
+        pool->rgba[j] = p->rgba;
+    }
+
+    pool->num_spawned = 0;
+}
+
+static inline float CL_ParticleTime(const cparticle_pool_t *pool, int i, int now)
+{
+    if (pool->alphavel[i] == INSTANT_PARTICLE)
+        return 0.0f;
+    return (now - pool->time[i]) * 0.001f;
+}
+
+static inline bool CL_ParticleFaded(const cparticle_pool_t *pool, int i, int now)
+{
+    return pool->alpha[i] + CL_ParticleTime(pool, i, now) * pool->alphavel[i] <= 0;
+}
+
+static void CL_MoveParticle(const cparticle_pool_t *pool, int to, int from)
+{
+    pool->time[to] = pool->time[from];
+    pool->org[0][to] = pool->org[0][from];
+    pool->org[1][to] = pool->org[1][from];
+    pool->org[2][to] = pool->org[2][from];
+    pool->vel[0][to] = pool->vel[0][from];
+    pool->vel[1][to] = pool->vel[1][from];
+    pool->vel[2][to] = pool->vel[2][from];
+    pool->accel[0][to] = pool->accel[0][from];
+    pool->accel[1][to] = pool->accel[1][from];
+    pool->accel[2][to] = pool->accel[2][from];
+    pool->alpha[to] = pool->alpha[from];
+    pool->alphavel[to] = pool->alphavel[from];
+    pool->scale[to] = pool->scale[from];
+    pool->color[to] = pool->color[from];
+    pool->rgba[to] = pool->rgba[from];
+}
+
+// removes faded out particles from the group of four starting at *first
+static void CL_CompactParticleGroup(cparticle_pool_t *pool, int *first, int now)
+{
+    int i = *first, end = min(i + 4, pool->num_live);
+
+    while (i < end) {
+        if (CL_ParticleFaded(pool, i, now)) {
+            CL_MoveParticle(pool, i, --pool->num_live);
+            end = min(end, pool->num_live);
+        } else {
+            i++;
+        }
+    }
+
+    *first = i;
+}
+
+/*
+===============
+CL_CompactParticles
+
+Removes particles that have faded out by time now. Groups of four where
+all are still visible are checked at once and left alone.
+===============
+*/
+static void CL_CompactParticles(cparticle_pool_t *pool, int now)
+{
+    int i = 0;
+
+#if USE_SSE2
+    const __m128i   vnow = _mm_set1_epi32(now);
+    const __m128    msec = _mm_set1_ps(0.001f);
+    const __m128    instant = _mm_set1_ps(INSTANT_PARTICLE);
+    const __m128    zero = _mm_setzero_ps();
+
+    // arrays are padded, lanes past num_live only cost a slower check
+    while (i < pool->num_live) {
+        __m128i dt = _mm_sub_epi32(vnow, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pool->time + i)));
+        __m128  av = _mm_loadu_ps(pool->alphavel + i);
+        __m128  t  = _mm_andnot_ps(_mm_cmpeq_ps(av, instant), _mm_mul_ps(_mm_cvtepi32_ps(dt), msec));
+        __m128  a  = _mm_add_ps(_mm_loadu_ps(pool->alpha + i), _mm_mul_ps(t, av));
+
+        if (_mm_movemask_ps(_mm_cmple_ps(a, zero)))
+            CL_CompactParticleGroup(pool, &i, now);
+        else
+            i += 4;
+    }
+#elif USE_NEON
+    const int32x4_t     vnow = vdupq_n_s32(now);
+    const float32x4_t   msec = vdupq_n_f32(0.001f);
+    const float32x4_t   instant = vdupq_n_f32(INSTANT_PARTICLE);
+    const float32x4_t   zero = vdupq_n_f32(0.0f);
+
+    // arrays are padded, lanes past num_live only cost a slower check
+    while (i < pool->num_live) {
+        int32x4_t   dt = vsubq_s32(vnow, vld1q_s32(pool->time + i));
+        float32x4_t av = vld1q_f32(pool->alphavel + i);
+        float32x4_t t  = vmulq_f32(vcvtq_f32_s32(dt), msec);
+        float32x4_t a;
+        uint32x4_t  faded;
+        uint32x2_t  any;
+
+        t = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(t), vceqq_f32(av, instant)));
+        a = vaddq_f32(vld1q_f32(pool->alpha + i), vmulq_f32(t, av));
+        faded = vcleq_f32(a, zero);
+        any = vorr_u32(vget_low_u32(faded), vget_high_u32(faded));
+
+        if (vget_lane_u32(any, 0) | vget_lane_u32(any, 1))
+            CL_CompactParticleGroup(pool, &i, now);
+        else
+            i += 4;
+    }
+#endif
+
+    while (i < pool->num_live) {
+        if (CL_ParticleFaded(pool, i, now))
+            CL_MoveParticle(pool, i, --pool->num_live);
+        else
+            i++;
+    }
+}
+
+static inline void CL_WriteParticle(const cparticle_pool_t *pool, int i, float x, float y, float z, float alpha)
+{
+    particle_t *part = &pool->out[i];
+
+    part->origin[0] = x;
+    part->origin[1] = y;
+    part->origin[2] = z;
+    part->color = pool->color[i];
+    part->scale = pool->scale[i];
+    part->alpha = alpha;
+    part->rgba = pool->rgba[i];
+    part->brightness = 0;
+    part->radius = 0;
+}
+
+// instant particles are drawn for a single frame, at their spawn origin
+static inline void CL_RetireInstantParticle(const cparticle_pool_t *pool, int i)
+{
+    if (pool->alphavel[i] == INSTANT_PARTICLE) {
+        pool->alphavel[i] = 0.0f;
+        pool->alpha[i] = 0.0f;
+    }
+}
+
+/*
+===============
+CL_AgeParticles
+
+Evaluates position and alpha of every live particle at time now into
+pool->out, which then holds exactly what is to be drawn.
+===============
+*/
+static void CL_AgeParticles(const cparticle_pool_t *pool, int now)
+{
+    int     i = 0, j;
+    float   time, time2;
+
+#if USE_SSE2
+    const __m128i   vnow = _mm_set1_epi32(now);
+    const __m128    msec = _mm_set1_ps(0.001f);
+    const __m128    instant = _mm_set1_ps(INSTANT_PARTICLE);
+    const __m128    one = _mm_set1_ps(1.0f);
+    alignas(16) float x[4], y[4], z[4], a[4];
+
+    for (; i + 4 <= pool->num_live; i += 4) {
+        __m128i dt = _mm_sub_epi32(vnow, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pool->time + i)));
+        __m128  av = _mm_loadu_ps(pool->alphavel + i);
+        __m128  is_instant = _mm_cmpeq_ps(av, instant);
+        __m128  t  = _mm_andnot_ps(is_instant, _mm_mul_ps(_mm_cvtepi32_ps(dt), msec));
+        __m128  t2 = _mm_mul_ps(t, t);
+
+        _mm_store_ps(x, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pool->org[0] + i), _mm_mul_ps(_mm_loadu_ps(pool->vel[0] + i), t)),
+                                   _mm_mul_ps(_mm_loadu_ps(pool->accel[0] + i), t2)));
+        _mm_store_ps(y, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pool->org[1] + i), _mm_mul_ps(_mm_loadu_ps(pool->vel[1] + i), t)),
+                                   _mm_mul_ps(_mm_loadu_ps(pool->accel[1] + i), t2)));
+        _mm_store_ps(z, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pool->org[2] + i), _mm_mul_ps(_mm_loadu_ps(pool->vel[2] + i), t)),
+                                   _mm_mul_ps(_mm_loadu_ps(pool->accel[2] + i), t2)));
+        _mm_store_ps(a, _mm_min_ps(_mm_add_ps(_mm_loadu_ps(pool->alpha + i), _mm_mul_ps(t, av)), one));
+
+        for (j = 0; j < 4; j++)
+            CL_WriteParticle(pool, i + j, x[j], y[j], z[j], a[j]);
+
+        if (_mm_movemask_ps(is_instant))
+            for (j = 0; j < 4; j++)
+                CL_RetireInstantParticle(pool, i + j);
+    }
+#elif USE_NEON
+    const int32x4_t     vnow = vdupq_n_s32(now);
+    const float32x4_t   msec = vdupq_n_f32(0.001f);
+    const float32x4_t   instant = vdupq_n_f32(INSTANT_PARTICLE);
+    const float32x4_t   one = vdupq_n_f32(1.0f);
+    alignas(16) float x[4], y[4], z[4], a[4];
+
+    for (; i + 4 <= pool->num_live; i += 4) {
+        int32x4_t   dt = vsubq_s32(vnow, vld1q_s32(pool->time + i));
+        float32x4_t av = vld1q_f32(pool->alphavel + i);
+        uint32x4_t  is_instant = vceqq_f32(av, instant);
+        float32x4_t t  = vmulq_f32(vcvtq_f32_s32(dt), msec);
+        float32x4_t t2;
+        uint32x2_t  any;
+
+        t  = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(t), is_instant));
+        t2 = vmulq_f32(t, t);
+
+        vst1q_f32(x, vaddq_f32(vaddq_f32(vld1q_f32(pool->org[0] + i), vmulq_f32(vld1q_f32(pool->vel[0] + i), t)),
+                               vmulq_f32(vld1q_f32(pool->accel[0] + i), t2)));
+        vst1q_f32(y, vaddq_f32(vaddq_f32(vld1q_f32(pool->org[1] + i), vmulq_f32(vld1q_f32(pool->vel[1] + i), t)),
+                               vmulq_f32(vld1q_f32(pool->accel[1] + i), t2)));
+        vst1q_f32(z, vaddq_f32(vaddq_f32(vld1q_f32(pool->org[2] + i), vmulq_f32(vld1q_f32(pool->vel[2] + i), t)),
+                               vmulq_f32(vld1q_f32(pool->accel[2] + i), t2)));
+        vst1q_f32(a, vminq_f32(vaddq_f32(vld1q_f32(pool->alpha + i), vmulq_f32(t, av)), one));
+
+        for (j = 0; j < 4; j++)
+            CL_WriteParticle(pool, i + j, x[j], y[j], z[j], a[j]);
+
+        any = vorr_u32(vget_low_u32(is_instant), vget_high_u32(is_instant));
+        if (vget_lane_u32(any, 0) | vget_lane_u32(any, 1))
+            for (j = 0; j < 4; j++)
+                CL_RetireInstantParticle(pool, i + j);
+    }
+#endif
+
+    for (; i < pool->num_live; i++) {
+        time = CL_ParticleTime(pool, i, now);
+        time2 = time * time;
+
+        CL_WriteParticle(pool, i,
+                         pool->org[0][i] + pool->vel[0][i] * time + pool->accel[0][i] * time2,
+                         pool->org[1][i] + pool->vel[1][i] * time + pool->accel[1][i] * time2,
+                         pool->org[2][i] + pool->vel[2][i] * time + pool->accel[2][i] * time2,
+                         min(pool->alpha[i] + time * pool->alphavel[i], 1.0f));
+        CL_RetireInstantParticle(pool, i);
+    }
+}
+
 /*
 ===============
 CL_ParticleEffect
@@ -1792,63 +2139,62 @@ CL_AddParticles
 */
 void CL_AddParticles(void)
 {
-    cparticle_t     *p, *next;
-    float           alpha;
-    float           time, time2;
-    cparticle_t     *active, *tail;
-
-    active = NULL;
-    tail = NULL;
-
-    for (p = active_particles; p; p = next) {
-        next = p->next;
-
-        if (p->alphavel != INSTANT_PARTICLE) {
-            time = (cl.time - p->time) * 0.001f;
-            alpha = p->alpha + time * p->alphavel;
-            if (alpha <= 0) {
-                // faded out
-                p->next = free_particles;
-                free_particles = p;
-                continue;
-            }
-        } else {
-            time = 0.0f;
-            alpha = p->alpha;
-        }
+    CL_CommitParticles(&cl_particles);
+    CL_CompactParticles(&cl_particles, cl.time);
+    CL_AgeParticles(&cl_particles, cl.time);
 
-        particle_t part = {};
-
-        time2 = time * time;
+    // anything past the renderer limit is still aged, just not drawn
+    V_AddParticles(cl_particles.out, cl_particles.num_live);
+}
 
-        part.origin[0] = p->org[0] + p->vel[0] * time + p->accel[0] * time2;
-        part.origin[1] = p->org[1] + p->vel[1] * time + p->accel[1] * time2;
-        part.origin[2] = p->org[2] + p->vel[2] * time + p->accel[2] * time2;
+#if USE_TESTS
+/*
+===============
+CL_ParticleBench
 
-        part.rgba = p->rgba;
-        part.color = p->color;
-        part.alpha = min(alpha, 1.0f);
-        part.scale = p->scale;
+Keeps a pool of count particles full and ages it for the given number of
+16 msec frames, the way CL_AddParticles does minus the renderer.
+===============
+*/
+void CL_ParticleBench(int count, int frames)
+{
+    cparticle_pool_t pool = {};
+    cparticle_t *p;
+    int i, j, now, spawned = 0;
+    int64_t aged = 0;
+    unsigned msec;
 
-        if (!V_AddParticle(&part))
-            break;
+    CL_AllocParticlePool(&pool, count);
 
-        p->next = NULL;
-        if (!tail)
-            active = tail = p;
-        else {
-            tail->next = p;
-            tail = p;
+    msec = Sys_Milliseconds();
+    for (i = 0, now = 0; i < frames; i++, now += 16) {
+        while ((p = CL_SpawnParticle(&pool))) {
+            p->time = now;
+            p->color = 0xe0 + (Q_rand() & 7);
+            for (j = 0; j < 3; j++) {
+                p->org[j] = crand() * 64;
+                p->vel[j] = crand() * 128;
+                p->accel[j] = 0;
+            }
+            p->accel[2] = -PARTICLE_GRAVITY;
+            p->alpha = 1.0f;
+            p->alphavel = -1.0f / (0.5f + frand() * 1.5f);
+            spawned++;
         }
 
-        if (p->alphavel == INSTANT_PARTICLE) {
-            p->alphavel = 0.0f;
-            p->alpha = 0.0f;
-        }
+        CL_CommitParticles(&pool);
+        CL_CompactParticles(&pool, now);
+        CL_AgeParticles(&pool, now);
+        aged += pool.num_live;
     }
+    msec = Sys_Milliseconds() - msec;
 
-    active_particles = active;
+    Com_Printf("%d frames, %d particles spawned, %" PRId64 " aged: %u msec, %.1f usec per frame\n",
+               frames, spawned, aged, msec, msec * 1000.0f / frames);
+
+    CL_FreeParticlePool(&pool);
 }
+#endif
 
 /*
 ==============
@@ -1902,6 +2248,8 @@ void CL_InitEffects(void)
     int i, j;
     static bool cg_rand_seeded;
 
+    cl_maxparticles = Cvar_Get("cl_maxparticles", "32768", 0);
+
     // Ensure particle/dlight lists are initialized for cgame module
     // (CL_ClearEffects may have run before cgame was loaded).
     CL_ClearLightStyles();
@@ -130,6 +130,9 @@ void CL_AddHelpPath(const vec3_t origin, const vec3_t dir, bool first);
 #if USE_DEBUG
 void CL_CheckEntityPresent(int entnum, const char *what);
 #endif
+#if USE_TESTS
+void CL_ParticleBench(int count, int frames);
+#endif
 
 static cgame_entity_export_t cg_entity_exports = {
     .api_version = CGAME_ENTITY_API_VERSION,
@@ -161,6 +164,9 @@ static cgame_entity_export_t cg_entity_exports = {
 #if USE_DEBUG
     .CheckEntityPresent = CL_CheckEntityPresent,
 #endif
+#if USE_TESTS
+    .ParticleBench = CL_ParticleBench,
+#endif
 };
 
 extern "C" const cgame_entity_export_t *CG_GetEntityAPI(void)
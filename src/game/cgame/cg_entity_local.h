@@ -166,6 +166,7 @@ static inline cvar_t *CG_SvPausedVar(void)
 
 #define V_AddEntity cgei->V_AddEntity
 #define V_AddParticle cgei->V_AddParticle
+#define V_AddParticles cgei->V_AddParticles
 #define V_AddLight cgei->V_AddLight
 #define V_AddLightEx cgei->V_AddLightEx
 #define V_AddLightStyle cgei->V_AddLightStyle
@@ -798,7 +798,7 @@ void ClientSessionServiceImpl::ClientBegin(local_game_import_t& gi, GameLocals&
 		// except for the persistant data that was initialized at
 		// ClientConnect() time
 		InitGEntity(ent);
-		ent->className = "player";
+		G_SetClassName(ent, "player");
 		worr::server::client::InitClientResp(cl);
 		cl->coopRespawn.spawnBegin = true;
 		worr::server::client::ClientCompleteSpawn(ent);
@@ -1033,7 +1033,7 @@ DisconnectResult ClientSessionServiceImpl::ClientDisconnect(local_game_import_t&
 	ent->solid = SOLID_NOT;
 	ent->inUse = false;
 	ent->sv.init = false;
-	ent->className = "disconnected";
+	G_SetClassName(ent, "disconnected");
 	cl->pers.connected = false;
 	cl->sess.inGame = false;
 	cl->sess.matchWins = 0;
@@ -22,7 +22,7 @@ namespace Commands {
 		if (!it) return;
 
 		gentity_t* it_ent = Spawn();
-		it_ent->className = it->className;
+		G_SetClassName(it_ent, it->className);
 		SpawnItem(it_ent, it);
 		if (it->flags & IF_AMMO) {
 			it_ent->count = count;
@@ -19,6 +19,7 @@ class Menu;
 #include <mutex>
 #include <optional> // for AutoSelectNextMap()
 #include <random>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -3829,6 +3830,7 @@ struct MonsterInfo {
   GameTime path_wait_time;       // don't try nav nodes until this is over
   PathInfo nav_path; // if AI_PATHING, this is where we are trying to reach
   GameTime nav_path_cache_time; // cache nav_path result for this much time
+  int nav_path_request;         // pending asynchronous path request, 0 if none
   CombatStyle combatStyle;      // pathing style
 
   struct dmg {
@@ -4103,6 +4105,7 @@ extern cvar_t *g_allowVoting;
 extern cvar_t *g_arenaSelfDmgArmor;
 extern cvar_t *g_arenaStartingArmor;
 extern cvar_t *g_arenaStartingHealth;
+extern cvar_t *g_async_monster_paths;
 extern cvar_t *g_cheats;
 extern cvar_t *g_ghost_min_play_time;
 extern cvar_t *g_coop_enable_lives;
@@ -4115,6 +4118,7 @@ extern cvar_t *g_lms_num_lives;
 extern cvar_t *g_damage_scale;
 extern cvar_t *g_debug_monster_kills;
 extern cvar_t *g_debug_monster_paths;
+extern cvar_t *g_debug_frame_arena;
 extern cvar_t *g_dedicated;
 extern cvar_t *g_disable_player_collision;
 extern cvar_t *match_startNoHumans;
@@ -4335,8 +4339,6 @@ bool CheckArenaValid(int arenaNum);
 bool ChangeArena(int newArenaNum);
 bool KillBox(gentity_t *ent, bool from_spawning, ModID mod = ModID::Telefragged,
              bool bsp_clipping = true);
-gentity_t *FindEntity(gentity_t *from,
-                      std::function<bool(gentity_t *e)> matcher);
 bool ReadyConditions(gentity_t *ent, bool admin_cmd);
 int TeamBalance(bool force);
 void ApplyQueuedTeamChange(gentity_t *ent, bool silent);
@@ -4352,17 +4354,42 @@ template <typename T>
 using member_object_type_t =
     typename member_object_type<std::remove_cv_t<T>>::type;
 
+// defined after gentity_t, see below
+template <typename Matcher>
+inline gentity_t *FindEntity(gentity_t *from, Matcher &&matcher);
 template <auto M>
-gentity_t *G_FindByString(gentity_t *from, const std::string_view &value) {
-  static_assert(std::is_same_v<member_object_type_t<decltype(M)>, const char *>,
-                "can only use string member functions");
-
-  return FindEntity(from, [&](gentity_t *e) {
-    return e->*M && strlen(e->*M) == value.length() &&
-           !Q_strncasecmp(e->*M, value.data(), value.length());
-  });
-}
-
+inline gentity_t *G_FindByString(gentity_t *from, const std::string_view &value);
+
+// g_entity_index.cpp
+// targetName and className lookups go through a hashed index instead of
+// scanning every entity. Spawned and freed entities are picked up on their
+// own and all entities are rechecked at the start of each frame, but code
+// that renames an existing entity must use G_SetClassName/G_SetTargetName
+// (or call G_ReindexEntity) for it to be found by its new name before then.
+enum class EntityIndexKey : uint8_t { TargetName, ClassName, Total };
+
+void G_ResetEntityIndex();
+void G_SyncEntityIndex();
+void G_ReindexEntity(gentity_t *ent);
+void G_SetClassName(gentity_t *ent, const char *className);
+void G_SetTargetName(gentity_t *ent, const char *targetName);
+gentity_t *G_FindIndexed(EntityIndexKey key, gentity_t *from,
+                         std::string_view value);
+
+// g_entity_grid.cpp
+// Linked entities are kept in a grid by their bounds and center, so
+// FindRadius and these queries only check nearby entities; unlinked ones
+// are always checked. Results are in entity order and match a scan of
+// g_entities, except for an entity moved without relinking by another
+// entity's think in the same frame, until G_RunFrame refiles it.
+void G_InitEntityGrid();
+void G_ResetEntityGrid();
+void G_RemoveFromEntityGrid(gentity_t *ent);
+void G_RefileEntity(gentity_t *ent);
+void G_EntityGridTest(int32_t searches, float rad);
+std::span<gentity_t *const> G_EntitiesInBox(const Vector3 &mins,
+                                            const Vector3 &maxs);
+std::span<gentity_t *const> G_EntitiesInSphere(const Vector3 &org, float rad);
 gentity_t *FindRadius(gentity_t *from, const Vector3 &org, float rad);
 gentity_t *PickTarget(const char *targetName);
 void UseTargets(gentity_t *ent, gentity_t *activator);
@@ -5116,6 +5143,7 @@ bool M_CheckBottom(gentity_t *ent);
 bool G_CloseEnough(gentity_t *ent, gentity_t *goal, float dist);
 bool M_walkmove(gentity_t *ent, float yaw, float dist);
 void M_MoveToGoal(gentity_t *ent, float dist);
+void M_InitNavApi();
 void M_ChangeYaw(gentity_t *ent);
 bool ai_check_move(gentity_t *self, float dist);
 
@@ -5126,6 +5154,7 @@ constexpr float g_friction = 6;
 constexpr float g_water_friction = 1;
 
 void G_RunEntity(gentity_t *ent);
+void G_PushTest(int32_t frames);
 bool G_RunThink(gentity_t *ent);
 void G_AddRotationalFriction(gentity_t *ent);
 void G_AddGravity(gentity_t *ent);
@@ -6538,6 +6567,46 @@ inline void ThrowGibs(gentity_t *self, int32_t damage,
                gib.scale * (self->s.scale ? self->s.scale : 1));
 }
 
+// Searches all active entities, beginning at the entity after from, for the
+// next one that validates the given callback. The matcher is taken by template
+// so that lambdas don't get wrapped in a heap allocated std::function.
+template <typename Matcher>
+inline gentity_t *FindEntity(gentity_t *from, Matcher &&matcher) {
+  if (!from)
+    from = g_entities;
+  else
+    from++;
+
+  for (; from < &g_entities[globals.numEntities]; from++) {
+    if (!from->inUse)
+      continue;
+    if (matcher(from))
+      return from;
+  }
+
+  return nullptr;
+}
+
+// Finds the next entity after from whose string field M matches value,
+// ignoring case. Indexed fields return the same entities in the same order
+// as a full scan would.
+template <auto M>
+inline gentity_t *G_FindByString(gentity_t *from,
+                                 const std::string_view &value) {
+  static_assert(std::is_same_v<member_object_type_t<decltype(M)>, const char *>,
+                "can only use string member functions");
+
+  if constexpr (M == &gentity_t::targetName)
+    return G_FindIndexed(EntityIndexKey::TargetName, from, value);
+  else if constexpr (M == &gentity_t::className)
+    return G_FindIndexed(EntityIndexKey::ClassName, from, value);
+  else
+    return FindEntity(from, [&](gentity_t *e) {
+      return e->*M && strlen(e->*M) == value.length() &&
+             !Q_strncasecmp(e->*M, value.data(), value.length());
+    });
+}
+
 inline bool M_CheckGib(gentity_t *self, const MeansOfDeath &mod) {
   if (self->deadFlag && mod.id == ModID::Crushed)
     return true;
@@ -884,7 +884,7 @@ gentity_t* SpawnBadArea(const Vector3& mins, const Vector3& maxs, GameTime lifes
 	badarea->touch = badarea_touch;
 	badarea->moveType = MoveType::None;
 	badarea->solid = SOLID_TRIGGER;
-	badarea->className = "bad_area";
+	G_SetClassName(badarea, "bad_area");
 	gi.linkEntity(badarea);
 
 	if (lifespan) {
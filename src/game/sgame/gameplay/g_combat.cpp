@@ -1228,10 +1228,11 @@ bool RadiusDamage(gentity_t *inflictor, gentity_t *attacker, float damage,
     v = closest_point_to_box(origin, bmin, bmax);
     v = origin - v;
 
-    if (v.length() >= radius)
+    const float distSq = v.lengthSquared();
+    if (distSq >= radius * radius)
       continue;
 
-    points = damage * (1.0f - v.length() / radius);
+    points = damage * (1.0f - std::sqrt(distSq) / radius);
 
     if (points > 0) {
       if (CanDamage(ent, inflictor)) {
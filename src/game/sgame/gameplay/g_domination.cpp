@@ -251,7 +251,7 @@ namespace {
 				gi.Com_PrintFmt("WARNING: {} failed to spawn domination point beam for point {}\n", __FUNCTION__, point.index);
 				return;
 			}
-			beam->className = "domination_point_beam";
+			G_SetClassName(beam, "domination_point_beam");
 			beam->moveType = MoveType::None;
 			beam->solid = SOLID_NOT;
 			beam->s.renderFX = RF_BEAM;
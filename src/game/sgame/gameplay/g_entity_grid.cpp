@@ -0,0 +1,451 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_entity_grid.cpp (Entity Spatial Grid)
+// Uniform grid of vertical columns holding every linked entity by the bounds
+// it was linked with and its center, so radius and box searches only look
+// at entities nearby instead of all of g_entities.
+//
+// gi.linkEntity and gi.unlinkEntity are wrapped at load to keep the grid
+// current, and G_RunFrame refiles each entity after it runs if its center
+// left its columns. Entities that aren't linked are not filed and every
+// query checks them one by one, so they are found wherever they are.
+// Columns are hashed into a fixed bucket table; entities spanning too many
+// columns go to a list checked by every query. Candidates are sorted by
+// entity number, so results come in the same order as a scan of g_entities.
+
+#include "../g_local.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float GRID_CELL = 256.f;
+constexpr uint32_t GRID_BUCKETS = 4096; // power of two
+constexpr int32_t GRID_MAX_COLUMNS = 64;
+
+struct GridEntry {
+  bool filed = false;
+  bool large = false;
+  int32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+};
+
+std::array<std::vector<int32_t>, GRID_BUCKETS> buckets;
+std::vector<int32_t> largeEntities;
+std::array<GridEntry, MAX_ENTITIES> entries;
+
+// entities not filed are checked by every query, except for slots known
+// to be free since FreeEntity
+constexpr size_t MASK_WORDS = MAX_ENTITIES / 64;
+std::array<uint64_t, MASK_WORDS> filedMask{};
+std::array<uint64_t, MASK_WORDS> freeMask{};
+
+inline void SetBit(std::array<uint64_t, MASK_WORDS> &mask, int32_t num, bool value) {
+  if (value)
+    mask[num >> 6] |= 1ull << (num & 63);
+  else
+    mask[num >> 6] &= ~(1ull << (num & 63));
+}
+
+// bumped whenever any entity is filed or removed
+uint32_t generation = 1;
+
+// dedupes entities and buckets within one query
+std::array<uint32_t, MAX_ENTITIES> entityStamp{};
+std::array<uint32_t, GRID_BUCKETS> bucketStamp{};
+uint32_t queryStamp;
+
+std::vector<int32_t> candidates;
+std::vector<gentity_t *> results;
+
+void (*engine_linkEntity)(gentity_t *ent);
+void (*engine_unlinkEntity)(gentity_t *ent);
+
+inline int32_t GridCoord(float v) {
+  return static_cast<int32_t>(std::floor(v / GRID_CELL));
+}
+
+inline uint32_t GridBucket(int32_t x, int32_t y) {
+  return (static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u) & (GRID_BUCKETS - 1);
+}
+
+void RemoveEntity(int32_t num) {
+  GridEntry &e = entries[num];
+
+  if (!e.filed)
+    return;
+
+  auto erase = [num](std::vector<int32_t> &list) {
+    auto it = std::find(list.begin(), list.end(), num);
+    if (it != list.end()) {
+      *it = list.back();
+      list.pop_back();
+    }
+  };
+
+  if (e.large) {
+    erase(largeEntities);
+  } else {
+    for (int32_t x = e.x0; x <= e.x1; x++)
+      for (int32_t y = e.y0; y <= e.y1; y++)
+        erase(buckets[GridBucket(x, y)]);
+  }
+
+  e.filed = false;
+  SetBit(filedMask, num, false);
+  generation++;
+}
+
+inline Vector3 EntityCenter(const gentity_t *ent) {
+  return ent->s.origin + (ent->mins + ent->maxs) * 0.5f;
+}
+
+// files by linked bounds for box queries and by center for radius queries
+void FileEntity(gentity_t *ent) {
+  int32_t num = static_cast<int32_t>(ent - g_entities);
+  GridEntry &e = entries[num];
+  Vector3 center = EntityCenter(ent);
+
+  RemoveEntity(num);
+
+  e.x0 = GridCoord(std::min(ent->absMin[0], center[0]));
+  e.y0 = GridCoord(std::min(ent->absMin[1], center[1]));
+  e.x1 = GridCoord(std::max(ent->absMax[0], center[0]));
+  e.y1 = GridCoord(std::max(ent->absMax[1], center[1]));
+  e.large = (int64_t)(e.x1 - e.x0 + 1) * (e.y1 - e.y0 + 1) > GRID_MAX_COLUMNS;
+  e.filed = true;
+  SetBit(filedMask, num, true);
+  SetBit(freeMask, num, false);
+
+  if (e.large) {
+    largeEntities.push_back(num);
+  } else {
+    for (int32_t x = e.x0; x <= e.x1; x++)
+      for (int32_t y = e.y0; y <= e.y1; y++)
+        buckets[GridBucket(x, y)].push_back(num);
+  }
+
+  generation++;
+}
+
+// world entity and unused slots never get filed, so the engine's own
+// checks for them are all that's needed
+void G_GridLinkEntity(gentity_t *ent) {
+  engine_linkEntity(ent);
+
+  if (ent && ent != g_entities && ent->inUse)
+    FileEntity(ent);
+}
+
+void G_GridUnlinkEntity(gentity_t *ent) {
+  engine_unlinkEntity(ent);
+
+  if (ent)
+    RemoveEntity(static_cast<int32_t>(ent - g_entities));
+}
+
+void NextQuery() {
+  if (!++queryStamp) {
+    entityStamp.fill(0);
+    bucketStamp.fill(0);
+    queryStamp = 1;
+  }
+}
+
+// fills candidates with entities filed in columns touching mins/maxs and
+// all entities not filed, sorted by entity number; they still need to be
+// checked exactly
+void GatherCandidates(const Vector3 &mins, const Vector3 &maxs) {
+  int32_t x0 = GridCoord(mins[0]), y0 = GridCoord(mins[1]);
+  int32_t x1 = GridCoord(maxs[0]), y1 = GridCoord(maxs[1]);
+
+  NextQuery();
+  candidates.clear();
+
+  auto visit = [&](const std::vector<int32_t> &list, bool overlapCheck) {
+    for (int32_t num : list) {
+      if (entityStamp[num] == queryStamp)
+        continue;
+
+      const GridEntry &e = entries[num];
+      if (overlapCheck && (e.x1 < x0 || e.x0 > x1 || e.y1 < y0 || e.y0 > y1))
+        continue; // hash collision
+
+      entityStamp[num] = queryStamp;
+      candidates.push_back(num);
+    }
+  };
+
+  if ((int64_t)(x1 - x0 + 1) * (y1 - y0 + 1) > GRID_BUCKETS) {
+    for (const auto &list : buckets)
+      visit(list, true);
+  } else {
+    for (int32_t x = x0; x <= x1; x++) {
+      for (int32_t y = y0; y <= y1; y++) {
+        uint32_t b = GridBucket(x, y);
+        if (bucketStamp[b] == queryStamp)
+          continue;
+        bucketStamp[b] = queryStamp;
+        visit(buckets[b], true);
+      }
+    }
+  }
+
+  visit(largeEntities, false);
+
+  uint32_t numEntities = std::min(globals.numEntities, static_cast<uint32_t>(MAX_ENTITIES));
+  for (uint32_t w = 0; w * 64 < numEntities; w++) {
+    uint64_t bits = ~(filedMask[w] | freeMask[w]);
+    if (numEntities - w * 64 < 64)
+      bits &= (1ull << (numEntities - w * 64)) - 1;
+    for (; bits; bits &= bits - 1)
+      candidates.push_back(static_cast<int32_t>(w * 64 + std::countr_zero(bits)));
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+}
+
+// FindRadius keeps the candidates of its last search while nothing was
+// filed or removed, so iterating over results is linear
+struct {
+  Vector3 org;
+  float rad = 0;
+  uint32_t generation = 0;
+  std::vector<int32_t> candidates;
+} radiusCache;
+
+} // namespace
+
+/*
+=============
+G_InitEntityGrid
+
+Hooks gi.linkEntity; called once when the game library is loaded.
+=============
+*/
+void G_InitEntityGrid() {
+  engine_linkEntity = gi.linkEntity;
+  gi.linkEntity = G_GridLinkEntity;
+  engine_unlinkEntity = gi.unlinkEntity;
+  gi.unlinkEntity = G_GridUnlinkEntity;
+}
+
+/*
+=============
+G_ResetEntityGrid
+
+Empties the grid when g_entities is wiped.
+=============
+*/
+void G_ResetEntityGrid() {
+  for (auto &list : buckets)
+    list.clear();
+  largeEntities.clear();
+  entries.fill({});
+  filedMask.fill(0);
+  freeMask.fill(0);
+  radiusCache.candidates.clear();
+  generation++;
+}
+
+/*
+=============
+G_RemoveFromEntityGrid
+
+Called when an entity is freed or reinitialized, after inUse is set. Freed
+slots are skipped by queries until filed again or reinitialized.
+=============
+*/
+void G_RemoveFromEntityGrid(gentity_t *ent) {
+  int32_t num = static_cast<int32_t>(ent - g_entities);
+
+  RemoveEntity(num);
+  SetBit(freeMask, num, !ent->inUse);
+  generation++;
+}
+
+/*
+=============
+G_RefileEntity
+
+Called after an entity runs, files it again if it was moved without being
+relinked and its center left its columns.
+=============
+*/
+void G_RefileEntity(gentity_t *ent) {
+  int32_t num = static_cast<int32_t>(ent - g_entities);
+  const GridEntry &e = entries[num];
+
+  if (!e.filed || !ent->inUse)
+    return;
+
+  Vector3 center = EntityCenter(ent);
+  int32_t x = GridCoord(center[0]), y = GridCoord(center[1]);
+
+  if (x < e.x0 || x > e.x1 || y < e.y0 || y > e.y1)
+    FileEntity(ent);
+}
+
+/*
+=============
+G_EntitiesInBox
+
+Entities in use whose bounds touch mins/maxs, in entity order. The span
+is valid until the next query.
+=============
+*/
+std::span<gentity_t *const> G_EntitiesInBox(const Vector3 &mins, const Vector3 &maxs) {
+  GatherCandidates(mins, maxs);
+  results.clear();
+
+  for (int32_t num : candidates) {
+    gentity_t *ent = &g_entities[num];
+
+    if (!ent->inUse)
+      continue;
+    if (ent->absMin[0] > maxs[0] || ent->absMin[1] > maxs[1] || ent->absMin[2] > maxs[2] ||
+        ent->absMax[0] < mins[0] || ent->absMax[1] < mins[1] || ent->absMax[2] < mins[2])
+      continue;
+
+    results.push_back(ent);
+  }
+
+  return results;
+}
+
+/*
+=============
+G_EntitiesInSphere
+
+Entities in use whose center is within rad of org, in entity order. The
+span is valid until the next query.
+=============
+*/
+std::span<gentity_t *const> G_EntitiesInSphere(const Vector3 &org, float rad) {
+  results.clear();
+
+  if (rad < 0)
+    return results;
+
+  GatherCandidates(org - Vector3{rad, rad, rad}, org + Vector3{rad, rad, rad});
+
+  for (int32_t num : candidates) {
+    gentity_t *ent = &g_entities[num];
+
+    if (!ent->inUse)
+      continue;
+    if ((org - EntityCenter(ent)).lengthSquared() > rad * rad)
+      continue;
+
+    results.push_back(ent);
+  }
+
+  return results;
+}
+
+/*
+=================
+FindRadius
+
+Returns entities that have origins within a spherical area
+
+FindRadius (origin, radius)
+=================
+*/
+gentity_t *FindRadius(gentity_t *from, const Vector3 &org, float rad) {
+  if (rad < 0)
+    return nullptr;
+
+  if (radiusCache.generation != generation || radiusCache.org != org || radiusCache.rad != rad) {
+    GatherCandidates(org - Vector3{rad, rad, rad}, org + Vector3{rad, rad, rad});
+    radiusCache.candidates.assign(candidates.begin(), candidates.end());
+    radiusCache.org = org;
+    radiusCache.rad = rad;
+    radiusCache.generation = generation;
+  }
+
+  const auto &list = radiusCache.candidates;
+  int32_t start = from ? static_cast<int32_t>(from - g_entities) + 1 : 0;
+
+  // entities are checked as they are returned, like a plain scan would
+  for (auto it = std::lower_bound(list.begin(), list.end(), start); it != list.end(); it++) {
+    gentity_t *ent = &g_entities[*it];
+
+    if (!ent->inUse)
+      continue;
+    if (ent->solid == SOLID_NOT)
+      continue;
+    if ((org - EntityCenter(ent)).lengthSquared() > rad * rad)
+      continue;
+
+    return ent;
+  }
+
+  return nullptr;
+}
+
+/*
+=============
+G_EntityGridTest
+
+"sv gridtest [searches] [radius]": runs FindRadius at random points in the
+world and checks it against a scan of g_entities, printing mismatches and
+the time each way takes.
+=============
+*/
+void G_EntityGridTest(int32_t searches, float rad) {
+  std::mt19937 rng(searches); // don't disturb the game's random numbers
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  std::vector<Vector3> points(std::max(searches, 1));
+
+  for (Vector3 &p : points)
+    for (int i = 0; i < 3; i++)
+      p[i] = world->absMin[i] + (world->absMax[i] - world->absMin[i]) * dist(rng);
+
+  auto scan = [rad](gentity_t *from, const Vector3 &org) -> gentity_t * {
+    for (gentity_t *ent = from ? from + 1 : g_entities; ent < &g_entities[globals.numEntities]; ent++) {
+      if (!ent->inUse || ent->solid == SOLID_NOT)
+        continue;
+      if ((org - EntityCenter(ent)).lengthSquared() > rad * rad)
+        continue;
+      return ent;
+    }
+    return nullptr;
+  };
+
+  int32_t mismatches = 0;
+
+  for (const Vector3 &p : points) {
+    gentity_t *a = nullptr, *b = nullptr;
+    do {
+      a = scan(a, p);
+      b = FindRadius(b, p, rad);
+    } while (a == b && a);
+    mismatches += a != b;
+  }
+
+  size_t found = 0;
+
+  // results are counted so the scan can't be optimized out
+  auto time = [&points, &found](auto &&search) {
+    auto start = std::chrono::steady_clock::now();
+    for (const Vector3 &p : points)
+      for (gentity_t *ent = nullptr; (ent = search(ent, p));)
+        found++;
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / points.size();
+  };
+
+  double scanTime = time(scan);
+  double gridTime = time([rad](gentity_t *from, const Vector3 &org) { return FindRadius(from, org, rad); });
+  found /= 2;
+
+  gi.Com_PrintFmt("{} searches of radius {} over {} entities, {} found, {} mismatched\n",
+                  points.size(), rad, globals.numEntities, found, mismatches);
+  gi.Com_PrintFmt("scan {:.2f} usec/search, grid {:.2f} usec/search\n", scanTime, gridTime);
+}
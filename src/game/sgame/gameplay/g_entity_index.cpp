@@ -0,0 +1,214 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_entity_index.cpp (Entity Name Index)
+// Hashed multimap from targetName and className to entity numbers, used by
+// G_FindByString so trigger chains don't scan every entity per lookup.
+//
+// Each entity keeps a copy of the name it was filed under. Syncing an
+// entity compares that against its current field and moves it between
+// buckets if it changed, so strings freed and copied again to the same
+// address are still noticed. Buckets are kept sorted by entity number, so
+// lookups return entities in the same order as a full scan.
+
+#include "../g_local.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// case insensitive, to match Q_strncasecmp
+struct NameHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view s) const {
+    uint32_t hash = 2166136261u;
+    for (char c : s) {
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+  }
+};
+
+struct NameEqual {
+  using is_transparent = void;
+
+  bool operator()(std::string_view a, std::string_view b) const {
+    return a.length() == b.length() &&
+           !Q_strncasecmp(a.data(), b.data(), a.length());
+  }
+};
+
+using Bucket = std::vector<int32_t>;
+
+struct NameIndex {
+  std::unordered_map<std::string, Bucket, NameHash, NameEqual> buckets;
+  std::array<std::string, MAX_ENTITIES> filed;   // name entity was filed under
+  std::array<Bucket *, MAX_ENTITIES> bucket{};    // nullptr if not filed, nodes
+                                                  // don't move on rehash
+};
+
+constexpr std::array<const char *gentity_t::*, static_cast<size_t>(EntityIndexKey::Total)> kFields = {
+    &gentity_t::targetName,
+    &gentity_t::className,
+};
+
+std::array<NameIndex, static_cast<size_t>(EntityIndexKey::Total)> indices;
+
+// entities spawned, freed or renamed since the last full sync
+std::vector<int32_t> dirty;
+std::array<bool, MAX_ENTITIES> isDirty{};
+
+void SyncEntity(int32_t num) {
+  const gentity_t *ent = &g_entities[num];
+
+  for (size_t k = 0; k < indices.size(); k++) {
+    NameIndex &index = indices[k];
+    const char *value = ent->inUse ? ent->*kFields[k] : nullptr;
+
+    if (value ? index.bucket[num] && index.filed[num] == value : !index.bucket[num])
+      continue;
+
+    if (Bucket *b = index.bucket[num]) {
+      auto it = std::lower_bound(b->begin(), b->end(), num);
+      if (it != b->end() && *it == num)
+        b->erase(it);
+    }
+
+    index.bucket[num] = nullptr;
+
+    if (!value) {
+      index.filed[num].clear();
+      continue;
+    }
+
+    index.filed[num] = value;
+
+    Bucket &b = index.buckets.try_emplace(value).first->second;
+    b.insert(std::lower_bound(b.begin(), b.end(), num), num);
+    index.bucket[num] = &b;
+  }
+}
+
+void SyncDirty() {
+  for (int32_t num : dirty)
+    SyncEntity(num);
+}
+
+} // namespace
+
+/*
+=============
+G_ResetEntityIndex
+
+Forgets all entities; called when g_entities is wiped, since strings of
+the old level may be reallocated at the same addresses.
+=============
+*/
+void G_ResetEntityIndex() {
+  for (NameIndex &index : indices) {
+    index.buckets.clear();
+    for (std::string &name : index.filed)
+      name.clear();
+    index.bucket.fill(nullptr);
+  }
+
+  for (int32_t num : dirty)
+    isDirty[num] = false;
+  dirty.clear();
+}
+
+/*
+=============
+G_SyncEntityIndex
+
+Rechecks every entity, catching renames nobody reported.
+=============
+*/
+void G_SyncEntityIndex() {
+  for (int32_t num = 0; num < static_cast<int32_t>(globals.numEntities); num++)
+    SyncEntity(num);
+
+  for (int32_t num : dirty)
+    isDirty[num] = false;
+  dirty.clear();
+}
+
+/*
+=============
+G_ReindexEntity
+
+Entity is resynced on every lookup until the next full sync.
+=============
+*/
+void G_ReindexEntity(gentity_t *ent) {
+  int32_t num = static_cast<int32_t>(ent - g_entities);
+
+  if (isDirty[num])
+    return;
+
+  isDirty[num] = true;
+  dirty.push_back(num);
+}
+
+/*
+=============
+G_SetClassName / G_SetTargetName
+
+Renames entity and refiles it right away.
+=============
+*/
+void G_SetClassName(gentity_t *ent, const char *className) {
+  ent->className = className;
+  SyncEntity(static_cast<int32_t>(ent - g_entities));
+}
+
+void G_SetTargetName(gentity_t *ent, const char *targetName) {
+  ent->targetName = targetName;
+  SyncEntity(static_cast<int32_t>(ent - g_entities));
+}
+
+/*
+=============
+G_FindIndexed
+
+Same as scanning from the entity after from for a field matching value.
+=============
+*/
+gentity_t *G_FindIndexed(EntityIndexKey key, gentity_t *from,
+                         std::string_view value) {
+  const NameIndex &index = indices[static_cast<size_t>(key)];
+  const auto field = kFields[static_cast<size_t>(key)];
+
+  SyncDirty();
+
+  auto found = index.buckets.find(value);
+  if (found == index.buckets.end())
+    return nullptr;
+
+  const Bucket &b = found->second;
+  int32_t start = from ? static_cast<int32_t>(from - g_entities) + 1 : 0;
+
+  for (auto it = std::lower_bound(b.begin(), b.end(), start); it != b.end(); it++) {
+    if (*it >= static_cast<int32_t>(globals.numEntities))
+      break;
+
+    gentity_t *ent = &g_entities[*it];
+    const char *s = ent->*field;
+
+    // renamed since it was filed and not reported yet
+    if (!ent->inUse || !s || strlen(s) != value.length() ||
+        Q_strncasecmp(s, value.data(), value.length()))
+      continue;
+
+    return ent;
+  }
+
+  return nullptr;
+}
@@ -0,0 +1,233 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_frame_arena.cpp (Game Frame Arena)
+// Implements the per-frame bump allocator declared in g_frame_arena.hpp and the
+// single arena instance shared by the game module. Also replaces the global
+// operator new/delete of the game module and hooks gi.TagMalloc, so that
+// g_debug_frame_arena can report every heap allocation made during a frame.
+
+#include "g_frame_arena.hpp"
+#include "../g_local.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+constexpr size_t FRAME_ARENA_INITIAL_SIZE = 64 * 1024;
+
+FrameArena frame_arena(FRAME_ARENA_INITIAL_SIZE);
+
+// operator new and gi.TagMalloc calls made by the game module
+std::atomic<size_t> heap_allocations;
+
+void *(*engine_TagMalloc)(size_t size, int tag);
+
+void *G_CountedTagMalloc(size_t size, int tag) {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return engine_TagMalloc(size, tag);
+}
+
+void *HeapAlloc(size_t size) noexcept {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+void *HeapAllocAligned(size_t size, std::align_val_t alignment) noexcept {
+  const size_t align = static_cast<size_t>(alignment);
+
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+  return _aligned_malloc(size ? size : 1, align);
+#else
+  return std::aligned_alloc(align, (size + align - 1) & ~(align - 1));
+#endif
+}
+
+void HeapFreeAligned(void *ptr) noexcept {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+} // namespace
+
+// Replaceable allocation functions. These only apply to the game module, and
+// only count allocations on top of what malloc does.
+
+void *operator new(size_t size) {
+  if (void *ptr = HeapAlloc(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return HeapAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return HeapAlloc(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  if (void *ptr = HeapAllocAligned(size, alignment))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return ::operator new(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return HeapAllocAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return HeapAllocAligned(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { HeapFreeAligned(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { HeapFreeAligned(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { HeapFreeAligned(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { HeapFreeAligned(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { HeapFreeAligned(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { HeapFreeAligned(ptr); }
+
+FrameArena::FrameArena(size_t initialSize)
+  : buffer_(static_cast<std::byte *>(::operator new(initialSize))),
+    size_(initialSize) {}
+
+FrameArena::~FrameArena() {
+  Reset();
+  ::operator delete(buffer_);
+}
+
+/*
+=============
+FrameArena::do_allocate
+
+Carves memory from the frame buffer. When the buffer is exhausted the request
+is passed to the heap and remembered, so that Reset can grow the buffer.
+=============
+*/
+void *FrameArena::do_allocate(size_t bytes, size_t alignment) {
+  const uintptr_t base = reinterpret_cast<uintptr_t>(buffer_);
+  const uintptr_t start = (base + used_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+  if (start + bytes <= base + size_) {
+    used_ = start + bytes - base;
+    return reinterpret_cast<void *>(start);
+  }
+
+  Overflow *block = static_cast<Overflow *>(::operator new(sizeof(Overflow)));
+  block->ptr = ::operator new(bytes, std::align_val_t(alignment));
+  block->bytes = bytes;
+  block->alignment = alignment;
+  block->next = overflow_;
+  overflow_ = block;
+  overflowBytes_ += bytes + alignment;
+  overflowAllocations_ += 2;
+  return block->ptr;
+}
+
+/*
+=============
+FrameArena::Reset
+
+Releases all memory handed out since the previous reset.
+=============
+*/
+void FrameArena::Reset() {
+  const size_t needed = used_ + overflowBytes_;
+
+  while (overflow_) {
+    Overflow *next = overflow_->next;
+    ::operator delete(overflow_->ptr, overflow_->bytes,
+                      std::align_val_t(overflow_->alignment));
+    ::operator delete(overflow_);
+    overflow_ = next;
+  }
+  overflowBytes_ = 0;
+  used_ = 0;
+
+  if (needed > size_) {
+    size_t newSize = size_;
+    while (newSize < needed)
+      newSize *= 2;
+
+    ::operator delete(buffer_);
+    buffer_ = static_cast<std::byte *>(::operator new(newSize));
+    size_ = newSize;
+  }
+}
+
+/*
+=============
+G_InitFrameArena
+
+Hooks gi.TagMalloc so its allocations are counted; called once when the game
+library is loaded.
+=============
+*/
+void G_InitFrameArena() {
+  engine_TagMalloc = gi.TagMalloc;
+  gi.TagMalloc = G_CountedTagMalloc;
+}
+
+/*
+=============
+G_FrameResource
+
+Returns memory resource for allocations that don't outlive current frame.
+=============
+*/
+std::pmr::memory_resource *G_FrameResource() {
+  return &frame_arena;
+}
+
+/*
+=============
+G_FrameArena_Reset
+
+Called at the end of each server frame.
+=============
+*/
+void G_FrameArena_Reset() {
+  static size_t reported, reportedOverflow;
+  const size_t used = frame_arena.Used();
+  const size_t overflow = frame_arena.OverflowAllocations() - reportedOverflow;
+
+  // growing the buffer here counts towards the frame that outgrew it
+  frame_arena.Reset();
+
+  const size_t total = heap_allocations.load(std::memory_order_relaxed);
+  const size_t allocations = total - reported;
+
+  if (g_debug_frame_arena && g_debug_frame_arena->integer) {
+    if (allocations || g_debug_frame_arena->integer > 1)
+      gi.Com_PrintFmt("frame {}: {} bytes of frame arena used, {} heap allocations ({} for arena overflow)\n",
+                      level.time.milliseconds(), used, allocations, overflow);
+  }
+
+  reported = total;
+  reportedOverflow = frame_arena.OverflowAllocations();
+}
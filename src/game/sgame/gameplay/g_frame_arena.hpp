@@ -0,0 +1,69 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_frame_arena.hpp (Game Frame Arena)
+// Bump allocator for scratch memory that only lives until the end of the
+// current server frame, such as scoreboard and HUD layout strings. It is
+// exposed as a `std::pmr::memory_resource`, so standard containers can use it
+// through `FrameString` and `FrameVector`.
+//
+// Key Responsibilities:
+// - Hands out memory from a single buffer, deallocation is a no-op.
+// - `G_FrameArena_Reset` releases everything at the end of `G_RunFrame`. If a
+//   frame ran out of buffer, the buffer grows so the next frame fits, keeping
+//   steady state frames free of heap allocations.
+// - Counts all heap allocations of the game module (operator new and
+//   gi.TagMalloc) and those the arena made for overflow, reported per frame
+//   when `g_debug_frame_arena` is set.
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+class FrameArena final : public std::pmr::memory_resource {
+public:
+  explicit FrameArena(size_t initialSize);
+  ~FrameArena() override;
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void Reset();
+
+  size_t Used() const { return used_ + overflowBytes_; }
+  size_t Capacity() const { return size_; }
+  size_t OverflowAllocations() const { return overflowAllocations_; }
+
+private:
+  struct Overflow {
+    Overflow *next;
+    size_t bytes;
+    size_t alignment;
+    void *ptr;
+  };
+
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  std::byte *buffer_ = nullptr;
+  size_t size_ = 0;
+  size_t used_ = 0;
+  Overflow *overflow_ = nullptr;
+  size_t overflowBytes_ = 0;
+  size_t overflowAllocations_ = 0;
+};
+
+using FrameString = std::pmr::string;
+
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+
+void G_InitFrameArena();
+std::pmr::memory_resource *G_FrameResource();
+void G_FrameArena_Reset();
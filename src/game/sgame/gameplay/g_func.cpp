@@ -2596,7 +2596,7 @@ void SP_func_water(gentity_t* self) {
 	// Bobbing water
 	const bool isBobbing = (!strcmp(self->className, "func_bobbingwater") || self->bob);
 	if (isBobbing) {
-		self->className = "func_door";
+		G_SetClassName(self, "func_door");
 		if (!self->bob) self->bob = 16;
 		if (!self->duration) self->duration = 8;
 		self->think = BobInit;
@@ -4154,7 +4154,7 @@ static THINK(object_repair_sparks) (gentity_t* ent) -> void {
 void SP_object_repair(gentity_t* ent) {
 	ent->moveType = MoveType::None;
 	ent->solid = SOLID_BBOX;
-	ent->className = "object_repair";
+	G_SetClassName(ent, "object_repair");
 	ent->mins = { -8, -8, 8 };
 	ent->maxs = { 8, 8, 8 };
 	ent->think = object_repair_sparks;
@@ -179,7 +179,7 @@ void Harvester_PositionOnFloor(gentity_t* ent) {
 }
 
 static void Harvester_SetupSkullEntity(gentity_t* skull, Item* item, Team team) {
-	skull->className = item->className;
+	G_SetClassName(skull, item->className);
 	skull->item = item;
 	skull->s.effects = item->worldModelFlags;
 	skull->s.renderFX |= RF_GLOW | RF_NO_LOD | RF_IR_VISIBLE;
@@ -158,7 +158,7 @@ namespace HeadHunters {
 			auto& state = State();
 			if (!state.headModelIndex)
 				state.headModelIndex = gi.modelIndex(kHeadModelPath);
-			head->className = "headhunters_carried_head";
+			G_SetClassName(head, "headhunters_carried_head");
 			head->solid = SOLID_NOT;
 			head->clipMask = CONTENTS_NONE;
 			head->moveType = MoveType::None;
@@ -181,7 +181,7 @@ namespace HeadHunters {
 			auto& state = State();
 			if (!state.headModelIndex)
 				state.headModelIndex = gi.modelIndex(kHeadModelPath);
-			head->className = "headhunters_spike_head";
+			G_SetClassName(head, "headhunters_spike_head");
 			head->solid = SOLID_NOT;
 			head->clipMask = CONTENTS_NONE;
 			head->moveType = MoveType::None;
@@ -463,7 +463,7 @@ const size_t desired = DesiredAttachmentCount(client);
 		gentity_t* head = Spawn();
 		if (!head)
 			return nullptr;
-		head->className = "item_headhunter_head";
+		G_SetClassName(head, "item_headhunter_head");
 		head->mins = { -12.0f, -12.0f, -12.0f };
 		head->maxs = { 12.0f, 12.0f, 12.0f };
 		head->solid = SOLID_TRIGGER;
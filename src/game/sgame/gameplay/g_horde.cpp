@@ -275,7 +275,7 @@ void Horde_RunSpawning() {
 
 	if (level.horde_monster_spawn_time <= level.time) {
 		gentity_t* e = Spawn();
-		e->className = Horde_PickMonster();
+		G_SetClassName(e, Horde_PickMonster());
 		const select_spawn_result_t result = SelectDeathmatchSpawnPoint(nullptr, vec3_origin, false, true, false, false);
 
 		if (result.spot) {
@@ -85,7 +85,7 @@ void G_HudBlob_SetFlags(uint32_t flags) {
   G_HudBlob_Commit();
 }
 
-void G_HudBlob_SetScoreboardSection(const std::string &section) {
+void G_HudBlob_SetScoreboardSection(std::string_view section) {
   if (scoreboard_section == section)
     return;
 
@@ -101,7 +101,7 @@ void G_HudBlob_ClearScoreboardSection() {
   G_HudBlob_Commit();
 }
 
-void G_HudBlob_SetEOUSection(const std::string &section) {
+void G_HudBlob_SetEOUSection(std::string_view section) {
   if (eou_section == section)
     return;
 
@@ -3,7 +3,7 @@
 #include "../g_local.hpp"
 
 void G_HudBlob_SetFlags(uint32_t flags);
-void G_HudBlob_SetScoreboardSection(const std::string &section);
+void G_HudBlob_SetScoreboardSection(std::string_view section);
 void G_HudBlob_ClearScoreboardSection();
-void G_HudBlob_SetEOUSection(const std::string &section);
+void G_HudBlob_SetEOUSection(std::string_view section);
 void G_HudBlob_ClearEOUSection();
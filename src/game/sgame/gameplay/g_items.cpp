@@ -217,7 +217,7 @@ static gentity_t* CreateDroppedItem(gentity_t* owner, Item* item, int count) {
 	// --- Basic Item Setup ---
 	dropped->item = item;
 	dropped->count = count;
-	dropped->className = item->className;
+	G_SetClassName(dropped, item->className);
 	dropped->spawnFlags = SPAWNFLAG_ITEM_DROPPED_PLAYER;
 	dropped->s.effects = item->worldModelFlags;
 	dropped->s.renderFX = RF_GLOW | RF_NO_LOD | RF_IR_VISIBLE;
@@ -404,7 +404,7 @@ void fire_doppelganger(gentity_t* ent, const Vector3& start, const Vector3& aimD
 	base->nextThink = level.time + 30_sec;
 	base->think = doppelganger_timeout;
 
-	base->className = "doppelganger";
+	G_SetClassName(base, "doppelganger");
 
 	gi.linkEntity(base);
 
@@ -931,7 +931,7 @@ gentity_t* Sphere_Spawn(gentity_t* owner, SpawnFlags spawnFlags) {
 	else
 		sphere->owner = owner;
 
-	sphere->className = "sphere";
+	G_SetClassName(sphere, "sphere");
 	sphere->yawSpeed = 40;
 	sphere->monsterInfo.attackFinished = 0_ms;
 	sphere->spawnFlags = spawnFlags; // need this for the HUD to recognize sphere
@@ -1068,7 +1068,7 @@ void QuadHog_Spawn(Item* item, gentity_t* spot, bool reset) {
 
 	ent = Spawn();
 
-	ent->className = item->className;
+	G_SetClassName(ent, item->className);
 	ent->item = item;
 	ent->spawnFlags = SPAWNFLAG_ITEM_DROPPED;
 	ent->s.effects = item->worldModelFlags | EF_COLOR_SHELL;
@@ -1262,7 +1262,7 @@ static THINK(Tech_Think) (gentity_t* tech) -> void {
 			return;
 		}
 
-		ent->className = tech->item->className;
+		G_SetClassName(ent, tech->item->className);
 		ent->item = tech->item;
 		ent->spawnFlags = SPAWNFLAG_ITEM_DROPPED;
 		ent->s.effects = tech->item->worldModelFlags;
@@ -1368,7 +1368,7 @@ static void Tech_Spawn(Item* item, gentity_t* spot) {
 	Vector3 forward, right;
 	Vector3 angles = { 0.0f, (float)irandom(360), 0.0f };
 
-	ent->className = item->className;
+	G_SetClassName(ent, item->className);
 	ent->item = item;
 	ent->spawnFlags = SPAWNFLAG_ITEM_DROPPED;
 	ent->s.effects = item->worldModelFlags;
@@ -1908,7 +1908,7 @@ THINK(RespawnItem)(gentity_t* ent) -> void {
 	if (g_dm_random_items->integer) {
 		if (item_id_t new_item = DoRandomRespawn(ent)) {
 			ent->item = GetItemByIndex(new_item);
-			ent->className = ent->item->className;
+			G_SetClassName(ent, ent->item->className);
 			ent->s.effects = ent->item->worldModelFlags;
 			gi.setModel(ent, ent->item->worldModel);
 		}
@@ -1965,7 +1965,7 @@ void SetRespawn(gentity_t* ent, GameTime delay, bool hide_self) {
 
 void Use_Teleporter(gentity_t* ent, Item* item) {
 	gentity_t* fx = Spawn();
-	fx->className = "telefx";
+	G_SetClassName(fx, "telefx");
 	fx->s.event = EV_PLAYER_TELEPORT;
 	fx->s.origin = ent->s.origin;
 	fx->s.origin[_Z] += 1.0f;
@@ -3634,7 +3634,7 @@ gentity_t* Drop_Item(gentity_t* ent, Item* item) {
 
 	dropped->item = item;
 	dropped->spawnFlags = SPAWNFLAG_ITEM_DROPPED;
-	dropped->className = item->className;
+	G_SetClassName(dropped, item->className);
 	dropped->s.effects = item->worldModelFlags;
 	gi.setModel(dropped, item->worldModel);
 	dropped->s.renderFX = RF_GLOW | RF_NO_LOD | RF_IR_VISIBLE;
@@ -4180,7 +4180,7 @@ bool SpawnItem(gentity_t* ent, Item* item) {
 	}
 
 	// Finalize class name and cache assets
-	ent->className = item->className;
+	G_SetClassName(ent, item->className);
 	PrecacheItem(item);
 
 	// Coop special handling
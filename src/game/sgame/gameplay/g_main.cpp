@@ -22,6 +22,8 @@ change game behavior on the fly.*/
 #include "../commands/commands.hpp"
 #include "../g_local.hpp"
 #include "g_clients.hpp"
+#include "g_frame_arena.hpp"
+#include "g_profile.hpp"
 #include "g_headhunters.hpp"
 #include "g_hud_blob.hpp"
 #include "g_qu3e_physics.hpp"
@@ -156,6 +158,7 @@ cvar_t *g_allowVoting;
 cvar_t *g_arenaSelfDmgArmor;
 cvar_t *g_arenaStartingArmor;
 cvar_t *g_arenaStartingHealth;
+cvar_t *g_async_monster_paths;
 cvar_t *g_cheats;
 cvar_t *g_ghost_min_play_time;
 cvar_t *g_coop_enable_lives;
@@ -168,6 +171,7 @@ cvar_t *g_lms_num_lives;
 cvar_t *g_damage_scale;
 cvar_t *g_debug_monster_kills;
 cvar_t *g_debug_monster_paths;
+cvar_t *g_debug_frame_arena;
 cvar_t *g_dedicated;
 cvar_t *g_disable_player_collision;
 cvar_t *match_startNoHumans;
@@ -954,6 +958,8 @@ static void InitGame() {
   RegisterAllCommands();
 
   G_InitSave();
+  G_Profile_Init();
+  M_InitNavApi();
 
   game = {};
 
@@ -1034,8 +1040,10 @@ static void InitGame() {
   g_frag_messages = gi.cvar("g_frag_messages", "1", CVAR_NOFLAGS);
   g_ghost_min_play_time = gi.cvar("g_ghost_min_play_time", "60", CVAR_NOFLAGS);
 
+  g_async_monster_paths = gi.cvar("g_async_monster_paths", "1", CVAR_NOFLAGS);
   g_debug_monster_paths = gi.cvar("g_debug_monster_paths", "0", CVAR_NOFLAGS);
   g_debug_monster_kills = gi.cvar("g_debug_monster_kills", "0", CVAR_LATCH);
+  g_debug_frame_arena = gi.cvar("g_debug_frame_arena", "0", CVAR_NOFLAGS);
 
   bot_debug_follow_actor = gi.cvar("bot_debug_follow_actor", "0", CVAR_NOFLAGS);
   bot_debug_move_to_point =
@@ -1262,6 +1270,8 @@ static void InitGame() {
       game.maxEntities * sizeof(g_entities[0]), TAG_GAME);
   std::memset(static_cast<void *>(g_entities), 0,
               game.maxEntities * sizeof(g_entities[0]));
+  G_ResetEntityIndex();
+  G_ResetEntityGrid();
   globals.gentities = g_entities;
   globals.maxEntities = game.maxEntities;
 
@@ -1391,6 +1401,8 @@ Q2GAME_API game_export_t *GetGameAPI(game_import_t *import) {
   gi = *import;
 
   InitServerLogging();
+  G_InitEntityGrid();
+  G_InitFrameArena();
 
   FRAME_TIME_S = FRAME_TIME_MS = GameTime::from_ms(gi.frameTimeMs);
 
@@ -1463,7 +1475,7 @@ gentity_t *CreateTargetChangeLevel(std::string_view map) {
     return nullptr;
 
   gentity_t *ent = Spawn();
-  ent->className = "target_changelevel";
+  G_SetClassName(ent, "target_changelevel");
 
   // Write into the level buffer
   Q_strlcpy(level.nextMap.data(), map.data(), level.nextMap.size());
@@ -2197,8 +2209,12 @@ Handles timeouts, intermission, entity updates, and respawns.
 =================
 */
 static inline void G_RunFrame_(bool main_loop) {
+  ProfileScope frameScope(ProfileZone::Frame);
   level.inFrame = true;
 
+  // pick up entities renamed since last frame
+  G_SyncEntityIndex();
+
   // --- Timeout Handling ---
   if (level.timeoutActive > 0_ms && level.timeoutOwner) {
     int tick = level.timeoutActive.seconds<int>() + 1;
@@ -2221,12 +2237,14 @@ static inline void G_RunFrame_(bool main_loop) {
   }
 
   // --- Global Updates ---
+  G_Profile_Begin(ProfileZone::Rules);
   GT_Changes();            // track gametype changes
   CheckVote();             // cancel vote if expired
   CheckCvars();            // check for updated cvars
   CheckPowerupsDisabled(); // disable unwanted powerups
   CheckRuleset();          // ruleset enforcement
   Bot_UpdateDebug();       // debug AI states
+  G_Profile_End();
   {
     uint32_t hud_flags = 0;
     if ((g_instaGib && g_instaGib->integer) ||
@@ -2316,9 +2334,12 @@ static inline void G_RunFrame_(bool main_loop) {
     }
   }
 
+  G_Profile_Begin(ProfileZone::Physics);
   SG_QU3EPhysics_RunFrame();
+  G_Profile_End();
 
   // --- Entity Loop ---
+  G_Profile_Begin(ProfileZone::Entities);
   gentity_t *ent = world;
   for (size_t i = 0; i < globals.numEntities; ++i, ++ent) {
     if (!ent->inUse) {
@@ -2392,16 +2413,23 @@ static inline void G_RunFrame_(bool main_loop) {
     Entity_UpdateState(ent);
 
     if (i >= 1 && i < 1 + static_cast<size_t>(game.maxClients)) {
+      ProfileScope clientScope((ent->svFlags & SVF_BOT) ? ProfileZone::Bots
+                                                         : ProfileZone::Clients);
       ClientBeginServerFrame(ent);
+      G_RefileEntity(ent);
       continue;
     }
 
     G_RunEntity(ent);
+    G_RefileEntity(ent);
   }
+  G_Profile_End();
 
   // --- Check for Match End / DM Logic ---
+  G_Profile_Begin(ProfileZone::MatchState);
   CheckDMEndFrame();
   CheckNeedPass();
+  G_Profile_End();
 
   // --- Reset coopRespawnState if all players are now alive ---
   if (CooperativeModeOn() &&
@@ -2420,10 +2448,13 @@ static inline void G_RunFrame_(bool main_loop) {
   }
 
   // --- Finalize Frame ---
+  G_Profile_Begin(ProfileZone::EndFrame);
   ClientEndServerFrames();
   HostAutoScreenshotsRun();
+  G_Profile_End();
 
   // --- Heatmap thinking ---
+  G_Profile_Begin(ProfileZone::AI);
   HM_Think();
 
   // --- Entry timer tracking ---
@@ -2442,6 +2473,7 @@ static inline void G_RunFrame_(bool main_loop) {
 
     M_ProcessPain(e);
   }
+  G_Profile_End();
 
   level.inFrame = false;
 }
@@ -2463,8 +2495,10 @@ static inline bool G_AnyClientsConnected() {
 }
 
 void G_RunFrame(bool main_loop) {
-  if (main_loop && !G_AnyClientsConnected())
+  if (main_loop && !G_AnyClientsConnected()) {
+    G_FrameArena_Reset();
     return;
+  }
 
   for (size_t i = 0; i < g_framesPerFrame->integer; i++)
     G_RunFrame_(main_loop);
@@ -2479,6 +2513,9 @@ void G_RunFrame(bool main_loop) {
       ReportMatchDetails(false);
     }
   }
+
+  // scratch memory allocated during this frame is no longer used
+  G_FrameArena_Reset();
 }
 
 /*
@@ -85,7 +85,7 @@ THINK(Respawn_Think) (gentity_t* ent) -> void {
 
 	// Spawn new entity
 	gentity_t* newEnt = Spawn();
-	newEnt->className = ent->saved->className;
+	G_SetClassName(newEnt, ent->saved->className);
 	//Q_strlcpy((char *)newEnt->className, ent->saved->className, sizeof(newEnt->className));
 	newEnt->s.origin = ent->saved->origin;
 	newEnt->s.angles = ent->saved->angles;
@@ -93,7 +93,7 @@ THINK(Respawn_Think) (gentity_t* ent) -> void {
 	newEnt->dmg = ent->saved->dmg;
 	newEnt->s.scale = ent->saved->scale;
 	newEnt->target = ent->saved->target;
-	newEnt->targetName = ent->saved->targetName;
+	G_SetTargetName(newEnt, ent->saved->targetName);
 	newEnt->spawnFlags = ent->saved->spawnFlags;
 	newEnt->mass = ent->saved->mass;
 	newEnt->mins = ent->saved->mins;
@@ -305,7 +305,7 @@ gentity_t* ThrowGib(gentity_t* self, std::string gibname, int damage, gib_type_t
 	gib->flags |= FL_NO_KNOCKBACK | FL_NO_DAMAGE_EFFECTS;
 	gib->takeDamage = true;
 	gib->die = gib_die;
-	gib->className = "gib";
+	G_SetClassName(gib, "gib");
 	if (type & GIB_SKINNED)
 		gib->s.skinNum = self->s.skinNum;
 	else
@@ -1636,7 +1636,7 @@ void SP_misc_teleporter(gentity_t* ent) {
 		return;
 
 	gentity_t* trig = Spawn();
-	trig->className = "teleporter_touch";
+	G_SetClassName(trig, "teleporter_touch");
 	trig->touch = teleporter_touch;
 	trig->solid = SOLID_TRIGGER;
 	trig->target = ent->target;
@@ -1778,7 +1778,7 @@ static THINK(fire_fly) (gentity_t* self) -> void {
 	fireball->velocity[_Y] = crandom() * 50;
 	fireball->aVelocity = { crandom() * 360, crandom() * 360, crandom() * 360 };
 	fireball->velocity[_Z] = (self->speed * 1.75f) + (frandom() * 200);
-	fireball->className = "fireball";
+	G_SetClassName(fireball, "fireball");
 	gi.setModel(fireball, "models/objects/gibs/sm_meat/tris.md2");
 	fireball->s.origin = self->s.origin;
 	fireball->nextThink = level.time + 5_sec;
@@ -1792,7 +1792,7 @@ static THINK(fire_fly) (gentity_t* self) -> void {
 }
 
 void SP_misc_lavaball(gentity_t* self) {
-	self->className = "fireball";
+	G_SetClassName(self, "fireball");
 	self->nextThink = level.time + random_time(5_sec);
 	self->think = fire_fly;
 	if (!self->speed)
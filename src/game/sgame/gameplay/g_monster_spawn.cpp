@@ -71,7 +71,7 @@ gentity_t* CreateMonster(const Vector3& origin, const Vector3& angles, const cha
 
 	newEnt->s.origin = origin;
 	newEnt->s.angles = angles;
-	newEnt->className = className;
+	G_SetClassName(newEnt, className);
 	newEnt->monsterInfo.aiFlags |= AI_DO_NOT_COUNT;
 
 	newEnt->gravityVector = { 0, 0, -1 };
@@ -299,7 +299,7 @@ void SpawnGrow_Spawn(const Vector3& startpos, float start_size, float end_size)
 	ent->solid = SOLID_NOT;
 	ent->s.renderFX |= RF_IR_VISIBLE;
 	ent->moveType = MoveType::None;
-	ent->className = "spawngro";
+	G_SetClassName(ent, "spawngro");
 
 	ent->s.modelIndex = gi.modelIndex("models/items/spawngro3/tris.md2");
 	ent->s.skinNum = 1;
@@ -324,7 +324,7 @@ void SpawnGrow_Spawn(const Vector3& startpos, float start_size, float end_size)
 	beam->s.renderFX = RF_BEAM_LIGHTNING | RF_NO_ORIGIN_LERP;
 	beam->s.frame = 1;
 	beam->s.skinNum = 0x30303030;
-	beam->className = "spawngro_beam";
+	G_SetClassName(beam, "spawngro_beam");
 	beam->angle = end_size;
 	beam->owner = ent;
 	beam->s.origin = ent->s.origin;
@@ -445,7 +445,7 @@ void Widowlegs_Spawn(const Vector3& startpos, const Vector3& angles) {
 	ent->solid = SOLID_NOT;
 	ent->s.renderFX = RF_IR_VISIBLE;
 	ent->moveType = MoveType::None;
-	ent->className = "widowlegs";
+	G_SetClassName(ent, "widowlegs");
 
 	ent->s.modelIndex = gi.modelIndex("models/monsters/legs/tris.md2");
 	ent->think = widowlegs_think;
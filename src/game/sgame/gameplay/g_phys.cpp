@@ -14,6 +14,9 @@ Utilities: Contains fundamental physics helpers like `G_AddGravity` and `G_Impac
 collisions.*/
 
 #include "../g_local.hpp"
+#include "g_profile.hpp"
+
+#include <chrono>
 
 /*
 
@@ -239,6 +242,21 @@ pushed_t pushed[MAX_ENTITIES], * pushed_p;
 
 gentity_t* obstacle;
 
+/*
+============
+G_Push_BoxFilter
+
+Only entities G_Push could move are candidates.
+============
+*/
+static BoxEntitiesResult_t G_Push_BoxFilter(gentity_t* check, void* data) {
+	if (check->moveType == MoveType::Push || check->moveType == MoveType::Stop || check->moveType == MoveType::None ||
+		check->moveType == MoveType::NoClip || check->moveType == MoveType::FreeCam)
+		return BoxEntitiesResult_t::Skip;
+
+	return BoxEntitiesResult_t::Keep;
+}
+
 /*
 ============
 G_Push
@@ -248,15 +266,26 @@ otherwise riders would continue to slide.
 ============
 */
 static bool G_Push(gentity_t* pusher, Vector3& move, Vector3& amove) {
+	static gentity_t* candidates[MAX_ENTITIES];
 	gentity_t* check, * block = nullptr;
-	Vector3	  mins, maxs;
+	Vector3	  mins, maxs, sweptMins, sweptMaxs;
 	pushed_t* p;
 	Vector3	  org, org2{}, move2, forward, right, up;
+	size_t	  num;
+
+	ProfileScope pushScope(ProfileZone::Push);
 
 	// find the bounding box
 	mins = pusher->absMin + move;
 	maxs = pusher->absMax + move;
 
+	// anything that can be pushed touches the swept bounds; riders
+	// touch the starting bounds even if the pusher moves away from them
+	for (int i = 0; i < 3; i++) {
+		sweptMins[i] = std::min(pusher->absMin[i], mins[i]);
+		sweptMaxs[i] = std::max(pusher->absMax[i], maxs[i]);
+	}
+
 	// we need this for pushing things later
 	org = -amove;
 	AngleVectors(org, forward, right, up);
@@ -273,14 +302,18 @@ static bool G_Push(gentity_t* pusher, Vector3& move, Vector3& amove) {
 	pusher->s.angles += amove;
 	gi.linkEntity(pusher);
 
+	// gather candidates from the area grid instead of testing every entity,
+	// then visit them in entity order so the first obstacle found is the same
+	num = gi.BoxEntities(sweptMins, sweptMaxs, candidates, MAX_ENTITIES, AREA_SOLID, G_Push_BoxFilter, nullptr);
+	num += gi.BoxEntities(sweptMins, sweptMaxs, candidates + num, MAX_ENTITIES - num, AREA_TRIGGERS, G_Push_BoxFilter, nullptr);
+	std::sort(candidates, candidates + num);
+
 	// see if any solid entities are inside the final position
-	check = g_entities + 1;
-	for (uint32_t e = 1; e < globals.numEntities; e++, check++) {
+	for (size_t i = 0; i < num; i++) {
+		check = candidates[i];
+
 		if (!check->inUse)
 			continue;
-		if (check->moveType == MoveType::Push || check->moveType == MoveType::Stop || check->moveType == MoveType::None ||
-			check->moveType == MoveType::NoClip || check->moveType == MoveType::FreeCam)
-			continue;
 
 		if (!check->linked)
 			continue; // not linked in anywhere
@@ -1080,3 +1113,48 @@ void G_RunEntity(gentity_t* ent) {
 	if (ent->postThink)
 		ent->postThink(ent);
 }
+
+/*
+=============
+G_PushTest
+
+"sv pushtest [frames]": runs pusher physics for every pusher on the map
+for a number of frames and prints the time each frame takes, along with
+a sum of entity positions so builds can be checked against each other.
+=============
+*/
+void G_PushTest(int32_t frames) {
+	size_t pushers = 0;
+
+	frames = std::max(frames, 1);
+
+	for (gentity_t* ent = g_entities + 1; ent < &g_entities[globals.numEntities]; ent++)
+		if (ent->inUse && (ent->moveType == MoveType::Push || ent->moveType == MoveType::Stop) && !(ent->flags & FL_TEAMSLAVE))
+			pushers++;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int32_t i = 0; i < frames; i++) {
+		for (gentity_t* ent = g_entities + 1; ent < &g_entities[globals.numEntities]; ent++) {
+			if (!ent->inUse || (ent->moveType != MoveType::Push && ent->moveType != MoveType::Stop))
+				continue;
+
+			G_Physics_Pusher(ent);
+		}
+	}
+
+	double frameTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+	double sum = 0;
+
+	for (gentity_t* ent = g_entities + 1; ent < &g_entities[globals.numEntities]; ent++) {
+		if (!ent->inUse)
+			continue;
+
+		for (int j = 0; j < 3; j++)
+			sum += ent->s.origin[j] + ent->s.angles[j];
+	}
+
+	gi.Com_PrintFmt("{} frames of {} pushers over {} entities, position sum {:.3f}\n",
+		frames, pushers, globals.numEntities, sum);
+	gi.Com_PrintFmt("{:.2f} usec/frame\n", frameTime);
+}
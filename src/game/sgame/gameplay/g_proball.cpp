@@ -76,7 +76,7 @@ void Ball_InitEntity(gentity_t* ball) {
 	Item* item = Ball_Item();
 	if (item) {
 		ball->item = item;
-		ball->className = item->className;
+		G_SetClassName(ball, item->className);
 		ball->s.modelIndex = gi.modelIndex(item->worldModel);
 		ball->s.effects = item->worldModelFlags;
 	}
@@ -0,0 +1,65 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_profile.cpp (Game Profile Zones)
+// Looks up the engine profiler extension and maps game zones to engine zone
+// handles.
+
+#include "g_profile.hpp"
+#include "../g_local.hpp"
+
+#include <array>
+
+namespace {
+
+struct profile_api_v1_t {
+  int (*RegisterZone)(const char *name);
+  void (*BeginZone)(int zone);
+  void (*EndZone)();
+};
+
+constexpr char kProfileApiV1[] = "PROFILE_API_V1";
+
+constexpr std::array<const char *, static_cast<size_t>(ProfileZone::Total)> kZoneNames = {
+    "game:frame",
+    "game:rules",
+    "game:physics",
+    "game:entities",
+    "game:clients",
+    "game:bots",
+    "game:match_state",
+    "game:end_frame",
+    "game:ai",
+    "game:push",
+};
+
+const profile_api_v1_t *profile_api;
+std::array<int, static_cast<size_t>(ProfileZone::Total)> zone_handles;
+
+} // namespace
+
+/*
+=============
+G_Profile_Init
+
+Registers game zones with the engine profiler, if it has one.
+=============
+*/
+void G_Profile_Init() {
+  profile_api = static_cast<const profile_api_v1_t *>(gi.GetExtension(kProfileApiV1));
+  if (!profile_api)
+    return;
+
+  for (size_t i = 0; i < kZoneNames.size(); i++)
+    zone_handles[i] = profile_api->RegisterZone(kZoneNames[i]);
+}
+
+void G_Profile_Begin(ProfileZone zone) {
+  if (profile_api)
+    profile_api->BeginZone(zone_handles[static_cast<size_t>(zone)]);
+}
+
+void G_Profile_End() {
+  if (profile_api)
+    profile_api->EndZone();
+}
@@ -0,0 +1,44 @@
+// Copyright (c) ZeniMax Media Inc.
+// Licensed under the GNU General Public License 2.0.
+
+// g_profile.hpp (Game Profile Zones)
+// Thin wrapper over the engine's PROFILE_API_V1 extension, which records
+// scoped timing zones while `com_profile` is enabled. Zones show up next to
+// the server's own phases in `profile_stats` and `profile_dump`.
+//
+// Key Responsibilities:
+// - Registers the game's zones with the engine once per game load.
+// - `ProfileScope` times a block of code, and compiles down to a null check
+//   when the engine doesn't provide the extension.
+
+#pragma once
+
+#include <cstdint>
+
+enum class ProfileZone : uint8_t {
+  Frame,      // one G_RunFrame_ iteration
+  Rules,      // gametype, vote, cvar and ruleset checks
+  Physics,    // rigid body physics step
+  Entities,   // entity loop, includes client and bot frames
+  Clients,    // human client frames
+  Bots,       // bot client frames
+  MatchState, // match end and warmup state
+  EndFrame,   // client view and stats updates
+  AI,         // heatmap and monster pain processing
+  Push,       // one G_Push call, a pusher move and everything it carries
+
+  Total
+};
+
+void G_Profile_Init();
+void G_Profile_Begin(ProfileZone zone);
+void G_Profile_End();
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileZone zone) { G_Profile_Begin(zone); }
+  ~ProfileScope() { G_Profile_End(); }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+};
@@ -2569,6 +2569,8 @@ void ReadLevelJson(const char* jsonString) {
         memset(static_cast<void *>(g_entities), 0,
                game.maxEntities * sizeof(g_entities[0]));
 	globals.numEntities = game.maxClients + 1;
+	G_ResetEntityIndex();
+	G_ResetEntityGrid();
 
 	// read level
 	json_push_stack("level");
@@ -2609,6 +2611,8 @@ void ReadLevelJson(const char* jsonString) {
 		ent->client->pers.spawned = false;
 	}
 
+	G_SyncEntityIndex();
+
 	// do any load time things at this point
 	for (size_t i = 0; i < globals.numEntities; i++) {
 		gentity_t* ent = &g_entities[i];
@@ -108,7 +108,7 @@ static bool EnsureWorldspawnPresent() {
   st = {};
   std::memset(static_cast<void *>(world), 0, sizeof(*world));
   world->s.number = 0;
-  world->className = "worldspawn";
+  G_SetClassName(world, "worldspawn");
   world->gravityVector = {0.0f, 0.0f, -1.0f};
 
   ED_CallSpawn(world);
@@ -793,6 +793,9 @@ void ED_CallSpawn(gentity_t *ent) {
     return;
   }
 
+  // spawn functions often change className
+  G_ReindexEntity(ent);
+
   worr::Logf(worr::LogLevel::Debug, "{}: dispatching spawn {}", __FUNCTION__,
              BuildMapEntityContext(ent));
 
@@ -822,39 +825,39 @@ void ED_CallSpawn(gentity_t *ent) {
   const char *original_class_name = ent->className;
   // FIXME - PMM classnames hack
   if (!strcmp(ent->className, "weapon_nailgun"))
-    ent->className = GetItemByIndex(IT_WEAPON_ETF_RIFLE)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_WEAPON_ETF_RIFLE)->className);
   else if (!strcmp(ent->className, "ammo_nails"))
-    ent->className = GetItemByIndex(IT_AMMO_FLECHETTES)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_AMMO_FLECHETTES)->className);
   else if (!strcmp(ent->className, "weapon_heatbeam"))
-    ent->className = GetItemByIndex(IT_WEAPON_PLASMABEAM)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_WEAPON_PLASMABEAM)->className);
   else if (!strcmp(ent->className, "weapon_plasmarifle"))
-    ent->className = GetItemByIndex(IT_WEAPON_PLASMAGUN)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_WEAPON_PLASMAGUN)->className);
   else if (!strcmp(ent->className, "item_haste"))
-    ent->className = GetItemByIndex(IT_POWERUP_HASTE)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_POWERUP_HASTE)->className);
   else if (RS(Quake3Arena) && !strcmp(ent->className, "weapon_supershotgun"))
-    ent->className = GetItemByIndex(IT_WEAPON_SHOTGUN)->className;
+    G_SetClassName(ent, GetItemByIndex(IT_WEAPON_SHOTGUN)->className);
   else if (!strcmp(ent->className, "info_player_team1"))
-    ent->className = "info_player_team_red";
+    G_SetClassName(ent, "info_player_team_red");
   else if (!strcmp(ent->className, "info_player_team2"))
-    ent->className = "info_player_team_blue";
+    G_SetClassName(ent, "info_player_team_blue");
   else if (!strcmp(ent->className, "item_flag_team1"))
-    ent->className = ITEM_CTF_FLAG_RED;
+    G_SetClassName(ent, ITEM_CTF_FLAG_RED);
   else if (!strcmp(ent->className, "item_flag_team2"))
-    ent->className = ITEM_CTF_FLAG_BLUE;
+    G_SetClassName(ent, ITEM_CTF_FLAG_BLUE);
 
   if (RS(Quake1)) {
     if (!strcmp(ent->className, "weapon_machinegun"))
-      ent->className = GetItemByIndex(IT_WEAPON_ETF_RIFLE)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_WEAPON_ETF_RIFLE)->className);
     else if (!strcmp(ent->className, "weapon_chaingun"))
-      ent->className = GetItemByIndex(IT_WEAPON_PLASMABEAM)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_WEAPON_PLASMABEAM)->className);
     else if (!strcmp(ent->className, "weapon_railgun"))
-      ent->className = GetItemByIndex(IT_WEAPON_HYPERBLASTER)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_WEAPON_HYPERBLASTER)->className);
     else if (!strcmp(ent->className, "ammo_slugs"))
-      ent->className = GetItemByIndex(IT_AMMO_CELLS)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_AMMO_CELLS)->className);
     else if (!strcmp(ent->className, "ammo_bullets"))
-      ent->className = GetItemByIndex(IT_AMMO_FLECHETTES)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_AMMO_FLECHETTES)->className);
     else if (!strcmp(ent->className, "ammo_grenades"))
-      ent->className = GetItemByIndex(IT_AMMO_ROCKETS_SMALL)->className;
+      G_SetClassName(ent, GetItemByIndex(IT_AMMO_ROCKETS_SMALL)->className);
   }
   // pmm
 
@@ -894,7 +897,7 @@ void ED_CallSpawn(gentity_t *ent) {
 
         if (new_item) {
           item = GetItemByIndex(new_item);
-          ent->className = item->className;
+          G_SetClassName(ent, item->className);
           worr::Logf(worr::LogLevel::Debug,
                      "{}: random respawn mapped to {} for {}", __FUNCTION__,
                      ent->className, LogEntityLabel(ent));
@@ -916,7 +919,7 @@ void ED_CallSpawn(gentity_t *ent) {
       s.spawn(ent);
 
       if (strcmp(ent->className, s.name) == 0)
-        ent->className = s.name;
+        G_SetClassName(ent, s.name);
 
       if (deathmatch->integer && !ent->saved) {
         saved_spawn_t *spawn =
@@ -2177,6 +2180,8 @@ void SpawnEntities(const char *mapName, const char *entities,
   std::memset(static_cast<void *>(g_entities), 0,
               sizeof(g_entities[0]) * game.maxEntities);
   globals.numEntities = game.maxClients + 1;
+  G_ResetEntityIndex();
+  G_ResetEntityGrid();
   std::memset(static_cast<void *>(world), 0, sizeof(*world));
   world->s.number = 0;
   level.bodyQue = 0;
@@ -2268,6 +2273,7 @@ void SpawnEntities(const char *mapName, const char *entities,
     gi.Com_ErrorFmt("{}: worldspawn failed to initialize after entity parse.\n",
                     __FUNCTION__);
   Locations_Finalize();
+  G_SyncEntityIndex();
 
   // Level post-processing and setup
   PrecacheStartItems();
@@ -19,10 +19,12 @@ that have not yet been migrated.*/
 
 #include "../../bgame/logger.hpp"
 #include "../g_local.hpp"
+#include "g_frame_arena.hpp"
 #include "g_headhunters.hpp"
 #include <algorithm>
 #include <cstring>
 #include <format>
+#include <span>
 
 
 /*
@@ -474,15 +476,17 @@ static bool SpotIsSafe(gentity_t *spot, bool check_players = true) {
 constexpr SpawnFlags SPAWNFLAG_INITIAL =
     0x10000_spawnflag; // example value, adjust as needed
 
+// candidate lists built while picking a spot only live for the current frame
+using SpawnList = FrameVector<gentity_t *>;
+
 /*
 ===============
 FilterInitialSpawns
 Keep only INITIAL-flagged spawns when present; otherwise fallback to all.
 ===============
 */
-static std::vector<gentity_t *>
-FilterInitialSpawns(const std::vector<gentity_t *> &spawns) {
-  std::vector<gentity_t *> flagged;
+static SpawnList FilterInitialSpawns(std::span<gentity_t *const> spawns) {
+  SpawnList flagged(G_FrameResource());
   flagged.reserve(spawns.size());
   for (auto *s : spawns) {
     if (!s)
@@ -491,7 +495,9 @@ FilterInitialSpawns(const std::vector<gentity_t *> &spawns) {
       flagged.push_back(s);
     }
   }
-  return flagged.empty() ? spawns : flagged;
+  if (flagged.empty())
+    flagged.assign(spawns.begin(), spawns.end());
+  return flagged;
 }
 
 /*
@@ -536,8 +542,8 @@ force_spawn still checks geometry but ignores player collisions and soft
 filters.
 ===============
 */
-static std::vector<gentity_t *>
-FilterEligibleSpawns(const std::vector<gentity_t *> &spawns,
+static SpawnList
+FilterEligibleSpawns(std::span<gentity_t *const> spawns,
                      const Vector3 &avoid_point, bool force_spawn,
                      gentity_t *entForTeamLogic, // may be null
                      bool respectAvoidPoint) {
@@ -548,7 +554,7 @@ FilterEligibleSpawns(const std::vector<gentity_t *> &spawns,
   constexpr float MAX_LOS_DIST =
       2048.0f; // consider LoS threats up to this range
 
-  std::vector<gentity_t *> out;
+  SpawnList out(G_FrameResource());
   out.reserve(spawns.size());
 
   for (auto *s : spawns) {
@@ -590,11 +596,10 @@ FilterFallbackSpawns
 Lightweight fallback filter: occupancy and minimum distance from avoid_point.
 ===============
 */
-static std::vector<gentity_t *>
-FilterFallbackSpawns(const std::vector<gentity_t *> &spawns,
-                     const Vector3 &avoid_point) {
+static SpawnList FilterFallbackSpawns(std::span<gentity_t *const> spawns,
+                                      const Vector3 &avoid_point) {
   constexpr float MIN_DIST = 192.0f;
-  std::vector<gentity_t *> out;
+  SpawnList out(G_FrameResource());
   out.reserve(spawns.size());
   for (auto *s : spawns) {
     if (!s)
@@ -613,7 +618,7 @@ FilterFallbackSpawns(const std::vector<gentity_t *> &spawns,
 PickRandomly
 ===============
 */
-template <typename T> static T *PickRandomly(const std::vector<T *> &vec) {
+static gentity_t *PickRandomly(std::span<gentity_t *const> vec) {
   if (vec.empty())
     return nullptr;
   std::uniform_int_distribution<size_t> dist(0, vec.size() - 1);
@@ -627,9 +632,9 @@ Pick random among all spots within epsilon of the best score.
 "scoreFn" must return lower-is-better scores.
 ===============
 */
-static gentity_t *
-SelectFromSpawnList(const std::vector<gentity_t *> &spawns,
-                    const std::function<float(gentity_t *)> &scoreFn) {
+template <typename ScoreFn>
+static gentity_t *SelectFromSpawnList(std::span<gentity_t *const> spawns,
+                                      ScoreFn &&scoreFn) {
   if (spawns.empty())
     return nullptr;
 
@@ -640,7 +645,7 @@ SelectFromSpawnList(const std::vector<gentity_t *> &spawns,
 
   constexpr float EPS =
       0.05f; // 5 percent tolerance if we use normalized scores
-  std::vector<gentity_t *> finalists;
+  SpawnList finalists(G_FrameResource());
   finalists.reserve(spawns.size());
   for (auto *s : spawns) {
     const float sc = scoreFn(s);
@@ -718,7 +723,7 @@ static gentity_t *SelectTeamSpawnPoint(gentity_t *ent, Team team) {
   };
 
   // [Paril-KEX] Filter for safety first!
-  std::vector<gentity_t *> eligible;
+  SpawnList eligible(G_FrameResource());
   eligible.reserve(list->size());
   for (gentity_t *s : *list) {
     if (SpotIsSafe(s))
@@ -757,7 +762,7 @@ team-specific spawns are unavailable.
 static gentity_t *SelectAnyTeamSpawnPoint(gentity_t *ent,
                                           const Vector3 &avoid_point,
                                           bool force_spawn) {
-  std::vector<gentity_t *> team_spawns;
+  SpawnList team_spawns(G_FrameResource());
   team_spawns.reserve(level.spawn.red.size() + level.spawn.blue.size());
   team_spawns.insert(team_spawns.end(), level.spawn.red.begin(),
                      level.spawn.red.end());
@@ -807,7 +812,8 @@ SelectDeathmatchSpawnPoint(gentity_t *ent, Vector3 avoid_point,
   }
 
   // Initial spawns: prefer INITIAL-flagged points if any exist
-  std::vector<gentity_t *> baseList = level.spawn.ffa;
+  SpawnList baseList(level.spawn.ffa.begin(), level.spawn.ffa.end(),
+                     G_FrameResource());
   if (initial) {
     baseList = FilterInitialSpawns(baseList);
   }
@@ -922,7 +928,7 @@ static gentity_t *SelectLavaCoopSpawnPoint(gentity_t *ent) {
   const float lavaTopThreshold = highestTopZ + 64.0f;
 
   // Gather coop-lava spawn points
-  std::vector<gentity_t *> spawns;
+  SpawnList spawns(G_FrameResource());
   spawns.reserve(64);
   for (gentity_t *spot = nullptr;
        (spot = G_FindByString<&gentity_t::className>(
@@ -974,7 +980,7 @@ static gentity_t *SelectCoopSpawnPoint(gentity_t *ent) {
     return lava;
 
   // Gather coop starts
-  std::vector<gentity_t *> coopSpots;
+  SpawnList coopSpots(G_FrameResource());
   for (gentity_t *s = nullptr; (s = G_FindByString<&gentity_t::className>(
                                     s, "info_player_coop")) != nullptr;) {
     if (s->inUse)
@@ -990,7 +996,7 @@ static gentity_t *SelectCoopSpawnPoint(gentity_t *ent) {
 
   // If still nothing, consider FFA list to keep players flowing
   if (coopSpots.empty() && !level.spawn.ffa.empty())
-    coopSpots = level.spawn.ffa;
+    coopSpots.assign(level.spawn.ffa.begin(), level.spawn.ffa.end());
 
   if (coopSpots.empty())
     return nullptr;
@@ -1573,7 +1579,8 @@ void ClientSpawn(gentity_t *ent) {
   ent->moveType = MoveType::Walk;
   ent->viewHeight = DEFAULT_VIEWHEIGHT;
   ent->inUse = true;
-  ent->className = "player";
+  G_RemoveFromEntityGrid(ent);
+  G_SetClassName(ent, "player");
   ent->mass = 200;
   ent->solid = SOLID_BBOX;
   ent->deadFlag = false;
@@ -515,6 +515,13 @@ void ServerCommand()
 	else if (Q_strcasecmp(cmd, "nextmap") == 0) {
 		SVCmd_NextMap_f();
 	}
+	else if (Q_strcasecmp(cmd, "gridtest") == 0) {
+		G_EntityGridTest(gi.argc() > 2 ? atoi(gi.argv(2)) : 1000,
+			gi.argc() > 3 ? static_cast<float>(atof(gi.argv(3))) : 256.f);
+	}
+	else if (Q_strcasecmp(cmd, "pushtest") == 0) {
+		G_PushTest(gi.argc() > 2 ? atoi(gi.argv(2)) : 100);
+	}
 	else {
 		gi.LocClient_Print(nullptr, PRINT_HIGH, "$g_sgame_auto_14d3c73afcac", cmd);
 	}
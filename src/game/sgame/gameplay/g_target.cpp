@@ -1044,7 +1044,7 @@ static USE(use_target_spawner) (gentity_t* self, gentity_t* other, gentity_t* ac
 	gentity_t* ent;
 
 	ent = Spawn();
-	ent->className = self->target;
+	G_SetClassName(ent, self->target);
 	ent->flags = self->flags;
 	ent->s.origin = self->s.origin;
 	ent->s.angles = self->s.angles;
@@ -5,7 +5,7 @@ g_utilities.cpp (Game Utilities) This file is a collection of miscellaneous
 utility and helper functions that are used throughout the server-side game
 module. It contains common, reusable code that doesn't belong to a more specific
 system like items or AI. Key Responsibilities: - Entity Searching: Provides
-functions like `FindEntity`, `FindRadius`, and `PickTarget` for locating
+functions like `FindRadius` and `PickTarget` for locating
 specific entities in the game world. - Spawning and Linking: Contains the core
 `Spawn` and `FreeEntity` functions that manage the entity lifecycle. - String
 and Text Manipulation: Includes functions for formatting strings, such as
@@ -150,66 +150,6 @@ bool ChangeArena(int newArenaNum) {
   return true;
 }
 
-/*
-=============
-FindEntity
-
-Searches all active entities for the next one that validates the given callback.
-
-Searches beginning at the entity after from, or the beginning if nullptr
-nullptr will be returned if the end of the list is reached.
-=============
-*/
-gentity_t *FindEntity(gentity_t *from,
-                      std::function<bool(gentity_t *e)> matcher) {
-  if (!from)
-    from = g_entities;
-  else
-    from++;
-
-  for (; from < &g_entities[globals.numEntities]; from++) {
-    if (!from->inUse)
-      continue;
-    if (matcher(from))
-      return from;
-  }
-
-  return nullptr;
-}
-
-/*
-=================
-FindRadius
-
-Returns entities that have origins within a spherical area
-
-FindRadius (origin, radius)
-=================
-*/
-gentity_t *FindRadius(gentity_t *from, const Vector3 &org, float rad) {
-  Vector3 eorg{};
-  int j;
-
-  if (!from)
-    from = g_entities;
-  else
-    from++;
-  for (; from < &g_entities[globals.numEntities]; from++) {
-    if (!from->inUse)
-      continue;
-    if (from->solid == SOLID_NOT)
-      continue;
-    for (j = 0; j < 3; j++)
-      eorg[j] =
-          org[j] - (from->s.origin[j] + (from->mins[j] + from->maxs[j]) * 0.5f);
-    if (eorg.length() > rad)
-      continue;
-    return from;
-  }
-
-  return nullptr;
-}
-
 /*
 =============
 PickTarget
@@ -340,7 +280,7 @@ void UseTargets(gentity_t *ent, gentity_t *activator) {
   if (ent->delay) {
     // create a temp object to fire at a later time
     t = Spawn();
-    t->className = "DelayedUse";
+    G_SetClassName(t, "DelayedUse");
     t->nextThink = level.time + GameTime::from_sec(ent->delay);
     t->think = Think_Delay;
     t->activator = activator;
@@ -506,6 +446,9 @@ void InitGEntity(gentity_t *e) {
 
   // do this before calling the spawn function so it can be overridden.
   e->gravityVector = {0.0, 0.0, -1.0};
+
+  G_ReindexEntity(e);
+  G_RemoveFromEntityGrid(e);
 }
 
 /*
@@ -579,6 +522,9 @@ THINK(FreeEntity)(gentity_t *ed)->void {
   ed->inUse = false;
   ed->spawn_count = id;
   ed->sv.init = false;
+
+  G_ReindexEntity(ed);
+  G_RemoveFromEntityGrid(ed);
 }
 
 /*
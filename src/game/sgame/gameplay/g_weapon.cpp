@@ -453,7 +453,7 @@ void fire_blaster(gentity_t *self, const Vector3 &start, const Vector3 &dir,
     bolt->splashRadius = 30; // 20;
     bolt->splashDamage = 20; // 15;
   }
-  bolt->className = "bolt";
+  G_SetClassName(bolt, "bolt");
   gi.linkEntity(bolt);
 
   trace_t tr =
@@ -562,7 +562,7 @@ void fire_greenblaster(gentity_t *self, const Vector3 &start,
   bolt->nextThink = level.time + 2_sec;
   bolt->think = FreeEntity;
   bolt->dmg = damage;
-  bolt->className = "bolt";
+  G_SetClassName(bolt, "bolt");
   gi.linkEntity(bolt);
 
   tr = gi.traceLine(self->s.origin, bolt->s.origin, bolt, bolt->clipMask);
@@ -607,7 +607,7 @@ void fire_blueblaster(gentity_t *self, const Vector3 &start, const Vector3 &dir,
   bolt->nextThink = level.time + 2_sec;
   bolt->think = FreeEntity;
   bolt->dmg = damage;
-  bolt->className = "bolt";
+  G_SetClassName(bolt, "bolt");
   gi.linkEntity(bolt);
 
   tr = gi.traceLine(self->s.origin, bolt->s.origin, bolt, bolt->clipMask);
@@ -790,7 +790,7 @@ void fire_grenade(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
   grenade->touch = Grenade_Touch;
   grenade->dmg = damage;
   grenade->splashRadius = splashRadius;
-  grenade->className = "grenade";
+  G_SetClassName(grenade, "grenade");
 
   gi.linkEntity(grenade);
 }
@@ -854,7 +854,7 @@ void fire_handgrenade(gentity_t *self, const Vector3 &start,
   grenade->think = Grenade_Explode;
   grenade->dmg = damage;
   grenade->splashRadius = splashRadius;
-  grenade->className = "hand_grenade";
+  G_SetClassName(grenade, "hand_grenade");
   grenade->spawnFlags = SPAWNFLAG_GRENADE_HAND;
   if (held)
     grenade->spawnFlags |= SPAWNFLAG_GRENADE_HELD;
@@ -951,7 +951,7 @@ gentity_t *fire_rocket(gentity_t *self, const Vector3 &start,
   rocket->splashRadius = splashRadius;
   rocket->s.sound = gi.soundIndex("weapons/rockfly.wav");
   rocket->s.renderFX |= RF_DOPPLER;
-  rocket->className = "rocket";
+  G_SetClassName(rocket, "rocket");
 
   gi.linkEntity(rocket);
 
@@ -1089,7 +1089,7 @@ void fire_rail(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
     gentity_t *exp;
 
     exp = Spawn();
-    exp->className = "railsplash";
+    G_SetClassName(exp, "railsplash");
     exp->s.origin = args.tr.endPos;
     exp->s.angles = VectorToAngles(aimDir);
     exp->clipMask = MASK_PROJECTILE;
@@ -1387,7 +1387,7 @@ void fire_bfg(gentity_t *self, const Vector3 &start, const Vector3 &dir,
   bfg->think = FreeEntity;
   bfg->splashDamage = damage;
   bfg->splashRadius = splashRadius;
-  bfg->className = "bfg blast";
+  G_SetClassName(bfg, "bfg blast");
   bfg->s.sound = gi.soundIndex("weapons/bfg__l1a.wav");
   bfg->s.renderFX |= RF_DOPPLER;
 
@@ -1438,7 +1438,7 @@ void fire_disintegrator(gentity_t *self, const Vector3 &start,
   bfg->touch = disintegrator_touch;
   bfg->nextThink = level.time + GameTime::from_sec(8000.f / speed);
   bfg->think = FreeEntity;
-  bfg->className = "disint ball";
+  G_SetClassName(bfg, "disint ball");
   bfg->s.sound = gi.soundIndex("weapons/bfg__l1a.wav");
   bfg->s.renderFX |= RF_DOPPLER;
 
@@ -1575,7 +1575,7 @@ static void SpawnThunderboltBeam(gentity_t *self, const Vector3 &start,
   if (!beam)
     return;
 
-  beam->className = "thunderbolt_beam";
+  G_SetClassName(beam, "thunderbolt_beam");
   beam->owner = self;
   beam->moveType = MoveType::None;
   beam->solid = SOLID_NOT;
@@ -1827,7 +1827,7 @@ static void disruptor_pain_daemon_spawn(gentity_t *owner, gentity_t *enemy,
     return;
 
   daemon = Spawn();
-  daemon->className = "pain daemon";
+  G_SetClassName(daemon, "pain daemon");
   daemon->think = disruptor_pain_daemon_think;
   daemon->nextThink = level.time;
   daemon->timeStamp = level.time;
@@ -1957,7 +1957,7 @@ void fire_disruptor(gentity_t *self, const Vector3 &start, const Vector3 &dir,
   bolt->enemy = enemy;
   bolt->owner = self;
   bolt->dmg = damage;
-  bolt->className = "tracker";
+  G_SetClassName(bolt, "tracker");
   gi.linkEntity(bolt);
 
   if (enemy) {
@@ -2395,7 +2395,7 @@ static TOUCH(prox_land)(gentity_t *ent, gentity_t *other, const trace_t &tr,
   trigger->moveType = MoveType::None;
   trigger->solid = SOLID_NOT; // no touch; purely radial via think
   trigger->owner = ent;       // back-pointer to the prox
-  trigger->className = "prox_trigger";
+  G_SetClassName(trigger, "prox_trigger");
   trigger->teamMaster = ent;
   trigger->timeStamp = level.time + PROX_ARMING_DELAY; // ARMED after this time
   trigger->think = Prox_TriggerThink;
@@ -2482,7 +2482,7 @@ void fire_prox(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
   prox->think = Prox_Think;
   prox->nextThink = level.time;
   prox->dmg = PROX_DAMAGE * prox_damage_multiplier;
-  prox->className = "prox_mine";
+  G_SetClassName(prox, "prox_mine");
   prox->flags |= FL_DAMAGEABLE;
   prox->flags |= FL_MECHANICAL;
 
@@ -2832,7 +2832,7 @@ void fire_nuke(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
         NUKE_RADIUS + NUKE_RADIUS * (0.25f * (float)damage_modifier);
   // this yields 1.0, 1.5, 2.0, 3.0 times radius
 
-  nuke->className = "nuke";
+  G_SetClassName(nuke, "nuke");
   nuke->die = nuke_die;
 
   gi.linkEntity(nuke);
@@ -3041,7 +3041,7 @@ static THINK(tesla_activate)(gentity_t *self)->void {
   trigger->solid = SOLID_TRIGGER;
   trigger->owner = self;
   trigger->touch = tesla_zap;
-  trigger->className = "tesla trigger";
+  G_SetClassName(trigger, "tesla trigger");
   // doesn't need to be marked as a teamslave since the move code for bounce
   // looks for teamchains
   gi.linkEntity(trigger);
@@ -3162,7 +3162,7 @@ void fire_tesla(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
   tesla->takeDamage = true;
   tesla->die = tesla_die;
   tesla->dmg = TESLA_DAMAGE * tesla_damage_multiplier;
-  tesla->className = "tesla_mine";
+  G_SetClassName(tesla, "tesla_mine");
   tesla->flags |= (FL_DAMAGEABLE | FL_TRAP);
   tesla->clipMask = (MASK_PROJECTILE | CONTENTS_SLIME | CONTENTS_LAVA) &
                     ~CONTENTS_DEADMONSTER;
@@ -3456,7 +3456,7 @@ void fire_plasmagun(gentity_t *self, const Vector3 &start, const Vector3 &dir,
   plasma->dmg = damage;
   plasma->splashDamage = splashDamage;
   plasma->splashRadius = splashRadius;
-  plasma->className = "plasma bolt";
+  G_SetClassName(plasma, "plasma bolt");
 
   gi.linkEntity(plasma);
 
@@ -3829,7 +3829,7 @@ void fire_trap(gentity_t *self, const Vector3 &start, const Vector3 &aimDir,
   trap->owner = trap->teamMaster = self;
   trap->nextThink = level.time + 1_sec;
   trap->think = Trap_Think;
-  trap->className = "food_cube_trap";
+  G_SetClassName(trap, "food_cube_trap");
   trap->s.sound = gi.soundIndex("weapons/traploop.wav");
 
   trap->flags |= (FL_DAMAGEABLE | FL_MECHANICAL | FL_TRAP);
@@ -3996,7 +3996,7 @@ void fire_homing_pod(gentity_t *self, const Vector3 &start, const Vector3 &dir,
 #endif
   // spawn projectile
   gentity_t *pod = Spawn();
-  pod->className = "vorepod";
+  G_SetClassName(pod, "vorepod");
   pod->owner = self;
   pod->solid = SOLID_BBOX;
   pod->moveType = MoveType::FlyMissile;
@@ -693,7 +693,7 @@ void SP_monster_chthon(gentity_t* self) {
                 return;
         }
 
-        self->className = "monster_chthon";
+        G_SetClassName(self, "monster_chthon");
         chthon_start(self);
 }
 
@@ -703,7 +703,7 @@ void SP_monster_lavaman(gentity_t* self) {
                 return;
         }
 
-        self->className = "monster_lavaman";
+        G_SetClassName(self, "monster_lavaman");
         self->s.scale = 0.75f;
         chthon_start(self);
 }
@@ -763,6 +763,6 @@ static USE(Use_target_chthon_lightning) (gentity_t* self, gentity_t* other, gent
 }
 
 void SP_target_chthon_lightning(gentity_t* self) {
-        self->className = "target_chthon_lightning";
+        G_SetClassName(self, "target_chthon_lightning");
         self->use = Use_target_chthon_lightning;
 }
@@ -488,7 +488,7 @@ void SP_monster_enforcer(gentity_t* self) {
 
 	enforcer_precache();
 
-	self->className = "monster_enforcer";
+	G_SetClassName(self, "monster_enforcer");
 	self->s.modelIndex = gi.modelIndex("models/monsters/enforcer/tris.md2");
 
 	enforcer_start(self);
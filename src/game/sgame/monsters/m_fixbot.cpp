@@ -138,7 +138,7 @@ static void landing_goal(gentity_t *self) {
 	gentity_t *ent;
 
 	ent = Spawn();
-	ent->className = "bot_goal";
+	G_SetClassName(ent, "bot_goal");
 	ent->solid = SOLID_BBOX;
 	ent->owner = self;
 	ent->think = bot_goal_check;
@@ -166,7 +166,7 @@ static void takeoff_goal(gentity_t *self) {
 	gentity_t *ent;
 
 	ent = Spawn();
-	ent->className = "bot_goal";
+	G_SetClassName(ent, "bot_goal");
 	ent->solid = SOLID_BBOX;
 	ent->owner = self;
 	ent->think = bot_goal_check;
@@ -229,7 +229,7 @@ void roam_goal(gentity_t *self) {
 	Vector3	 whichvec{};
 
 	ent = Spawn();
-	ent->className = "bot_goal";
+	G_SetClassName(ent, "bot_goal");
 	ent->solid = SOLID_BBOX;
 	ent->owner = self;
 	ent->think = bot_goal_check;
@@ -804,7 +804,7 @@ static void fixbot_fire_laser(gentity_t *self) {
 		self->enemy->spawnFlags = SPAWNFLAG_NONE;
 		self->enemy->monsterInfo.aiFlags &= AI_STINKY | AI_SPAWNED_MASK;
 		self->enemy->target = nullptr;
-		self->enemy->targetName = nullptr;
+		G_SetTargetName(self->enemy, nullptr);
 		self->enemy->combatTarget = nullptr;
 		self->enemy->deathTarget = nullptr;
 		self->enemy->healthTarget = nullptr;
@@ -330,7 +330,7 @@ void SP_monster_hell_knight(gentity_t* self) {
 	s_sword1.assign("knight/sword1.wav");
 	s_sword2.assign("knight/sword2.wav");
 
-	self->className = "monster_hell_knight";
+	G_SetClassName(self, "monster_hell_knight");
 	self->s.modelIndex = gi.modelIndex("models/monsters/hknight/tris.md2");
 	self->mins = HK_MINS;
 	self->maxs = HK_MAXS;
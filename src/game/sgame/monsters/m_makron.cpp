@@ -743,7 +743,7 @@ Jorg is just about dead, so set up to launch Makron out
 */
 void MakronToss(gentity_t *self) {
 	gentity_t *ent = Spawn();
-	ent->className = "monster_makron";
+	G_SetClassName(ent, "monster_makron");
 	ent->target = self->target;
 	ent->s.origin = self->s.origin;
 	ent->enemy = self->enemy;
@@ -174,7 +174,7 @@ void M_SetupReinforcements(const char *reinforcements, reinforcement_list_t &lis
 
 		gentity_t *newEnt = Spawn();
 
-		newEnt->className = r->className;
+		G_SetClassName(newEnt, r->className);
 
 		newEnt->monsterInfo.aiFlags |= AI_DO_NOT_COUNT;
 
@@ -885,7 +885,7 @@ static void medic_cable_attack(gentity_t *self) {
 		self->enemy->spawnFlags = SPAWNFLAG_NONE;
 		self->enemy->monsterInfo.aiFlags &= AI_STINKY | AI_SPAWNED_MASK;
 		self->enemy->target = nullptr;
-		self->enemy->targetName = nullptr;
+		G_SetTargetName(self->enemy, nullptr);
 		self->enemy->combatTarget = nullptr;
 		self->enemy->deathTarget = nullptr;
 		self->enemy->healthTarget = nullptr;
@@ -1025,50 +1025,120 @@ bool G_CloseEnough(gentity_t *ent, gentity_t *goal, float dist) {
 	return true;
 }
 
+namespace {
+
+struct nav_api_v1_t {
+	int (*RequestPath)(const PathRequest &request);
+	int (*PollPath)(int handle, PathInfo &info);
+	void (*CancelPath)(int handle);
+};
+
+constexpr char kNavApiV1[] = "NAV_API_V1";
+
+const nav_api_v1_t *nav_api;
+
+} // namespace
+
+/*
+=============
+M_InitNavApi
+
+Looks up the engine extension for asynchronous path requests, if it has one.
+=============
+*/
+void M_InitNavApi() {
+	nav_api = static_cast<const nav_api_v1_t *>(gi.GetExtension(kNavApiV1));
+}
+
+static void M_BuildPathRequest(gentity_t *self, float dist, PathRequest &request) {
+	if (self->enemy)
+		request.goal = self->enemy->s.origin;
+	else
+		request.goal = self->goalEntity->s.origin;
+	request.moveDist = dist;
+	if (g_debug_monster_paths->integer == 1)
+		request.debugging.drawTime = gi.frameTimeSec;
+	request.start = self->s.origin;
+	request.pathFlags = PathFlags::Walk;
+
+	if (self->monsterInfo.canJump || (self->flags & FL_FLY)) {
+		if (self->monsterInfo.jumpHeight) {
+			request.pathFlags |= PathFlags::BarrierJump;
+			request.traversals.jumpHeight = self->monsterInfo.jumpHeight;
+		}
+		if (self->monsterInfo.dropHeight) {
+			request.pathFlags |= PathFlags::WalkOffLedge;
+			request.traversals.dropHeight = self->monsterInfo.dropHeight;
+		}
+	}
+
+	if (self->flags & FL_FLY) {
+		request.nodeSearch.maxHeight = request.nodeSearch.minHeight = 8192.f;
+		request.pathFlags |= PathFlags::LongJump;
+	}
+}
+
+// returns false if pathing should be given up
+static bool M_SetPathResult(gentity_t *self, bool found) {
+	if (!found) {
+		// fatal error, don't bother ever trying nodes
+		if (self->monsterInfo.nav_path.returnCode == PathReturnCode::NoNavAvailable)
+			self->monsterInfo.aiFlags |= AI_NO_PATH_FINDING;
+		return false;
+	}
+
+	self->monsterInfo.nav_path_cache_time = level.time + 2_sec;
+	return true;
+}
+
 static bool M_NavPathToGoal(gentity_t *self, float dist, const Vector3 &goal) {
 	// mark us as *trying* now (nav_pos is valid)
 	self->monsterInfo.aiFlags |= AI_PATHING;
 
+	// pick up path requested on an earlier frame
+	if (self->monsterInfo.nav_path_request) {
+		PathInfo info;
+		int status = nav_api->PollPath(self->monsterInfo.nav_path_request, info);
+
+		if (status) {
+			self->monsterInfo.nav_path_request = 0;
+
+			if (status > 0) {
+				self->monsterInfo.nav_path = info;
+				if (!M_SetPathResult(self, info.returnCode < PathReturnCode::StartPathErrors))
+					return false;
+			}
+		}
+	}
+
 	Vector3 &path_to = (self->monsterInfo.nav_path.returnCode == PathReturnCode::TraversalPending) ?
 		self->monsterInfo.nav_path.secondMovePoint : self->monsterInfo.nav_path.firstMovePoint;
 
-	if ((self->monsterInfo.nav_path.returnCode != PathReturnCode::TraversalPending && (path_to - self->s.origin).length() <= (self->size.length() * 0.5f)) ||
-		self->monsterInfo.nav_path_cache_time <= level.time) {
+	bool reached = self->monsterInfo.nav_path.returnCode != PathReturnCode::TraversalPending &&
+		(path_to - self->s.origin).length() <= (self->size.length() * 0.5f);
+
+	if (reached || self->monsterInfo.nav_path_cache_time <= level.time) {
 		PathRequest request;
-		if (self->enemy)
-			request.goal = self->enemy->s.origin;
-		else
-			request.goal = self->goalEntity->s.origin;
-		request.moveDist = dist;
-		if (g_debug_monster_paths->integer == 1)
-			request.debugging.drawTime = gi.frameTimeSec;
-		request.start = self->s.origin;
-		request.pathFlags = PathFlags::Walk;
-
-		if (self->monsterInfo.canJump || (self->flags & FL_FLY)) {
-			if (self->monsterInfo.jumpHeight) {
-				request.pathFlags |= PathFlags::BarrierJump;
-				request.traversals.jumpHeight = self->monsterInfo.jumpHeight;
-			}
-			if (self->monsterInfo.dropHeight) {
-				request.pathFlags |= PathFlags::WalkOffLedge;
-				request.traversals.dropHeight = self->monsterInfo.dropHeight;
-			}
-		}
+		M_BuildPathRequest(self, dist, request);
 
-		if (self->flags & FL_FLY) {
-			request.nodeSearch.maxHeight = request.nodeSearch.minHeight = 8192.f;
-			request.pathFlags |= PathFlags::LongJump;
-		}
+		// if current path is still good, keep following it while
+		// a fresh one is searched for on a worker thread
+		bool async = !reached && nav_api && g_async_monster_paths->integer &&
+			!request.debugging.drawTime &&
+			self->monsterInfo.nav_path.returnCode < PathReturnCode::StartPathErrors;
 
-		if (!gi.GetPathToGoal(request, self->monsterInfo.nav_path)) {
-			// fatal error, don't bother ever trying nodes
-			if (self->monsterInfo.nav_path.returnCode == PathReturnCode::NoNavAvailable)
-				self->monsterInfo.aiFlags |= AI_NO_PATH_FINDING;
-			return false;
-		}
+		if (async && !self->monsterInfo.nav_path_request)
+			self->monsterInfo.nav_path_request = nav_api->RequestPath(request);
+
+		if (!async || !self->monsterInfo.nav_path_request) {
+			if (self->monsterInfo.nav_path_request) {
+				nav_api->CancelPath(self->monsterInfo.nav_path_request);
+				self->monsterInfo.nav_path_request = 0;
+			}
 
-		self->monsterInfo.nav_path_cache_time = level.time + 2_sec;
+			if (!M_SetPathResult(self, gi.GetPathToGoal(request, self->monsterInfo.nav_path)))
+				return false;
+		}
 	}
 
 	float yaw;
@@ -117,7 +117,7 @@ static void scrag_fire_acid(gentity_t* self, const Vector3& start, const Vector3
 	acid->nextThink = level.time + 2_sec;
 	acid->think = FreeEntity;
 	acid->dmg = damage;
-	acid->className = "scrag_acid";
+	G_SetClassName(acid, "scrag_acid");
 
 	gi.linkEntity(acid);
 
@@ -431,7 +431,7 @@ void SP_monster_wizard(gentity_t* self) {
 
 	scrag_precache();
 
-	self->className = "monster_wizard";
+	G_SetClassName(self, "monster_wizard");
 	self->s.modelIndex = gi.modelIndex("models/monsters/scrag/tris.md2");
 
 	scrag_start(self);
@@ -528,7 +528,7 @@ void SP_monster_oldone(gentity_t* self) {
 
         oldone_precache();
 
-        self->className = "monster_oldone";
+        G_SetClassName(self, "monster_oldone");
         self->s.modelIndex = gi.modelIndex("models/monsters/oldone/tris.md2");
 
         oldone_configure(self, st);
@@ -567,6 +567,6 @@ static USE(Use_target_oldone_vulnerable)
 }
 
 void SP_target_oldone_vulnerable(gentity_t* self) {
-        self->className = "target_oldone_vulnerable";
+        G_SetClassName(self, "target_oldone_vulnerable");
         self->use = Use_target_oldone_vulnerable;
 }
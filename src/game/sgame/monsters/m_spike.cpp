@@ -265,7 +265,7 @@ void SP_monster_spike(gentity_t* self) {
 
         spike_precache();
 
-        self->className = "monster_spike";
+        G_SetClassName(self, "monster_spike");
         self->moveType = MoveType::Step;
         self->solid = SOLID_BBOX;
         self->s.modelIndex = gi.modelIndex("models/monsters/spikeball/tris.md2");
@@ -222,7 +222,7 @@ void TurretAim(gentity_t *self) {
 		self->targetEnt->s.renderFX = RF_BEAM;
 		self->targetEnt->s.frame = 1;
 		self->targetEnt->s.skinNum = 0xf0f0f0f0;
-		self->targetEnt->className = "turret_lasersight";
+		G_SetClassName(self->targetEnt, "turret_lasersight");
 		self->targetEnt->s.origin = self->s.origin;
 	}
 
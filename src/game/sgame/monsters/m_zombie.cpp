@@ -111,7 +111,7 @@ namespace {
 		gib->nextThink = level.time + 2500_ms;
 		gib->think = FreeEntity;
 		gib->dmg = damage;
-		gib->className = "zombie_gib";
+		G_SetClassName(gib, "zombie_gib");
 
 		gi.linkEntity(gib);
 		return gib;
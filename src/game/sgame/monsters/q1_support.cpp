@@ -383,7 +383,7 @@ gentity_t* fire_lavaball(gentity_t* self, const Vector3& start, const Vector3& d
 	lavaball->dmg = damage;
 	lavaball->splashDamage = radiusDamage;
 	lavaball->splashRadius = damageRadius;
-	lavaball->className = "lavaball";
+	G_SetClassName(lavaball, "lavaball");
 
 	gi.linkEntity(lavaball);
 	return lavaball;
@@ -444,7 +444,7 @@ gentity_t* fire_flame(gentity_t* self, const Vector3& start, const Vector3& dir,
 	flame->think = FreeEntity;
 	flame->dmg = damage;
 	flame->style = static_cast<int>(mod);
-	flame->className = "flame";
+	G_SetClassName(flame, "flame");
 
 	gi.linkEntity(flame);
 
@@ -492,7 +492,7 @@ void fire_gib(gentity_t* self, const Vector3& start, const Vector3& aimDir, int
 	gib->nextThink = level.time + 2.5_sec;
 	gib->think = FreeEntity;
 	gib->dmg = damage;
-	gib->className = "gib";
+	G_SetClassName(gib, "gib");
 
 	gi.linkEntity(gib);
 }
@@ -519,7 +519,7 @@ void fire_plasmaball(gentity_t* self, const Vector3& start, const Vector3& dir,
 	plasma->think = FreeEntity;
 	plasma->splashDamage = damage;
 	plasma->splashRadius = damageRadius;
-	plasma->className = "plasma blast";
+	G_SetClassName(plasma, "plasma blast");
 	plasma->s.sound = gi.soundIndex("weapons/plasma__l1a.wav");
 	plasma->s.renderFX |= RF_DOPPLER;
 	plasma->teamMaster = plasma;
@@ -551,7 +551,7 @@ void fire_lightning(gentity_t* self, const Vector3& start, const Vector3& dir, i
 	bolt->nextThink = level.time + 2_sec;
 	bolt->think = FreeEntity;
 	bolt->dmg = damage;
-	bolt->className = "bolt";
+	G_SetClassName(bolt, "bolt");
 	bolt->style = static_cast<int32_t>(ModID::Thunderbolt);
 
 	gi.linkEntity(bolt);
@@ -2912,7 +2912,7 @@ void InitBodyQue() {
   level.bodyQue = 0;
   for (size_t i = 0; i < BODY_QUEUE_SIZE; i++) {
     ent = Spawn();
-    ent->className = "bodyque";
+    G_SetClassName(ent, "bodyque");
   }
 }
 
@@ -4058,7 +4058,7 @@ static inline gentity_t *ClientChooseSlot_Coop(const char *userInfo,
         matches[i].slot->solid = SOLID_BBOX;
 
         InitGEntity(matches[i].slot);
-        matches[i].slot->className = "player";
+        G_SetClassName(matches[i].slot, "player");
         worr::server::client::InitClientResp(matches[i].slot->client);
         matches[i].slot->client->coopRespawn.spawnBegin = true;
         ClientSpawn(matches[i].slot);
@@ -4068,7 +4068,7 @@ static inline gentity_t *ClientChooseSlot_Coop(const char *userInfo,
         matches[i].slot->svFlags |= SVF_PLAYER;
 
         matches[i].slot->sv.init = false;
-        matches[i].slot->className = "player";
+        G_SetClassName(matches[i].slot, "player");
         matches[i].slot->client->pers.connected = true;
         matches[i].slot->client->pers.spawned = true;
         P_AssignClientSkinNum(matches[i].slot);
@@ -16,6 +16,7 @@ targets. - Crosshair ID: Updates the stats that show the name of the player
 being aimed at.*/
 
 #include "../g_local.hpp"
+#include "../gameplay/g_frame_arena.hpp"
 #include "../gameplay/g_hud_blob.hpp"
 #include "../gameplay/g_statusbar.hpp"
 
@@ -130,8 +131,8 @@ static void SortLevelEntries() {
             });
 }
 
-static std::string HudBlob_QuoteToken(std::string_view value) {
-  std::string cleaned;
+static FrameString HudBlob_QuoteToken(std::string_view value) {
+  FrameString cleaned(G_FrameResource());
   cleaned.reserve(value.size());
   bool needs_quotes = value.empty();
 
@@ -149,7 +150,7 @@ static std::string HudBlob_QuoteToken(std::string_view value) {
   if (!needs_quotes)
     return cleaned;
 
-  std::string out;
+  FrameString out(G_FrameResource());
   out.reserve(cleaned.size() + 2);
   out.push_back('"');
   out += cleaned;
@@ -164,9 +165,9 @@ BuildEOUTableRow
 Appends a single End-of-Unit stats row to the layout.
 ===============
 */
-static void BuildEOUTableRow(std::stringstream &layout, int y,
+static void BuildEOUTableRow(FrameString &layout, int y,
                              const LevelEntry &entry) {
-  layout << G_Fmt("yv {} ", y).data();
+  fmt::format_to(std::back_inserter(layout), "yv {} ", y);
 
   const char *displayName = nullptr;
   if (entry.longMapName[0]) {
@@ -177,16 +178,17 @@ static void BuildEOUTableRow(std::stringstream &layout, int y,
     displayName = "???";
   }
 
-  layout << G_Fmt("table_row 4 \"{}\" ", displayName).data()
-         << G_Fmt("{}/{} ", entry.killedMonsters, entry.totalMonsters).data()
-         << G_Fmt("{}/{} ", entry.foundSecrets, entry.totalSecrets).data();
+  fmt::format_to(std::back_inserter(layout), "table_row 4 \"{}\" {}/{} {}/{} ",
+                 displayName, entry.killedMonsters, entry.totalMonsters,
+                 entry.foundSecrets, entry.totalSecrets);
 
   int32_t ms = entry.time.milliseconds();
   int32_t minutes = ms / 60000;
   int32_t seconds = (ms / 1000) % 60;
   int32_t milliseconds = ms % 1000;
 
-  layout << G_Fmt("{:02}:{:02}:{:03} ", minutes, seconds, milliseconds).data();
+  fmt::format_to(std::back_inserter(layout), "{:02}:{:02}:{:03} ", minutes,
+                 seconds, milliseconds);
 }
 
 /*
@@ -194,10 +196,10 @@ static void BuildEOUTableRow(std::stringstream &layout, int y,
 AddEOUTotalsRow
 ===============
 */
-static void AddEOUTotalsRow(std::stringstream &layout, int y,
+static void AddEOUTotalsRow(FrameString &layout, int y,
                             LevelEntry &totals) {
   y += 8;
-  layout << "table_row 0 ";
+  layout += "table_row 0 ";
   totals.longMapName[0] = ' ';
   BuildEOUTableRow(layout, y, totals);
 }
@@ -207,9 +209,8 @@ static void AddEOUTotalsRow(std::stringstream &layout, int y,
 BroadcastEOULayout
 ===============
 */
-static void BroadcastEOULayout(const std::stringstream &layout) {
+static void BroadcastEOULayout(FrameString &out) {
   // Finalize table rendering
-  std::string out = layout.str();
   out += "xv 160 yt 0 draw_table ";
 
   // Add intermission press button prompt (after 5 seconds)
@@ -237,14 +238,13 @@ void EndOfUnitMessage() {
   UpdateLevelEntry();
   SortLevelEntries();
 
-  std::stringstream layout;
-  layout
-      << "start_table 4 $m_eou_level $m_eou_kills $m_eou_secrets $m_eou_time ";
+  FrameString layout(G_FrameResource());
+  layout = "start_table 4 $m_eou_level $m_eou_kills $m_eou_secrets $m_eou_time ";
 
   int y = 16;
   LevelEntry totals{};
   int32_t numRows = 0;
-  std::string eou_section;
+  FrameString eou_section(G_FrameResource());
   eou_section.reserve(1024);
 
   for (auto &entry : game.levelEntries) {
@@ -1449,7 +1449,8 @@ static void SetMatchTimerStats(gentity_t *ent) {
     }
   }
 
-  std::string finalStr = G_Fmt("{}{}", s1, s2).data();
+  FrameString finalStr(G_FrameResource());
+  fmt::format_to(std::back_inserter(finalStr), "{}{}", s1, s2);
   ent->client->ps.stats[STAT_MATCH_STATE] = CONFIG_MATCH_STATE;
   gi.configString(CONFIG_MATCH_STATE, finalStr.c_str());
 }
@@ -1499,7 +1500,7 @@ void SetStats(gentity_t *ent) {
 
   const bool freezeActive = Game::Is(GameType::FreezeTag);
   bool frozen = false;
-  std::string freezeStatus;
+  FrameString freezeStatus(G_FrameResource());
 
   if (deathmatch->integer) {
     int countdown = level.countdownTimerCheck.seconds<int>();
@@ -1522,9 +1523,9 @@ void SetStats(gentity_t *ent) {
       if (ent->client->resp.thawer && ent->client->freeze.holdDeadline &&
           ent->client->freeze.holdDeadline > level.time &&
           ent->client->resp.thawer->client) {
-        freezeStatus =
-            fmt::format("Being thawed by {}",
-                        G_ColorResetAfter(ent->client->resp.thawer->client->sess.netName));
+        fmt::format_to(
+            std::back_inserter(freezeStatus), "Being thawed by {}",
+            G_ColorResetAfter(ent->client->resp.thawer->client->sess.netName));
       } else {
         freezeStatus = "Frozen - waiting for thaw";
       }
@@ -1571,7 +1572,7 @@ void SetStats(gentity_t *ent) {
                      medal != PlayerMedal::None &&
                      ent->client->pers.medalTime + 3_sec > level.time;
     const char *desired = ent->client->sess.netName;
-    std::string medalText;
+    FrameString medalText(G_FrameResource());
 
     if (showAward) {
       const auto &label = awardNames[static_cast<size_t>(medal)];
@@ -1580,7 +1581,7 @@ void SetStats(gentity_t *ent) {
         if (awardCount < 1)
           awardCount = 1;
 
-        medalText = label;
+        medalText.assign(label.data(), label.size());
         if (awardCount > 1) {
           for (char &ch : medalText) {
             if (ch >= 'a' && ch <= 'z')
@@ -1588,7 +1589,7 @@ void SetStats(gentity_t *ent) {
           }
           if (!medalText.empty() && medalText.back() != '!')
             medalText.push_back('!');
-          medalText += G_Fmt(" (x{})", awardCount).data();
+          fmt::format_to(std::back_inserter(medalText), " (x{})", awardCount);
         }
 
         desired = medalText.c_str();
@@ -19,6 +19,7 @@ different modes like FFA, Duel, and Team Deathmatch.*/
 #include <utility>
 #include <vector>
 
+#include "../gameplay/g_frame_arena.hpp"
 #include "../gameplay/g_hud_blob.hpp"
 #include "../g_local.hpp"
 
@@ -79,8 +80,8 @@ enum class PlayerEntryMode { FFA, Duel, Team };
 
 static size_t CollectActiveDuelistsByJoinTime(std::array<int, 2> &duelists);
 
-static std::string HudBlob_QuoteToken(std::string_view value) {
-  std::string cleaned;
+static FrameString HudBlob_QuoteToken(std::string_view value) {
+  FrameString cleaned(G_FrameResource());
   cleaned.reserve(value.size());
   bool needs_quotes = value.empty();
 
@@ -98,7 +99,7 @@ static std::string HudBlob_QuoteToken(std::string_view value) {
   if (!needs_quotes)
     return cleaned;
 
-  std::string out;
+  FrameString out(G_FrameResource());
   out.reserve(cleaned.size() + 2);
   out.push_back('"');
   out += cleaned;
@@ -125,7 +126,7 @@ static uint32_t BuildScoreboardFlags() {
   return flags;
 }
 
-static void AppendScoreboardRow(std::string &section, int clientNum, int score,
+static void AppendScoreboardRow(FrameString &section, int clientNum, int score,
                                 int ping, int team, uint32_t rowFlags,
                                 int skinIcon) {
   fmt::format_to(std::back_inserter(section),
@@ -133,7 +134,7 @@ static void AppendScoreboardRow(std::string &section, int clientNum, int score,
                  std::min(ping, 999), team, rowFlags, skinIcon);
 }
 
-static std::string BuildScoreboardSection() {
+static FrameString BuildScoreboardSection() {
   scoreboard_mode_t mode = SB_MODE_FFA;
   if (Teams() && Game::IsNot(GameType::RedRover))
     mode = SB_MODE_TEAM;
@@ -143,10 +144,10 @@ static std::string BuildScoreboardSection() {
   const uint32_t flags = BuildScoreboardFlags();
   const int redScore = level.teamScores[static_cast<int>(Team::Red)];
   const int blueScore = level.teamScores[static_cast<int>(Team::Blue)];
-  const std::string gametype = HudBlob_QuoteToken(level.gametype_name.data());
+  const FrameString gametype = HudBlob_QuoteToken(level.gametype_name.data());
   const bool in_progress = (level.matchState == MatchState::In_Progress);
 
-  std::string section;
+  FrameString section(G_FrameResource());
   section.reserve(1024);
   fmt::format_to(std::back_inserter(section),
                  FMT_STRING("sb_meta {} {} {} {} {} {}\n"),
@@ -167,7 +168,7 @@ static std::string BuildScoreboardSection() {
           (level.intermission.time - level.levelStartTime - 1_sec)
               .milliseconds();
       const bool showMilliseconds = (mode != SB_MODE_TEAM);
-      const std::string timeLine = HudBlob_QuoteToken(
+      const FrameString timeLine = HudBlob_QuoteToken(
           G_Fmt("Total Match Time: {}",
                 TimeString(duration, showMilliseconds, false))
               .data());
@@ -303,13 +304,16 @@ the append would exceed MAX_STRING_CHARS, leaving the layout untouched.
 ===============
 */
 template <typename... Args>
-static bool AppendFormat(std::string &layout,
+static bool AppendFormat(FrameString &layout,
                          fmt::format_string<Args...> fmtStr, Args &&...args) {
-  std::string buffer = fmt::format(fmtStr, std::forward<Args>(args)...);
-  if (layout.size() + buffer.size() > MAX_STRING_CHARS)
+  const size_t start = layout.size();
+  fmt::format_to(std::back_inserter(layout), fmtStr,
+                 std::forward<Args>(args)...);
+  if (layout.size() > MAX_STRING_CHARS) {
+    layout.resize(start);
     return false;
+  }
 
-  layout += buffer;
   return true;
 }
 
@@ -323,7 +327,7 @@ optional footer tip. Sections are omitted when insufficient room remains in the
 layout buffer.
 ===============
 */
-static void AddScoreboardHeaderAndFooter(std::string &layout, gentity_t *viewer,
+static void AddScoreboardHeaderAndFooter(FrameString &layout, gentity_t *viewer,
                                          bool includeFooter = true) {
   const char *limitLabel = "Score Limit";
   if (Game::Has(GameFlags::Rounds) || Game::Has(GameFlags::Elimination)) {
@@ -392,7 +396,7 @@ Draws queued players, passive spectators, or both.
 Used by all scoreboard modes.
 ===============
 */
-static void AddSpectatorList(std::string &layout, int startY,
+static void AddSpectatorList(FrameString &layout, int startY,
                              SpectatorListMode mode) {
   uint32_t y = startY;
   bool wroteQueued = false;
@@ -484,15 +488,15 @@ static void AddSpectatorList(std::string &layout, int startY,
   }
 }
 
-static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
+static void AddPlayerEntry(FrameString &layout, gentity_t *cl_ent, int x, int y,
                            PlayerEntryMode mode, gentity_t *viewer,
                            gentity_t *killer, bool isReady,
                            const char *flagIcon);
 
 static size_t CollectActiveDuelistsByJoinTime(
     std::array<int, 2> &duelists) {
-  std::vector<int> playing;
-  playing.reserve(2);
+  FrameVector<int> playing(G_FrameResource());
+  playing.reserve(game.maxClients);
 
   for (uint32_t i = 0; i < game.maxClients; ++i) {
     gentity_t *cl_ent = &g_entities[i + 1];
@@ -526,7 +530,7 @@ static size_t CollectActiveDuelistsByJoinTime(
   return count;
 }
 
-static int AddDuelistSummary(std::string &layout, int startY,
+static int AddDuelistSummary(FrameString &layout, int startY,
                              gentity_t *viewer, gentity_t *killer) {
   if (!Game::Has(GameFlags::OneVOne))
     return startY;
@@ -565,7 +569,7 @@ Draws a single player entry row in the scoreboard.
 Can be used by all scoreboard types.
 ===============
 */
-static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
+static void AddPlayerEntry(FrameString &layout, gentity_t *cl_ent, int x, int y,
                            PlayerEntryMode mode, gentity_t *viewer,
                            gentity_t *killer, bool isReady,
                            const char *flagIcon) {
@@ -575,7 +579,7 @@ static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
   gclient_t *cl = cl_ent->client;
   int clientNum = cl_ent->s.number - 1;
 
-  std::string entry;
+  FrameString entry(G_FrameResource());
 
   // === Tag icon ===
   if (mode == PlayerEntryMode::FFA || mode == PlayerEntryMode::Duel) {
@@ -596,9 +600,8 @@ static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
 
   // === Skin icon ===
   if (cl->sess.skinIconIndex > 0) {
-    std::string skinPath = G_Fmt("/players/{}_i", cl->sess.skinName).data();
-    fmt::format_to(std::back_inserter(entry), "xv {} yv {} picn {} ", x, y,
-                   skinPath);
+    fmt::format_to(std::back_inserter(entry), "xv {} yv {} picn /players/{}_i ",
+                   x, y, cl->sess.skinName.data());
   }
 
   // === Ready or eliminated marker ===
@@ -629,7 +632,7 @@ static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
   layout += entry;
 
   if (Game::Is(GameType::FreezeTag)) {
-    std::string extra;
+    FrameString extra(G_FrameResource());
 
     if (cl->eliminated) {
       const bool thawing = cl->resp.thawer && cl->freeze.holdDeadline &&
@@ -658,7 +661,7 @@ static void AddPlayerEntry(std::string &layout, gentity_t *cl_ent, int x, int y,
 AddTeamScoreOverlay
 ===============
 */
-[[maybe_unused]] static void AddTeamScoreOverlay(std::string &layout, const uint8_t total[2],
+[[maybe_unused]] static void AddTeamScoreOverlay(FrameString &layout, const uint8_t total[2],
                                 const uint8_t totalLiving[2], int teamsize) {
   const bool domination = Game::Is(GameType::Domination);
   const bool proBall = Game::Is(GameType::ProBall);
@@ -719,7 +722,7 @@ AddTeamPlayerEntries
 Returns the last shown index for the team.
 ===============
 */
-[[maybe_unused]] static uint8_t AddTeamPlayerEntries(std::string &layout, int teamIndex,
+[[maybe_unused]] static uint8_t AddTeamPlayerEntries(FrameString &layout, int teamIndex,
                                     const uint8_t *sorted, uint8_t total,
                                     gentity_t * /* killer */) {
   uint8_t lastShown = 0;
@@ -759,7 +762,7 @@ Returns the last shown index for the team.
 AddSpectatorEntries
 ===============
 */
-[[maybe_unused]] static void AddSpectatorEntries(std::string &layout, uint8_t lastRed,
+[[maybe_unused]] static void AddSpectatorEntries(FrameString &layout, uint8_t lastRed,
                                 uint8_t lastBlue) {
   uint32_t j = ((std::max(lastRed, lastBlue) + 3) * 8) + 42;
   uint32_t lineIndex = 0;
@@ -836,7 +839,7 @@ AddSpectatorEntries
 AddTeamSummaryLine
 ===============
 */
-[[maybe_unused]] static void AddTeamSummaryLine(std::string &layout, const uint8_t total[2],
+[[maybe_unused]] static void AddTeamSummaryLine(FrameString &layout, const uint8_t total[2],
                                const uint8_t lastShown[2]) {
   if (total[0] > lastShown[0] + 1) {
     int y = 42 + (lastShown[0] + 1) * 8;
@@ -906,8 +909,7 @@ void TeamsScoreboardMessage(gentity_t *ent, gentity_t *killer) {
       totalLiving[team]++;
   }
 
-  std::string layout;
-  layout.clear();
+  FrameString layout(G_FrameResource());
 
   fmt::format_to(std::back_inserter(layout),
                  FMT_STRING("xv 0 yv -40 cstring2 \"{} on '{}'\" "),
@@ -1113,7 +1115,7 @@ DuelScoreboardMessage
 ===============
 */
 static void DuelScoreboardMessage(gentity_t *ent, gentity_t *killer) {
-  std::string layout;
+  FrameString layout(G_FrameResource());
   AddScoreboardHeaderAndFooter(layout, ent);
   int spectatorStart = AddDuelistSummary(layout, 0, ent, killer);
   if (spectatorStart == 0)
@@ -1140,7 +1142,7 @@ void DeathmatchScoreboardMessage(gentity_t *ent, gentity_t *killer) {
   }
 
   uint8_t total = std::min<uint8_t>(level.pop.num_playing_clients, 16);
-  std::string layout;
+  FrameString layout(G_FrameResource());
 
   for (size_t i = 0; i < total; ++i) {
     uint32_t clientNum = level.sortedClients[i];
@@ -57,7 +57,7 @@ static gentity_t* PlayerTrail_Spawn(gentity_t* owner) {
 	else {
 		// spawn a new head
 		trail = Spawn();
-		trail->className = "player_trail";
+		G_SetClassName(trail, "player_trail");
 	}
 
 	// link as new head
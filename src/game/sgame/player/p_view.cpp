@@ -959,7 +959,7 @@ static void UpdateShellLight(gentity_t* ent) {
 
 	if (!light) {
 		light = Spawn();
-		light->className = "player_shell_light";
+		G_SetClassName(light, "player_shell_light");
 		light->s.modelIndex = 1;
 		light->s.renderFX = RF_CUSTOM_LIGHT;
 		light->solid = SOLID_NOT;
@@ -213,7 +213,7 @@ void G_PlayerNoise(gentity_t *who, const Vector3 &where, PlayerNoise type) {
   if (!who->myNoise) {
     auto createNoise = [who]() {
       gentity_t *noise = Spawn();
-      noise->className = "player_noise";
+      G_SetClassName(noise, "player_noise");
       noise->mins = {-8, -8, -8};
       noise->maxs = {8, 8, 8};
       noise->owner = who;
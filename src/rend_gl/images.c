@@ -71,11 +71,34 @@ static bool check_image_size(unsigned w, unsigned h)
     return (w < 1 || h < 1 || w > MAX_TEXTURE_SIZE || h > MAX_TEXTURE_SIZE);
 }
 
+// set while decoding on preload worker, where pixels are malloc'd and
+// warnings can't be printed
+static q_thread_local bool img_on_worker;
+static q_thread_local bool img_warned;
+
 static void *img_alloc_pixels(size_t size)
 {
+    if (img_on_worker)
+        return malloc(size);
     return IMG_AllocPixels(size);
 }
 
+static void img_free_pixels(void *pixels)
+{
+    if (img_on_worker)
+        free(pixels);
+    else
+        IMG_FreePixels(pixels);
+}
+
+// worker result is discarded then, main thread decodes again and prints
+static bool img_defer_warning(void)
+{
+    if (img_on_worker)
+        img_warned = true;
+    return img_on_worker;
+}
+
 /*
 ====================================================================
 
@@ -290,8 +313,13 @@ static int load_pcx(const byte *rawdata, size_t rawlen,
         SZ_InitRead(&s, rawdata, rawlen);
         s.readcount = offsetof(dpcx_t, data);
 
-        out = pixels = IMG_AllocPixels(w * h * (is_pal ? 1 : 4));
-        scanline = IMG_AllocPixels(bytes_per_scanline);
+        out = pixels = img_alloc_pixels(w * h * (is_pal ? 1 : 4));
+        scanline = img_alloc_pixels(bytes_per_scanline);
+        if (!pixels || !scanline) {
+            img_free_pixels(pixels);
+            img_free_pixels(scanline);
+            return Q_ERR(ENOMEM);
+        }
 
         for (int y = 0; y < h; y++) {
             ret = uncompress_pcx(&s, bytes_per_scanline, scanline);
@@ -310,27 +338,32 @@ static int load_pcx(const byte *rawdata, size_t rawlen,
             }
         }
 
-        IMG_FreePixels(scanline);
+        img_free_pixels(scanline);
 
         if (ret < 0) {
-            IMG_FreePixels(pixels);
+            img_free_pixels(pixels);
             return ret;
         }
 
         if (is_pal) {
-            if (SZ_Remaining(&s) < PCX_PALETTE_SIZE)
+            if (SZ_Remaining(&s) < PCX_PALETTE_SIZE && !img_defer_warning())
                 Com_WPrintf("PCX file %s possibly corrupted\n", image->name);
 
             if (image->type == IT_SKIN)
                 IMG_FloodFill(pixels, w, h);
 
-            *pic = IMG_AllocPixels(w * h * 4);
+            *pic = img_alloc_pixels(w * h * 4);
+            if (!*pic) {
+                img_free_pixels(pixels);
+                return Q_ERR(ENOMEM);
+            }
 
             image->flags |= IMG_Unpack8((uint32_t *)*pic, pixels, w, h);
 
-            IMG_FreePixels(pixels);
+            img_free_pixels(pixels);
         } else {
-            Com_DWPrintf("%s is a 24-bit PCX file. This is not portable.\n", image->name);
+            if (!img_defer_warning())
+                Com_DWPrintf("%s is a 24-bit PCX file. This is not portable.\n", image->name);
             *pic = pixels;
             image->flags |= IF_OPAQUE;
         }
@@ -378,7 +411,9 @@ IMG_LOAD(WAL)
         return Q_ERR_INVALID_FORMAT;
     }
 
-    *pic = IMG_AllocPixels(w * h * 4);
+    *pic = img_alloc_pixels(w * h * 4);
+    if (!*pic)
+        return Q_ERR(ENOMEM);
 
     image->upload_width = image->width = w;
     image->upload_height = image->height = h;
@@ -674,7 +709,9 @@ IMG_LOAD(TGA)
     }
 
     stride = w * 4;
-    start = pixels = IMG_AllocPixels(h * stride);
+    start = pixels = img_alloc_pixels(h * stride);
+    if (!pixels)
+        return Q_ERR(ENOMEM);
 
     if (!(attributes & TGA_TOPTOBOTTOM)) {
         start += (h - 1) * stride;
@@ -696,7 +733,7 @@ IMG_LOAD(TGA)
     else
         ret = tga_decode_raw(&s, row_pointers, w, h, bpp, pal);
     if (ret < 0) {
-        IMG_FreePixels(pixels);
+        img_free_pixels(pixels);
         return ret;
     }
 
@@ -788,7 +825,7 @@ static void my_output_message_2(j_common_ptr cinfo, bool err_exit)
 
     if (err_exit)
         Com_SetLastError(buffer);
-    else
+    else if (!img_defer_warning())
         Com_WPrintf("libjpeg: %s: %s\n", jerr->filename, buffer);
 }
 
@@ -875,14 +912,18 @@ IMG_LOAD(JPG)
     image->flags |= IF_OPAQUE;
 
     rowbytes = cinfo.output_width * 4;
-    pixels = IMG_AllocPixels(cinfo.output_height * rowbytes);
+    pixels = img_alloc_pixels(cinfo.output_height * rowbytes);
+    if (!pixels) {
+        ret = Q_ERR(ENOMEM);
+        goto fail;
+    }
 
     for (row = 0; row < cinfo.output_height; row++)
         row_pointers[row] = (JSAMPROW)(pixels + row * rowbytes);
 
     ret = my_jpeg_finish_decompress(&cinfo, row_pointers);
     if (ret < 0) {
-        IMG_FreePixels(pixels);
+        img_free_pixels(pixels);
         goto fail;
     }
 
@@ -991,7 +1032,7 @@ static void my_png_warning_fn(png_structp png_ptr, png_const_charp warning_msg)
 {
     my_png_error *err = png_get_error_ptr(png_ptr);
 
-    if (err->filename)
+    if (err->filename && !img_defer_warning())
         Com_WPrintf("libpng: %s: %s\n", err->filename, warning_msg);
 }
 
@@ -1109,14 +1150,18 @@ IMG_LOAD(PNG)
 
     h = image->height;
     rowbytes = image->width * 4;
-    pixels = IMG_AllocPixels(h * rowbytes);
+    pixels = img_alloc_pixels(h * rowbytes);
+    if (!pixels) {
+        ret = Q_ERR(ENOMEM);
+        goto fail;
+    }
 
     for (row = 0; row < h; row++)
         row_pointers[row] = (png_bytep)(pixels + row * rowbytes);
 
     ret = my_png_read_image(png_ptr, info_ptr, row_pointers);
     if (ret < 0) {
-        IMG_FreePixels(pixels);
+        img_free_pixels(pixels);
         goto fail;
     }
 
@@ -1224,9 +1269,12 @@ IMG_LOAD(PNG)
     }
 
     size = (size_t)w * (size_t)h * 4u;
-    pixels = IMG_AllocPixels(size);
-    memcpy(pixels, data, size);
+    pixels = img_alloc_pixels(size);
+    if (pixels)
+        memcpy(pixels, data, size);
     stbi_image_free(data);
+    if (!pixels)
+        return Q_ERR(ENOMEM);
 
     image->upload_width = image->width = w;
     image->upload_height = image->height = h;
@@ -1900,13 +1948,134 @@ static image_t *lookup_image(const char *name,
     return NULL;
 }
 
+/*
+=================
+IMG_DecodeAhead
+
+Runs on preload worker for images client queued with r_image_decoder, with
+image type passed as argument. Anything that would print is decoded again
+on main thread.
+=================
+*/
+typedef struct {
+    imagetype_t     type;
+    imageflags_t    flags;
+    int             width, height;
+    int             upload_width, upload_height;
+    byte            *pic;
+} decoded_image_t;
+
+static void *IMG_DecodeAhead(const char *path, const void *data, size_t len,
+                             void *arg, size_t *size)
+{
+    image_t         image = { .type = (imagetype_t)(intptr_t)arg };
+    decoded_image_t *d;
+    imageformat_t   fmt;
+    const char      *ext;
+    byte            *pic = NULL;
+    int             ret;
+
+    ext = COM_FileExtension(path);
+    if (*ext != '.')
+        return NULL;
+
+    for (fmt = 0; fmt < IM_MAX; fmt++)
+        if (!Q_stricmp(ext + 1, img_loaders[fmt].ext))
+            break;
+    if (fmt == IM_MAX)
+        return NULL;
+
+    Q_strlcpy(image.name, path, sizeof(image.name));
+
+    img_on_worker = true;
+    img_warned = false;
+    ret = img_loaders[fmt].load(data, len, &image, &pic);
+    img_on_worker = false;
+
+    if (ret < 0)
+        return NULL;
+
+    d = img_warned ? NULL : malloc(sizeof(*d));
+    if (!d) {
+        free(pic);
+        return NULL;
+    }
+
+    d->type = image.type;
+    d->flags = image.flags;
+    d->width = image.width;
+    d->height = image.height;
+    d->upload_width = image.upload_width;
+    d->upload_height = image.upload_height;
+    d->pic = pic;
+
+    *size = sizeof(*d) + (size_t)d->upload_width * d->upload_height * 4;
+    return d;
+}
+
+static void IMG_FreeDecoded(void *decoded)
+{
+    decoded_image_t *d = decoded;
+
+    free(d->pic);
+    free(d);
+}
+
+const fs_decoder_t r_image_decoder = {
+    .decode = IMG_DecodeAhead,
+    .free = IMG_FreeDecoded,
+};
+
+// pic handed out from decoded image is malloc'd, only one at once
+static byte *img_decoded_pic;
+
+static void img_free_pic(byte *pic)
+{
+    if (pic && pic == img_decoded_pic) {
+        free(pic);
+        img_decoded_pic = NULL;
+    } else {
+        Z_Free(pic);
+    }
+}
+
+static bool try_decoded_image(image_t *image, byte **pic)
+{
+    decoded_image_t *d;
+
+    if (img_decoded_pic)
+        return false;
+
+    d = FS_ClaimDecoded(image->name, &r_image_decoder);
+    if (!d)
+        return false;
+
+    if (d->type != image->type) {
+        IMG_FreeDecoded(d);
+        return false;
+    }
+
+    image->flags |= d->flags;
+    image->width = d->width;
+    image->height = d->height;
+    image->upload_width = d->upload_width;
+    image->upload_height = d->upload_height;
+    *pic = img_decoded_pic = d->pic;
+    free(d);
+    return true;
+}
+
 static int try_image_format(imageformat_t fmt, image_t *image, byte **pic)
 {
     void    *data;
     int     ret;
 
-    // load the file
-    ret = FS_LoadFile(image->name, &data);
+    // upload only if preload worker decoded it already
+    if (try_decoded_image(image, pic))
+        return fmt;
+
+    // load the file, decoders don't modify it
+    ret = FS_LoadFileFlags(image->name, &data, FS_FLAG_MMAP);
     if (!data)
         return ret;
 
@@ -2169,7 +2338,7 @@ static void check_for_glow_map(image_t *image)
     IMG_Load(&temporary, glow_pic);
     image->texnum2 = temporary.texnum;
 
-    Z_Free(glow_pic);
+    img_free_pic(glow_pic);
 }
 
 static void load_special_image(image_t *image, byte **pic) {
@@ -2375,7 +2544,7 @@ static image_t *find_or_load_image(const char *name, size_t len,
     }
 
     // don't need pics in memory after GL upload
-    Z_Free(pic);
+    img_free_pic(pic);
 
     return image;
 
@@ -768,24 +768,27 @@ static void MOD_PrintError(const char *path, int err)
 
 #include <setjmp.h>
 
-#include "common/json.h"
+#include "renderer/md5_cache.h"
+
+_Static_assert(sizeof(md5_vertex_t) == sizeof(md5c_vertex_t), "MD5 vertex layout mismatch");
+_Static_assert(sizeof(maliastc_t) == sizeof(md5c_tcoord_t), "MD5 tcoord layout mismatch");
+_Static_assert(sizeof(md5_weight_t) == sizeof(md5c_weight_t), "MD5 weight layout mismatch");
+_Static_assert(sizeof(md5_joint_t) == sizeof(md5c_joint_t), "MD5 joint layout mismatch");
 
 static jmp_buf md5_jmpbuf;
 
 q_noreturn
-static void MD5_ParseError(const char *text)
+static void MD5_Error(const char *text)
 {
-    Com_SetLastError(va("Line %u: %s", com_linenum, text));
+    Com_SetLastError(text);
     longjmp(md5_jmpbuf, -1);
 }
 
 static void *MD5_HunkAlloc(memhunk_t *hunk, size_t size)
 {
     void *ptr = Hunk_TryAlloc(hunk, size, gl_static.hunk_align);
-    if (!ptr) {
-        Com_SetLastError("Out of memory");
-        longjmp(md5_jmpbuf, -1);
-    }
+    if (!ptr)
+        MD5_Error("Out of memory");
     return ptr;
 }
 
@@ -798,571 +801,50 @@ static void *MD5_HunkAlloc(memhunk_t *hunk, size_t size)
 #define MD5_CpuMalloc(size) \
     (gl_static.use_gpu_lerp ? R_Mallocz(size) : MD5_HunkAlloc(&model->hunk, size))
 
-static void MD5_ParseExpect(const char **buffer, const char *expect)
-{
-    char *token = COM_Parse(buffer);
-
-    if (strcmp(token, expect))
-        MD5_ParseError(va("Expected \"%s\", got \"%s\"", expect, Com_MakePrintable(token)));
-}
-
-static float MD5_ParseFloat(const char **buffer)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr;
-
-    float v = strtof(token, &endptr);
-    if (endptr == token || *endptr)
-        MD5_ParseError(va("Expected float, got \"%s\"", Com_MakePrintable(token)));
-
-    return v;
-}
-
-static uint32_t MD5_ParseUint(const char **buffer, uint32_t min_v, uint32_t max_v)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr;
-
-    unsigned long v = strtoul(token, &endptr, 10);
-    if (endptr == token || *endptr)
-        MD5_ParseError(va("Expected uint, got \"%s\"", Com_MakePrintable(token)));
-    if (v < min_v || v > max_v)
-        MD5_ParseError(va("Value out of range: %lu", v));
-
-    return v;
-}
-
-static int32_t MD5_ParseInt(const char **buffer, int32_t min_v, int32_t max_v)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr;
-
-    long v = strtol(token, &endptr, 10);
-    if (endptr == token || *endptr)
-        MD5_ParseError(va("Expected int, got \"%s\"", Com_MakePrintable(token)));
-    if (v < min_v || v > max_v)
-        MD5_ParseError(va("Value out of range: %ld", v));
-
-    return v;
-}
-
-static void MD5_ParseVector(const char **buffer, vec3_t output)
-{
-    MD5_ParseExpect(buffer, "(");
-    output[0] = MD5_ParseFloat(buffer);
-    output[1] = MD5_ParseFloat(buffer);
-    output[2] = MD5_ParseFloat(buffer);
-    MD5_ParseExpect(buffer, ")");
-}
-
-typedef struct {
-    vec3_t pos;
-    quat_t orient;
-} baseframe_joint_t;
-
-static void MD5_ComputeNormals(md5_mesh_t *mesh, const baseframe_joint_t *base_skeleton)
-{
-    vec3_t finalVerts[TESS_MAX_VERTICES];
-    md5_vertex_t *vert;
-    int i, j;
-
-    hash_map_t *pos_to_normal_map = HashMap_Create(vec3_t, vec3_t, &HashVec3, NULL);
-    HashMap_Reserve(pos_to_normal_map, mesh->num_verts);
-
-    for (i = 0, vert = mesh->vertices; i < mesh->num_verts; i++, vert++) {
-        /* Calculate final vertex to draw with weights */
-        VectorClear(finalVerts[i]);
-
-        for (j = 0; j < vert->count; j++) {
-            const md5_weight_t *weight = &mesh->weights[vert->start + j];
-            const baseframe_joint_t *joint = &base_skeleton[mesh->jointnums[vert->start + j]];
-
-            /* Calculate transformed vertex for this weight */
-            vec3_t wv;
-            Quat_RotatePoint(joint->orient, weight->pos, wv);
-
-            /* The sum of all weight->bias should be 1.0 */
-            VectorAdd(joint->pos, wv, wv);
-            VectorMA(finalVerts[i], weight->bias, wv, finalVerts[i]);
-        }
-    }
-
-    for (i = 0; i < mesh->num_indices; i += 3) {
-        vec3_t xyz[3];
-
-        for (j = 0; j < 3; j++)
-            VectorCopy(finalVerts[mesh->indices[i + j]], xyz[j]);
-
-        vec3_t d1, d2;
-        VectorSubtract(xyz[2], xyz[0], d1);
-        VectorSubtract(xyz[1], xyz[0], d2);
-        VectorNormalize(d1);
-        VectorNormalize(d2);
-
-        vec3_t norm;
-        CrossProduct(d1, d2, norm);
-        VectorNormalize(norm);
-
-        float angle = acosf(DotProduct(d1, d2));
-        VectorScale(norm, angle, norm);
-
-        for (j = 0; j < 3; j++) {
-            vec3_t *found_normal;
-            if ((found_normal = HashMap_Lookup(vec3_t, pos_to_normal_map, &xyz[j])))
-                VectorAdd(*found_normal, norm, *found_normal);
-            else
-                HashMap_Insert(pos_to_normal_map, &xyz[j], &norm);
-        }
-    }
-
-    uint32_t map_size = HashMap_Size(pos_to_normal_map);
-    for (i = 0; i < map_size; i++) {
-        vec3_t *norm = HashMap_GetValue(vec3_t, pos_to_normal_map, i);
-        VectorNormalize(*norm);
-    }
-
-    for (i = 0, vert = mesh->vertices; i < mesh->num_verts; i++, vert++) {
-        VectorClear(vert->normal);
-        vec3_t *norm = HashMap_Lookup(vec3_t, pos_to_normal_map, &finalVerts[i]);
-        if (norm) {
-            // Put the bind-pose normal into joint-local space
-            // so the animated normal can be computed faster later.
-            // Done by transforming the vertex normal by the inverse
-            // joint's orientation quaternion of the weight.
-            for (j = 0; j < vert->count; j++) {
-                const md5_weight_t *weight = &mesh->weights[vert->start + j];
-                const baseframe_joint_t *joint = &base_skeleton[mesh->jointnums[vert->start + j]];
-                vec3_t wv;
-                quat_t orient_inv;
-                Quat_Conjugate(joint->orient, orient_inv);
-                Quat_RotatePoint(orient_inv, *norm, wv);
-                VectorMA(vert->normal, weight->bias, wv, vert->normal);
-            }
-        }
-    }
-
-    HashMap_Destroy(pos_to_normal_map);
-}
+#define MD5_Copy(size, ofs) \
+    memcpy(MD5_GpuMalloc(size), MD5C_DATA(hdr, ofs), size)
 
-static bool MD5_ParseMesh(model_t *model, const char *s, const char *path)
+/**
+ * Copy compiled MD5 model into renderer allocations.
+ */
+static bool MD5_LoadCompiled(model_t *model, const md5c_header_t *hdr)
 {
-    baseframe_joint_t base_skeleton[MD5_MAX_JOINTS];
+    const md5c_mesh_t *src = MD5C_DATA(hdr, hdr->ofs_meshes);
     md5_model_t *mdl;
-    int i, j, k;
+    size_t size;
 
     if (setjmp(md5_jmpbuf))
         return false;
 
-    com_linenum = 1;
-
-    // parse header
-    MD5_ParseExpect(&s, "MD5Version");
-    MD5_ParseExpect(&s, "10");
-
     model->skeleton = mdl = MD5_CpuMalloc(sizeof(*mdl));
-
-    MD5_ParseExpect(&s, "commandline");
-    COM_SkipToken(&s);
-
-    MD5_ParseExpect(&s, "numJoints");
-    mdl->num_joints = MD5_ParseUint(&s, 1, MD5_MAX_JOINTS);
-
-    MD5_ParseExpect(&s, "numMeshes");
-    mdl->num_meshes = MD5_ParseUint(&s, 1, MD5_MAX_MESHES);
-
-    MD5_ParseExpect(&s, "joints");
-    MD5_ParseExpect(&s, "{");
-
-    for (i = 0; i < mdl->num_joints; i++) {
-        baseframe_joint_t *joint = &base_skeleton[i];
-
-        // skip name
-        COM_SkipToken(&s);
-
-        // skip parent
-        COM_SkipToken(&s);
-
-        MD5_ParseVector(&s, joint->pos);
-        MD5_ParseVector(&s, joint->orient);
-
-        Quat_ComputeW(joint->orient);
-    }
-
-    MD5_ParseExpect(&s, "}");
+    mdl->num_meshes = hdr->num_meshes;
+    mdl->num_joints = hdr->num_joints;
+    mdl->num_frames = hdr->num_frames;
 
     mdl->meshes = MD5_CpuMalloc(mdl->num_meshes * sizeof(mdl->meshes[0]));
-    for (i = 0; i < mdl->num_meshes; i++) {
+    for (int i = 0; i < mdl->num_meshes; i++, src++) {
         md5_mesh_t *mesh = &mdl->meshes[i];
 
-        MD5_ParseExpect(&s, "mesh");
-        MD5_ParseExpect(&s, "{");
-
-        MD5_ParseExpect(&s, "shader");
-        COM_SkipToken(&s);
-
-        MD5_ParseExpect(&s, "numverts");
-        mesh->num_verts = MD5_ParseUint(&s, 0, TESS_MAX_VERTICES);
-        mesh->vertices  = MD5_GpuMalloc(mesh->num_verts * sizeof(mesh->vertices[0]));
-        mesh->tcoords   = MD5_GpuMalloc(mesh->num_verts * sizeof(mesh->tcoords [0]));
-
-        for (j = 0; j < mesh->num_verts; j++) {
-            MD5_ParseExpect(&s, "vert");
-
-            uint32_t vert_index = MD5_ParseUint(&s, 0, mesh->num_verts - 1);
-
-            maliastc_t *tc = &mesh->tcoords[vert_index];
-            MD5_ParseExpect(&s, "(");
-            tc->st[0] = MD5_ParseFloat(&s);
-            tc->st[1] = MD5_ParseFloat(&s);
-            MD5_ParseExpect(&s, ")");
-
-            md5_vertex_t *vert = &mesh->vertices[vert_index];
-            vert->start = MD5_ParseUint(&s, 0, UINT16_MAX);
-            vert->count = MD5_ParseUint(&s, 0, UINT16_MAX);
-        }
-
-        MD5_ParseExpect(&s, "numtris");
-        uint32_t num_tris = MD5_ParseUint(&s, 0, TESS_MAX_INDICES / 3);
-        mesh->indices = MD5_GpuMallocIndices(num_tris * 3 * sizeof(mesh->indices[0]));
-        mesh->num_indices = num_tris * 3;
-
-        for (j = 0; j < num_tris; j++) {
-            MD5_ParseExpect(&s, "tri");
-            uint32_t tri_index = MD5_ParseUint(&s, 0, num_tris - 1);
-            for (k = 0; k < 3; k++)
-                mesh->indices[tri_index * 3 + k] = MD5_ParseUint(&s, 0, mesh->num_verts - 1);
-            }
-
-        MD5_ParseExpect(&s, "numweights");
-        mesh->num_weights = MD5_ParseUint(&s, 0, MD5_MAX_WEIGHTS);
-        mesh->weights     = MD5_GpuMalloc(mesh->num_weights * sizeof(mesh->weights  [0]));
-        mesh->jointnums   = MD5_GpuMalloc(mesh->num_weights * sizeof(mesh->jointnums[0]));
+        if (src->num_verts > TESS_MAX_VERTICES || src->num_indices > TESS_MAX_INDICES)
+            MD5_Error("Too many vertices");
 
-        for (j = 0; j < mesh->num_weights; j++) {
-            MD5_ParseExpect(&s, "weight");
+        mesh->num_verts = src->num_verts;
+        mesh->num_indices = src->num_indices;
+        mesh->num_weights = src->num_weights;
 
-            uint32_t weight_index = MD5_ParseUint(&s, 0, mesh->num_weights - 1);
-            mesh->jointnums[weight_index] = MD5_ParseUint(&s, 0, mdl->num_joints - 1);
-
-            md5_weight_t *weight = &mesh->weights[weight_index];
-            weight->bias = MD5_ParseFloat(&s);
-            MD5_ParseVector(&s, weight->pos);
-        }
-
-        MD5_ParseExpect(&s, "}");
-
-        // check integrity of data; this has to be done last
-        // because of circular data dependencies
-        for (j = 0; j < mesh->num_verts; j++) {
-            md5_vertex_t *vert = &mesh->vertices[j];
-            if (vert->start + vert->count > mesh->num_weights)
-                MD5_ParseError("Bad vert start/count");
-        }
+        mesh->vertices  = MD5_Copy(mesh->num_verts   * sizeof(mesh->vertices [0]), src->ofs_vertices);
+        mesh->tcoords   = MD5_Copy(mesh->num_verts   * sizeof(mesh->tcoords  [0]), src->ofs_tcoords);
+        mesh->weights   = MD5_Copy(mesh->num_weights * sizeof(mesh->weights  [0]), src->ofs_weights);
+        mesh->jointnums = MD5_Copy(mesh->num_weights * sizeof(mesh->jointnums[0]), src->ofs_jointnums);
 
-        MD5_ComputeNormals(mesh, base_skeleton);
+        size = mesh->num_indices * sizeof(mesh->indices[0]);
+        mesh->indices = MD5_GpuMallocIndices(size);
+        memcpy(mesh->indices, MD5C_DATA(hdr, src->ofs_indices), size);
     }
 
-    return true;
-}
-
-typedef struct {
-    char name[MD5_MAX_JOINTNAME];
-    int parent, flags, start_index;
-    bool scale_pos;
-} joint_info_t;
-
-#define MD5_NUM_ANIMATED_COMPONENT_BITS 6
-
-/**
- * Build skeleton for a given frame data.
- */
-static void MD5_BuildFrameSkeleton(const joint_info_t *joint_infos,
-                                   const baseframe_joint_t *base_frame,
-                                   const float *anim_frame_data,
-                                   md5_joint_t *skeleton_frame,
-                                   int num_joints)
-{
-    for (int i = 0; i < num_joints; i++) {
-        const baseframe_joint_t *baseJoint = &base_frame[i];
-        float components[7];
-
-        float *animated_position = components + 0;
-        float *animated_quat = components + 3;
-
-        VectorCopy(baseJoint->pos, animated_position);
-        VectorCopy(baseJoint->orient, animated_quat); // W will be re-calculated below
-
-        for (int c = 0, j = 0; c < MD5_NUM_ANIMATED_COMPONENT_BITS; c++)
-            if (joint_infos[i].flags & BIT(c))
-                components[c] = anim_frame_data[joint_infos[i].start_index + j++];
-
-        Quat_ComputeW(animated_quat);
-
-        md5_joint_t *thisJoint = &skeleton_frame[i];
-
-        if (joint_infos[i].scale_pos)
-            VectorScale(animated_position, thisJoint->scale, animated_position);
-
-        int parent = joint_infos[i].parent;
-        if (parent < 0) {
-            VectorCopy(animated_position, thisJoint->pos);
-            Vector4Copy(animated_quat, thisJoint->orient);
-            Quat_ToAxis(thisJoint->orient, thisJoint->axis);
-            continue;
-        }
-
-        // parent should already be calculated
-        Q_assert(parent < i);
-        const md5_joint_t *parentJoint = &skeleton_frame[parent];
-
-        // add positions
-        vec3_t rotated_pos;
-        Quat_RotatePoint(parentJoint->orient, animated_position, rotated_pos);
-        VectorAdd(rotated_pos, parentJoint->pos, thisJoint->pos);
-
-        // concat rotations
-        Quat_MultiplyQuat(parentJoint->orient, animated_quat, thisJoint->orient);
-        Quat_Normalize(thisJoint->orient);
-
-        Quat_ToAxis(thisJoint->orient, thisJoint->axis);
-    }
-}
-
-/**
- * Parse some JSON vomit. Don't ask.
- */
-static void MD5_LoadScales(const md5_model_t *model, const char *path, joint_info_t *joint_infos)
-{
-    const jsmntok_t *tok, *end;
-    jsmn_parser parser;
-    jsmntok_t tokens[4096];
-    char *data;
-    int len, ret;
-
-    len = FS_LoadFile(path, (void **)&data);
-    if (!data) {
-        if (len != Q_ERR(ENOENT))
-            MOD_PrintError(path, len);
-        return;
-    }
-
-    jsmn_init(&parser);
-    ret = jsmn_parse(&parser, data, len, tokens, q_countof(tokens));
-    if (ret < 0)
-        goto fail;
-    if (ret == 0)
-        goto skip;
-
-    tok = &tokens[0];
-    if (tok->type != JSMN_OBJECT)
-        goto fail;
-
-    end = tokens + ret;
-    tok++;
-
-    while (tok < end) {
-        if (tok->type != JSMN_STRING)
-            goto fail;
-
-        int joint_id = -1;
-        const char *joint_name = data + tok->start;
-
-        data[tok->end] = 0;
-        for (int i = 0; i < model->num_joints; i++) {
-            if (!strcmp(joint_name, joint_infos[i].name)) {
-                joint_id = i;
-                break;
-            }
-        }
-
-        if (joint_id == -1)
-            Com_WPrintf("No such joint \"%s\" in %s\n", Com_MakePrintable(joint_name), path);
-
-        if (++tok == end || tok->type != JSMN_OBJECT)
-            goto fail;
-
-        int num_keys = tok->size;
-        if (end - ++tok < num_keys * 2)
-            goto fail;
-
-        for (int i = 0; i < num_keys; i++) {
-            const jsmntok_t *key = tok++;
-            const jsmntok_t *val = tok++;
-            if (key->type != JSMN_STRING || val->type != JSMN_PRIMITIVE)
-                goto fail;
-
-            if (joint_id == -1)
-                continue;
-
-            data[key->end] = 0;
-            if (!strcmp(data + key->start, "scale_positions")) {
-                joint_infos[joint_id].scale_pos = data[val->start] == 't';
-            } else {
-                unsigned frame_id = Q_atoi(data + key->start);
-                if (frame_id < model->num_frames)
-                    model->skeleton_frames[frame_id * model->num_joints + joint_id].scale = Q_atof(data + val->start);
-                else
-                    Com_WPrintf("No such frame %d in %s\n", frame_id, path);
-            }
-        }
-    }
-
-skip:
-    FS_FreeFile(data);
-    return;
-
-fail:
-    Com_EPrintf("Couldn't load %s: Invalid JSON data\n", path);
-    FS_FreeFile(data);
-}
-
-/**
- * Load an MD5 animation from file.
- */
-static bool MD5_ParseAnim(model_t *model, const char *s, const char *path)
-{
-    joint_info_t joint_infos[MD5_MAX_JOINTS];
-    baseframe_joint_t base_frame[MD5_MAX_JOINTS];
-    float anim_frame_data[MD5_MAX_JOINTS * MD5_NUM_ANIMATED_COMPONENT_BITS];
-    int num_joints, num_animated_components;
-    md5_model_t *mdl = model->skeleton;
-    int i, j;
-
-    if (setjmp(md5_jmpbuf))
-        return false;
-
-    com_linenum = 1;
-
-    // parse header
-    MD5_ParseExpect(&s, "MD5Version");
-    MD5_ParseExpect(&s, "10");
-
-    MD5_ParseExpect(&s, "commandline");
-    COM_SkipToken(&s);
-
-    MD5_ParseExpect(&s, "numFrames");
-    // MD5 replacements need at least 1 frame, because the
-    // pose frame isn't used
-    mdl->num_frames = MD5_ParseUint(&s, 1, MD5_MAX_FRAMES);
-
-    // warn on mismatched frame counts (not fatal)
-    if (mdl->num_frames < model->numframes)
-        Com_WPrintf("%s has less frames than %s (%i < %i)\n", path,
-                    model->name, mdl->num_frames, model->numframes);
-
-    MD5_ParseExpect(&s, "numJoints");
-    num_joints = MD5_ParseUint(&s, 1, MD5_MAX_JOINTS);
-    if (num_joints != mdl->num_joints)
-        MD5_ParseError("Bad numJoints");
-
-    MD5_ParseExpect(&s, "frameRate");
-    COM_SkipToken(&s);
-
-    MD5_ParseExpect(&s, "numAnimatedComponents");
-    num_animated_components = MD5_ParseUint(&s, 0, q_countof(anim_frame_data));
-
-    MD5_ParseExpect(&s, "hierarchy");
-    MD5_ParseExpect(&s, "{");
-
-    for (i = 0; i < mdl->num_joints; i++) {
-        joint_info_t *joint_info = &joint_infos[i];
-
-        COM_ParseToken(&s, joint_info->name, sizeof(joint_info->name), PARSE_FLAG_NONE);
-
-        joint_info->parent      = MD5_ParseInt (&s, -1, mdl->num_joints - 1);
-        joint_info->flags       = MD5_ParseUint(&s,  0, UINT32_MAX);
-        joint_info->start_index = MD5_ParseUint(&s,  0, num_animated_components);
-        joint_info->scale_pos = false;
-
-        // validate animated components
-        int num_components = 0;
-
-        for (j = 0; j < MD5_NUM_ANIMATED_COMPONENT_BITS; j++)
-            if (joint_info->flags & BIT(j))
-                num_components++;
-
-        if (joint_info->start_index + num_components > num_animated_components)
-            MD5_ParseError("Bad joint info");
-
-        // parent must be -1 or already processed joint
-        if (joint_info->parent >= i)
-            MD5_ParseError("Bad parent joint");
-    }
-
-    MD5_ParseExpect(&s, "}");
-
-    // bounds are ignored and are apparently usually wrong anyways
-    // so we'll just rely on them being "replacement" MD2s/MD3s.
-    // the MD2/MD3 ones are used instead.
-    MD5_ParseExpect(&s, "bounds");
-    MD5_ParseExpect(&s, "{");
-
-    for (i = 0; i < mdl->num_frames * 2 * 5; i++)
-        COM_SkipToken(&s);
-
-    MD5_ParseExpect(&s, "}");
-
-    MD5_ParseExpect(&s, "baseframe");
-    MD5_ParseExpect(&s, "{");
-
-    for (i = 0; i < mdl->num_joints; i++) {
-        baseframe_joint_t *base_joint = &base_frame[i];
-
-        MD5_ParseVector(&s, base_joint->pos);
-        MD5_ParseVector(&s, base_joint->orient);
-
-        Quat_ComputeW(base_joint->orient);
-    }
-
-    MD5_ParseExpect(&s, "}");
-
-    mdl->skeleton_frames = MD5_CpuMalloc(sizeof(mdl->skeleton_frames[0]) * mdl->num_frames * mdl->num_joints);
-
-    // initialize scales
-    for (i = 0; i < mdl->num_frames * mdl->num_joints; i++)
-        mdl->skeleton_frames[i].scale = 1.0f;
-
-    // load scales
-    char scale_path[MAX_QPATH];
-    if (COM_StripExtension(scale_path, path, sizeof(scale_path)) < sizeof(scale_path) &&
-        Q_strlcat(scale_path, ".md5scale", sizeof(scale_path)) < sizeof(scale_path))
-        MD5_LoadScales(model->skeleton, scale_path, joint_infos);
-    else
-        Com_WPrintf("MD5 scale path too long: %s\n", scale_path);
-
-    for (i = 0; i < mdl->num_frames; i++) {
-        MD5_ParseExpect(&s, "frame");
-
-        uint32_t frame_index = MD5_ParseUint(&s, 0, mdl->num_frames - 1);
-
-        MD5_ParseExpect(&s, "{");
-        for (j = 0; j < num_animated_components; j++)
-            anim_frame_data[j] = MD5_ParseFloat(&s);
-        MD5_ParseExpect(&s, "}");
-
-        /* Build frame skeleton from the collected data */
-        MD5_BuildFrameSkeleton(joint_infos, base_frame, anim_frame_data,
-                               &mdl->skeleton_frames[frame_index * mdl->num_joints], mdl->num_joints);
-    }
-
-    return true;
-}
-
-static bool MD5_LoadFile(model_t *model, const char *path, bool (*parse)(model_t *, const char *, const char *))
-{
-    void *data;
-    int ret = FS_LoadFile(path, &data);
-    if (!data) {
-    MOD_PrintError(path, ret);
-    return false;
-}
-
-    ret = parse(model, data, path);
-    FS_FreeFile(data);
-    if (!ret) {
-        MOD_PrintError(path, Q_ERR_INVALID_FORMAT);
-        return false;
-    }
+    size = sizeof(mdl->skeleton_frames[0]) * mdl->num_frames * mdl->num_joints;
+    mdl->skeleton_frames = MD5_CpuMalloc(size);
+    memcpy(mdl->skeleton_frames, MD5C_DATA(hdr, hdr->ofs_frames), size);
 
     return true;
 }
@@ -1416,6 +898,8 @@ static void MOD_LoadMD5(model_t *model)
 {
     char model_name[MAX_QPATH], base_path[MAX_QPATH];
     char mesh_path[MAX_QPATH], anim_path[MAX_QPATH];
+    const md5c_header_t *hdr;
+    bool ok;
 
     COM_SplitPath(model->name, model_name, sizeof(model_name), base_path, sizeof(base_path), true);
 
@@ -1427,12 +911,24 @@ static void MOD_LoadMD5(model_t *model)
     if (!FS_FileExists(mesh_path) || !FS_FileExists(anim_path))
         return;
 
+    hdr = R_MD5Load(mesh_path, anim_path);
+    if (!hdr)
+        return;
+
+    // warn on mismatched frame counts (not fatal)
+    if (hdr->num_frames < model->numframes)
+        Com_WPrintf("%s has less frames than %s (%u < %i)\n", anim_path,
+                    model->name, hdr->num_frames, model->numframes);
+
     size_t watermark = model->hunk.cursize;
 
-    if (!MD5_LoadFile(model, mesh_path, MD5_ParseMesh))
-        goto fail;
-    if (!MD5_LoadFile(model, anim_path, MD5_ParseAnim))
+    ok = MD5_LoadCompiled(model, hdr);
+    R_MD5Free(hdr);
+
+    if (!ok) {
+        MOD_PrintError(mesh_path, Q_ERR_INVALID_FORMAT);
         goto fail;
+    }
     if (!MD5_LoadSkins(model))
         goto fail;
 
@@ -1585,7 +1081,7 @@ qhandle_t R_RegisterModel(const char *name)
         goto done;
     }
 
-    ret = FS_LoadFile(normalized, (void **)&rawdata);
+    ret = FS_LoadFileFlags(normalized, (void **)&rawdata, FS_FLAG_MMAP);
     if (!rawdata)
         goto fail1;
 
@@ -23,7 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "color.h"
 #include "conversion.h"
 
-#define TR_PARTICLE_MAX_NUM    MAX_PARTICLES
+#define TR_PARTICLE_MAX_NUM    8192 // vertices are indexed with uint16_t
 #define TR_BEAM_MAX_NUM        MAX_ENTITIES
 #define TR_SPRITE_MAX_NUM      MAX_ENTITIES
 #define TR_VERTEX_MAX_NUM      ((TR_PARTICLE_MAX_NUM + TR_SPRITE_MAX_NUM) * 4)
@@ -10,14 +10,14 @@ Copyright (C) 2026
 #include "renderer/view_setup.h"
 #include "format/md2.h"
 #include "format/sp2.h"
+#if USE_MD5
+#include "renderer/md5_cache.h"
+#endif
 
 #include <math.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
-#if USE_MD5
-#include <setjmp.h>
-#endif
 
 typedef enum {
     VK_MODEL_FREE = 0,
@@ -45,16 +45,6 @@ typedef struct {
 } vk_md2_t;
 
 #if USE_MD5
-enum {
-    VK_MD5_MAX_JOINTS = 256,
-    VK_MD5_MAX_MESHES = 32,
-    VK_MD5_MAX_WEIGHTS = 8192,
-    VK_MD5_MAX_FRAMES = 1024,
-    VK_MD5_MAX_JOINTNAME = 48,
-    VK_MD5_MAX_VERTICES = 65535,
-    VK_MD5_MAX_INDICES = VK_MD5_MAX_VERTICES * 3,
-};
-
 typedef struct {
     uint16_t start;
     uint16_t count;
@@ -192,7 +182,6 @@ static cvar_t *vk_partscale;
 static cvar_t *vk_md5_load;
 static cvar_t *vk_md5_use;
 static cvar_t *vk_md5_distance;
-static jmp_buf vk_md5_jmpbuf;
 #endif
 
 static VkDescriptorSet VK_Entity_SetForImage(qhandle_t handle);
@@ -237,84 +226,6 @@ static bool VK_Entity_Check(VkResult result, const char *what)
 }
 
 #if USE_MD5
-typedef struct {
-    int parent;
-    uint32_t flags;
-    uint32_t start_index;
-    char name[VK_MD5_MAX_JOINTNAME];
-    bool scale_pos;
-} vk_md5_joint_info_t;
-
-typedef struct {
-    vec3_t pos;
-    quat_t orient;
-} vk_md5_base_joint_t;
-
-q_noreturn static void VK_MD5_ParseError(const char *text)
-{
-    Com_SetLastError(va("MD5 parse line %u: %s", com_linenum, text));
-    longjmp(vk_md5_jmpbuf, -1);
-}
-
-static void VK_MD5_ParseExpect(const char **buffer, const char *expect)
-{
-    char *token = COM_Parse(buffer);
-    if (strcmp(token, expect)) {
-        VK_MD5_ParseError(va("expected \"%s\", got \"%s\"", expect, Com_MakePrintable(token)));
-    }
-}
-
-static float VK_MD5_ParseFloat(const char **buffer)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr = NULL;
-
-    float v = strtof(token, &endptr);
-    if (!endptr || endptr == token || *endptr) {
-        VK_MD5_ParseError(va("expected float, got \"%s\"", Com_MakePrintable(token)));
-    }
-    return v;
-}
-
-static uint32_t VK_MD5_ParseUint(const char **buffer, uint32_t min_v, uint32_t max_v)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr = NULL;
-
-    unsigned long v = strtoul(token, &endptr, 10);
-    if (!endptr || endptr == token || *endptr) {
-        VK_MD5_ParseError(va("expected uint, got \"%s\"", Com_MakePrintable(token)));
-    }
-    if (v < min_v || v > max_v) {
-        VK_MD5_ParseError(va("value out of range: %lu", v));
-    }
-    return (uint32_t)v;
-}
-
-static int32_t VK_MD5_ParseInt(const char **buffer, int32_t min_v, int32_t max_v)
-{
-    char *token = COM_Parse(buffer);
-    char *endptr = NULL;
-
-    long v = strtol(token, &endptr, 10);
-    if (!endptr || endptr == token || *endptr) {
-        VK_MD5_ParseError(va("expected int, got \"%s\"", Com_MakePrintable(token)));
-    }
-    if (v < min_v || v > max_v) {
-        VK_MD5_ParseError(va("value out of range: %ld", v));
-    }
-    return (int32_t)v;
-}
-
-static void VK_MD5_ParseVector(const char **buffer, vec3_t out_vec)
-{
-    VK_MD5_ParseExpect(buffer, "(");
-    out_vec[0] = VK_MD5_ParseFloat(buffer);
-    out_vec[1] = VK_MD5_ParseFloat(buffer);
-    out_vec[2] = VK_MD5_ParseFloat(buffer);
-    VK_MD5_ParseExpect(buffer, ")");
-}
-
 static void VK_MD5_Free(vk_md5_t *md5)
 {
     if (!md5) {
@@ -337,413 +248,83 @@ static void VK_MD5_Free(vk_md5_t *md5)
     memset(md5, 0, sizeof(*md5));
 }
 
-static bool VK_MD5_ParseMesh(vk_md5_t *out_md5, const char *source)
+static bool VK_MD5_CopyArray(void **dst, const md5c_header_t *hdr, uint32_t ofs, size_t size)
 {
-    if (!out_md5 || !source) {
-        return false;
+    if (!size) {
+        return true;
     }
 
-    vk_md5_base_joint_t base_joints[VK_MD5_MAX_JOINTS];
-    memset(base_joints, 0, sizeof(base_joints));
-
-    vk_md5_t parsed = { 0 };
-    const char *s = source;
-    com_linenum = 1;
-
-    if (setjmp(vk_md5_jmpbuf)) {
-        VK_MD5_Free(&parsed);
+    *dst = malloc(size);
+    if (!*dst) {
         return false;
     }
 
-    VK_MD5_ParseExpect(&s, "MD5Version");
-    VK_MD5_ParseExpect(&s, "10");
-
-    VK_MD5_ParseExpect(&s, "commandline");
-    COM_SkipToken(&s);
-
-    VK_MD5_ParseExpect(&s, "numJoints");
-    parsed.num_joints = VK_MD5_ParseUint(&s, 1, VK_MD5_MAX_JOINTS);
-
-    VK_MD5_ParseExpect(&s, "numMeshes");
-    parsed.num_meshes = VK_MD5_ParseUint(&s, 1, VK_MD5_MAX_MESHES);
-
-    VK_MD5_ParseExpect(&s, "joints");
-    VK_MD5_ParseExpect(&s, "{");
-    for (uint32_t i = 0; i < parsed.num_joints; i++) {
-        COM_SkipToken(&s); // name
-        COM_SkipToken(&s); // parent
-        VK_MD5_ParseVector(&s, base_joints[i].pos);
-        VK_MD5_ParseVector(&s, base_joints[i].orient);
-        Quat_ComputeW(base_joints[i].orient);
-    }
-    VK_MD5_ParseExpect(&s, "}");
-
-    parsed.meshes = calloc(parsed.num_meshes, sizeof(*parsed.meshes));
-    if (!parsed.meshes) {
-        VK_MD5_ParseError("out of memory allocating MD5 meshes");
-    }
-
-    for (uint32_t i = 0; i < parsed.num_meshes; i++) {
-        vk_md5_mesh_t *mesh = &parsed.meshes[i];
-
-        VK_MD5_ParseExpect(&s, "mesh");
-        VK_MD5_ParseExpect(&s, "{");
-
-        VK_MD5_ParseExpect(&s, "shader");
-        const char *shader_token = COM_Parse(&s);
-        if (shader_token && *shader_token) {
-            char shader_name[MAX_QPATH];
-            Q_strlcpy(shader_name, shader_token, sizeof(shader_name));
-            FS_NormalizePath(shader_name);
-            mesh->shader_image = VK_UI_RegisterImage(shader_name, IT_SKIN, IF_NONE);
-        }
-
-        VK_MD5_ParseExpect(&s, "numverts");
-        mesh->num_verts = VK_MD5_ParseUint(&s, 0, VK_MD5_MAX_VERTICES);
-        if (mesh->num_verts) {
-            mesh->vertices = calloc(mesh->num_verts, sizeof(*mesh->vertices));
-            mesh->tcoords = calloc(mesh->num_verts, sizeof(*mesh->tcoords));
-            if (!mesh->vertices || !mesh->tcoords) {
-                VK_MD5_ParseError("out of memory allocating MD5 vertices");
-            }
-        }
-
-        for (uint32_t v = 0; v < mesh->num_verts; v++) {
-            VK_MD5_ParseExpect(&s, "vert");
-            uint32_t vert_index = VK_MD5_ParseUint(&s, 0, mesh->num_verts - 1);
-
-            VK_MD5_ParseExpect(&s, "(");
-            mesh->tcoords[vert_index].st[0] = VK_MD5_ParseFloat(&s);
-            mesh->tcoords[vert_index].st[1] = VK_MD5_ParseFloat(&s);
-            VK_MD5_ParseExpect(&s, ")");
-
-            mesh->vertices[vert_index].start = (uint16_t)VK_MD5_ParseUint(&s, 0, UINT16_MAX);
-            mesh->vertices[vert_index].count = (uint16_t)VK_MD5_ParseUint(&s, 0, UINT16_MAX);
-        }
-
-        VK_MD5_ParseExpect(&s, "numtris");
-        uint32_t num_tris = VK_MD5_ParseUint(&s, 0, VK_MD5_MAX_INDICES / 3);
-        if (num_tris && !mesh->num_verts) {
-            VK_MD5_ParseError("mesh has triangles but no vertices");
-        }
-        mesh->num_indices = num_tris * 3;
-        if (mesh->num_indices) {
-            mesh->indices = calloc(mesh->num_indices, sizeof(*mesh->indices));
-            if (!mesh->indices) {
-                VK_MD5_ParseError("out of memory allocating MD5 indices");
-            }
-        }
-        for (uint32_t t = 0; t < num_tris; t++) {
-            VK_MD5_ParseExpect(&s, "tri");
-            uint32_t tri_index = VK_MD5_ParseUint(&s, 0, num_tris - 1);
-            for (int k = 0; k < 3; k++) {
-                mesh->indices[tri_index * 3 + k] = (uint16_t)VK_MD5_ParseUint(&s, 0, mesh->num_verts ? mesh->num_verts - 1 : 0);
-            }
-        }
-
-        VK_MD5_ParseExpect(&s, "numweights");
-        mesh->num_weights = VK_MD5_ParseUint(&s, 0, VK_MD5_MAX_WEIGHTS);
-        if (mesh->num_weights) {
-            mesh->weights = calloc(mesh->num_weights, sizeof(*mesh->weights));
-            mesh->jointnums = calloc(mesh->num_weights, sizeof(*mesh->jointnums));
-            if (!mesh->weights || !mesh->jointnums) {
-                VK_MD5_ParseError("out of memory allocating MD5 weights");
-            }
-        }
-        for (uint32_t w = 0; w < mesh->num_weights; w++) {
-            VK_MD5_ParseExpect(&s, "weight");
-            uint32_t weight_index = VK_MD5_ParseUint(&s, 0, mesh->num_weights - 1);
-            mesh->jointnums[weight_index] = (uint8_t)VK_MD5_ParseUint(&s, 0, parsed.num_joints - 1);
-            mesh->weights[weight_index].bias = VK_MD5_ParseFloat(&s);
-            VK_MD5_ParseVector(&s, mesh->weights[weight_index].pos);
-        }
-
-        VK_MD5_ParseExpect(&s, "}");
-
-        for (uint32_t v = 0; v < mesh->num_verts; v++) {
-            const vk_md5_vertex_t *vert = &mesh->vertices[v];
-            if ((uint32_t)vert->start + (uint32_t)vert->count > mesh->num_weights) {
-                VK_MD5_ParseError("invalid MD5 vertex weight span");
-            }
-        }
-    }
-
-    parsed.loaded = true;
-    *out_md5 = parsed;
+    memcpy(*dst, MD5C_DATA(hdr, ofs), size);
     return true;
 }
 
-static void VK_MD5_BuildFrameSkeleton(const vk_md5_joint_info_t *joint_infos,
-                                      const vk_md5_base_joint_t *base_frame,
-                                      const float *frame_data,
-                                      vk_md5_joint_t *out_skeleton,
-                                      uint32_t num_joints)
-{
-    for (uint32_t i = 0; i < num_joints; i++) {
-        vec3_t animated_pos;
-        quat_t animated_orient;
-        VectorCopy(base_frame[i].pos, animated_pos);
-        Vector4Copy(base_frame[i].orient, animated_orient);
-
-        int component_index = 0;
-        uint32_t flags = joint_infos[i].flags;
-        uint32_t start = joint_infos[i].start_index;
-
-        if (flags & BIT(0))
-            animated_pos[0] = frame_data[start + component_index++];
-        if (flags & BIT(1))
-            animated_pos[1] = frame_data[start + component_index++];
-        if (flags & BIT(2))
-            animated_pos[2] = frame_data[start + component_index++];
-        if (flags & BIT(3))
-            animated_orient[0] = frame_data[start + component_index++];
-        if (flags & BIT(4))
-            animated_orient[1] = frame_data[start + component_index++];
-        if (flags & BIT(5))
-            animated_orient[2] = frame_data[start + component_index++];
-
-        Quat_ComputeW(animated_orient);
-
-        vk_md5_joint_t *joint = &out_skeleton[i];
-        if (joint_infos[i].scale_pos) {
-            VectorScale(animated_pos, joint->scale, animated_pos);
-        }
-
-        if (joint_infos[i].parent < 0) {
-            VectorCopy(animated_pos, joint->pos);
-            Vector4Copy(animated_orient, joint->orient);
-            Quat_ToAxis(joint->orient, joint->axis);
-            continue;
-        }
-
-        const vk_md5_joint_t *parent = &out_skeleton[joint_infos[i].parent];
-        vec3_t rotated_pos;
-        Quat_RotatePoint(parent->orient, animated_pos, rotated_pos);
-        VectorAdd(parent->pos, rotated_pos, joint->pos);
-
-        Quat_MultiplyQuat(parent->orient, animated_orient, joint->orient);
-        Quat_Normalize(joint->orient);
-        Quat_ToAxis(joint->orient, joint->axis);
-    }
-}
-
-static void VK_MD5_LoadScales(vk_md5_t *md5, const char *path, vk_md5_joint_info_t *joint_infos)
+static bool VK_MD5_LoadCompiled(vk_md5_t *out_md5, const md5c_header_t *hdr)
 {
-    if (!md5 || !path || !joint_infos) {
-        return;
-    }
-
-    jsmn_parser parser;
-    jsmntok_t tokens[4096];
-    char *data = NULL;
-    int len = FS_LoadFile(path, (void **)&data);
-    if (!data) {
-        if (len != Q_ERR(ENOENT)) {
-            Com_EPrintf("Couldn't load %s: %s\n", path, Q_ErrorString(len));
-        }
-        return;
-    }
+    const md5c_mesh_t *src = MD5C_DATA(hdr, hdr->ofs_meshes);
+    vk_md5_t md5 = { 0 };
 
-    jsmn_init(&parser);
-    int ret = jsmn_parse(&parser, data, (size_t)len, tokens, q_countof(tokens));
-    if (ret < 0) {
-        goto fail;
-    }
-    if (ret == 0) {
-        goto skip;
-    }
+    md5.num_meshes = hdr->num_meshes;
+    md5.num_joints = hdr->num_joints;
+    md5.num_frames = hdr->num_frames;
 
-    const jsmntok_t *tok = &tokens[0];
-    if (tok->type != JSMN_OBJECT) {
-        goto fail;
+    md5.meshes = calloc(md5.num_meshes, sizeof(*md5.meshes));
+    if (!md5.meshes ||
+        !VK_MD5_CopyArray((void **)&md5.skeleton_frames, hdr, hdr->ofs_frames,
+                          (size_t)md5.num_frames * md5.num_joints * sizeof(*md5.skeleton_frames))) {
+        goto oom;
     }
 
-    const jsmntok_t *end = tokens + ret;
-    tok++;
+    for (uint32_t i = 0; i < md5.num_meshes; i++, src++) {
+        vk_md5_mesh_t *mesh = &md5.meshes[i];
 
-    while (tok < end) {
-        if (tok->type != JSMN_STRING) {
-            goto fail;
-        }
-
-        int joint_id = -1;
-        const char *joint_name = data + tok->start;
-        data[tok->end] = 0;
-        for (uint32_t i = 0; i < md5->num_joints; i++) {
-            if (!strcmp(joint_name, joint_infos[i].name)) {
-                joint_id = (int)i;
-                break;
-            }
-        }
+        mesh->num_verts = src->num_verts;
+        mesh->num_indices = src->num_indices;
+        mesh->num_weights = src->num_weights;
 
-        if (joint_id == -1) {
-            Com_WPrintf("No such joint \"%s\" in %s\n", Com_MakePrintable(joint_name), path);
+        if (!VK_MD5_CopyArray((void **)&mesh->tcoords, hdr, src->ofs_tcoords,
+                              mesh->num_verts * sizeof(*mesh->tcoords)) ||
+            !VK_MD5_CopyArray((void **)&mesh->indices, hdr, src->ofs_indices,
+                              mesh->num_indices * sizeof(*mesh->indices)) ||
+            !VK_MD5_CopyArray((void **)&mesh->weights, hdr, src->ofs_weights,
+                              mesh->num_weights * sizeof(*mesh->weights)) ||
+            !VK_MD5_CopyArray((void **)&mesh->jointnums, hdr, src->ofs_jointnums,
+                              mesh->num_weights * sizeof(*mesh->jointnums))) {
+            goto oom;
         }
 
-        if (++tok == end || tok->type != JSMN_OBJECT) {
-            goto fail;
-        }
-
-        int num_keys = tok->size;
-        if (end - ++tok < num_keys * 2) {
-            goto fail;
-        }
-
-        for (int i = 0; i < num_keys; i++) {
-            const jsmntok_t *key = tok++;
-            const jsmntok_t *val = tok++;
-            if (key->type != JSMN_STRING || val->type != JSMN_PRIMITIVE) {
-                goto fail;
-            }
-
-            if (joint_id == -1) {
-                continue;
-            }
-
-            data[key->end] = 0;
-            const char *key_text = data + key->start;
-            if (!strcmp(key_text, "scale_positions")) {
-                joint_infos[joint_id].scale_pos = data[val->start] == 't';
-            } else {
-                unsigned frame_id = Q_atoi(key_text);
-                if (frame_id < md5->num_frames) {
-                    md5->skeleton_frames[(size_t)frame_id * md5->num_joints + (uint32_t)joint_id].scale =
-                        Q_atof(data + val->start);
-                } else {
-                    Com_WPrintf("No such frame %u in %s\n", frame_id, path);
-                }
+        // normals aren't used here
+        if (mesh->num_verts) {
+            const md5c_vertex_t *verts = MD5C_DATA(hdr, src->ofs_vertices);
+            mesh->vertices = malloc(mesh->num_verts * sizeof(*mesh->vertices));
+            if (!mesh->vertices) {
+                goto oom;
             }
-        }
-    }
-
-skip:
-    FS_FreeFile(data);
-    return;
-
-fail:
-    Com_EPrintf("Couldn't load %s: Invalid JSON data\n", path);
-    FS_FreeFile(data);
-}
-
-static bool VK_MD5_ParseAnim(vk_md5_t *md5, const char *source, const char *path)
-{
-    if (!md5 || !source) {
-        return false;
-    }
-
-    vk_md5_joint_info_t joint_infos[VK_MD5_MAX_JOINTS];
-    vk_md5_base_joint_t base_frame[VK_MD5_MAX_JOINTS];
-    float anim_frame_data[VK_MD5_MAX_JOINTS * 6];
-    memset(joint_infos, 0, sizeof(joint_infos));
-    memset(base_frame, 0, sizeof(base_frame));
-    memset(anim_frame_data, 0, sizeof(anim_frame_data));
-
-    const char *s = source;
-    com_linenum = 1;
-
-    if (setjmp(vk_md5_jmpbuf)) {
-        return false;
-    }
-
-    VK_MD5_ParseExpect(&s, "MD5Version");
-    VK_MD5_ParseExpect(&s, "10");
-
-    VK_MD5_ParseExpect(&s, "commandline");
-    COM_SkipToken(&s);
-
-    VK_MD5_ParseExpect(&s, "numFrames");
-    md5->num_frames = VK_MD5_ParseUint(&s, 1, VK_MD5_MAX_FRAMES);
-
-    VK_MD5_ParseExpect(&s, "numJoints");
-    uint32_t num_joints = VK_MD5_ParseUint(&s, 1, VK_MD5_MAX_JOINTS);
-    if (num_joints != md5->num_joints) {
-        VK_MD5_ParseError("numJoints mismatch between mesh and animation");
-    }
-
-    VK_MD5_ParseExpect(&s, "frameRate");
-    COM_SkipToken(&s);
-
-    VK_MD5_ParseExpect(&s, "numAnimatedComponents");
-    uint32_t num_animated_components = VK_MD5_ParseUint(&s, 0, md5->num_joints * 6);
-
-    VK_MD5_ParseExpect(&s, "hierarchy");
-    VK_MD5_ParseExpect(&s, "{");
-    for (uint32_t i = 0; i < md5->num_joints; i++) {
-        COM_ParseToken(&s, joint_infos[i].name, sizeof(joint_infos[i].name), PARSE_FLAG_NONE);
-        joint_infos[i].parent = VK_MD5_ParseInt(&s, -1, (int32_t)md5->num_joints - 1);
-        joint_infos[i].flags = VK_MD5_ParseUint(&s, 0, UINT32_MAX);
-        joint_infos[i].start_index = VK_MD5_ParseUint(&s, 0, num_animated_components);
-        joint_infos[i].scale_pos = false;
-
-        int num_components = 0;
-        for (int c = 0; c < 6; c++) {
-            if (joint_infos[i].flags & BIT(c)) {
-                num_components++;
+            for (uint32_t v = 0; v < mesh->num_verts; v++) {
+                mesh->vertices[v].start = verts[v].start;
+                mesh->vertices[v].count = verts[v].count;
             }
         }
 
-        if (joint_infos[i].start_index + (uint32_t)num_components > num_animated_components) {
-            VK_MD5_ParseError("invalid hierarchy animated component span");
-        }
-        if (joint_infos[i].parent >= (int)i) {
-            VK_MD5_ParseError("invalid hierarchy parent ordering");
-        }
-    }
-    VK_MD5_ParseExpect(&s, "}");
-
-    VK_MD5_ParseExpect(&s, "bounds");
-    VK_MD5_ParseExpect(&s, "{");
-    for (uint32_t i = 0; i < md5->num_frames; i++) {
-        vec3_t ignore_min;
-        vec3_t ignore_max;
-        VK_MD5_ParseVector(&s, ignore_min);
-        VK_MD5_ParseVector(&s, ignore_max);
-    }
-    VK_MD5_ParseExpect(&s, "}");
-
-    VK_MD5_ParseExpect(&s, "baseframe");
-    VK_MD5_ParseExpect(&s, "{");
-    for (uint32_t i = 0; i < md5->num_joints; i++) {
-        VK_MD5_ParseVector(&s, base_frame[i].pos);
-        VK_MD5_ParseVector(&s, base_frame[i].orient);
-        Quat_ComputeW(base_frame[i].orient);
-    }
-    VK_MD5_ParseExpect(&s, "}");
-
-    md5->skeleton_frames = calloc((size_t)md5->num_frames * (size_t)md5->num_joints,
-                                  sizeof(*md5->skeleton_frames));
-    if (!md5->skeleton_frames) {
-        VK_MD5_ParseError("out of memory allocating MD5 skeleton frames");
-    }
-
-    for (uint32_t i = 0; i < md5->num_frames * md5->num_joints; i++) {
-        md5->skeleton_frames[i].scale = 1.0f;
-    }
-
-    if (path && *path) {
-        char scale_path[MAX_QPATH];
-        if (COM_StripExtension(scale_path, path, sizeof(scale_path)) < sizeof(scale_path) &&
-            Q_strlcat(scale_path, ".md5scale", sizeof(scale_path)) < sizeof(scale_path)) {
-            VK_MD5_LoadScales(md5, scale_path, joint_infos);
-        } else {
-            Com_WPrintf("MD5 scale path too long: %s\n", scale_path);
+        if (src->shader[0]) {
+            char shader_name[MAX_QPATH];
+            Q_strlcpy(shader_name, src->shader, sizeof(shader_name));
+            FS_NormalizePath(shader_name);
+            mesh->shader_image = VK_UI_RegisterImage(shader_name, IT_SKIN, IF_NONE);
         }
     }
 
-    for (uint32_t frame = 0; frame < md5->num_frames; frame++) {
-        VK_MD5_ParseExpect(&s, "frame");
-        uint32_t frame_index = VK_MD5_ParseUint(&s, 0, md5->num_frames - 1);
-        VK_MD5_ParseExpect(&s, "{");
-        for (uint32_t i = 0; i < num_animated_components; i++) {
-            anim_frame_data[i] = VK_MD5_ParseFloat(&s);
-        }
-        VK_MD5_ParseExpect(&s, "}");
-
-        VK_MD5_BuildFrameSkeleton(joint_infos, base_frame, anim_frame_data,
-                                  &md5->skeleton_frames[(size_t)frame_index * md5->num_joints],
-                                  md5->num_joints);
-    }
+    *out_md5 = md5;
     return true;
+
+oom:
+    Com_SetLastError("out of memory allocating MD5 model");
+    VK_MD5_Free(&md5);
+    return false;
 }
 
 static bool VK_Entity_LoadMD5Replacement(vk_model_t *model)
@@ -767,32 +348,17 @@ static bool VK_Entity_LoadMD5Replacement(vk_model_t *model)
         return false;
     }
 
-    char *mesh_data = NULL;
-    char *anim_data = NULL;
-    int mesh_len = FS_LoadFile(mesh_path, (void **)&mesh_data);
-    if (!mesh_data || mesh_len < 0) {
-        if (mesh_data) {
-            FS_FreeFile(mesh_data);
-        }
-        return false;
-    }
-
-    int anim_len = FS_LoadFile(anim_path, (void **)&anim_data);
-    if (!anim_data || anim_len < 0) {
-        FS_FreeFile(mesh_data);
-        if (anim_data) {
-            FS_FreeFile(anim_data);
-        }
+    const md5c_header_t *hdr = R_MD5Load(mesh_path, anim_path);
+    if (!hdr) {
         return false;
     }
 
     vk_md5_t parsed = { 0 };
-    bool ok = VK_MD5_ParseMesh(&parsed, mesh_data) && VK_MD5_ParseAnim(&parsed, anim_data, anim_path);
-    FS_FreeFile(mesh_data);
-    FS_FreeFile(anim_data);
+    bool ok = VK_MD5_LoadCompiled(&parsed, hdr);
+    R_MD5Free(hdr);
 
     if (!ok) {
-        VK_MD5_Free(&parsed);
+        Com_EPrintf("Couldn't load %s: %s\n", mesh_path, Com_GetLastError());
         return false;
     }
 
@@ -0,0 +1,911 @@
+/*
+Copyright (C) 2026
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#include "renderer/md5_cache.h"
+
+#if USE_MD5
+
+#include "common/common.h"
+#include "common/files.h"
+#include "common/hash_map.h"
+#include "common/json.h"
+#include "common/math.h"
+#include "renderer/renderer_api.h"
+
+#include <setjmp.h>
+#include <string.h>
+
+#define MD5C_MAX_JOINTNAME  48
+#define MD5C_ALIGN          16
+
+#define MD5C_NUM_ANIMATED_COMPONENT_BITS 6
+
+#define MD5C_Malloc(size)   Z_TagMallocz(size, TAG_RENDERER)
+
+_Static_assert(sizeof(md5c_source_t) == 48, "MD5 cache source size mismatch");
+_Static_assert(sizeof(md5c_vertex_t) == 16, "MD5 cache vertex size mismatch");
+_Static_assert(sizeof(md5c_joint_t) == 68, "MD5 cache joint size mismatch");
+_Static_assert(sizeof(md5c_mesh_t) == MAX_QPATH + 32, "MD5 cache mesh size mismatch");
+_Static_assert(sizeof(md5c_header_t) == 176, "MD5 cache header size mismatch");
+
+static cvar_t *r_md5_cache;
+
+/*
+=============================================================================
+
+TEXT PARSING
+
+=============================================================================
+*/
+
+typedef struct {
+    vec3_t pos;
+    quat_t orient;
+} baseframe_joint_t;
+
+typedef struct {
+    char name[MD5C_MAX_JOINTNAME];
+    int parent, flags, start_index;
+    bool scale_pos;
+} joint_info_t;
+
+// model as parsed, before it is laid out into a blob
+typedef struct {
+    char shader[MAX_QPATH];
+    uint32_t num_verts;
+    uint32_t num_indices;
+    uint32_t num_weights;
+    md5c_vertex_t *vertices;
+    md5c_tcoord_t *tcoords;
+    uint16_t *indices;
+    md5c_weight_t *weights;
+    uint8_t *jointnums;
+} parsed_mesh_t;
+
+typedef struct {
+    uint32_t num_meshes;
+    uint32_t num_joints;
+    uint32_t num_frames;
+    parsed_mesh_t meshes[MD5C_MAX_MESHES];
+    md5c_joint_t *frames; // [num_frames][num_joints]
+} parsed_model_t;
+
+static jmp_buf md5_jmpbuf;
+
+q_noreturn
+static void MD5_ParseError(const char *text)
+{
+    Com_SetLastError(va("Line %u: %s", com_linenum, text));
+    longjmp(md5_jmpbuf, -1);
+}
+
+static void MD5_ParseExpect(const char **buffer, const char *expect)
+{
+    char *token = COM_Parse(buffer);
+
+    if (strcmp(token, expect))
+        MD5_ParseError(va("Expected \"%s\", got \"%s\"", expect, Com_MakePrintable(token)));
+}
+
+static float MD5_ParseFloat(const char **buffer)
+{
+    char *token = COM_Parse(buffer);
+    char *endptr;
+
+    float v = strtof(token, &endptr);
+    if (endptr == token || *endptr)
+        MD5_ParseError(va("Expected float, got \"%s\"", Com_MakePrintable(token)));
+
+    return v;
+}
+
+static uint32_t MD5_ParseUint(const char **buffer, uint32_t min_v, uint32_t max_v)
+{
+    char *token = COM_Parse(buffer);
+    char *endptr;
+
+    unsigned long v = strtoul(token, &endptr, 10);
+    if (endptr == token || *endptr)
+        MD5_ParseError(va("Expected uint, got \"%s\"", Com_MakePrintable(token)));
+    if (v < min_v || v > max_v)
+        MD5_ParseError(va("Value out of range: %lu", v));
+
+    return v;
+}
+
+static int32_t MD5_ParseInt(const char **buffer, int32_t min_v, int32_t max_v)
+{
+    char *token = COM_Parse(buffer);
+    char *endptr;
+
+    long v = strtol(token, &endptr, 10);
+    if (endptr == token || *endptr)
+        MD5_ParseError(va("Expected int, got \"%s\"", Com_MakePrintable(token)));
+    if (v < min_v || v > max_v)
+        MD5_ParseError(va("Value out of range: %ld", v));
+
+    return v;
+}
+
+static void MD5_ParseVector(const char **buffer, vec3_t output)
+{
+    MD5_ParseExpect(buffer, "(");
+    output[0] = MD5_ParseFloat(buffer);
+    output[1] = MD5_ParseFloat(buffer);
+    output[2] = MD5_ParseFloat(buffer);
+    MD5_ParseExpect(buffer, ")");
+}
+
+static void MD5_ComputeNormals(parsed_mesh_t *mesh, const baseframe_joint_t *base_skeleton)
+{
+    vec3_t *finalVerts;
+    md5c_vertex_t *vert;
+    uint32_t i, j;
+
+    if (!mesh->num_verts)
+        return;
+
+    finalVerts = MD5C_Malloc(mesh->num_verts * sizeof(finalVerts[0]));
+
+    hash_map_t *pos_to_normal_map = HashMap_Create(vec3_t, vec3_t, &HashVec3, NULL);
+    HashMap_Reserve(pos_to_normal_map, mesh->num_verts);
+
+    for (i = 0, vert = mesh->vertices; i < mesh->num_verts; i++, vert++) {
+        /* Calculate final vertex to draw with weights */
+        VectorClear(finalVerts[i]);
+
+        for (j = 0; j < vert->count; j++) {
+            const md5c_weight_t *weight = &mesh->weights[vert->start + j];
+            const baseframe_joint_t *joint = &base_skeleton[mesh->jointnums[vert->start + j]];
+
+            /* Calculate transformed vertex for this weight */
+            vec3_t wv;
+            Quat_RotatePoint(joint->orient, weight->pos, wv);
+
+            /* The sum of all weight->bias should be 1.0 */
+            VectorAdd(joint->pos, wv, wv);
+            VectorMA(finalVerts[i], weight->bias, wv, finalVerts[i]);
+        }
+    }
+
+    for (i = 0; i < mesh->num_indices; i += 3) {
+        vec3_t xyz[3];
+
+        for (j = 0; j < 3; j++)
+            VectorCopy(finalVerts[mesh->indices[i + j]], xyz[j]);
+
+        vec3_t d1, d2;
+        VectorSubtract(xyz[2], xyz[0], d1);
+        VectorSubtract(xyz[1], xyz[0], d2);
+        VectorNormalize(d1);
+        VectorNormalize(d2);
+
+        vec3_t norm;
+        CrossProduct(d1, d2, norm);
+        VectorNormalize(norm);
+
+        float angle = acosf(DotProduct(d1, d2));
+        VectorScale(norm, angle, norm);
+
+        for (j = 0; j < 3; j++) {
+            vec3_t *found_normal;
+            if ((found_normal = HashMap_Lookup(vec3_t, pos_to_normal_map, &xyz[j])))
+                VectorAdd(*found_normal, norm, *found_normal);
+            else
+                HashMap_Insert(pos_to_normal_map, &xyz[j], &norm);
+        }
+    }
+
+    uint32_t map_size = HashMap_Size(pos_to_normal_map);
+    for (i = 0; i < map_size; i++) {
+        vec3_t *norm = HashMap_GetValue(vec3_t, pos_to_normal_map, i);
+        VectorNormalize(*norm);
+    }
+
+    for (i = 0, vert = mesh->vertices; i < mesh->num_verts; i++, vert++) {
+        VectorClear(vert->normal);
+        vec3_t *norm = HashMap_Lookup(vec3_t, pos_to_normal_map, &finalVerts[i]);
+        if (norm) {
+            // Put the bind-pose normal into joint-local space
+            // so the animated normal can be computed faster later.
+            // Done by transforming the vertex normal by the inverse
+            // joint's orientation quaternion of the weight.
+            for (j = 0; j < vert->count; j++) {
+                const md5c_weight_t *weight = &mesh->weights[vert->start + j];
+                const baseframe_joint_t *joint = &base_skeleton[mesh->jointnums[vert->start + j]];
+                vec3_t wv;
+                quat_t orient_inv;
+                Quat_Conjugate(joint->orient, orient_inv);
+                Quat_RotatePoint(orient_inv, *norm, wv);
+                VectorMA(vert->normal, weight->bias, wv, vert->normal);
+            }
+        }
+    }
+
+    HashMap_Destroy(pos_to_normal_map);
+    Z_Free(finalVerts);
+}
+
+static void MD5_ParseMesh(parsed_model_t *mdl, const char *s)
+{
+    baseframe_joint_t base_skeleton[MD5C_MAX_JOINTS];
+    uint32_t i, j, k;
+
+    com_linenum = 1;
+
+    // parse header
+    MD5_ParseExpect(&s, "MD5Version");
+    MD5_ParseExpect(&s, "10");
+
+    MD5_ParseExpect(&s, "commandline");
+    COM_SkipToken(&s);
+
+    MD5_ParseExpect(&s, "numJoints");
+    mdl->num_joints = MD5_ParseUint(&s, 1, MD5C_MAX_JOINTS);
+
+    MD5_ParseExpect(&s, "numMeshes");
+    mdl->num_meshes = MD5_ParseUint(&s, 1, MD5C_MAX_MESHES);
+
+    MD5_ParseExpect(&s, "joints");
+    MD5_ParseExpect(&s, "{");
+
+    for (i = 0; i < mdl->num_joints; i++) {
+        baseframe_joint_t *joint = &base_skeleton[i];
+
+        // skip name
+        COM_SkipToken(&s);
+
+        // skip parent
+        COM_SkipToken(&s);
+
+        MD5_ParseVector(&s, joint->pos);
+        MD5_ParseVector(&s, joint->orient);
+
+        Quat_ComputeW(joint->orient);
+    }
+
+    MD5_ParseExpect(&s, "}");
+
+    for (i = 0; i < mdl->num_meshes; i++) {
+        parsed_mesh_t *mesh = &mdl->meshes[i];
+
+        MD5_ParseExpect(&s, "mesh");
+        MD5_ParseExpect(&s, "{");
+
+        MD5_ParseExpect(&s, "shader");
+        COM_ParseToken(&s, mesh->shader, sizeof(mesh->shader), PARSE_FLAG_NONE);
+
+        MD5_ParseExpect(&s, "numverts");
+        mesh->num_verts = MD5_ParseUint(&s, 0, MD5C_MAX_VERTICES);
+        mesh->vertices  = MD5C_Malloc(mesh->num_verts * sizeof(mesh->vertices[0]));
+        mesh->tcoords   = MD5C_Malloc(mesh->num_verts * sizeof(mesh->tcoords [0]));
+
+        for (j = 0; j < mesh->num_verts; j++) {
+            MD5_ParseExpect(&s, "vert");
+
+            uint32_t vert_index = MD5_ParseUint(&s, 0, mesh->num_verts - 1);
+
+            md5c_tcoord_t *tc = &mesh->tcoords[vert_index];
+            MD5_ParseExpect(&s, "(");
+            tc->st[0] = MD5_ParseFloat(&s);
+            tc->st[1] = MD5_ParseFloat(&s);
+            MD5_ParseExpect(&s, ")");
+
+            md5c_vertex_t *vert = &mesh->vertices[vert_index];
+            vert->start = MD5_ParseUint(&s, 0, UINT16_MAX);
+            vert->count = MD5_ParseUint(&s, 0, UINT16_MAX);
+        }
+
+        MD5_ParseExpect(&s, "numtris");
+        uint32_t num_tris = MD5_ParseUint(&s, 0, MD5C_MAX_INDICES / 3);
+        if (num_tris && !mesh->num_verts)
+            MD5_ParseError("Mesh has triangles but no vertices");
+        mesh->indices = MD5C_Malloc(num_tris * 3 * sizeof(mesh->indices[0]));
+        mesh->num_indices = num_tris * 3;
+
+        for (j = 0; j < num_tris; j++) {
+            MD5_ParseExpect(&s, "tri");
+            uint32_t tri_index = MD5_ParseUint(&s, 0, num_tris - 1);
+            for (k = 0; k < 3; k++)
+                mesh->indices[tri_index * 3 + k] = MD5_ParseUint(&s, 0, mesh->num_verts - 1);
+        }
+
+        MD5_ParseExpect(&s, "numweights");
+        mesh->num_weights = MD5_ParseUint(&s, 0, MD5C_MAX_WEIGHTS);
+        mesh->weights     = MD5C_Malloc(mesh->num_weights * sizeof(mesh->weights  [0]));
+        mesh->jointnums   = MD5C_Malloc(mesh->num_weights * sizeof(mesh->jointnums[0]));
+
+        for (j = 0; j < mesh->num_weights; j++) {
+            MD5_ParseExpect(&s, "weight");
+
+            uint32_t weight_index = MD5_ParseUint(&s, 0, mesh->num_weights - 1);
+            mesh->jointnums[weight_index] = MD5_ParseUint(&s, 0, mdl->num_joints - 1);
+
+            md5c_weight_t *weight = &mesh->weights[weight_index];
+            weight->bias = MD5_ParseFloat(&s);
+            MD5_ParseVector(&s, weight->pos);
+        }
+
+        MD5_ParseExpect(&s, "}");
+
+        // check integrity of data; this has to be done last
+        // because of circular data dependencies
+        for (j = 0; j < mesh->num_verts; j++) {
+            md5c_vertex_t *vert = &mesh->vertices[j];
+            if (vert->start + vert->count > mesh->num_weights)
+                MD5_ParseError("Bad vert start/count");
+        }
+
+        MD5_ComputeNormals(mesh, base_skeleton);
+    }
+}
+
+/**
+ * Build skeleton for a given frame data.
+ */
+static void MD5_BuildFrameSkeleton(const joint_info_t *joint_infos,
+                                   const baseframe_joint_t *base_frame,
+                                   const float *anim_frame_data,
+                                   md5c_joint_t *skeleton_frame,
+                                   int num_joints)
+{
+    for (int i = 0; i < num_joints; i++) {
+        const baseframe_joint_t *baseJoint = &base_frame[i];
+        float components[7];
+
+        float *animated_position = components + 0;
+        float *animated_quat = components + 3;
+
+        VectorCopy(baseJoint->pos, animated_position);
+        VectorCopy(baseJoint->orient, animated_quat); // W will be re-calculated below
+
+        for (int c = 0, j = 0; c < MD5C_NUM_ANIMATED_COMPONENT_BITS; c++)
+            if (joint_infos[i].flags & BIT(c))
+                components[c] = anim_frame_data[joint_infos[i].start_index + j++];
+
+        Quat_ComputeW(animated_quat);
+
+        md5c_joint_t *thisJoint = &skeleton_frame[i];
+
+        if (joint_infos[i].scale_pos)
+            VectorScale(animated_position, thisJoint->scale, animated_position);
+
+        int parent = joint_infos[i].parent;
+        if (parent < 0) {
+            VectorCopy(animated_position, thisJoint->pos);
+            Vector4Copy(animated_quat, thisJoint->orient);
+            Quat_ToAxis(thisJoint->orient, thisJoint->axis);
+            continue;
+        }
+
+        // parent should already be calculated
+        Q_assert(parent < i);
+        const md5c_joint_t *parentJoint = &skeleton_frame[parent];
+
+        // add positions
+        vec3_t rotated_pos;
+        Quat_RotatePoint(parentJoint->orient, animated_position, rotated_pos);
+        VectorAdd(rotated_pos, parentJoint->pos, thisJoint->pos);
+
+        // concat rotations
+        Quat_MultiplyQuat(parentJoint->orient, animated_quat, thisJoint->orient);
+        Quat_Normalize(thisJoint->orient);
+
+        Quat_ToAxis(thisJoint->orient, thisJoint->axis);
+    }
+}
+
+/**
+ * Parse some JSON vomit. Don't ask.
+ */
+static void MD5_LoadScales(parsed_model_t *model, const char *path, joint_info_t *joint_infos)
+{
+    const jsmntok_t *tok, *end;
+    jsmn_parser parser;
+    jsmntok_t tokens[4096];
+    char *data;
+    int len, ret;
+
+    len = FS_LoadFile(path, (void **)&data);
+    if (!data) {
+        if (len != Q_ERR(ENOENT))
+            Com_EPrintf("Couldn't load %s: %s\n", path, Q_ErrorString(len));
+        return;
+    }
+
+    jsmn_init(&parser);
+    ret = jsmn_parse(&parser, data, len, tokens, q_countof(tokens));
+    if (ret < 0)
+        goto fail;
+    if (ret == 0)
+        goto skip;
+
+    tok = &tokens[0];
+    if (tok->type != JSMN_OBJECT)
+        goto fail;
+
+    end = tokens + ret;
+    tok++;
+
+    while (tok < end) {
+        if (tok->type != JSMN_STRING)
+            goto fail;
+
+        int joint_id = -1;
+        const char *joint_name = data + tok->start;
+
+        data[tok->end] = 0;
+        for (uint32_t i = 0; i < model->num_joints; i++) {
+            if (!strcmp(joint_name, joint_infos[i].name)) {
+                joint_id = (int)i;
+                break;
+            }
+        }
+
+        if (joint_id == -1)
+            Com_WPrintf("No such joint \"%s\" in %s\n", Com_MakePrintable(joint_name), path);
+
+        if (++tok == end || tok->type != JSMN_OBJECT)
+            goto fail;
+
+        int num_keys = tok->size;
+        if (end - ++tok < num_keys * 2)
+            goto fail;
+
+        for (int i = 0; i < num_keys; i++) {
+            const jsmntok_t *key = tok++;
+            const jsmntok_t *val = tok++;
+            if (key->type != JSMN_STRING || val->type != JSMN_PRIMITIVE)
+                goto fail;
+
+            if (joint_id == -1)
+                continue;
+
+            data[key->end] = 0;
+            if (!strcmp(data + key->start, "scale_positions")) {
+                joint_infos[joint_id].scale_pos = data[val->start] == 't';
+            } else {
+                unsigned frame_id = Q_atoi(data + key->start);
+                if (frame_id < model->num_frames)
+                    model->frames[frame_id * model->num_joints + joint_id].scale = Q_atof(data + val->start);
+                else
+                    Com_WPrintf("No such frame %d in %s\n", frame_id, path);
+            }
+        }
+    }
+
+skip:
+    FS_FreeFile(data);
+    return;
+
+fail:
+    Com_EPrintf("Couldn't load %s: Invalid JSON data\n", path);
+    FS_FreeFile(data);
+}
+
+/**
+ * Load an MD5 animation from file.
+ */
+static void MD5_ParseAnim(parsed_model_t *mdl, const char *s, const char *scale_path)
+{
+    joint_info_t joint_infos[MD5C_MAX_JOINTS];
+    baseframe_joint_t base_frame[MD5C_MAX_JOINTS];
+    float anim_frame_data[MD5C_MAX_JOINTS * MD5C_NUM_ANIMATED_COMPONENT_BITS];
+    uint32_t num_joints, num_animated_components;
+    uint32_t i, j;
+
+    com_linenum = 1;
+
+    // parse header
+    MD5_ParseExpect(&s, "MD5Version");
+    MD5_ParseExpect(&s, "10");
+
+    MD5_ParseExpect(&s, "commandline");
+    COM_SkipToken(&s);
+
+    MD5_ParseExpect(&s, "numFrames");
+    // MD5 replacements need at least 1 frame, because the
+    // pose frame isn't used
+    mdl->num_frames = MD5_ParseUint(&s, 1, MD5C_MAX_FRAMES);
+
+    MD5_ParseExpect(&s, "numJoints");
+    num_joints = MD5_ParseUint(&s, 1, MD5C_MAX_JOINTS);
+    if (num_joints != mdl->num_joints)
+        MD5_ParseError("Bad numJoints");
+
+    MD5_ParseExpect(&s, "frameRate");
+    COM_SkipToken(&s);
+
+    MD5_ParseExpect(&s, "numAnimatedComponents");
+    num_animated_components = MD5_ParseUint(&s, 0, q_countof(anim_frame_data));
+
+    MD5_ParseExpect(&s, "hierarchy");
+    MD5_ParseExpect(&s, "{");
+
+    for (i = 0; i < mdl->num_joints; i++) {
+        joint_info_t *joint_info = &joint_infos[i];
+
+        COM_ParseToken(&s, joint_info->name, sizeof(joint_info->name), PARSE_FLAG_NONE);
+
+        joint_info->parent      = MD5_ParseInt (&s, -1, mdl->num_joints - 1);
+        joint_info->flags       = MD5_ParseUint(&s,  0, UINT32_MAX);
+        joint_info->start_index = MD5_ParseUint(&s,  0, num_animated_components);
+        joint_info->scale_pos = false;
+
+        // validate animated components
+        int num_components = 0;
+
+        for (j = 0; j < MD5C_NUM_ANIMATED_COMPONENT_BITS; j++)
+            if (joint_info->flags & BIT(j))
+                num_components++;
+
+        if (joint_info->start_index + num_components > (int)num_animated_components)
+            MD5_ParseError("Bad joint info");
+
+        // parent must be -1 or already processed joint
+        if (joint_info->parent >= (int)i)
+            MD5_ParseError("Bad parent joint");
+    }
+
+    MD5_ParseExpect(&s, "}");
+
+    // bounds are ignored and are apparently usually wrong anyways
+    // so we'll just rely on them being "replacement" MD2s/MD3s.
+    // the MD2/MD3 ones are used instead.
+    MD5_ParseExpect(&s, "bounds");
+    MD5_ParseExpect(&s, "{");
+
+    for (i = 0; i < mdl->num_frames * 2 * 5; i++)
+        COM_SkipToken(&s);
+
+    MD5_ParseExpect(&s, "}");
+
+    MD5_ParseExpect(&s, "baseframe");
+    MD5_ParseExpect(&s, "{");
+
+    for (i = 0; i < mdl->num_joints; i++) {
+        baseframe_joint_t *base_joint = &base_frame[i];
+
+        MD5_ParseVector(&s, base_joint->pos);
+        MD5_ParseVector(&s, base_joint->orient);
+
+        Quat_ComputeW(base_joint->orient);
+    }
+
+    MD5_ParseExpect(&s, "}");
+
+    mdl->frames = MD5C_Malloc(sizeof(mdl->frames[0]) * mdl->num_frames * mdl->num_joints);
+
+    // initialize scales
+    for (i = 0; i < mdl->num_frames * mdl->num_joints; i++)
+        mdl->frames[i].scale = 1.0f;
+
+    // load scales
+    if (*scale_path)
+        MD5_LoadScales(mdl, scale_path, joint_infos);
+
+    for (i = 0; i < mdl->num_frames; i++) {
+        MD5_ParseExpect(&s, "frame");
+
+        uint32_t frame_index = MD5_ParseUint(&s, 0, mdl->num_frames - 1);
+
+        MD5_ParseExpect(&s, "{");
+        for (j = 0; j < num_animated_components; j++)
+            anim_frame_data[j] = MD5_ParseFloat(&s);
+        MD5_ParseExpect(&s, "}");
+
+        /* Build frame skeleton from the collected data */
+        MD5_BuildFrameSkeleton(joint_infos, base_frame, anim_frame_data,
+                               &mdl->frames[frame_index * mdl->num_joints], mdl->num_joints);
+    }
+}
+
+static void MD5_FreeParsed(parsed_model_t *mdl)
+{
+    for (int i = 0; i < MD5C_MAX_MESHES; i++) {
+        parsed_mesh_t *mesh = &mdl->meshes[i];
+        Z_Free(mesh->vertices);
+        Z_Free(mesh->tcoords);
+        Z_Free(mesh->indices);
+        Z_Free(mesh->weights);
+        Z_Free(mesh->jointnums);
+    }
+    Z_Free(mdl->frames);
+}
+
+static bool MD5_LoadText(const char *path, char **data)
+{
+    int ret = FS_LoadFile(path, (void **)data);
+
+    if (!*data) {
+        Com_EPrintf("Couldn't load %s: %s\n", Com_MakePrintable(path), Q_ErrorString(ret));
+        return false;
+    }
+
+    return true;
+}
+
+// parses both text files, returns false after printing an error
+static bool MD5_Parse(parsed_model_t *mdl, const char *mesh_path,
+                      const char *anim_path, const char *scale_path)
+{
+    char *mesh_data, *anim_data;
+    const char *volatile path = mesh_path;
+
+    if (!MD5_LoadText(mesh_path, &mesh_data))
+        return false;
+    if (!MD5_LoadText(anim_path, &anim_data)) {
+        FS_FreeFile(mesh_data);
+        return false;
+    }
+
+    if (setjmp(md5_jmpbuf)) {
+        Com_EPrintf("Couldn't load %s: %s\n", Com_MakePrintable(path), Com_GetLastError());
+        FS_FreeFile(mesh_data);
+        FS_FreeFile(anim_data);
+        return false;
+    }
+
+    MD5_ParseMesh(mdl, mesh_data);
+    path = anim_path;
+    MD5_ParseAnim(mdl, anim_data, scale_path);
+
+    FS_FreeFile(mesh_data);
+    FS_FreeFile(anim_data);
+    return true;
+}
+
+/*
+=============================================================================
+
+BLOB LAYOUT
+
+=============================================================================
+*/
+
+static uint32_t MD5_Place(size_t *size, size_t len)
+{
+    uint32_t ofs = Q_ALIGN(*size, MD5C_ALIGN);
+    *size = ofs + len;
+    return ofs;
+}
+
+static md5c_header_t *MD5_Compile(const parsed_model_t *mdl)
+{
+    md5c_header_t hdr = {
+        .ident = MD5C_IDENT,
+        .version = MD5C_VERSION,
+        .num_meshes = mdl->num_meshes,
+        .num_joints = mdl->num_joints,
+        .num_frames = mdl->num_frames,
+    };
+    md5c_mesh_t meshes[MD5C_MAX_MESHES];
+    size_t size = sizeof(hdr);
+    byte *out;
+
+    memset(meshes, 0, sizeof(meshes));
+
+    hdr.ofs_meshes = MD5_Place(&size, sizeof(meshes[0]) * mdl->num_meshes);
+
+    for (uint32_t i = 0; i < mdl->num_meshes; i++) {
+        const parsed_mesh_t *src = &mdl->meshes[i];
+        md5c_mesh_t *dst = &meshes[i];
+
+        memcpy(dst->shader, src->shader, sizeof(dst->shader));
+        dst->num_verts = src->num_verts;
+        dst->num_indices = src->num_indices;
+        dst->num_weights = src->num_weights;
+        dst->ofs_vertices = MD5_Place(&size, sizeof(src->vertices[0]) * src->num_verts);
+        dst->ofs_tcoords = MD5_Place(&size, sizeof(src->tcoords[0]) * src->num_verts);
+        dst->ofs_indices = MD5_Place(&size, sizeof(src->indices[0]) * src->num_indices);
+        dst->ofs_weights = MD5_Place(&size, sizeof(src->weights[0]) * src->num_weights);
+        dst->ofs_jointnums = MD5_Place(&size, sizeof(src->jointnums[0]) * src->num_weights);
+    }
+
+    hdr.ofs_frames = MD5_Place(&size, sizeof(mdl->frames[0]) * mdl->num_frames * mdl->num_joints);
+    hdr.size = size;
+
+    out = MD5C_Malloc(size);
+    memcpy(out, &hdr, sizeof(hdr));
+    memcpy(out + hdr.ofs_meshes, meshes, sizeof(meshes[0]) * mdl->num_meshes);
+
+    for (uint32_t i = 0; i < mdl->num_meshes; i++) {
+        const parsed_mesh_t *src = &mdl->meshes[i];
+        const md5c_mesh_t *dst = &meshes[i];
+
+        memcpy(out + dst->ofs_vertices, src->vertices, sizeof(src->vertices[0]) * src->num_verts);
+        memcpy(out + dst->ofs_tcoords, src->tcoords, sizeof(src->tcoords[0]) * src->num_verts);
+        memcpy(out + dst->ofs_indices, src->indices, sizeof(src->indices[0]) * src->num_indices);
+        memcpy(out + dst->ofs_weights, src->weights, sizeof(src->weights[0]) * src->num_weights);
+        memcpy(out + dst->ofs_jointnums, src->jointnums, sizeof(src->jointnums[0]) * src->num_weights);
+    }
+
+    memcpy(out + hdr.ofs_frames, mdl->frames, sizeof(mdl->frames[0]) * mdl->num_frames * mdl->num_joints);
+
+    return (md5c_header_t *)out;
+}
+
+static bool MD5_CheckRange(const md5c_header_t *hdr, uint32_t ofs, size_t count, size_t elem)
+{
+    return !(ofs & (MD5C_ALIGN - 1)) && ofs <= hdr->size && count <= (hdr->size - ofs) / elem;
+}
+
+// cache files come from the write dir, check everything renderers index with
+static bool MD5_CheckCompiled(const md5c_header_t *hdr, int len, const md5c_source_t *sources)
+{
+    if (len < (int)sizeof(*hdr))
+        return false;
+    if (hdr->ident != MD5C_IDENT || hdr->version != MD5C_VERSION || hdr->size != (uint32_t)len)
+        return false;
+    if (memcmp(hdr->sources, sources, sizeof(hdr->sources)))
+        return false;
+
+    if (hdr->num_meshes < 1 || hdr->num_meshes > MD5C_MAX_MESHES)
+        return false;
+    if (hdr->num_joints < 1 || hdr->num_joints > MD5C_MAX_JOINTS)
+        return false;
+    if (hdr->num_frames < 1 || hdr->num_frames > MD5C_MAX_FRAMES)
+        return false;
+    if (!MD5_CheckRange(hdr, hdr->ofs_meshes, hdr->num_meshes, sizeof(md5c_mesh_t)))
+        return false;
+    if (!MD5_CheckRange(hdr, hdr->ofs_frames, hdr->num_frames * hdr->num_joints, sizeof(md5c_joint_t)))
+        return false;
+
+    const md5c_mesh_t *meshes = MD5C_DATA(hdr, hdr->ofs_meshes);
+
+    for (uint32_t i = 0; i < hdr->num_meshes; i++) {
+        const md5c_mesh_t *mesh = &meshes[i];
+
+        if (!memchr(mesh->shader, 0, sizeof(mesh->shader)))
+            return false;
+        if (mesh->num_verts > MD5C_MAX_VERTICES || mesh->num_indices > MD5C_MAX_INDICES ||
+            mesh->num_indices % 3 || mesh->num_weights > MD5C_MAX_WEIGHTS)
+            return false;
+        if (!MD5_CheckRange(hdr, mesh->ofs_vertices, mesh->num_verts, sizeof(md5c_vertex_t)) ||
+            !MD5_CheckRange(hdr, mesh->ofs_tcoords, mesh->num_verts, sizeof(md5c_tcoord_t)) ||
+            !MD5_CheckRange(hdr, mesh->ofs_indices, mesh->num_indices, sizeof(uint16_t)) ||
+            !MD5_CheckRange(hdr, mesh->ofs_weights, mesh->num_weights, sizeof(md5c_weight_t)) ||
+            !MD5_CheckRange(hdr, mesh->ofs_jointnums, mesh->num_weights, sizeof(uint8_t)))
+            return false;
+
+        const md5c_vertex_t *vertices = MD5C_DATA(hdr, mesh->ofs_vertices);
+        const uint16_t *indices = MD5C_DATA(hdr, mesh->ofs_indices);
+        const uint8_t *jointnums = MD5C_DATA(hdr, mesh->ofs_jointnums);
+
+        for (uint32_t j = 0; j < mesh->num_verts; j++)
+            if (vertices[j].start + vertices[j].count > mesh->num_weights)
+                return false;
+        for (uint32_t j = 0; j < mesh->num_indices; j++)
+            if (indices[j] >= mesh->num_verts)
+                return false;
+        for (uint32_t j = 0; j < mesh->num_weights; j++)
+            if (jointnums[j] >= hdr->num_joints)
+                return false;
+    }
+
+    return true;
+}
+
+/*
+=============================================================================
+
+CACHE
+
+=============================================================================
+*/
+
+static void MD5_SourceKey(md5c_source_t *src, const char *path)
+{
+    pack_source_t pack;
+    int len;
+
+    memset(src, 0, sizeof(*src));
+
+    len = *path ? FS_LoadFile(path, NULL) : Q_ERR(ENOENT);
+    if (len < 0) {
+        src->size = -1;
+        return;
+    }
+
+    src->size = len;
+    if (FS_LastModified(path, &src->mtime) == Q_ERR_SUCCESS)
+        return;
+
+    // stored in a pack, which doesn't keep mtimes; identify the entry by
+    // pack file and position instead of reading it
+    if (FS_PackSource(path, &pack) != Q_ERR_SUCCESS)
+        return;
+
+    src->mtime = pack.mtime;
+    src->pack_size = pack.size;
+    src->filepos = pack.filepos;
+
+    mdfour_t md;
+    mdfour_begin(&md);
+    mdfour_update(&md, (const uint8_t *)pack.filename, strlen(pack.filename));
+    mdfour_result(&md, src->pack_digest);
+}
+
+/*
+================
+R_MD5Load
+
+Returns compiled model for the given mesh and animation, with scales from
+the md5scale file next to the animation applied. Cache under md5cache/ is
+used in place if it matches the sources, otherwise they are parsed and the
+cache is rewritten. Returns NULL after printing an error.
+================
+*/
+const md5c_header_t *R_MD5Load(const char *mesh_path, const char *anim_path)
+{
+    md5c_source_t sources[MD5C_NUM_SOURCES];
+    char scale_path[MAX_QPATH], base_path[MAX_QPATH], cache_path[MAX_QPATH];
+    parsed_model_t *parsed;
+    md5c_header_t *hdr;
+    bool use_cache;
+    void *data;
+    int ret;
+
+    if (!r_md5_cache)
+        r_md5_cache = Cvar_Get("r_md5_cache", "1", 0);
+
+    if (COM_StripExtension(scale_path, anim_path, sizeof(scale_path)) >= sizeof(scale_path) ||
+        Q_strlcat(scale_path, ".md5scale", sizeof(scale_path)) >= sizeof(scale_path)) {
+        Com_WPrintf("MD5 scale path too long: %s\n", scale_path);
+        scale_path[0] = 0;
+    }
+
+    use_cache = r_md5_cache->integer &&
+        COM_StripExtension(base_path, mesh_path, sizeof(base_path)) < sizeof(base_path) &&
+        Q_concat(cache_path, sizeof(cache_path), "md5cache/", base_path, ".md5c") < sizeof(cache_path);
+
+    if (use_cache) {
+        MD5_SourceKey(&sources[MD5C_SOURCE_MESH], mesh_path);
+        MD5_SourceKey(&sources[MD5C_SOURCE_ANIM], anim_path);
+        MD5_SourceKey(&sources[MD5C_SOURCE_SCALE], scale_path);
+
+        ret = FS_LoadFileFlags(cache_path, &data, FS_FLAG_MMAP | FS_FLAG_MMAP_DISK);
+        if (data) {
+            if (MD5_CheckCompiled(data, ret, sources))
+                return data;
+            FS_FreeFile(data);
+        }
+    }
+
+    parsed = MD5C_Malloc(sizeof(*parsed));
+    hdr = NULL;
+
+    if (MD5_Parse(parsed, mesh_path, anim_path, scale_path))
+        hdr = MD5_Compile(parsed);
+
+    MD5_FreeParsed(parsed);
+    Z_Free(parsed);
+
+    if (hdr && use_cache) {
+        memcpy(hdr->sources, sources, sizeof(hdr->sources));
+        ret = FS_WriteFile(cache_path, hdr, hdr->size);
+        if (ret < 0)
+            Com_DPrintf("Couldn't write %s: %s\n", cache_path, Q_ErrorString(ret));
+    }
+
+    return hdr;
+}
+
+/*
+================
+R_MD5Free
+================
+*/
+void R_MD5Free(const md5c_header_t *hdr)
+{
+    // either a view of the cache file or an allocated blob
+    FS_FreeFile((void *)hdr);
+}
+
+#endif // USE_MD5
@@ -90,6 +90,9 @@ static const renderer_export_t renderer_exports = {
     .AddDebugText           = R_AddDebugText,
     .PaletteTable           = d_8to24table,
     .Config                 = &r_config,
+#if USE_REF == REF_GL
+    .ImageDecoder           = &r_image_decoder,
+#endif
 };
 
 RENDERER_API const renderer_export_t *Renderer_GetAPI(const renderer_import_t *import)
@@ -1827,6 +1827,44 @@ static void SV_Stop_f(void)
 
 //===========================================================
 
+static void print_vis_counter(const char *name, const vis_counter_t *c)
+{
+    Com_Printf("%-9s %10"PRIu64" %10"PRIu64" %5.1f%%\n", name, c->lookups, c->hits,
+               c->lookups ? c->hits * 100.0 / c->lookups : 0.0);
+}
+
+/*
+==================
+SV_Stats_f
+
+Prints server statistics. Use `sv_stats reset' to clear counters.
+==================
+*/
+static void SV_Stats_f(void)
+{
+    const vis_stats_t *vis = SV_GetVisStats();
+
+    const gamestate_stats_t *gs = SV_GetGamestateStats();
+
+    if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset")) {
+        SV_ResetVisStats();
+        SV_ResetGamestateStats();
+        return;
+    }
+
+    Com_Printf("Visibility cache (%s):\n", sv_viscache->integer ? "enabled" : "disabled");
+    Com_Printf("type         lookups       hits   rate\n"
+               "--------- ---------- ---------- ------\n");
+    print_vis_counter("pvs", &vis->rows[0]);
+    print_vis_counter("phs", &vis->rows[1]);
+    print_vis_counter("pvs2", &vis->rows[2]);
+    print_vis_counter("fatpvs", &vis->fatpvs);
+    print_vis_counter("areabits", &vis->areabits);
+
+    Com_Printf("\nGamestates: %u sent, %u cached, %.1f usec average\n", gs->sent, gs->hits,
+               gs->sent ? gs->time * 1e-3 / gs->sent : 0.0);
+}
+
 static const cmdreg_t c_server[] = {
     { "heartbeat", SV_Heartbeat_f },
     { "kick", SV_Kick_f, SV_SetPlayer_c },
@@ -1843,6 +1881,10 @@ static const cmdreg_t c_server[] = {
     { "gamemap", SV_GameMap_f, SV_Map_c },
     { "endgame", SV_Endgame_f },
     { "dumpents", SV_DumpEnts_f },
+    { "snapshotbench", SV_SnapshotBench_f },
+    { "tracebench", SV_TraceBench_f },
+    { "areatest", SV_AreaTest_f },
+    { "sv_stats", SV_Stats_f },
     { "setmaster", SV_SetMaster_f },
     { "listmasters", SV_ListMasters_f },
     { "killserver", SV_KillServer_f },
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "server.h"
+#include "system/pthread.h"
 
 /*
 =============================================================================
@@ -448,6 +449,264 @@ bool SV_WriteFrameToClient_Enhanced(client_t *client, unsigned maxsize)
 /*
 =============================================================================
 
+Visibility cache
+
+Vis rows are shared between all clients and multicasts looking from the
+same clusters. Fat PVS rows are keyed by the set of clusters touched by
+the fat PVS box, so cached results are exact. Rows don't change during
+the level, but area bits depend on portal state and are only cached
+until the end of the frame or the next portal state change.
+
+Only the game map is cached. All lookups happen on the main thread.
+
+=============================================================================
+*/
+
+#define VIS_HASH_SIZE   1024    // must be power of two
+#define VIS_MAX_ROWS    1024    // flushed at the end of frame if exceeded
+#define VIS_MAX_KEY     8       // fat PVS rows with more clusters are not cached
+#define VIS_FATPVS      -1      // key type for fat PVS rows
+
+typedef struct vis_row_s {
+    struct vis_row_s    *next;
+    struct vis_row_s    *hash_next;
+    int                 vis;
+    int                 numclusters;
+    int                 clusters[VIS_MAX_KEY];
+    visrow_t            *row;
+} vis_row_t;
+
+typedef struct {
+    unsigned    stamp;
+    int         bytes;
+    byte        bits[MAX_MAP_AREA_BYTES];
+} vis_areabits_t;
+
+static struct {
+    vis_row_t       *rows;
+    vis_row_t       *hash[VIS_HASH_SIZE];
+    int             numrows;
+    unsigned        stamp;
+    vis_areabits_t  areabits[MAX_MAP_AREAS];
+    vis_stats_t     stats;
+} vis_cache;
+
+static bool SV_VisCacheEnabled(const cm_t *cm)
+{
+    return sv_viscache->integer && cm == &sv.cm && cm->cache && cm->cache->vis;
+}
+
+static vis_row_t *SV_FindVisRow(int vis, const int *clusters, int numclusters, unsigned *hash)
+{
+    vis_row_t *r;
+    unsigned h;
+    int i;
+
+    h = vis;
+    for (i = 0; i < numclusters; i++)
+        h = h * 31 + clusters[i];
+    h &= VIS_HASH_SIZE - 1;
+    *hash = h;
+
+    for (r = vis_cache.hash[h]; r; r = r->hash_next) {
+        if (r->vis != vis || r->numclusters != numclusters)
+            continue;
+        if (!memcmp(r->clusters, clusters, sizeof(clusters[0]) * numclusters))
+            return r;
+    }
+
+    return NULL;
+}
+
+static vis_row_t *SV_AddVisRow(int vis, const int *clusters, int numclusters, unsigned hash)
+{
+    size_t rowsize = VIS_FAST_LONGS(sv.cm.cache->visrowsize) * sizeof(size_t);
+    vis_row_t *r = SV_Malloc(sizeof(*r) + rowsize);
+
+    r->vis = vis;
+    r->numclusters = numclusters;
+    memcpy(r->clusters, clusters, sizeof(clusters[0]) * numclusters);
+    r->row = (visrow_t *)(r + 1);
+
+    r->next = vis_cache.rows;
+    vis_cache.rows = r;
+    r->hash_next = vis_cache.hash[hash];
+    vis_cache.hash[hash] = r;
+    vis_cache.numrows++;
+
+    return r;
+}
+
+/*
+=============
+SV_ClusterVis
+
+Returns decompressed vis row of the given cluster. Result is either
+cached or stored in `temp'.
+=============
+*/
+const visrow_t *SV_ClusterVis(const cm_t *cm, visrow_t *temp, int cluster, int vis)
+{
+    vis_counter_t *c = &vis_cache.stats.rows[vis == DVIS_PVS2 ? 2 : vis];
+    vis_row_t *r;
+    unsigned hash;
+
+    if (!SV_VisCacheEnabled(cm)) {
+        BSP_ClusterVis(cm->cache, temp, cluster, vis);
+        return temp;
+    }
+
+    c->lookups++;
+    r = SV_FindVisRow(vis, &cluster, 1, &hash);
+    if (r) {
+        c->hits++;
+        return r->row;
+    }
+
+    r = SV_AddVisRow(vis, &cluster, 1, hash);
+    BSP_ClusterVis(cm->cache, r->row, cluster, vis);
+    return r->row;
+}
+
+/*
+=============
+SV_FatPVS
+
+Returns combined PVS of all clusters around the given origin. Result is
+either cached or stored in `temp'.
+=============
+*/
+const visrow_t *SV_FatPVS(const cm_t *cm, visrow_t *temp, const vec3_t org)
+{
+    vis_counter_t *c = &vis_cache.stats.fatpvs;
+    int clusters[MAX_FATPVS_CLUSTERS];
+    int i, j, count, key;
+    vis_row_t *r;
+    unsigned hash;
+
+    if (!SV_VisCacheEnabled(cm)) {
+        CM_FatPVS(cm, temp, org);
+        return temp;
+    }
+
+    count = CM_FatPVSClusters(cm, org, clusters);
+    if (count > VIS_MAX_KEY) {
+        CM_ClusterListPVS(cm, temp, clusters, count);
+        return temp;
+    }
+
+    // result doesn't depend on cluster order, sort them
+    for (i = 1; i < count; i++) {
+        key = clusters[i];
+        for (j = i - 1; j >= 0 && clusters[j] > key; j--)
+            clusters[j + 1] = clusters[j];
+        clusters[j + 1] = key;
+    }
+
+    c->lookups++;
+    r = SV_FindVisRow(VIS_FATPVS, clusters, count, &hash);
+    if (r) {
+        c->hits++;
+        return r->row;
+    }
+
+    r = SV_AddVisRow(VIS_FATPVS, clusters, count, hash);
+    CM_ClusterListPVS(cm, r->row, clusters, count);
+    return r->row;
+}
+
+/*
+=============
+SV_WriteAreaBits
+
+Cached version of CM_WriteAreaBits().
+=============
+*/
+int SV_WriteAreaBits(const cm_t *cm, byte *buffer, int area)
+{
+    vis_counter_t *c = &vis_cache.stats.areabits;
+    vis_areabits_t *a;
+
+    if (!sv_viscache->integer || cm != &sv.cm || area < 0 || area >= MAX_MAP_AREAS)
+        return CM_WriteAreaBits(cm, buffer, area);
+
+    c->lookups++;
+    a = &vis_cache.areabits[area];
+    if (a->stamp && a->stamp == vis_cache.stamp) {
+        c->hits++;
+    } else {
+        a->bytes = CM_WriteAreaBits(cm, a->bits, area);
+        a->stamp = vis_cache.stamp;
+    }
+
+    memcpy(buffer, a->bits, a->bytes);
+    return a->bytes;
+}
+
+/*
+=============
+SV_InvalidateAreaBits
+
+Called when area portal state changes.
+=============
+*/
+void SV_InvalidateAreaBits(void)
+{
+    // stamp 0 is never valid
+    if (!++vis_cache.stamp)
+        vis_cache.stamp++;
+}
+
+/*
+=============
+SV_ClearVisCache
+=============
+*/
+void SV_ClearVisCache(void)
+{
+    vis_row_t *r, *next;
+
+    for (r = vis_cache.rows; r; r = next) {
+        next = r->next;
+        Z_Free(r);
+    }
+
+    vis_cache.rows = NULL;
+    vis_cache.numrows = 0;
+    memset(vis_cache.hash, 0, sizeof(vis_cache.hash));
+    SV_InvalidateAreaBits();
+}
+
+/*
+=============
+SV_EndVisCacheFrame
+
+Expires area bits and keeps the row cache from growing unbounded.
+Rows are never freed during a frame because frame jobs hold pointers
+to them.
+=============
+*/
+void SV_EndVisCacheFrame(void)
+{
+    if (vis_cache.numrows > VIS_MAX_ROWS)
+        SV_ClearVisCache();
+    else
+        SV_InvalidateAreaBits();
+}
+
+const vis_stats_t *SV_GetVisStats(void)
+{
+    return &vis_cache.stats;
+}
+
+void SV_ResetVisStats(void)
+{
+    memset(&vis_cache.stats, 0, sizeof(vis_cache.stats));
+}
+
+/*
+=============================================================================
+
 Build a client frame structure
 
 =============================================================================
@@ -523,81 +782,99 @@ static bool SV_EntityAttenuatedAway(const vec3_t org, const edict_t *ent)
 #define IS_MONSTER(ent) \
     ((ent->svflags & (SVF_MONSTER | SVF_DEADMONSTER)) == SVF_MONSTER || (ent->s.renderfx & RF_FRAMELERP))
 
-#define IS_HI_PRIO(ent) \
-    (ent->s.number <= sv_client->maxclients || IS_MONSTER(ent) || ent->solid == SOLID_BSP)
+#define IS_HI_PRIO(client, ent) \
+    (ent->s.number <= client->maxclients || IS_MONSTER(ent) || ent->solid == SOLID_BSP)
 
-#define IS_GIB(ent) \
-    (sv_client->csr->extended ? (ent->s.renderfx & RF_LOW_PRIORITY) : (ent->s.effects & (EF_GIB | EF_GREENGIB)))
+#define IS_GIB(client, ent) \
+    (client->csr->extended ? (ent->s.renderfx & RF_LOW_PRIORITY) : (ent->s.effects & (EF_GIB | EF_GREENGIB)))
 
-#define IS_LO_PRIO(ent) \
-    (IS_GIB(ent) || (!ent->s.modelindex && !ent->s.effects))
+#define IS_LO_PRIO(client, ent) \
+    (IS_GIB(client, ent) || (!ent->s.modelindex && !ent->s.effects))
 
-static vec3_t clientorg;
+// sort keys are computed up front so that comparison functions
+// don't need any global state and can run on any thread
+typedef struct {
+    edict_t     *ent;
+    bool        hi_prio;
+    bool        lo_prio;
+    float       dist;
+} frame_entity_t;
+
+// per-thread scratch space for collecting entities
+typedef struct {
+    frame_entity_t  edicts[MAX_EDICTS];
+    uint32_t        candidates[MAX_EDICTS / 32];
+    visrow_t        mask;
+} frame_scratch_t;
+
+// per-client state computed on the main thread before entity
+// collection, which may then happen on a worker thread
+typedef struct {
+    client_t    *client;
+    vec3_t      org;
+    int         clientarea;
+    int         max_packet_entities;
+    bool        client_is_spectator;
+    bool        client_is_dead;
+    const visrow_t  *clientphs;
+    const visrow_t  *clientpvs;
+    const visrow_t  *clientpvs2;
+    visrow_t    temp[3];    // used if visibility is not cached
+} frame_job_t;
+
+// entities that must be considered for every client regardless of
+// clusters they are linked into, rebuilt each frame
+static struct {
+    bool        enabled;
+    uint32_t    always[MAX_EDICTS / 32];
+} frame_index;
 
 static int entpriocmp(const void *p1, const void *p2)
 {
-    const edict_t *a = *(const edict_t **)p1;
-    const edict_t *b = *(const edict_t **)p2;
+    const frame_entity_t *a = (const frame_entity_t *)p1;
+    const frame_entity_t *b = (const frame_entity_t *)p2;
 
-    bool hi_a = IS_HI_PRIO(a);
-    bool hi_b = IS_HI_PRIO(b);
-    if (hi_a != hi_b)
-        return hi_b - hi_a;
+    if (a->hi_prio != b->hi_prio)
+        return b->hi_prio - a->hi_prio;
 
-    bool lo_a = IS_LO_PRIO(a);
-    bool lo_b = IS_LO_PRIO(b);
-    if (lo_a != lo_b)
-        return lo_a - lo_b;
+    if (a->lo_prio != b->lo_prio)
+        return a->lo_prio - b->lo_prio;
 
-    float dist_a = DistanceSquared(a->s.origin, clientorg);
-    float dist_b = DistanceSquared(b->s.origin, clientorg);
-    if (dist_a > dist_b)
+    if (a->dist > b->dist)
         return 1;
     return -1;
 }
 
 static int entnumcmp(const void *p1, const void *p2)
 {
-    const edict_t *a = *(const edict_t **)p1;
-    const edict_t *b = *(const edict_t **)p2;
-    return a->s.number - b->s.number;
+    const frame_entity_t *a = (const frame_entity_t *)p1;
+    const frame_entity_t *b = (const frame_entity_t *)p2;
+    return a->ent->s.number - b->ent->s.number;
 }
 
 /*
 =============
-SV_BuildClientFrame
+SV_SetupClientFrame
 
-Decides which entities are going to be visible to the client, and
-copies off the playerstat and areabits.
+Initializes the frame header, copies off the playerstate and areabits
+and calculates visibility. Must be called from the main thread.
 =============
 */
-void SV_BuildClientFrame(client_t *client)
+static bool SV_SetupClientFrame(client_t *client, frame_job_t *job)
 {
-    int         i, e;
-    vec3_t      org;
-    edict_t     *ent;
-    server_entity_t *svent;
-    edict_t     *clent;
+    edict_t         *clent;
     client_frame_t  *frame;
-    server_entity_packed_t *state;
     const mleaf_t   *leaf;
-    int         clientarea, clientcluster;
-    visrow_t    clientphs;
-    visrow_t    clientpvs;
-    visrow_t    clientpvs2;
-    int         max_packet_entities;
-    edict_t     *edicts[MAX_EDICTS];
-    int         num_edicts;
-    qboolean (*visible)(edict_t *, edict_t *) = NULL;
-    qboolean (*customize)(edict_t *, edict_t *, customize_entity_t *) = NULL;
-    customize_entity_t temp;
+    int             clientcluster;
 
     clent = client->edict;
     if (!clent->client)
-        return;        // not in game yet
+        return false;   // not in game yet
 
     Q_assert(client->entities);
 
+    job->client = client;
+
     // this is the frame we are creating
     frame = &client->frames[client->framenum & UPDATE_MASK];
     frame->number = client->framenum;
@@ -607,17 +884,17 @@ void SV_BuildClientFrame(client_t *client)
     client->frames_sent++;
 
     // find the client's PVS
-    SV_GetClient_ViewOrg(client, org);
+    SV_GetClient_ViewOrg(client, job->org);
     // Rerelease game doesn't include viewheight in viewoffset, vanilla does
     if (svs.game_api == Q2PROTO_GAME_RERELEASE)
-        org[2] += clent->client->ps.pmove.viewheight;
+        job->org[2] += clent->client->ps.pmove.viewheight;
 
-    leaf = CM_PointLeaf(client->cm, org);
-    clientarea = leaf->area;
+    leaf = CM_PointLeaf(client->cm, job->org);
+    job->clientarea = leaf->area;
     clientcluster = leaf->cluster;
 
     // calculate the visible areas
-    frame->areabytes = CM_WriteAreaBits(client->cm, frame->areabits, clientarea);
+    frame->areabytes = SV_WriteAreaBits(client->cm, frame->areabits, job->clientarea);
     if (!frame->areabytes) {
         frame->areabits[0] = 255;
         frame->areabytes = 1;
@@ -639,134 +916,267 @@ void SV_BuildClientFrame(client_t *client)
     }
 
     // limit maximum number of entities in client frame
-    max_packet_entities =
+    job->max_packet_entities =
         sv_max_packet_entities->integer > 0 ? sv_max_packet_entities->integer :
         MAX_PACKET_ENTITIES;
 
-    if (g_customize_entity) {
-        visible = g_customize_entity->EntityVisibleToClient;
-        customize = g_customize_entity->CustomizeEntityToClient;
-    }
-
-    CM_FatPVS(client->cm, &clientpvs, org);
-    BSP_ClusterVis(client->cm->cache, &clientphs, clientcluster, DVIS_PHS);
-    BSP_ClusterVis(client->cm->cache, &clientpvs2, clientcluster, DVIS_PVS2);
-
-    bool client_is_spectator = clent->client->ps.pmove.pm_type == PM_SPECTATOR
+    job->client_is_spectator = clent->client->ps.pmove.pm_type == PM_SPECTATOR
         || clent->client->ps.pmove.pm_type == PM_FREEZE;
-    bool client_is_dead = clent->client->ps.pmove.pm_type == PM_DEAD
+    job->client_is_dead = clent->client->ps.pmove.pm_type == PM_DEAD
         || clent->client->ps.pmove.pm_type == PM_GIB;
 
-    // build up the list of visible entities
-    frame->num_entities = 0;
-    frame->first_entity = client->next_entity;
+    job->clientpvs = SV_FatPVS(client->cm, &job->temp[0], job->org);
+    job->clientphs = SV_ClusterVis(client->cm, &job->temp[1], clientcluster, DVIS_PHS);
+    job->clientpvs2 = SV_ClusterVis(client->cm, &job->temp[2], clientcluster, DVIS_PVS2);
 
-    num_edicts = 0;
-    for (e = 1; e < client->ge->num_edicts; e++) {
-        ent = EDICT_NUM2(client->ge, e);
-        svent = &sv.entities[e];
+    return true;
+}
+
+/*
+=============
+SV_PrepareFrameEntities
 
-        // ignore entities not in use
+Fixes up entity numbers and builds the list of entities that can't be
+culled by cluster index. Must be called from the main thread before
+building any client frames.
+=============
+*/
+static void SV_PrepareFrameEntities(void)
+{
+    edict_t *ent;
+    int e;
+
+    frame_index.enabled = false;
+    if (sv.state != ss_game)
+        return;
+
+    frame_index.enabled = !sv_novis->integer && sv.cm.cache && sv.cm.cache->vis;
+    memset(frame_index.always, 0, sizeof(frame_index.always));
+
+    for (e = 1; e < ge->num_edicts; e++) {
+        ent = EDICT_NUM(e);
         if (!ent->inuse && (g_features->integer & GMF_PROPERINUSE))
             continue;
-
-        // ignore ents without visible models
         if (ent->svflags & SVF_NOCLIENT)
             continue;
-
-        // ignore ents without visible models unless they have an effect
         if (!HAS_EFFECTS(ent))
             continue;
 
-        // ignore gibs if client says so
-        if (client->settings[CLS_NOGIBS]) {
-            if (ent->s.effects & EF_GIB && !(client->csr->extended && ent->s.effects & EF_ROCKET))
-                continue;
-            if (ent->s.effects & EF_GREENGIB)
-                continue;
+        // fix up entity numbers here, so that workers never need to
+        SV_CheckEntityNumber(ent, e);
+
+        // clients may be forced visible to teammates and spectators,
+        // beams are culled by PHS from one point only, and entities
+        // touching too many leafs go by headnode
+        if (ent->svflags & SVF_NOCULL || ent->client || ent->s.renderfx & RF_BEAM ||
+            sv.entities[e].num_clusters == -1)
+            frame_index.always[e >> 5] |= 1U << (e & 31);
+    }
+}
+
+/*
+=============
+SV_CollectCandidates
+
+Marks entities that may be visible to the client. Returns number of
+words in candidate bitmap.
+=============
+*/
+static int SV_CollectCandidates(const frame_job_t *job, frame_scratch_t *scratch)
+{
+    const client_t *client = job->client;
+    int i, words = (client->ge->num_edicts + 31) >> 5;
+
+    if (frame_index.enabled && client->cm == &sv.cm) {
+        for (i = 0; i < VIS_FAST_LONGS(sv.cm.cache->visrowsize); i++)
+            scratch->mask.l[i] = job->clientpvs->l[i] | job->clientphs->l[i] | job->clientpvs2->l[i];
+
+        memcpy(scratch->candidates, frame_index.always, words * sizeof(uint32_t));
+        if (SV_MarkClusterEntities(&scratch->mask, scratch->candidates))
+            return words;
+    }
+
+    memset(scratch->candidates, 255, words * sizeof(uint32_t));
+    return words;
+}
+
+/*
+=============
+SV_FrameEntityVisible
+
+Runs all culling tests for a single entity.
+=============
+*/
+static bool SV_FrameEntityVisible(const frame_job_t *job, edict_t *ent, int e)
+{
+    const client_t  *client = job->client;
+    const float     *org = job->org;
+    edict_t         *clent = client->edict;
+    server_entity_t *svent = &sv.entities[e];
+
+    // ignore entities not in use
+    if (!ent->inuse && (g_features->integer & GMF_PROPERINUSE))
+        return false;
+
+    // ignore ents without visible models
+    if (ent->svflags & SVF_NOCLIENT)
+        return false;
+
+    // ignore ents without visible models unless they have an effect
+    if (!HAS_EFFECTS(ent))
+        return false;
+
+    // ignore gibs if client says so
+    if (client->settings[CLS_NOGIBS]) {
+        if (ent->s.effects & EF_GIB && !(client->csr->extended && ent->s.effects & EF_ROCKET))
+            return false;
+        if (ent->s.effects & EF_GREENGIB)
+            return false;
+    }
+
+    bool force_visible = false;
+    if (ent != clent && ent->client && clent->client) {
+        uint8_t my_team = clent->client->ps.team_id;
+        if (my_team && ent->client->ps.team_id == my_team)
+            force_visible = true;
+        if (job->client_is_spectator || job->client_is_dead)
+            force_visible = true;
+    }
+
+    // ignore flares if client says so
+    if (client->csr->extended && ent->s.renderfx & RF_FLARE && client->settings[CLS_NOFLARES])
+        return false;
+
+    // ignore if not touching a PV leaf
+    if (ent != clent && !sv_novis->integer && !(ent->svflags & SVF_NOCULL) && !force_visible) {
+        // check area
+        if (!CM_AreasConnected(client->cm, job->clientarea, ent->areanum)) {
+            // doors can legally straddle two areas, so
+            // we may need to check another one
+            if (!CM_AreasConnected(client->cm, job->clientarea, ent->areanum2)) {
+                return false;        // blocked by a door
+            }
         }
 
-        bool force_visible = false;
-        if (ent != clent && ent->client && clent->client) {
-            uint8_t my_team = clent->client->ps.team_id;
-            if (my_team && ent->client->ps.team_id == my_team)
-                force_visible = true;
-            if (client_is_spectator || client_is_dead)
-                force_visible = true;
+        // beams just check one point for PHS
+        bool beam_cull = ent->s.renderfx & RF_BEAM;
+        // remaster uses different sound culling rules
+        bool sound_cull = ent->s.sound;
+
+        bool shadow_affecting = (ent->s.renderfx & RF_CASTSHADOW)
+            || (ent->s.modelindex && !(ent->s.renderfx & RF_NOSHADOW));
+        const visrow_t *entity_vis = (beam_cull || sound_cull) ? job->clientphs
+            : (shadow_affecting ? job->clientpvs2 : job->clientpvs);
+
+        if (!SV_EntityVisible(client, svent, entity_vis))
+            return false;
+
+        // don't send sounds if they will be attenuated away
+        if (sound_cull) {
+            if (SV_EntityAttenuatedAway(org, ent)) {
+                if (!ent->s.modelindex)
+                    return false;
+                const visrow_t *sound_vis = shadow_affecting ? job->clientpvs2 : job->clientpvs;
+                if (!beam_cull && !SV_EntityVisible(client, svent, sound_vis))
+                    return false;
+            }
+        } else if (!ent->s.modelindex && !(ent->s.renderfx & RF_CASTSHADOW)) {
+            // Paril TODO: is this a good idea? seems weird to remove
+            // visual effects based on distance if there's no model and
+            // no sound...
+            if (DistanceSquared(org, ent->s.origin) > 400 * 400)
+                return false;
         }
+    }
 
-        // ignore flares if client says so
-        if (client->csr->extended && ent->s.renderfx & RF_FLARE && client->settings[CLS_NOFLARES])
-            continue;
+    return true;
+}
 
-        // ignore if not touching a PV leaf
-        if (ent != clent && !sv_novis->integer && !(ent->svflags & SVF_NOCULL) && !force_visible) {
-            // check area
-            if (!CM_AreasConnected(client->cm, clientarea, ent->areanum)) {
-                // doors can legally straddle two areas, so
-                // we may need to check another one
-                if (!CM_AreasConnected(client->cm, clientarea, ent->areanum2)) {
-                    continue;        // blocked by a door
-                }
-            }
+/*
+=============
+SV_AddFrameEntities
 
-            // beams just check one point for PHS
-            bool beam_cull = ent->s.renderfx & RF_BEAM;
-            // remaster uses different sound culling rules
-            bool sound_cull = ent->s.sound;
+Decides which entities are going to be visible to the client and adds
+them to the frame. Safe to call from worker threads as long as game
+customization callbacks are not installed.
+=============
+*/
+static void SV_AddFrameEntities(const frame_job_t *job, frame_scratch_t *scratch)
+{
+    client_t    *client = job->client;
+    const float *org = job->org;
+    int         i, e, w, words;
+    uint32_t    bits;
+    edict_t     *ent;
+    edict_t     *clent;
+    client_frame_t  *frame;
+    server_entity_packed_t *state;
+    frame_entity_t  *edicts = scratch->edicts;
+    int         num_edicts;
+    bool        full;
+    qboolean (*visible)(edict_t *, edict_t *) = NULL;
+    qboolean (*customize)(edict_t *, edict_t *, customize_entity_t *) = NULL;
+    customize_entity_t temp;
 
-            bool shadow_affecting = (ent->s.renderfx & RF_CASTSHADOW)
-                || (ent->s.modelindex && !(ent->s.renderfx & RF_NOSHADOW));
-            const visrow_t *entity_vis = (beam_cull || sound_cull) ? &clientphs
-                : (shadow_affecting ? &clientpvs2 : &clientpvs);
+    clent = client->edict;
+    frame = &client->frames[client->framenum & UPDATE_MASK];
 
-            if (!SV_EntityVisible(client, svent, entity_vis))
+    if (g_customize_entity) {
+        visible = g_customize_entity->EntityVisibleToClient;
+        customize = g_customize_entity->CustomizeEntityToClient;
+    }
+
+    // build up the list of visible entities
+    frame->num_entities = 0;
+    frame->first_entity = client->next_entity;
+
+    // only visit entities in visible clusters, in ascending order
+    words = SV_CollectCandidates(job, scratch);
+
+    num_edicts = 0;
+    full = false;
+    for (w = 0; w < words && !full; w++) {
+        bits = scratch->candidates[w];
+        for (e = w << 5; bits; e++, bits >>= 1) {
+            if (!(bits & 1))
+                continue;
+            if (e < 1 || e >= client->ge->num_edicts)
                 continue;
 
-            // don't send sounds if they will be attenuated away
-            if (sound_cull) {
-                if (SV_EntityAttenuatedAway(org, ent)) {
-                    if (!ent->s.modelindex)
-                        continue;
-                    const visrow_t *sound_vis = shadow_affecting ? &clientpvs2 : &clientpvs;
-                    if (!beam_cull && !SV_EntityVisible(client, svent, sound_vis))
-                        continue;
-                }
-            } else if (!ent->s.modelindex && !(ent->s.renderfx & RF_CASTSHADOW)) {
-                // Paril TODO: is this a good idea? seems weird to remove
-                // visual effects based on distance if there's no model and
-                // no sound...
-                if (DistanceSquared(org, ent->s.origin) > 400 * 400)
-                    continue;
-            }
-        }
+            ent = EDICT_NUM2(client->ge, e);
+            if (!SV_FrameEntityVisible(job, ent, e))
+                continue;
 
-        SV_CheckEntityNumber(ent, e);
+            SV_CheckEntityNumber(ent, e);
 
-        // optionally skip it
-        if (visible && !visible(clent, ent))
-            continue;
+            // optionally skip it
+            if (visible && !visible(clent, ent))
+                continue;
 
-        edicts[num_edicts++] = ent;
+            edicts[num_edicts++].ent = ent;
 
-        if (num_edicts == max_packet_entities && !sv_prioritize_entities->integer)
-            break;
+            if (num_edicts == job->max_packet_entities && !sv_prioritize_entities->integer) {
+                full = true;
+                break;
+            }
+        }
     }
 
     // prioritize entities on overflow
-    if (num_edicts > max_packet_entities) {
-        VectorCopy(org, clientorg);
-        sv_client = client;
-        sv_player = client->edict;
+    if (num_edicts > job->max_packet_entities) {
+        for (i = 0; i < num_edicts; i++) {
+            ent = edicts[i].ent;
+            edicts[i].hi_prio = IS_HI_PRIO(client, ent);
+            edicts[i].lo_prio = IS_LO_PRIO(client, ent);
+            edicts[i].dist = DistanceSquared(ent->s.origin, org);
+        }
         qsort(edicts, num_edicts, sizeof(edicts[0]), entpriocmp);
-        sv_client = NULL;
-        sv_player = NULL;
-        num_edicts = max_packet_entities;
+        num_edicts = job->max_packet_entities;
         qsort(edicts, num_edicts, sizeof(edicts[0]), entnumcmp);
     }
 
     for (i = 0; i < num_edicts; i++) {
-        ent = edicts[i];
+        ent = edicts[i].ent;
         e = ent->s.number;
 
         // add it to the circular client_entities array
@@ -811,3 +1221,344 @@ void SV_BuildClientFrame(client_t *client)
         client->next_entity++;
     }
 }
+
+static frame_job_t      serial_job;
+static frame_scratch_t  serial_scratch;
+
+/*
+=============
+SV_BuildClientFrame
+
+Decides which entities are going to be visible to the client, and
+copies off the playerstat and areabits.
+=============
+*/
+static void SV_BuildClientFrame(client_t *client)
+{
+    bool ok;
+
+    PROF_BEGIN(PROF_SV_SNAPSHOT_SETUP);
+    ok = SV_SetupClientFrame(client, &serial_job);
+    PROF_END();
+
+    if (ok) {
+        PROF_BEGIN(PROF_SV_SNAPSHOT);
+        SV_AddFrameEntities(&serial_job, &serial_scratch);
+        PROF_END();
+    }
+}
+
+/*
+=============================================================================
+
+Parallel client frame building
+
+Frame setup (visibility, playerstate) runs on the main thread, then
+entity collection, prioritization and packing for all clients is
+distributed between worker threads and the main thread. Each client
+only writes into its own frame and entity ring, so the result is
+identical to building frames serially.
+
+=============================================================================
+*/
+
+#define MAX_FRAME_THREADS   32
+
+static struct {
+    int             num_threads;
+    pthread_t       threads[MAX_FRAME_THREADS];
+    frame_scratch_t *scratch[MAX_FRAME_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+    frame_job_t     *jobs;
+    int             max_jobs;
+    int             num_jobs;
+    int             next_job;
+    int             jobs_done;
+    unsigned        generation;
+    bool            terminate;
+} frame_pool;
+
+// called with frame_pool.lock held
+static void run_frame_jobs(frame_scratch_t *scratch)
+{
+    while (frame_pool.next_job < frame_pool.num_jobs) {
+        const frame_job_t *job = &frame_pool.jobs[frame_pool.next_job++];
+
+        pthread_mutex_unlock(&frame_pool.lock);
+        PROF_BEGIN(PROF_SV_SNAPSHOT);
+        SV_AddFrameEntities(job, scratch);
+        PROF_END();
+        pthread_mutex_lock(&frame_pool.lock);
+
+        if (++frame_pool.jobs_done == frame_pool.num_jobs)
+            pthread_cond_signal(&frame_pool.done_cond);
+    }
+}
+
+static void *frame_thread_func(void *arg)
+{
+    frame_scratch_t *scratch = arg;
+    unsigned generation = 0;
+
+    pthread_mutex_lock(&frame_pool.lock);
+    while (1) {
+        while (frame_pool.generation == generation && !frame_pool.terminate)
+            pthread_cond_wait(&frame_pool.work_cond, &frame_pool.lock);
+
+        if (frame_pool.terminate)
+            break;
+
+        generation = frame_pool.generation;
+        run_frame_jobs(scratch);
+    }
+    pthread_mutex_unlock(&frame_pool.lock);
+
+    Prof_ReleaseThread();
+    return NULL;
+}
+
+void SV_ShutdownFrameThreads(void)
+{
+    int i;
+
+    if (!frame_pool.num_threads)
+        return;
+
+    pthread_mutex_lock(&frame_pool.lock);
+    frame_pool.terminate = true;
+    pthread_mutex_unlock(&frame_pool.lock);
+
+    pthread_cond_broadcast(&frame_pool.work_cond);
+
+    for (i = 0; i < frame_pool.num_threads; i++) {
+        Q_assert(!pthread_join(frame_pool.threads[i], NULL));
+        Z_Free(frame_pool.scratch[i]);
+    }
+
+    pthread_mutex_destroy(&frame_pool.lock);
+    pthread_cond_destroy(&frame_pool.work_cond);
+    pthread_cond_destroy(&frame_pool.done_cond);
+
+    Z_Free(frame_pool.jobs);
+    memset(&frame_pool, 0, sizeof(frame_pool));
+}
+
+static void start_frame_threads(int count)
+{
+    int i;
+
+    pthread_mutex_init(&frame_pool.lock, NULL);
+    pthread_cond_init(&frame_pool.work_cond, NULL);
+    pthread_cond_init(&frame_pool.done_cond, NULL);
+
+    for (i = 0; i < count; i++) {
+        frame_pool.scratch[i] = Z_TagMalloc(sizeof(frame_scratch_t), TAG_SERVER);
+        if (pthread_create(&frame_pool.threads[i], NULL, frame_thread_func, frame_pool.scratch[i])) {
+            Com_EPrintf("Couldn't create snapshot thread\n");
+            Z_Free(frame_pool.scratch[i]);
+            break;
+        }
+    }
+
+    frame_pool.num_threads = i;
+    if (!i) {
+        pthread_mutex_destroy(&frame_pool.lock);
+        pthread_cond_destroy(&frame_pool.work_cond);
+        pthread_cond_destroy(&frame_pool.done_cond);
+    }
+}
+
+static bool check_frame_threads(void)
+{
+    int count = Cvar_ClampInteger(sv_snapshot_threads, 0, MAX_FRAME_THREADS);
+
+    if (count != frame_pool.num_threads) {
+        SV_ShutdownFrameThreads();
+        if (count)
+            start_frame_threads(count);
+    }
+
+    return frame_pool.num_threads > 0;
+}
+
+/*
+=============
+SV_BuildClientFrames
+
+Builds frames for a batch of clients, using worker threads if enabled.
+Produces exactly the same results as calling SV_BuildClientFrame() for
+each client in order.
+=============
+*/
+void SV_BuildClientFrames(client_t **clients, int count)
+{
+    frame_job_t *job;
+    int i;
+
+    SV_PrepareFrameEntities();
+
+    // game callbacks are not thread safe, and MVD channels may have
+    // separate entity lists per client
+    if (count < 2 || g_customize_entity || sv.state != ss_game || !check_frame_threads()) {
+        for (i = 0; i < count; i++)
+            SV_BuildClientFrame(clients[i]);
+        return;
+    }
+
+    if (frame_pool.max_jobs < count) {
+        Z_Free(frame_pool.jobs);
+        frame_pool.jobs = Z_TagMalloc(sizeof(frame_job_t) * count, TAG_SERVER);
+        frame_pool.max_jobs = count;
+    }
+
+    job = frame_pool.jobs;
+    for (i = 0; i < count; i++) {
+        PROF_BEGIN(PROF_SV_SNAPSHOT_SETUP);
+        if (SV_SetupClientFrame(clients[i], job))
+            job++;
+        PROF_END();
+    }
+
+    pthread_mutex_lock(&frame_pool.lock);
+    frame_pool.num_jobs = job - frame_pool.jobs;
+    frame_pool.next_job = 0;
+    frame_pool.jobs_done = 0;
+    frame_pool.generation++;
+    pthread_cond_broadcast(&frame_pool.work_cond);
+
+    // main thread works too
+    run_frame_jobs(&serial_scratch);
+
+    while (frame_pool.jobs_done < frame_pool.num_jobs)
+        pthread_cond_wait(&frame_pool.done_cond, &frame_pool.lock);
+    pthread_mutex_unlock(&frame_pool.lock);
+}
+
+/*
+=============
+SV_SnapshotBench_f
+
+Times frame building for increasing numbers of active clients, both
+serially and using worker threads, and verifies that results match
+a full scan of all entities.
+=============
+*/
+void SV_SnapshotBench_f(void)
+{
+    static client_t *clients[MAX_CLIENTS];
+    static int      next_entity[MAX_CLIENTS];
+    static unsigned frames_sent[MAX_CLIENTS];
+    client_frame_t  *frames, *frame;
+    server_entity_packed_t *states[MAX_CLIENTS];
+    client_t        *client;
+    int             i, j, n, count, iterations, mismatches;
+    uint64_t        start, serial_time, threaded_time;
+    bool            threaded;
+
+    if (sv.state != ss_game) {
+        Com_Printf("No game running.\n");
+        return;
+    }
+
+    count = 0;
+    FOR_EACH_CLIENT(client) {
+        if (CLIENT_ACTIVE(client) && client->edict->client) {
+            next_entity[count] = client->next_entity;
+            frames_sent[count] = client->frames_sent;
+            clients[count++] = client;
+        }
+    }
+    if (!count) {
+        Com_Printf("No active clients.\n");
+        return;
+    }
+
+    iterations = 100;
+    if (Cmd_Argc() > 1)
+        iterations = Q_clip(Q_atoi(Cmd_Argv(1)), 1, 100000);
+
+    threaded = !g_customize_entity && check_frame_threads();
+    if (!threaded)
+        Com_Printf("Worker threads disabled, timing serial path only.\n");
+
+#define RESTORE_CLIENTS(n) \
+    for (j = 0; j < n; j++) { \
+        clients[j]->next_entity = next_entity[j]; \
+        clients[j]->frames_sent = frames_sent[j]; \
+    }
+
+    // verify indexed and threaded results match a full serial scan
+    mismatches = 0;
+    frames = Z_TagMalloc(sizeof(frames[0]) * count, TAG_SERVER);
+    RESTORE_CLIENTS(count);
+    SV_PrepareFrameEntities();
+    frame_index.enabled = false;
+    for (i = 0; i < count; i++) {
+        client = clients[i];
+        SV_BuildClientFrame(client);
+        frame = &client->frames[client->framenum & UPDATE_MASK];
+        frames[i] = *frame;
+        states[i] = Z_TagMalloc(sizeof(states[0][0]) * (frame->num_entities + 1), TAG_SERVER);
+        for (j = 0; j < frame->num_entities; j++)
+            states[i][j] = client->entities[(frame->first_entity + j) & (client->num_entities - 1)];
+    }
+
+    RESTORE_CLIENTS(count);
+    SV_BuildClientFrames(clients, count);
+    for (i = 0; i < count; i++) {
+        client = clients[i];
+        frame = &client->frames[client->framenum & UPDATE_MASK];
+        if (memcmp(frame, &frames[i], sizeof(*frame))) {
+            mismatches++;
+        } else {
+            for (j = 0; j < frame->num_entities; j++) {
+                if (memcmp(&states[i][j], &client->entities[(frame->first_entity + j) & (client->num_entities - 1)], sizeof(states[0][0]))) {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+        Z_Free(states[i]);
+    }
+    Z_Free(frames);
+
+    Com_Printf("%d iterations, %d worker threads\n", iterations, frame_pool.num_threads);
+    Com_Printf("clients serial(usec) threaded(usec)\n"
+               "------- ------------ --------------\n");
+
+    for (n = 1; ; n = min(n * 2, count)) {
+        start = Sys_Nanoseconds();
+        for (i = 0; i < iterations; i++) {
+            RESTORE_CLIENTS(n);
+            SV_PrepareFrameEntities();
+            for (j = 0; j < n; j++)
+                SV_BuildClientFrame(clients[j]);
+        }
+        serial_time = Sys_Nanoseconds() - start;
+
+        threaded_time = 0;
+        if (threaded) {
+            start = Sys_Nanoseconds();
+            for (i = 0; i < iterations; i++) {
+                RESTORE_CLIENTS(n);
+                SV_BuildClientFrames(clients, n);
+            }
+            threaded_time = Sys_Nanoseconds() - start;
+        }
+
+        Com_Printf("%7d %12.1f %14.1f\n", n,
+                   serial_time * 1e-3 / iterations,
+                   threaded_time * 1e-3 / iterations);
+
+        if (n == count)
+            break;
+    }
+
+    RESTORE_CLIENTS(count);
+
+#undef RESTORE_CLIENTS
+
+    Com_Printf("%d mismatched frames\n", mismatches);
+}
@@ -470,6 +470,8 @@ static void PF_configstring(int index, const char *val)
     memcpy(dst, val, len);
     dst[len] = 0;
 
+    SV_ClearGamestateCache();
+
     if (sv.state == ss_loading) {
         return;
     }
@@ -802,6 +804,7 @@ static void PF_AddCommandString(const char *string)
 static void PF_SetAreaPortalState(int portalnum, bool open)
 {
     CM_SetAreaPortalState(&sv.cm, portalnum, open);
+    SV_InvalidateAreaBits();
 }
 
 static qboolean PF_AreasConnected(int area1, int area2)
@@ -830,7 +833,8 @@ static int PF_LoadFile(const char *path, void **buffer, unsigned flags, unsigned
     if (tag > UINT16_MAX - TAG_MAX) {
         Com_Error(ERR_DROP, "%s: bad tag", __func__);
     }
-    return FS_LoadFileEx(path, buffer, flags, tag + TAG_MAX);
+    // game frees buffers with TagFree, so it can't get views of packs
+    return FS_LoadFileEx(path, buffer, flags & ~FS_FLAG_MMAP, tag + TAG_MAX);
 }
 
 static void *PF_GetExtension(const char *name);
@@ -1123,6 +1127,32 @@ static const filesystem_api_v1_t filesystem_api_v1 = {
     .ErrorString = Q_ErrorString,
 };
 
+static const trace_api_v1_t trace_api_v1 = {
+    .TraceBatch = SV_TraceBatch,
+};
+
+static void PF_BeginZone(int zone)
+{
+    PROF_BEGIN(zone);
+}
+
+static void PF_EndZone(void)
+{
+    PROF_END();
+}
+
+static const profile_api_v1_t profile_api_v1 = {
+    .RegisterZone = Prof_RegisterZone,
+    .BeginZone = PF_BeginZone,
+    .EndZone = PF_EndZone,
+};
+
+static const nav_api_v1_t nav_api_v1 = {
+    .RequestPath = Nav_RequestPath,
+    .PollPath = Nav_PollPath,
+    .CancelPath = Nav_CancelPath,
+};
+
 #if USE_REF && USE_DEBUG
 static const debug_draw_api_v1_t debug_draw_api_v1 = {
     .ClearDebugLines = R_ClearDebugLines,
@@ -1147,6 +1177,15 @@ static void *PF_GetExtension(const char *name)
     if (!strcmp(name, FILESYSTEM_API_V1))
         return (void *)&filesystem_api_v1;
 
+    if (!strcmp(name, TRACE_API_V1))
+        return (void *)&trace_api_v1;
+
+    if (!strcmp(name, PROFILE_API_V1))
+        return (void *)&profile_api_v1;
+
+    if (!strcmp(name, NAV_API_V1))
+        return (void *)&nav_api_v1;
+
 #if USE_REF && USE_DEBUG
     if (!strcmp(name, DEBUG_DRAW_API_V1) && !dedicated->integer)
         return (void *)&debug_draw_api_v1;
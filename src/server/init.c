@@ -123,6 +123,8 @@ void SV_SpawnServer(const mapcmd_t *cmd)
     // free current level
     CM_FreeMap(&sv.cm);
     Nav_Unload();
+    SV_ClearVisCache();
+    SV_ClearGamestateCache();
 
     // wipe the entire per-level structure
     memset(&sv, 0, sizeof(sv));
@@ -83,6 +83,8 @@ cvar_t  *sv_max_download_size;
 cvar_t  *sv_max_packet_entities;
 cvar_t  *sv_trunc_packet_entities;
 cvar_t  *sv_prioritize_entities;
+cvar_t  *sv_snapshot_threads;
+cvar_t  *sv_viscache;
 
 cvar_t  *sv_strafejump_hack;
 cvar_t  *sv_waterjump_hack;
@@ -1710,7 +1712,9 @@ SV_RunGameFrame
 static void SV_RunGameFrame(void)
 {
     // save the entire world state if recording a serverdemo
+    PROF_BEGIN(PROF_SV_MVD_CAPTURE);
     SV_MvdBeginFrame();
+    PROF_END();
 
 #if USE_CLIENT
     if (host_speeds->integer)
@@ -1722,9 +1726,13 @@ static void SV_RunGameFrame(void)
 #endif
 
     // run nav stuff before frame runs
+    PROF_BEGIN(PROF_SV_NAV);
     Nav_Frame();
+    PROF_END();
 
+    PROF_BEGIN(PROF_SV_GAME_FRAME);
     ge->RunFrame(true);
+    PROF_END();
 
 #if USE_CLIENT
     if (host_speeds->integer)
@@ -1742,7 +1750,9 @@ static void SV_RunGameFrame(void)
     }
 
     // save the entire world state if recording a serverdemo
+    PROF_BEGIN(PROF_SV_MVD_CAPTURE);
     SV_MvdEndFrame();
+    PROF_END();
 }
 
 /*
@@ -1859,17 +1869,25 @@ unsigned SV_Frame(unsigned msec)
 #endif
 
     // read packets from UDP clients
+    PROF_BEGIN(PROF_SV_PACKETS);
     NET_GetPackets(NS_SERVER, SV_PacketEvent);
+    PROF_END();
 
     if (svs.initialized) {
         // run connection to the anticheat server
+        PROF_BEGIN(PROF_SV_ANTICHEAT);
         AC_Run();
+        PROF_END();
 
         // run connections from MVD/GTV clients
+        PROF_BEGIN(PROF_SV_MVD_CLIENTS);
         SV_MvdRunClients();
+        PROF_END();
 
         // deliver fragments and reliable messages for connecting clients
+        PROF_BEGIN(PROF_SV_ASYNC_PACKETS);
         SV_SendAsyncPackets();
+        PROF_END();
     }
 
     // move autonomous things around if enough time has passed
@@ -1879,6 +1897,8 @@ unsigned SV_Frame(unsigned msec)
     }
 
     if (svs.initialized && !check_paused()) {
+        PROF_BEGIN(PROF_SV_FRAME);
+
         // check timeouts
         SV_CheckTimeouts();
 
@@ -1889,10 +1909,17 @@ unsigned SV_Frame(unsigned msec)
         SV_GiveMsec();
 
         // let everything in the world think and move
+        PROF_BEGIN(PROF_SV_GAME);
         SV_RunGameFrame();
+        PROF_END();
 
         // send messages back to the UDP clients
+        PROF_BEGIN(PROF_SV_SEND);
         SV_SendClientMessages();
+        PROF_END();
+
+        // expire per-frame visibility data
+        SV_EndVisCacheFrame();
 
         // send a heartbeat to the master if needed
         SV_MasterHeartbeat();
@@ -1902,6 +1929,9 @@ unsigned SV_Frame(unsigned msec)
 
         // advance for next frame
         sv.framenum++;
+
+        PROF_END();
+        Prof_EndTick();
     }
 
     if (COM_DEDICATED) {
@@ -2165,6 +2195,8 @@ void SV_Init(void)
     sv_max_packet_entities = Cvar_Get("sv_max_packet_entities", "0", 0);
     sv_trunc_packet_entities = Cvar_Get("sv_trunc_packet_entities", "1", 0);
     sv_prioritize_entities = Cvar_Get("sv_prioritize_entities", "0", 0);
+    sv_snapshot_threads = Cvar_Get("sv_snapshot_threads", "0", 0);
+    sv_viscache = Cvar_Get("sv_viscache", "1", 0);
 
     sv_strafejump_hack = Cvar_Get("sv_strafejump_hack", "1", CVAR_LATCH);
     sv_waterjump_hack = Cvar_Get("sv_waterjump_hack", "1", CVAR_LATCH);
@@ -2319,6 +2351,9 @@ void SV_Shutdown(const char *finalmsg, error_type_t type)
     SV_MvdShutdown(type);
 
     SV_FinalMessage(finalmsg, type);
+    SV_ShutdownFrameThreads();
+    SV_ClearVisCache();
+    SV_ClearGamestateCache();
     SV_MasterShutdown();
     SV_ShutdownGameProgs();
 
@@ -29,6 +29,15 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define FOR_EACH_ACTIVE_GTV(client) \
     LIST_FOR_EACH(gtv_client_t, client, &gtv_active_list, active)
 
+#if USE_ZLIB
+// shared stream data not yet sent to every client reading it
+#define GTV_RING_SIZE       (MAX_GTS_MSGLEN * 8)
+
+// clients that start streaming compress their own data until the next
+// keyframe of the shared stream, which are at most this often
+#define GTV_KEYFRAME_MSEC   1000
+#endif
+
 typedef struct {
     list_t      entry;
     list_t      active;
@@ -36,6 +45,9 @@ typedef struct {
     netstream_t stream;
 #if USE_ZLIB
     z_stream    z;
+    uLong       adler;      // of everything deflated for this client
+    bool        shared;     // reading from the shared stream
+    uint64_t    zpos;       // in shared stream
 #endif
     unsigned    msglen;
     unsigned    lastmessage;
@@ -80,6 +92,21 @@ typedef struct {
     // TCP client pool
     int             maxclients;
     gtv_client_t    *clients; // [sv_mvd_maxclients]
+
+#if USE_ZLIB
+    // raw deflate stream shared by clients that joined at a keyframe
+    z_stream        z;
+    byte            *zring;     // [GTV_RING_SIZE]
+    uint64_t        zhead;      // bytes ever appended to zring
+    int             num_shared;
+    unsigned        zkeyframe;
+    bool            zdirty;     // deflated anything since keyframe
+#endif
+
+    // frame fan-out cost since last mvdstatus
+    uint64_t        fanout_time;
+    unsigned        fanout_frames;
+    unsigned        fanout_clients;
 } mvd_server_t;
 
 static mvd_server_t     mvd;
@@ -114,11 +141,15 @@ static bool     mvd_enable(void);
 static void     mvd_disable(void);
 static void     mvd_error(const char *reason);
 
-static void     write_stream(gtv_client_t *client, void *data, size_t len);
+static void     write_stream(gtv_client_t *client, const void *data, size_t len);
 static void     write_message(gtv_client_t *client, gtv_serverop_t op);
 #if USE_ZLIB
-static void     flush_stream(gtv_client_t *client, int flush);
+static bool     flush_stream(gtv_client_t *client, int flush);
+static void     shared_attach(void);
 #endif
+static void     broadcast_stream(const void *data, size_t len);
+static void     broadcast_message(gtv_serverop_t op);
+static void     broadcast_flush(bool force);
 
 static void     rec_stop(void);
 static bool     rec_allowed(void);
@@ -799,16 +830,9 @@ static void emit_frame(void)
 
 static void suspend_streams(void)
 {
-    gtv_client_t *client;
-
-    FOR_EACH_ACTIVE_GTV(client) {
-        // send stream suspend marker
-        write_message(client, GTS_STREAM_DATA);
-#if USE_ZLIB
-        flush_stream(client, Z_SYNC_FLUSH);
-#endif
-        NET_UpdateStream(&client->stream);
-    }
+    // send stream suspend marker
+    broadcast_message(GTS_STREAM_DATA);
+    broadcast_flush(true);
 
     Com_DPrintf("Suspending MVD streams.\n");
     mvd.active = false;
@@ -816,8 +840,6 @@ static void suspend_streams(void)
 
 static void resume_streams(void)
 {
-    gtv_client_t *client;
-
     // build and emit gamestate
     build_gamestate();
     emit_gamestate();
@@ -829,14 +851,9 @@ static void resume_streams(void)
         return;
     }
 
-    FOR_EACH_ACTIVE_GTV(client) {
-        // send gamestate
-        write_message(client, GTS_STREAM_DATA);
-#if USE_ZLIB
-        flush_stream(client, Z_SYNC_FLUSH);
-#endif
-        NET_UpdateStream(&client->stream);
-    }
+    // send gamestate
+    broadcast_message(GTS_STREAM_DATA);
+    broadcast_flush(true);
 
     // write it to demofile
     if (mvd.recording) {
@@ -1004,6 +1021,7 @@ void SV_MvdEndFrame(void)
     gtv_client_t *client;
     size_t total;
     byte header[3];
+    uint64_t start;
 
     if (!SV_FRAMESYNC)
         return;
@@ -1052,18 +1070,25 @@ void SV_MvdEndFrame(void)
     WL16(header, total + 1);
     header[2] = GTS_STREAM_DATA;
 
-    // send frame to clients
-    FOR_EACH_ACTIVE_GTV(client) {
-        write_stream(client, header, sizeof(header));
-        write_stream(client, mvd.message.data, mvd.message.cursize);
-        write_stream(client, msg_write.data, msg_write.cursize);
-        write_stream(client, mvd.datagram.data, mvd.datagram.cursize);
+    start = Sys_Nanoseconds();
+
 #if USE_ZLIB
-        if (++client->bufcount > client->maxbuf) {
-            flush_stream(client, Z_SYNC_FLUSH);
-        }
+    shared_attach();
 #endif
-        NET_UpdateStream(&client->stream);
+
+    // send frame to clients
+    broadcast_stream(header, sizeof(header));
+    broadcast_stream(mvd.message.data, mvd.message.cursize);
+    broadcast_stream(msg_write.data, msg_write.cursize);
+    broadcast_stream(mvd.datagram.data, mvd.datagram.cursize);
+    broadcast_flush(false);
+
+    if (!LIST_EMPTY(&gtv_active_list)) {
+        mvd.fanout_time += Sys_Nanoseconds() - start;
+        mvd.fanout_frames++;
+        FOR_EACH_ACTIVE_GTV(client) {
+            mvd.fanout_clients++;
+        }
     }
 
     // write frame to demofile
@@ -1319,7 +1344,8 @@ static void remove_client(gtv_client_t *client)
 }
 
 #if USE_ZLIB
-static void flush_stream(gtv_client_t *client, int flush)
+// returns false if send buffer filled up before flushing completed
+static bool flush_stream(gtv_client_t *client, int flush)
 {
     fifo_t *fifo = &client->stream.send;
     z_streamp z = &client->z;
@@ -1328,10 +1354,10 @@ static void flush_stream(gtv_client_t *client, int flush)
     int ret;
 
     if (client->state <= cs_zombie) {
-        return;
+        return false;
     }
     if (!z->state) {
-        return;
+        return true;
     }
 
     z->next_in = NULL;
@@ -1341,7 +1367,7 @@ static void flush_stream(gtv_client_t *client, int flush)
         data = FIFO_Reserve(fifo, &len);
         if (!len) {
             // FIXME: this is not an error when flushing
-            return;
+            return false;
         }
 
         z->next_out = data;
@@ -1355,6 +1381,62 @@ static void flush_stream(gtv_client_t *client, int flush)
             client->bufcount = 0;
         }
     } while (ret == Z_OK);
+
+    return true;
+}
+
+// ends zlib stream with an empty final block and checksum of everything
+// deflated for this client, which deflate() can't know about when part
+// of it came from the shared stream
+static void finish_stream(gtv_client_t *client)
+{
+    byte trailer[6];
+
+    trailer[0] = 0x03;  // final block, fixed codes, end of block
+    trailer[1] = 0x00;
+    trailer[2] = client->adler >> 24;
+    trailer[3] = client->adler >> 16;
+    trailer[4] = client->adler >> 8;
+    trailer[5] = client->adler;
+
+    FIFO_Write(&client->stream.send, trailer, sizeof(trailer));
+}
+
+// copies shared stream data client hasn't received yet into its send
+// buffer, returns false if it didn't fit
+static bool pump_shared(gtv_client_t *client)
+{
+    fifo_t *fifo = &client->stream.send;
+    size_t pos, len, avail;
+    byte *data;
+
+    while (client->zpos < mvd.zhead) {
+        data = FIFO_Reserve(fifo, &avail);
+        if (!avail) {
+            return false;
+        }
+
+        pos = client->zpos % GTV_RING_SIZE;
+        len = min(mvd.zhead - client->zpos, GTV_RING_SIZE - pos);
+        len = min(len, avail);
+
+        memcpy(data, mvd.zring + pos, len);
+        FIFO_Commit(fifo, len);
+        client->zpos += len;
+    }
+
+    return true;
+}
+
+// client's own stream forgot its history when it joined the shared one,
+// so it can continue once everything shared has been received
+static bool shared_detach(gtv_client_t *client)
+{
+    bool done = pump_shared(client);
+
+    client->shared = false;
+    mvd.num_shared--;
+    return done;
 }
 #endif
 
@@ -1373,7 +1455,9 @@ static void drop_client(gtv_client_t *client, const char *error)
 #if USE_ZLIB
     if (client->z.state) {
         // finish zlib stream
-        flush_stream(client, Z_FINISH);
+        if ((!client->shared || shared_detach(client)) && flush_stream(client, Z_SYNC_FLUSH)) {
+            finish_stream(client);
+        }
         deflateEnd(&client->z);
     }
 #endif
@@ -1383,8 +1467,111 @@ static void drop_client(gtv_client_t *client, const char *error)
     client->lastmessage = svs.realtime;
 }
 
+#if USE_ZLIB
+// drops clients that haven't received data about to be overwritten
+static void shared_append(const byte *data, size_t len)
+{
+    gtv_client_t *client;
+    size_t pos, n;
+
+    FOR_EACH_ACTIVE_GTV(client) {
+        if (!client->shared || mvd.zhead + len - client->zpos <= GTV_RING_SIZE) {
+            continue;
+        }
+        // send buffer may fill up after enough was copied
+        pump_shared(client);
+        if (mvd.zhead + len - client->zpos > GTV_RING_SIZE) {
+            drop_client(client, "overflowed");
+        }
+    }
+
+    while (len) {
+        pos = mvd.zhead % GTV_RING_SIZE;
+        n = min(len, GTV_RING_SIZE - pos);
+        memcpy(mvd.zring + pos, data, n);
+        mvd.zhead += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void shared_deflate(const void *data, size_t len, int flush)
+{
+    z_streamp z = &mvd.z;
+    byte buffer[0x4000];
+
+    z->next_in = (Bytef *)data;
+    z->avail_in = (uInt)len;
+
+    do {
+        z->next_out = buffer;
+        z->avail_out = sizeof(buffer);
+        deflate(z, flush);
+        shared_append(buffer, sizeof(buffer) - z->avail_out);
+    } while (!z->avail_out);
+
+    if (len) {
+        mvd.zdirty = true;
+    }
+}
+
+// clients can only join at a keyframe, after which the shared stream
+// refers to no earlier data
+static bool shared_keyframe(void)
+{
+    if (!mvd.zring) {
+        mvd.z.zalloc = SV_zalloc;
+        mvd.z.zfree = SV_zfree;
+        if (deflateInit2(&mvd.z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         -MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        mvd.zring = SV_Malloc(GTV_RING_SIZE);
+    } else if (!mvd.num_shared) {
+        deflateReset(&mvd.z);
+    } else if (mvd.zdirty) {
+        shared_deflate(NULL, 0, Z_FULL_FLUSH);
+    }
+
+    mvd.zdirty = false;
+    mvd.zkeyframe = svs.realtime;
+    return true;
+}
 
-static void write_stream(gtv_client_t *client, void *data, size_t len)
+// moves streaming clients that compress their own data to the shared stream
+static void shared_attach(void)
+{
+    gtv_client_t *client;
+    bool keyframe = false;
+
+    FOR_EACH_ACTIVE_GTV(client) {
+        if (client->shared || !client->z.state || client->state != cs_spawned) {
+            continue;
+        }
+
+        if (!keyframe) {
+            if (mvd.num_shared && svs.realtime - mvd.zkeyframe < GTV_KEYFRAME_MSEC) {
+                return;
+            }
+            if (!shared_keyframe()) {
+                return;
+            }
+            keyframe = true;
+        }
+
+        // own stream must forget its history too
+        if (!flush_stream(client, Z_FULL_FLUSH)) {
+            continue;
+        }
+
+        client->shared = true;
+        client->zpos = mvd.zhead;
+        mvd.num_shared++;
+    }
+}
+#endif
+
+static void write_stream(gtv_client_t *client, const void *data, size_t len)
 {
     fifo_t *fifo = &client->stream.send;
 
@@ -1397,20 +1584,28 @@ static void write_stream(gtv_client_t *client, void *data, size_t len)
     }
 
 #if USE_ZLIB
+    if (client->shared && !shared_detach(client)) {
+        drop_client(client, "overflowed");
+        return;
+    }
+
     if (client->z.state) {
         z_streamp z = &client->z;
+        byte *out;
+
+        client->adler = adler32(client->adler, data, (uInt)len);
 
-        z->next_in = data;
+        z->next_in = (Bytef *)data;
         z->avail_in = (uInt)len;
 
         do {
-            data = FIFO_Reserve(fifo, &len);
+            out = FIFO_Reserve(fifo, &len);
             if (!len) {
                 drop_client(client, "overflowed");
                 return;
             }
 
-            z->next_out = data;
+            z->next_out = out;
             z->avail_out = (uInt)len;
 
             if (deflate(z, Z_NO_FLUSH) != Z_OK) {
@@ -1442,6 +1637,75 @@ static void write_message(gtv_client_t *client, gtv_serverop_t op)
     write_stream(client, msg_write.data, msg_write.cursize);
 }
 
+// data common to all streaming clients is deflated once for those reading
+// the shared stream
+static void broadcast_stream(const void *data, size_t len)
+{
+    gtv_client_t *client;
+
+    if (!len) {
+        return;
+    }
+
+#if USE_ZLIB
+    if (mvd.num_shared) {
+        uLong adler = adler32(adler32(0, Z_NULL, 0), data, (uInt)len);
+
+        FOR_EACH_ACTIVE_GTV(client) {
+            if (client->shared) {
+                client->adler = adler32_combine(client->adler, adler, len);
+            }
+        }
+
+        shared_deflate(data, len, Z_NO_FLUSH);
+    }
+#endif
+
+    FOR_EACH_ACTIVE_GTV(client) {
+#if USE_ZLIB
+        if (client->shared) {
+            continue;
+        }
+#endif
+        write_stream(client, data, len);
+    }
+}
+
+static void broadcast_message(gtv_serverop_t op)
+{
+    byte header[3];
+
+    WL16(header, msg_write.cursize + 1);
+    header[2] = op;
+    broadcast_stream(header, sizeof(header));
+
+    broadcast_stream(msg_write.data, msg_write.cursize);
+}
+
+// shared stream is flushed every time, own streams only if forced or
+// client's buffering limit is reached
+static void broadcast_flush(bool force)
+{
+    gtv_client_t *client;
+
+#if USE_ZLIB
+    if (mvd.num_shared) {
+        shared_deflate(NULL, 0, Z_SYNC_FLUSH);
+    }
+#endif
+
+    FOR_EACH_ACTIVE_GTV(client) {
+#if USE_ZLIB
+        if (client->shared) {
+            pump_shared(client);
+        } else if (force || ++client->bufcount > client->maxbuf) {
+            flush_stream(client, Z_SYNC_FLUSH);
+        }
+#endif
+        NET_UpdateStream(&client->stream);
+    }
+}
+
 static bool auth_client(const gtv_client_t *client, const char *password)
 {
     if (SV_MatchAddress(&gtv_white_list, &client->stream.address))
@@ -1528,6 +1792,7 @@ static void parse_hello(gtv_client_t *client)
             drop_client(client, "deflateInit failed");
             return;
         }
+        client->adler = adler32(0, Z_NULL, 0);
     }
 #endif
 
@@ -1834,6 +2099,14 @@ void SV_MvdRunClients(void)
             break;
         }
 
+#if USE_ZLIB
+        // send more of the shared stream as buffer space frees up
+        if (client->shared) {
+            pump_shared(client);
+            NET_UpdateStream(&client->stream);
+        }
+#endif
+
         // run network stream
         ret = NET_RunStream(&client->stream);
         switch (ret) {
@@ -1912,6 +2185,27 @@ static void dump_versions(void)
     }
 }
 
+static void dump_fanout(void)
+{
+    double usec;
+
+    if (!mvd.fanout_frames) {
+        return;
+    }
+
+    usec = mvd.fanout_time * 1e-3 / mvd.fanout_frames;
+    Com_Printf("Frame fan-out: %.1f usec per frame, %.1f usec per client",
+               usec, usec * mvd.fanout_frames / mvd.fanout_clients);
+#if USE_ZLIB
+    Com_Printf(", %d on shared stream", mvd.num_shared);
+#endif
+    Com_Printf("\n");
+
+    mvd.fanout_time = 0;
+    mvd.fanout_frames = 0;
+    mvd.fanout_clients = 0;
+}
+
 void SV_MvdStatus_f(void)
 {
     if (LIST_EMPTY(&gtv_client_list)) {
@@ -1921,6 +2215,7 @@ void SV_MvdStatus_f(void)
             dump_versions();
         } else {
             dump_clients();
+            dump_fanout();
         }
     }
     Com_Printf("\n");
@@ -1992,7 +2287,6 @@ Server has just changed the map, spawn the MVD dummy and go!
 */
 void SV_MvdMapChanged(void)
 {
-    gtv_client_t *client;
     int ret;
 
     if (!mvd.entities) {
@@ -2026,10 +2320,8 @@ void SV_MvdMapChanged(void)
         }
 
         // send gamestate to all MVD clients
-        FOR_EACH_ACTIVE_GTV(client) {
-            write_message(client, GTS_STREAM_DATA);
-            NET_UpdateStream(&client->stream);
-        }
+        broadcast_message(GTS_STREAM_DATA);
+        broadcast_flush(false);
     }
 
     if (mvd.recording) {
@@ -2184,6 +2476,13 @@ void SV_MvdShutdown(error_type_t type)
     Z_Free(mvd.entities);
     Z_Free(mvd.clients);
 
+#if USE_ZLIB
+    if (mvd.zring) {
+        deflateEnd(&mvd.z);
+        Z_Free(mvd.zring);
+    }
+#endif
+
     // close server TCP socket
     NET_Listen(false);
 
@@ -19,7 +19,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "server.h"
 #include "server/nav.h"
+#include "common/async.h"
 #include "common/error.h"
+#include "system/pthread.h"
 #if USE_REF
 #include "../client/client.h"
 
@@ -27,6 +29,14 @@ static cvar_t *nav_debug;
 static cvar_t *nav_debug_range;
 #endif
 
+// edge of region graph; link is NULL for precomputed
+// routes between entrances of the same region
+typedef struct {
+    const nav_link_t    *link;
+    float               cost;
+    int16_t             target;
+} nav_region_edge_t;
+
 static struct {
     bool	loaded;
     char	filename[MAX_QPATH];
@@ -37,10 +47,6 @@ static struct {
     int32_t     num_edicts;
     float       heuristic;
 
-    // for quick node lookups
-    int32_t     node_link_bitmap_size;
-    byte        *node_link_bitmap;
-    
     nav_node_t      *nodes;
     nav_link_t      *links;
     nav_traversal_t *traversals;
@@ -49,9 +55,35 @@ static struct {
     int32_t     num_conditional_nodes;
     nav_node_t  **conditional_nodes;
 
+    // uniform XY grid over node origins for closest node lookups;
+    // grid_cells holds first index into grid_nodes for each cell
+    vec2_t      grid_mins;
+    int32_t     grid_size[2];
+    int32_t     *grid_cells;
+    int16_t     *grid_nodes;
+
+    // nodes are grouped into regions by BSP area and cluster, see
+    // Nav_BuildRegions. nodes linked to other regions are entrances, and
+    // have region graph edges to entrances they can reach in own region.
+    int32_t     num_regions;
+    int32_t     *node_region;
+    int32_t     *region_first;      // into region_entrances, num_regions + 1
+    int16_t     *region_entrances;
+    int32_t     *edge_first;        // into region_edges, num_nodes + 1
+    nav_region_edge_t *region_edges;
+
     // built-in context
     nav_ctx_t   *ctx;
 
+    // routes between node pairs, see Nav_CacheLookup
+    struct nav_cache_s  *cache;
+    uint32_t    cache_generation;
+
+    // stats
+    unsigned    searches;
+    unsigned    cache_hits;
+    unsigned    async_requests;
+
     // entity stuff; TODO efficiently
     const edict_t     *registered_edicts[MAX_EDICTS];
     size_t            num_registered_edicts;
@@ -389,22 +421,59 @@ types:
 #define NAV_VERIFY_READ(v) \
     NAV_VERIFY(FS_Read(&v, sizeof(v), f) == sizeof(v), "bad data")
 
-typedef struct nav_open_s {
-    const nav_node_t  *node;
-    float             f_score;
-    list_t            entry;
-} nav_open_t;
+// grid cell size for closest node lookups, in units
+#define NAV_GRID_CELL   256
+#define NAV_GRID_MAX    1024
+
+// neighbouring clusters are merged into regions of up to this many nodes
+#define NAV_REGION_NODES    128
+
+// links kept between same two regions, at least this far apart
+#define NAV_PORTAL_LINKS    4
+#define NAV_PORTAL_SPACING  128
+
+// refined paths costing more than this times region route estimate are
+// searched again over all nodes
+#define NAV_REFINE_BOUND    1.25f
+
+// paths shorter than this don't use region graph
+#define NAV_REGION_MIN_DIST 1024
+
+typedef struct {
+    float       dist;
+    int32_t     id;
+} nav_candidate_t;
 
 typedef struct nav_ctx_s {
-    list_t          open_set_open, open_set_free;
-    
-    // TODO: min-heap or priority queue ordered by f_score?
-    // currently using linked list which is a bit slow for insertion
-    nav_open_t     *open_set;
+    // open set is a binary min-heap of node ids ordered by f_score, ties
+    // broken by insertion order. heap_pos allows decreasing keys in place.
+    int32_t         num_open;
+    uint32_t        sequence;
+    int16_t         *open_heap;
+    int32_t         *heap_pos;      // -1 if node is not in open set
+    float           *f_score;
+    uint32_t        *open_seq;
     // TODO: figure out a way to get rid of "came_from"
     // and track start -> end off the bat
     int16_t         *came_from, *went_to;
     float           *g_score;
+
+    // g_score and heap_pos are only valid for nodes visited with current
+    // stamp, so starting a search doesn't touch all nodes
+    uint32_t        *visited;
+    uint32_t        visit_stamp;
+
+    // closest node candidates, also holds region route between
+    // Nav_SearchRegions and Nav_RefineRegions
+    nav_candidate_t *candidates;
+
+    // regions of refined search are marked with current stamp
+    uint32_t        *corridor;
+    uint32_t        corridor_stamp;
+
+    // stats of last search
+    unsigned        expanded;
+    float           path_cost;
 } nav_ctx_t;
 
 #define NAV_ALLOC(n) \
@@ -415,15 +484,32 @@ typedef struct nav_ctx_s {
 nav_ctx_t *Nav_AllocCtx(void)
 {
     size_t size = sizeof(nav_ctx_t) +
-        (sizeof(nav_open_t) * nav_data.num_nodes) +
+        (sizeof(nav_candidate_t) * nav_data.num_nodes) +
+        (sizeof(uint32_t) * nav_data.num_nodes) +
+        (sizeof(uint32_t) * nav_data.num_nodes) +
+        (sizeof(int32_t) * nav_data.num_nodes) +
+        (sizeof(float) * nav_data.num_nodes) +
+        (sizeof(uint32_t) * nav_data.num_nodes) +
+        (sizeof(float) * nav_data.num_nodes) +
         (sizeof(int16_t) * nav_data.num_nodes) +
         (sizeof(int16_t) * nav_data.num_nodes) +
-        (sizeof(float) * nav_data.num_nodes);
+        (sizeof(int16_t) * nav_data.num_nodes);
     nav_ctx_t *ctx = Z_TagMalloc(size, TAG_NAV);
-    ctx->open_set = (nav_open_t *) (ctx + 1);
-    ctx->came_from = (int16_t *) (ctx->open_set + nav_data.num_nodes);
+    ctx->candidates = (nav_candidate_t *) (ctx + 1);
+    ctx->visited = (uint32_t *) (ctx->candidates + nav_data.num_nodes);
+    ctx->corridor = (uint32_t *) (ctx->visited + nav_data.num_nodes);
+    ctx->heap_pos = (int32_t *) (ctx->corridor + nav_data.num_nodes);
+    ctx->f_score = (float *) (ctx->heap_pos + nav_data.num_nodes);
+    ctx->open_seq = (uint32_t *) (ctx->f_score + nav_data.num_nodes);
+    ctx->g_score = (float *) (ctx->open_seq + nav_data.num_nodes);
+    ctx->open_heap = (int16_t *) (ctx->g_score + nav_data.num_nodes);
+    ctx->came_from = (int16_t *) (ctx->open_heap + nav_data.num_nodes);
     ctx->went_to = (int16_t *) (ctx->came_from + nav_data.num_nodes);
-    ctx->g_score = (float *) (ctx->went_to + nav_data.num_nodes);
+
+    memset(ctx->visited, 0, sizeof(ctx->visited[0]) * nav_data.num_nodes);
+    ctx->visit_stamp = 0;
+    memset(ctx->corridor, 0, sizeof(ctx->corridor[0]) * nav_data.num_nodes);
+    ctx->corridor_stamp = 0;
 
     return ctx;
 }
@@ -434,11 +520,6 @@ void Nav_FreeCtx(nav_ctx_t *ctx)
 }
 
 // built-in path functions
-static float Nav_Heuristic(const nav_path_t *path, const nav_node_t *node)
-{
-    return VectorDistance(path->goal->origin, node->origin);
-}
-
 static float Nav_Weight(const nav_path_t *path, const nav_node_t *node, const nav_link_t *link)
 {
     if (link->type == NavLinkType_Teleport)
@@ -521,10 +602,28 @@ static bool Nav_LinkAccessible(const nav_path_t *path, const nav_node_t *node, c
 #define Nav_ParamSupplied(x, def) \
     x > 0.0f ? x : def
 
-static nav_node_t *Nav_ClosestNodeTo(const vec3_t p, const PathRequest *request)
+static int Nav_CandidateCmp(const void *p1, const void *p2)
+{
+    const nav_candidate_t *a = p1;
+    const nav_candidate_t *b = p2;
+
+    if (a->dist != b->dist)
+        return a->dist < b->dist ? -1 : 1;
+
+    // of equally close nodes, the last one used to win
+    return b->id - a->id;
+}
+
+static void Nav_GridCell(const float *p, int32_t *cell)
+{
+    for (int i = 0; i < 2; i++) {
+        float c = floorf((p[i] - nav_data.grid_mins[i]) / NAV_GRID_CELL);
+        cell[i] = Q_clipf(c, 0, nav_data.grid_size[i] - 1);
+    }
+}
+
+static nav_node_t *Nav_ClosestNodeTo(nav_ctx_t *ctx, const vec3_t p, const PathRequest *request)
 {
-    float w = INFINITY;
-    nav_node_t *c = NULL;
     float minHeight = Nav_ParamSupplied(request->nodeSearch.minHeight, 64.0f);
     float maxHeight = Nav_ParamSupplied(request->nodeSearch.maxHeight, 64.0f);
     float radius = Nav_ParamSupplied(request->nodeSearch.maxHeight, 512.0f); 
@@ -533,36 +632,59 @@ static nav_node_t *Nav_ClosestNodeTo(const vec3_t p, const PathRequest *request)
     float bz = p[2] - minHeight;
     float tz = p[2] + maxHeight;
 
-    for (int i = 0; i < nav_data.num_nodes; i++) {
-        nav_node_t *node = &nav_data.nodes[i];
+    // gather nodes from grid cells touching search radius
+    vec2_t lo = { p[0] - radius, p[1] - radius };
+    vec2_t hi = { p[0] + radius, p[1] + radius };
+    int32_t cell_lo[2], cell_hi[2];
+    int num_candidates = 0;
 
-        if (!request->nodeSearch.ignoreNodeFlags) {
-            // these nodes should never be considered for
-            // closest walkable nodes, they're transitional
-            // or not for monsters
-            if (node->flags & (NodeFlag_Disabled | NodeFlag_Pusher | NodeFlag_Teleporter | NodeFlag_Ladder | NodeFlag_Crouch | NodeFlag_NoMonsters))
-                continue;
+    Nav_GridCell(lo, cell_lo);
+    Nav_GridCell(hi, cell_hi);
 
-            // swimmies?
-            if (waterOnly && !(node->flags & NodeFlag_UnderWater))
-                continue;
-        }
+    for (int y = cell_lo[1]; y <= cell_hi[1]; y++) {
+        for (int x = cell_lo[0]; x <= cell_hi[0]; x++) {
+            int32_t cell = y * nav_data.grid_size[0] + x;
 
-        // check Z distance
-        if (node->origin[2] < bz || node->origin[2] > tz)
-            continue;
+            for (int i = nav_data.grid_cells[cell]; i < nav_data.grid_cells[cell + 1]; i++) {
+                nav_node_t *node = &nav_data.nodes[nav_data.grid_nodes[i]];
+
+                if (!request->nodeSearch.ignoreNodeFlags) {
+                    // these nodes should never be considered for
+                    // closest walkable nodes, they're transitional
+                    // or not for monsters
+                    if (node->flags & (NodeFlag_Disabled | NodeFlag_Pusher | NodeFlag_Teleporter | NodeFlag_Ladder | NodeFlag_Crouch | NodeFlag_NoMonsters))
+                        continue;
 
-        // check XY distance
-        vec2_t d;
-        Vector2Subtract(p, node->origin, d);
+                    // swimmies?
+                    if (waterOnly && !(node->flags & NodeFlag_UnderWater))
+                        continue;
+                }
 
-        float l = Vector2Length(d);
+                // check Z distance
+                if (node->origin[2] < bz || node->origin[2] > tz)
+                    continue;
 
-        if (l > radius)
-            continue;
+                // check XY distance
+                vec2_t d;
+                Vector2Subtract(p, node->origin, d);
 
-        if (l > w)
-            continue;
+                float l = Vector2Length(d);
+
+                if (l > radius)
+                    continue;
+
+                ctx->candidates[num_candidates].dist = l;
+                ctx->candidates[num_candidates].id = node->id;
+                num_candidates++;
+            }
+        }
+    }
+
+    // closest visible node wins, trace nearest ones first
+    qsort(ctx->candidates, num_candidates, sizeof(ctx->candidates[0]), Nav_CandidateCmp);
+
+    for (int i = 0; i < num_candidates; i++) {
+        nav_node_t *node = &nav_data.nodes[ctx->candidates[i].id];
 
         // check visibility
         vec3_t end = { 0.f, 0.f, 32.f };
@@ -572,25 +694,31 @@ static nav_node_t *Nav_ClosestNodeTo(const vec3_t p, const PathRequest *request)
         if (tr.fraction < 1.0f)
             continue;
 
-        w = l;
-        c = node;
+        return node;
     }
 
-    return c;
+    return NULL;
 }
 
 const float PATH_POINT_TOO_CLOSE = 64.f;
 
-static const nav_link_t *Nav_GetLink(const nav_node_t *a, const nav_node_t *b)
+static const nav_link_t *Nav_FindLink(const nav_node_t *a, const nav_node_t *b)
 {
     for (const nav_link_t *link = a->links; link != a->links + a->num_links; link++)
         if (link->target == b)
             return link;
 
-    Q_assert(false);
     return NULL;
 }
 
+static const nav_link_t *Nav_GetLink(const nav_node_t *a, const nav_node_t *b)
+{
+    const nav_link_t *link = Nav_FindLink(a, b);
+
+    Q_assert(link);
+    return link;
+}
+
 static bool Nav_TouchingNode(const vec3_t pos, float move_dist, const nav_node_t *node)
 {
     return VectorDistance(pos, node->origin) <= move_dist;
@@ -609,28 +737,113 @@ static bool Nav_NodeReached(const vec3_t pos, const nav_node_t *node)
     return true;
 }
 
+static inline bool Nav_OpenLess(const nav_ctx_t *ctx, int16_t a, int16_t b)
+{
+    if (ctx->f_score[a] != ctx->f_score[b])
+        return ctx->f_score[a] < ctx->f_score[b];
+
+    return ctx->open_seq[a] < ctx->open_seq[b];
+}
+
+static inline void Nav_HeapPlace(nav_ctx_t *ctx, int32_t pos, int16_t id)
+{
+    ctx->open_heap[pos] = id;
+    ctx->heap_pos[id] = pos;
+}
+
+static void Nav_SiftUp(nav_ctx_t *ctx, int32_t pos)
+{
+    int16_t id = ctx->open_heap[pos];
+
+    while (pos > 0) {
+        int32_t parent = (pos - 1) >> 1;
+
+        if (!Nav_OpenLess(ctx, id, ctx->open_heap[parent]))
+            break;
+
+        Nav_HeapPlace(ctx, pos, ctx->open_heap[parent]);
+        pos = parent;
+    }
+
+    Nav_HeapPlace(ctx, pos, id);
+}
+
+static void Nav_SiftDown(nav_ctx_t *ctx, int32_t pos)
+{
+    int16_t id = ctx->open_heap[pos];
+
+    while (true) {
+        int32_t child = pos * 2 + 1;
+
+        if (child >= ctx->num_open)
+            break;
+
+        if (child + 1 < ctx->num_open && Nav_OpenLess(ctx, ctx->open_heap[child + 1], ctx->open_heap[child]))
+            child++;
+
+        if (!Nav_OpenLess(ctx, ctx->open_heap[child], id))
+            break;
+
+        Nav_HeapPlace(ctx, pos, ctx->open_heap[child]);
+        pos = child;
+    }
+
+    Nav_HeapPlace(ctx, pos, id);
+}
+
+// inserts node or updates its score if already open
 static inline void Nav_PushOpenSet(nav_ctx_t *ctx, const nav_node_t *node, float f)
 {
-    // grab free entry
-    nav_open_t *o = LIST_FIRST(nav_open_t, &ctx->open_set_free, entry);
-    List_Remove(&o->entry);
+    int16_t id = node->id;
+    int32_t pos = ctx->heap_pos[id];
 
-    o->node = node;
-    o->f_score = f;
+    ctx->f_score[id] = f;
+    ctx->open_seq[id] = ctx->sequence++;
 
-    nav_open_t *open_where = LIST_FIRST(nav_open_t, &ctx->open_set_open, entry);
+    if (pos == -1) {
+        pos = ctx->num_open++;
+        Nav_HeapPlace(ctx, pos, id);
+    }
 
-    while (!LIST_TERM(open_where, &ctx->open_set_open, entry)) {
+    Nav_SiftUp(ctx, pos);
+    Nav_SiftDown(ctx, ctx->heap_pos[id]);
+}
 
-        if (f < open_where->f_score) {
-            List_Insert(open_where->entry.prev, &o->entry);
-            return;
-        }
+static inline int16_t Nav_PopOpenSet(nav_ctx_t *ctx)
+{
+    int16_t id = ctx->open_heap[0];
+
+    ctx->heap_pos[id] = -1;
+
+    if (--ctx->num_open > 0) {
+        Nav_HeapPlace(ctx, 0, ctx->open_heap[ctx->num_open]);
+        Nav_SiftDown(ctx, 0);
+    }
+
+    return id;
+}
+
+static void Nav_ResetSearch(nav_ctx_t *ctx)
+{
+    ctx->num_open = 0;
+    ctx->sequence = 0;
 
-        open_where = LIST_NEXT(nav_open_t, open_where, entry);
+    if (!++ctx->visit_stamp) {
+        memset(ctx->visited, 0, sizeof(ctx->visited[0]) * nav_data.num_nodes);
+        ctx->visit_stamp = 1;
+    }
+}
+
+// must be called before node is pushed to open set
+static inline float Nav_GScore(nav_ctx_t *ctx, int16_t id)
+{
+    if (ctx->visited[id] != ctx->visit_stamp) {
+        ctx->visited[id] = ctx->visit_stamp;
+        ctx->g_score[id] = INFINITY;
+        ctx->heap_pos[id] = -1;
     }
 
-    List_Append(&ctx->open_set_open, &o->entry);
+    return ctx->g_score[id];
 }
 
 static inline void Nav_PushPathPoint(PathInfo *info, const PathRequest *request, const vec3_t p)
@@ -640,12 +853,12 @@ static inline void Nav_PushPathPoint(PathInfo *info, const PathRequest *request,
     info->numPathPoints++;
 }
 
-static inline void Nav_ReachedGoal(nav_path_t *path, PathInfo *info, const PathRequest *request, nav_ctx_t *ctx, int current)
+// reverses the order of came_from into route to make
+// stuff below a bit easier to work with
+static int64_t Nav_BuildRoute(nav_ctx_t *ctx, int16_t current, int16_t *route)
 {
     int64_t num_points = 0;
 
-    // reverse the order of came_from into went_to
-    // to make stuff below a bit easier to work with
     int16_t n = current;
     while (ctx->came_from[n] != -1) {
         num_points++;
@@ -655,10 +868,18 @@ static inline void Nav_ReachedGoal(nav_path_t *path, PathInfo *info, const PathR
     n = current;
     int64_t p = 0;
     while (ctx->came_from[n] != -1) {
-        n = ctx->went_to[num_points - p - 1] = ctx->came_from[n];
+        n = route[num_points - p - 1] = ctx->came_from[n];
         p++;
     }
 
+    return num_points;
+}
+
+// turns route in went_to into path info
+static void Nav_ReachedGoal(nav_path_t *path, PathInfo *info, const PathRequest *request, nav_ctx_t *ctx, int64_t num_points)
+{
+    int64_t p;
+
     // num_points now contains points between start
     // and current; it will be at least 1, since start can't
     // be the same as end, but may be less once we start clipping.
@@ -739,193 +960,1407 @@ static inline void Nav_ReachedGoal(nav_path_t *path, PathInfo *info, const PathR
     info->returnCode = PathReturnCode_InProgress;
 }
 
-static PathInfo Nav_Path_(nav_path_t *path)
+/*
+=============================================================================
+
+PATH CACHE
+
+Routes between node pairs are kept for nav_cache_time milliseconds, so
+monsters chasing the same target from around the same spot share a search.
+Only the node route is cached; path info is rebuilt for each request since
+it depends on exact start and goal positions. Changes to conditional nodes
+bump cache generation, which drops all cached routes at once.
+
+=============================================================================
+*/
+
+#define NAV_CACHE_SIZE      256
+#define NAV_CACHE_POINTS    128
+
+typedef struct {
+    int16_t     start, goal;
+    uint32_t    flags;
+    float       drop_height, jump_height;
+    bool        ignore_node_flags;
+} nav_cache_key_t;
+
+typedef struct nav_cache_s {
+    nav_cache_key_t key;
+    uint32_t    generation;
+    unsigned    time;
+    int16_t     num_points;     // -1 if no path was found
+    int16_t     points[NAV_CACHE_POINTS];
+} nav_cache_t;
+
+static cvar_t *nav_cache_time;
+static cvar_t *nav_hierarchy;
+
+static void Nav_CacheKey(const nav_path_t *path, nav_cache_key_t *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->start = path->start->id;
+    key->goal = path->goal->id;
+    key->flags = path->request->pathFlags;
+    key->drop_height = path->request->traversals.dropHeight;
+    key->jump_height = path->request->traversals.jumpHeight;
+    key->ignore_node_flags = path->request->nodeSearch.ignoreNodeFlags;
+}
+
+static nav_cache_t *Nav_CacheSlot(const nav_cache_key_t *key)
 {
-    PathInfo info = { 0 };
+    uint32_t hash = key->start * 0x9E3779B1u ^ key->goal * 0x85EBCA77u ^ key->flags;
+
+    return &nav_data.cache[(hash ^ (hash >> 16)) & (NAV_CACHE_SIZE - 1)];
+}
+
+// custom path functions change the result, so such paths are never cached
+static bool Nav_Cacheable(const nav_path_t *path)
+{
+    return nav_data.cache && nav_cache_time->integer > 0 &&
+        !path->heuristic && !path->weight && !path->link_accessible;
+}
+
+// copies cached route into went_to, returns false on miss
+static bool Nav_CacheLookup(const nav_path_t *path, nav_ctx_t *ctx, int64_t *num_points)
+{
+    nav_cache_key_t key;
+    Nav_CacheKey(path, &key);
+
+    nav_cache_t *c = Nav_CacheSlot(&key);
+
+    if (c->generation != nav_data.cache_generation)
+        return false;
+    if (svs.realtime - c->time >= nav_cache_time->integer)
+        return false;
+    if (memcmp(&c->key, &key, sizeof(key)))
+        return false;
+
+    for (int i = 0; i < c->num_points; i++)
+        ctx->went_to[i] = c->points[i];
+
+    *num_points = c->num_points;
+    nav_data.cache_hits++;
+    return true;
+}
+
+static void Nav_CacheStore(const nav_path_t *path, const nav_ctx_t *ctx, int64_t num_points, uint32_t generation)
+{
+    if (generation != nav_data.cache_generation)
+        return;
+    if (num_points > NAV_CACHE_POINTS)
+        return;
+
+    nav_cache_key_t key;
+    Nav_CacheKey(path, &key);
+
+    nav_cache_t *c = Nav_CacheSlot(&key);
+
+    c->key = key;
+    c->generation = generation;
+    c->time = svs.realtime;
+    c->num_points = num_points;
+
+    for (int i = 0; i < num_points; i++)
+        c->points[i] = ctx->went_to[i];
+}
+
+// region graph only pays off for long paths. custom path
+// functions aren't known when region graph is built.
+static bool Nav_UseRegions(const nav_path_t *path)
+{
+    if (!nav_hierarchy->integer || !nav_data.num_regions)
+        return false;
+    if (path->heuristic || path->weight || path->link_accessible)
+        return false;
+    if (nav_data.node_region[path->start->id] == nav_data.node_region[path->goal->id])
+        return false;
+
+    return VectorDistance(path->start->origin, path->goal->origin) >= NAV_REGION_MIN_DIST;
+}
+
+// checks that can be answered without searching; returns false if
+// info is final. must be called from main thread since it traces.
+static bool Nav_PathBegin(nav_path_t *path, nav_ctx_t *ctx, PathInfo *info)
+{
+    const PathRequest *request = path->request;
 
     if (!nav_data.loaded) {
-        info.returnCode = PathReturnCode_NoNavAvailable;
-        return info;
+        info->returnCode = PathReturnCode_NoNavAvailable;
+        return false;
     }
 
-    if ((path->request->pathFlags & (PathFlags_Walk | PathFlags_Water)) == 0) {
-        info.returnCode = PathReturnCode_MissingWalkOrSwimFlag;
-        return info;
+    if ((request->pathFlags & (PathFlags_Walk | PathFlags_Water)) == 0) {
+        info->returnCode = PathReturnCode_MissingWalkOrSwimFlag;
+        return false;
     }
 
-    const PathRequest *request = path->request;
-
-    path->start = Nav_ClosestNodeTo(request->start, path->request);
+    path->start = Nav_ClosestNodeTo(ctx, request->start, request);
 
     if (!path->start) {
-        info.returnCode = PathReturnCode_NoStartNode;
-        return info;
+        info->returnCode = PathReturnCode_NoStartNode;
+        return false;
     }
 
-    path->goal = Nav_ClosestNodeTo(request->goal, path->request);
+    path->goal = Nav_ClosestNodeTo(ctx, request->goal, request);
 
     if (!path->goal) {
-        info.returnCode = PathReturnCode_NoGoalNode;
-        return info;
+        info->returnCode = PathReturnCode_NoGoalNode;
+        return false;
     }
 
     if (path->start == path->goal ||
         Nav_TouchingNode(request->start, request->moveDist, path->goal)) {
-        info.returnCode = PathReturnCode_ReachedGoal;
-        return info;
+        info->returnCode = PathReturnCode_ReachedGoal;
+        return false;
     }
 
-    if (!path->request->nodeSearch.ignoreNodeFlags) {
-        if (SV_PointContents(path->request->start) & MASK_SOLID) {
-            info.returnCode = PathReturnCode_InvalidStart;
-            return info;
+    if (!request->nodeSearch.ignoreNodeFlags) {
+        if (SV_PointContents(request->start) & MASK_SOLID) {
+            info->returnCode = PathReturnCode_InvalidStart;
+            return false;
         }
-        if (SV_PointContents(path->request->goal) & MASK_SOLID) {
-            info.returnCode = PathReturnCode_InvalidGoal;
-            return info;
+        if (SV_PointContents(request->goal) & MASK_SOLID) {
+            info->returnCode = PathReturnCode_InvalidGoal;
+            return false;
         }
     }
 
-    int16_t start_id = path->start->id;
-    int16_t goal_id = path->goal->id;
-    
+    path->hierarchical = Nav_UseRegions(path);
+    return true;
+}
+
+// A* search from start to goal node, staying inside regions marked in
+// corridor if asked to. returns false if goal can't be reached, otherwise
+// route can be built from came_from and g_score of goal is its cost.
+static bool Nav_SearchNodes(nav_path_t *path, nav_ctx_t *ctx, int16_t start_id, int16_t goal_id, bool corridor)
+{
+    const nav_node_t *goal = &nav_data.nodes[goal_id];
+
     nav_weight_func_t weight_func = path->weight ? path->weight : Nav_Weight;
-    nav_heuristic_func_t heuristic_func = path->heuristic ? path->heuristic : Nav_Heuristic;
     nav_link_accessible_func_t link_accessible_func = path->link_accessible ? path->link_accessible : Nav_LinkAccessible;
 
-    nav_ctx_t *ctx = path->context ? path->context : nav_data.ctx;
-
-    for (int i = 0; i < nav_data.num_nodes; i++)
-        ctx->g_score[i] = INFINITY;
-    
-    List_Init(&ctx->open_set_open);
-    List_Init(&ctx->open_set_free);
+    Nav_ResetSearch(ctx);
 
-    for (int i = 0; i < nav_data.num_nodes; i++)
-        List_Append(&ctx->open_set_free, &ctx->open_set[i].entry);
-    
+    Nav_GScore(ctx, start_id);
     ctx->came_from[start_id] = -1;
     ctx->g_score[start_id] = 0;
-    Nav_PushOpenSet(ctx, path->start, heuristic_func(path, path->start));
+    Nav_PushOpenSet(ctx, &nav_data.nodes[start_id], 0);
 
-    info.returnCode = PathReturnCode_NoPathFound;
-
-    while (true) {
-        nav_open_t *cursor = LIST_FIRST(nav_open_t, &ctx->open_set_open, entry);
-
-        // end of open set; can't reach the goal, or something
-        // weird happened
-        if (LIST_TERM(cursor, &ctx->open_set_open, entry))
-            break;
+    // end of open set; can't reach the goal, or something
+    // weird happened
+    while (ctx->num_open) {
+        int16_t current = Nav_PopOpenSet(ctx);
 
-        // shift off the head, insert into free
-        List_Remove(&cursor->entry);
-        List_Insert(&ctx->open_set_free, &cursor->entry);
-        
-        int16_t current = cursor->node->id;
+        ctx->expanded++;
 
-        if (current == goal_id) {
-            Nav_ReachedGoal(path, &info, request, ctx, current);
-            break;
-        }
+        if (current == goal_id)
+            return true;
 
         const nav_node_t *current_node = &nav_data.nodes[current];
 
         for (const nav_link_t *link = current_node->links; link != current_node->links + current_node->num_links; link++) {
-            if (!link_accessible_func(path, current_node, link))
+            int16_t target_id = link->target->id;
+
+            if (corridor && ctx->corridor[nav_data.node_region[target_id]] != ctx->corridor_stamp)
                 continue;
 
-            int16_t target_id = link->target->id;
+            if (!link_accessible_func(path, current_node, link))
+                continue;
 
             float temp_g_score = ctx->g_score[current] + weight_func(path, current_node, link);
 
-            if (temp_g_score >= ctx->g_score[target_id])
+            if (temp_g_score >= Nav_GScore(ctx, target_id))
                 continue;
 
             ctx->came_from[target_id] = current;
             ctx->g_score[target_id] = temp_g_score;
 
-            Nav_PushOpenSet(ctx, link->target, temp_g_score + heuristic_func(path, link->target));
+            // custom heuristic is only used when searching for path goal
+            float h = path->heuristic ? path->heuristic(path, link->target) : VectorDistance(goal->origin, link->target->origin);
+            Nav_PushOpenSet(ctx, link->target, temp_g_score + h);
         }
     }
 
-    return info;
+    return false;
 }
 
-#if USE_REF
-static void Nav_DebugPath(const PathInfo *path, const PathRequest *request)
+static inline void Nav_Relax(nav_ctx_t *ctx, int16_t from, int16_t to, float cost, const nav_node_t *goal)
 {
-    R_ClearDebugLines();
-
-    int time = (request->debugging.drawTime * 1000) + 6000;
-    
-    color_t path_color = COLOR_SETA_U8(COLOR_RED, 64);
-    color_t arrow_color = COLOR_SETA_U8(COLOR_YELLOW, 64);
-
-    R_AddDebugSphere(request->start, 8.0f, path_color, time, false);
-    R_AddDebugSphere(request->goal, 8.0f, path_color, time, false);
-
-    if (request->pathPoints.count) {
-        R_AddDebugArrow(request->start, request->pathPoints.posArray[0], 8.0f, arrow_color, arrow_color, time, false);
+    float g = ctx->g_score[from] + cost;
 
-        for (int64_t i = 0; i < request->pathPoints.count - 1; i++)
-            R_AddDebugArrow(request->pathPoints.posArray[i], request->pathPoints.posArray[i + 1], 8.0f, arrow_color, arrow_color, time, false);
+    if (g >= Nav_GScore(ctx, to))
+        return;
 
-        R_AddDebugArrow(request->pathPoints.posArray[request->pathPoints.count - 1], request->goal, 8.0f, arrow_color, arrow_color, time, false);
-    } else {
-        R_AddDebugArrow(request->start, request->goal, 8.0f, arrow_color, arrow_color, time, false);
-    }
+    ctx->came_from[to] = from;
+    ctx->g_score[to] = g;
 
-    R_AddDebugSphere(path->firstMovePoint, 16.0f, path_color, time, false);
-    R_AddDebugArrow(path->firstMovePoint, path->secondMovePoint, 16.0f, path_color, path_color, time, false);
+    Nav_PushOpenSet(ctx, &nav_data.nodes[to], g + VectorDistance(goal->origin, nav_data.nodes[to].origin));
 }
-#endif
 
-PathInfo Nav_Path(nav_path_t *path)
+static inline float Nav_StubCost(int16_t a, int16_t b)
 {
-    PathInfo result = Nav_Path_(path);
-    
-#if USE_REF
-    if (path->request->debugging.drawTime)
-        Nav_DebugPath(&result, path->request);
-#endif
-
-    return result;
+    return VectorDistance(nav_data.nodes[a].origin, nav_data.nodes[b].origin) * nav_data.heuristic;
 }
 
-static bool Nav_NodeIsConditional(const nav_node_t *node)
+// A* over region graph. start and goal are joined to entrances of their
+// regions by straight line estimates. route from start to goal through
+// entrances is stored in candidates, returns number of nodes in it or 0
+// if there's no route.
+static int32_t Nav_SearchRegions(nav_path_t *path, nav_ctx_t *ctx)
 {
-    return node->flags & (NodeFlag_CheckDoorLinks | NodeFlag_CheckForHazard | NodeFlag_CheckHasFloor | NodeFlag_CheckInLiquid | NodeFlag_CheckInSolid);
-}
+    int16_t start_id = path->start->id;
+    int16_t goal_id = path->goal->id;
+    int32_t start_region = nav_data.node_region[start_id];
+    int32_t goal_region = nav_data.node_region[goal_id];
 
-void Nav_Load(const char *map_name)
-{
-    Q_assert(!nav_data.loaded);
+    Nav_ResetSearch(ctx);
 
-    nav_data.loaded = true;
+    Nav_GScore(ctx, start_id);
+    ctx->came_from[start_id] = -1;
+    ctx->g_score[start_id] = 0;
+    Nav_PushOpenSet(ctx, path->start, 0);
 
-    Q_snprintf(nav_data.filename, sizeof(nav_data.filename), "bots/navigation/%s.nav", map_name);
+    while (ctx->num_open) {
+        int16_t current = Nav_PopOpenSet(ctx);
 
-    qhandle_t f;
-    int64_t l = FS_OpenFile(nav_data.filename, &f, FS_MODE_READ);
+        ctx->expanded++;
 
-    if (l < 0)
-        return;
+        if (current == goal_id)
+            break;
 
-    int v;
+        const nav_node_t *current_node = &nav_data.nodes[current];
 
-    NAV_VERIFY_READ(v);
-    NAV_VERIFY(v == NAV_MAGIC, "bad magic");
+        if (current == start_id) {
+            for (int i = nav_data.region_first[start_region]; i < nav_data.region_first[start_region + 1]; i++) {
+                int16_t e = nav_data.region_entrances[i];
+                if (e != start_id)
+                    Nav_Relax(ctx, current, e, Nav_StubCost(current, e), path->goal);
+            }
+        }
 
-    NAV_VERIFY_READ(v);
-    NAV_VERIFY((v <= NAV_VERSION_LATEST), va("bad version %i\n", v));
+        if (nav_data.node_region[current] == goal_region)
+            Nav_Relax(ctx, current, goal_id, Nav_StubCost(current, goal_id), path->goal);
 
-    NAV_VERIFY_READ(nav_data.num_nodes);
-    NAV_VERIFY_READ(nav_data.num_links);
-    NAV_VERIFY_READ(nav_data.num_traversals);
-    NAV_VERIFY_READ(nav_data.heuristic);
+        for (int i = nav_data.edge_first[current]; i < nav_data.edge_first[current + 1]; i++) {
+            const nav_region_edge_t *edge = &nav_data.region_edges[i];
 
-    NAV_VERIFY(nav_data.nodes = NAV_ALLOCZ(sizeof(nav_node_t) * nav_data.num_nodes), "out of memory");
+            if (edge->link) {
+                if (!Nav_LinkAccessible(path, current_node, edge->link))
+                    continue;
+            } else if (!Nav_NodeAccessible(path, &nav_data.nodes[edge->target])) {
+                continue;
+            }
+
+            Nav_Relax(ctx, current, edge->target, edge->cost, path->goal);
+        }
+    }
+
+    if (Nav_GScore(ctx, goal_id) == INFINITY)
+        return 0;
+
+    int32_t num_nodes = 0;
+
+    for (int16_t n = goal_id; n != -1; n = ctx->came_from[n])
+        num_nodes++;
+
+    int32_t i = num_nodes;
+
+    for (int16_t n = goal_id; n != -1; n = ctx->came_from[n])
+        ctx->candidates[--i].id = n;
+
+    return num_nodes;
+}
+
+// turns region route into node route with one search over all nodes of
+// regions along the route, so the path isn't forced through the picked
+// entrances. returns -1 if route isn't walkable by these nodes.
+static int64_t Nav_RefineRegions(nav_path_t *path, nav_ctx_t *ctx, int32_t num_nodes)
+{
+    int16_t goal_id = path->goal->id;
+
+    if (!++ctx->corridor_stamp) {
+        memset(ctx->corridor, 0, sizeof(ctx->corridor[0]) * nav_data.num_nodes);
+        ctx->corridor_stamp = 1;
+    }
+
+    for (int32_t i = 0; i < num_nodes; i++)
+        ctx->corridor[nav_data.node_region[ctx->candidates[i].id]] = ctx->corridor_stamp;
+
+    if (!Nav_SearchNodes(path, ctx, path->start->id, goal_id, true))
+        return -1;
+
+    ctx->path_cost = ctx->g_score[goal_id];
+    return Nav_BuildRoute(ctx, goal_id, ctx->went_to);
+}
+
+// only reads node graph, so it's safe to run on worker threads
+// between Nav_Frame calls
+static int64_t Nav_Search(nav_path_t *path, nav_ctx_t *ctx)
+{
+    int16_t goal_id = path->goal->id;
+
+    ctx->expanded = 0;
+    ctx->path_cost = INFINITY;
+
+    // fall back to searching all nodes if region route wasn't walkable
+    if (path->hierarchical) {
+        int32_t num_nodes = Nav_SearchRegions(path, ctx);
+
+        if (num_nodes) {
+            float estimate = ctx->g_score[goal_id];
+            int64_t num_points = Nav_RefineRegions(path, ctx, num_nodes);
+            if (num_points >= 0 && ctx->path_cost <= estimate * NAV_REFINE_BOUND)
+                return num_points;
+        }
+    }
+
+    if (!Nav_SearchNodes(path, ctx, path->start->id, goal_id, false)) {
+        ctx->path_cost = INFINITY;
+        return -1;
+    }
+
+    ctx->path_cost = ctx->g_score[goal_id];
+    return Nav_BuildRoute(ctx, goal_id, ctx->went_to);
+}
+
+static void Nav_PathFinish(nav_path_t *path, nav_ctx_t *ctx, PathInfo *info, int64_t num_points)
+{
+    if (num_points < 0) {
+        info->returnCode = PathReturnCode_NoPathFound;
+        return;
+    }
+
+    Nav_ReachedGoal(path, info, path->request, ctx, num_points);
+}
+
+static PathInfo Nav_Path_(nav_path_t *path, bool use_cache)
+{
+    PathInfo info = { 0 };
+    nav_ctx_t *ctx = path->context ? path->context : nav_data.ctx;
+    int64_t num_points;
+
+    if (!Nav_PathBegin(path, ctx, &info))
+        return info;
+
+    use_cache &= Nav_Cacheable(path);
+
+    if (!use_cache || !Nav_CacheLookup(path, ctx, &num_points)) {
+        num_points = Nav_Search(path, ctx);
+        nav_data.searches++;
+
+        if (use_cache)
+            Nav_CacheStore(path, ctx, num_points, nav_data.cache_generation);
+    }
+
+    Nav_PathFinish(path, ctx, &info, num_points);
+    return info;
+}
+
+#if USE_REF
+static void Nav_DebugPath(const PathInfo *path, const PathRequest *request)
+{
+    R_ClearDebugLines();
+
+    int time = (request->debugging.drawTime * 1000) + 6000;
+    
+    color_t path_color = COLOR_SETA_U8(COLOR_RED, 64);
+    color_t arrow_color = COLOR_SETA_U8(COLOR_YELLOW, 64);
+
+    R_AddDebugSphere(request->start, 8.0f, path_color, time, false);
+    R_AddDebugSphere(request->goal, 8.0f, path_color, time, false);
+
+    if (request->pathPoints.count) {
+        R_AddDebugArrow(request->start, request->pathPoints.posArray[0], 8.0f, arrow_color, arrow_color, time, false);
+
+        for (int64_t i = 0; i < request->pathPoints.count - 1; i++)
+            R_AddDebugArrow(request->pathPoints.posArray[i], request->pathPoints.posArray[i + 1], 8.0f, arrow_color, arrow_color, time, false);
+
+        R_AddDebugArrow(request->pathPoints.posArray[request->pathPoints.count - 1], request->goal, 8.0f, arrow_color, arrow_color, time, false);
+    } else {
+        R_AddDebugArrow(request->start, request->goal, 8.0f, arrow_color, arrow_color, time, false);
+    }
+
+    R_AddDebugSphere(path->firstMovePoint, 16.0f, path_color, time, false);
+    R_AddDebugArrow(path->firstMovePoint, path->secondMovePoint, 16.0f, path_color, path_color, time, false);
+}
+#endif
+
+/*
+=============================================================================
+
+REQUEST RECORDING
+
+Path requests made by the game can be written to a file and replayed later
+with nav_bench on the same map, to measure pathing speed on a real workload.
+
+=============================================================================
+*/
+
+#define NAV_RECORD_MAGIC    MakeLittleLong('N','A','V','R')
+#define NAV_RECORD_VERSION  1
+#define NAV_RECORD_WORDS    19
+
+// max path points per replayed request
+#define NAV_BENCH_POINTS    512
+
+typedef union {
+    float       f;
+    uint32_t    u;
+} nav_word_t;
+
+static qhandle_t nav_record_file;
+
+static void Nav_PackRequest(nav_word_t *w, const PathRequest *request, PathReturnCode code)
+{
+    const float f[] = {
+        request->start[0], request->start[1], request->start[2],
+        request->goal[0], request->goal[1], request->goal[2],
+        request->moveDist,
+        request->nodeSearch.minHeight, request->nodeSearch.maxHeight, request->nodeSearch.radius,
+        request->traversals.dropHeight, request->traversals.jumpHeight
+    };
+    int i;
+
+    for (i = 0; i < q_countof(f); i++)
+        w[i].f = LittleFloat(f[i]);
+
+    w[i++].u = LittleLong(request->pathFlags);
+    w[i++].u = LittleLong(request->nodeSearch.ignoreNodeFlags);
+    w[i++].u = LittleLong(Q_clip(request->pathPoints.count, 0, INT32_MAX));
+    w[i++].u = LittleLong(code);
+
+    // reserved
+    for (; i < NAV_RECORD_WORDS; i++)
+        w[i].u = 0;
+}
+
+// returns recorded return code
+static PathReturnCode Nav_UnpackRequest(const nav_word_t *w, PathRequest *request)
+{
+    float f[12];
+    int i;
+
+    for (i = 0; i < q_countof(f); i++)
+        f[i] = LittleFloat(w[i].f);
+
+    memset(request, 0, sizeof(*request));
+    VectorCopy(f + 0, request->start);
+    VectorCopy(f + 3, request->goal);
+    request->moveDist = f[6];
+    request->nodeSearch.minHeight = f[7];
+    request->nodeSearch.maxHeight = f[8];
+    request->nodeSearch.radius = f[9];
+    request->traversals.dropHeight = f[10];
+    request->traversals.jumpHeight = f[11];
+
+    request->pathFlags = LittleLong(w[i++].u);
+    request->nodeSearch.ignoreNodeFlags = LittleLong(w[i++].u);
+    request->pathPoints.count = LittleLong(w[i++].u);
+    return LittleLong(w[i].u);
+}
+
+static void Nav_StopRecord(void)
+{
+    if (!nav_record_file)
+        return;
+
+    FS_CloseFile(nav_record_file);
+    nav_record_file = 0;
+}
+
+static void Nav_Record(const PathRequest *request, PathReturnCode code)
+{
+    nav_word_t w[NAV_RECORD_WORDS];
+
+    Nav_PackRequest(w, request, code);
+
+    if (FS_Write(w, sizeof(w), nav_record_file) != sizeof(w)) {
+        Com_EPrintf("Couldn't write path request, recording stopped.\n");
+        Nav_StopRecord();
+    }
+}
+
+static void Nav_Record_f(void)
+{
+    char buffer[MAX_OSPATH];
+    uint32_t header[2];
+
+    if (Cmd_Argc() < 2) {
+        if (!nav_record_file) {
+            Com_Printf("Usage: %s <filename>\n", Cmd_Argv(0));
+            return;
+        }
+        Com_Printf("Stopped recording path requests.\n");
+        Nav_StopRecord();
+        return;
+    }
+
+    if (!nav_data.loaded) {
+        Com_Printf("No navigation loaded.\n");
+        return;
+    }
+
+    Nav_StopRecord();
+
+    nav_record_file = FS_EasyOpenFile(buffer, sizeof(buffer), FS_MODE_WRITE,
+                                      "bots/", Cmd_Argv(1), ".navreq");
+    if (!nav_record_file)
+        return;
+
+    header[0] = LittleLong(NAV_RECORD_MAGIC);
+    header[1] = LittleLong(NAV_RECORD_VERSION);
+
+    if (FS_Write(header, sizeof(header), nav_record_file) != sizeof(header)) {
+        Com_EPrintf("Couldn't write %s\n", buffer);
+        Nav_StopRecord();
+        return;
+    }
+
+    Com_Printf("Recording path requests to %s\n", buffer);
+}
+
+/*
+==================
+Nav_Bench_f
+
+Replays recorded path requests and reports search throughput, both with
+all nodes searched and with region graph searched first. Closest node
+lookups are done once up front and not timed. Results are compared
+against recorded return codes, which can legitimately differ if
+conditional nodes changed state since recording.
+==================
+*/
+static void Nav_Bench_f(void)
+{
+    char        buffer[MAX_OSPATH];
+    byte        *data;
+    vec3_t      *points;
+    uint64_t    start, elapsed;
+    int         i, iterations, count, mismatches, failures, compared;
+    int64_t     len, expanded;
+    double      cost_ratio;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <filename> [iterations]\n", Cmd_Argv(0));
+        return;
+    }
+
+    if (!nav_data.loaded) {
+        Com_Printf("No navigation loaded.\n");
+        return;
+    }
+
+    iterations = 10;
+    if (Cmd_Argc() > 2)
+        iterations = Q_clip(Q_atoi(Cmd_Argv(2)), 1, 100000);
+
+    if (Q_concat(buffer, sizeof(buffer), "bots/", Cmd_Argv(1)) >= sizeof(buffer)) {
+        Com_Printf("Oversize filename specified.\n");
+        return;
+    }
+    COM_DefaultExtension(buffer, ".navreq", sizeof(buffer));
+
+    len = FS_LoadFile(buffer, (void **)&data);
+    if (!data) {
+        Com_Printf("Couldn't load %s: %s\n", buffer, Q_ErrorString(len));
+        return;
+    }
+
+    if (len < 8 || RL32(data) != NAV_RECORD_MAGIC || RL32(data + 4) != NAV_RECORD_VERSION) {
+        Com_Printf("%s is not a path request recording.\n", buffer);
+        FS_FreeFile(data);
+        return;
+    }
+
+    count = (len - 8) / (NAV_RECORD_WORDS * 4);
+    if (!count) {
+        Com_Printf("%s has no path requests.\n", buffer);
+        FS_FreeFile(data);
+        return;
+    }
+
+    PathRequest *requests = Z_Malloc(sizeof(requests[0]) * count);
+    PathReturnCode *codes = Z_Malloc(sizeof(codes[0]) * count);
+    nav_path_t *paths = Z_Mallocz(sizeof(paths[0]) * count);
+    PathInfo *begun = Z_Mallocz(sizeof(begun[0]) * count);
+    bool *search = Z_Malloc(sizeof(search[0]) * count);
+    float *costs = Z_Malloc(sizeof(costs[0]) * count);
+    points = Z_Malloc(sizeof(points[0]) * NAV_BENCH_POINTS);
+
+    for (i = 0; i < count; i++) {
+        codes[i] = Nav_UnpackRequest((const nav_word_t *)(data + 8) + i * NAV_RECORD_WORDS, &requests[i]);
+        requests[i].pathPoints.count = min(requests[i].pathPoints.count, NAV_BENCH_POINTS);
+        if (requests[i].pathPoints.count)
+            requests[i].pathPoints.posArray = points;
+    }
+
+    FS_FreeFile(data);
+
+    for (i = 0; i < count; i++) {
+        paths[i].request = &requests[i];
+        search[i] = Nav_PathBegin(&paths[i], nav_data.ctx, &begun[i]);
+    }
+
+    Com_Printf("%d requests x %d iterations\n", count, iterations);
+    Com_Printf("search        ms  paths/sec  us/path  expanded  cost  failed  differ\n"
+               "------------ ----- --------- -------- --------- ----- ------- -------\n");
+
+    for (int pass = 0; pass < 2; pass++) {
+        mismatches = failures = compared = 0;
+        expanded = 0;
+        cost_ratio = 0;
+        start = Sys_Nanoseconds();
+
+        for (int iter = 0; iter < iterations; iter++) {
+            for (i = 0; i < count; i++) {
+                PathInfo result = begun[i];
+
+                if (search[i]) {
+                    nav_path_t *path = &paths[i];
+
+                    path->hierarchical = pass && Nav_UseRegions(path);
+                    Nav_PathFinish(path, nav_data.ctx, &result, Nav_Search(path, nav_data.ctx));
+
+                    if (!iter) {
+                        expanded += nav_data.ctx->expanded;
+
+                        if (!pass) {
+                            costs[i] = nav_data.ctx->path_cost;
+                        } else if (isfinite(costs[i]) && isfinite(nav_data.ctx->path_cost) && costs[i] > 0) {
+                            cost_ratio += nav_data.ctx->path_cost / costs[i];
+                            compared++;
+                        }
+                    }
+                }
+
+                if (iter)
+                    continue;
+                if (result.returnCode != codes[i])
+                    mismatches++;
+                if (result.returnCode >= PathReturnCode_StartPathErrors)
+                    failures++;
+            }
+        }
+
+        elapsed = Sys_Nanoseconds() - start;
+
+        Com_Printf("%-12s %5.0f %9.0f %8.2f %9.1f %5.3f %7d %7d\n",
+                   pass ? "hierarchical" : "flat", elapsed * 1e-6,
+                   (double)count * iterations * 1e9 / max(elapsed, 1),
+                   elapsed * 1e-3 / ((double)count * iterations),
+                   (double)expanded / count,
+                   pass ? (compared ? cost_ratio / compared : 1.0) : 1.0,
+                   failures, mismatches);
+    }
+
+    Z_Free(points);
+    Z_Free(costs);
+    Z_Free(search);
+    Z_Free(begun);
+    Z_Free(paths);
+    Z_Free(codes);
+    Z_Free(requests);
+}
+
+PathInfo Nav_Path(nav_path_t *path)
+{
+    PathInfo result = Nav_Path_(path, true);
+
+    if (nav_record_file)
+        Nav_Record(path->request, result.returnCode);
+    
+#if USE_REF
+    if (path->request->debugging.drawTime)
+        Nav_DebugPath(&result, path->request);
+#endif
+
+    return result;
+}
+
+/*
+=============================================================================
+
+ASYNCHRONOUS PATHING
+
+Game submits a request and polls for the result on a later frame. Closest
+node lookups trace the world, so they are done when the request is made,
+and only the search runs on a worker thread with its own context. Nav_Frame
+finishes all searches before updating conditional nodes, so workers never
+see node flags change under them and results are always ready on the frame
+after the request was made.
+
+=============================================================================
+*/
+
+#define NAV_MAX_JOBS    64
+#define NAV_JOB_EXPIRE  5000    // unclaimed results are dropped after this many ms
+
+typedef struct {
+    unsigned    serial;         // 0 if slot is free
+    unsigned    work;           // async work id, 0 if not queued
+    bool        done;           // protected by nav_jobs.lock
+    bool        searched;       // route came from search, not cache
+    unsigned    time;
+    uint32_t    generation;
+    PathRequest request;
+    nav_path_t  path;
+    nav_ctx_t   *ctx;
+    int64_t     num_points;
+    PathInfo    info;
+} nav_job_t;
+
+static struct {
+    nav_job_t       jobs[NAV_MAX_JOBS];
+    unsigned        serial;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} nav_jobs;
+
+static cvar_t *nav_async;
+
+static void Nav_JobWork(void *arg)
+{
+    nav_job_t *job = arg;
+
+    job->num_points = Nav_Search(&job->path, job->ctx);
+    Nav_PathFinish(&job->path, job->ctx, &job->info, job->num_points);
+
+    pthread_mutex_lock(&nav_jobs.lock);
+    job->done = true;
+    pthread_cond_broadcast(&nav_jobs.cond);
+    pthread_mutex_unlock(&nav_jobs.lock);
+}
+
+// waits for queued search, running it here if worker hasn't started yet
+static void Nav_FinishJob(nav_job_t *job)
+{
+    if (!job->work)
+        return;
+
+    if (Com_CancelAsyncWork(job->work)) {
+        Nav_JobWork(job);
+    } else {
+        pthread_mutex_lock(&nav_jobs.lock);
+        while (!job->done)
+            pthread_cond_wait(&nav_jobs.cond, &nav_jobs.lock);
+        pthread_mutex_unlock(&nav_jobs.lock);
+    }
+
+    job->work = 0;
+}
+
+static void Nav_FinishJobs(void)
+{
+    for (int i = 0; i < NAV_MAX_JOBS; i++)
+        Nav_FinishJob(&nav_jobs.jobs[i]);
+}
+
+// forgets results nobody came back for, e.g. because monster died
+static void Nav_ExpireJobs(void)
+{
+    for (int i = 0; i < NAV_MAX_JOBS; i++) {
+        nav_job_t *job = &nav_jobs.jobs[i];
+
+        if (job->serial && svs.realtime - job->time > NAV_JOB_EXPIRE)
+            job->serial = 0;
+    }
+}
+
+// contexts are freed with the rest of nav data
+static void Nav_ResetJobs(void)
+{
+    Nav_FinishJobs();
+
+    for (int i = 0; i < NAV_MAX_JOBS; i++) {
+        nav_jobs.jobs[i].serial = 0;
+        nav_jobs.jobs[i].ctx = NULL;
+    }
+}
+
+static nav_job_t *Nav_JobForHandle(int handle)
+{
+    if (handle <= 0)
+        return NULL;
+
+    nav_job_t *job = &nav_jobs.jobs[handle % NAV_MAX_JOBS];
+
+    if (!job->serial || job->serial != handle / NAV_MAX_JOBS)
+        return NULL;
+
+    return job;
+}
+
+/*
+=================
+Nav_RequestPath
+
+Starts finding path for request, which is copied. Path points aren't
+returned for asynchronous requests. Returns handle to pass to Nav_PollPath,
+or 0 if too many requests are pending.
+=================
+*/
+int Nav_RequestPath(const PathRequest *request)
+{
+    nav_job_t *job = NULL;
+    int64_t num_points;
+    int i;
+
+    for (i = 0; i < NAV_MAX_JOBS; i++) {
+        if (!nav_jobs.jobs[i].serial) {
+            job = &nav_jobs.jobs[i];
+            break;
+        }
+    }
+
+    if (!job)
+        return 0;
+
+    if (++nav_jobs.serial > INT_MAX / NAV_MAX_JOBS)
+        nav_jobs.serial = 1;
+
+    job->serial = nav_jobs.serial;
+    job->time = svs.realtime;
+    job->done = true;
+    job->searched = false;
+
+    job->request = *request;
+    job->request.debugging.drawTime = 0;
+    job->request.pathPoints.posArray = NULL;
+    job->request.pathPoints.count = 0;
+
+    memset(&job->path, 0, sizeof(job->path));
+    memset(&job->info, 0, sizeof(job->info));
+    job->path.request = &job->request;
+
+    nav_data.async_requests++;
+
+    if (!Nav_PathBegin(&job->path, nav_data.ctx, &job->info))
+        goto done;
+
+    if (Nav_Cacheable(&job->path) && Nav_CacheLookup(&job->path, nav_data.ctx, &num_points)) {
+        Nav_PathFinish(&job->path, nav_data.ctx, &job->info, num_points);
+        goto done;
+    }
+
+    if (!job->ctx)
+        job->ctx = Nav_AllocCtx();
+
+    job->generation = nav_data.cache_generation;
+    job->searched = true;
+    nav_data.searches++;
+
+    if (nav_async->integer) {
+        asyncwork_t work = {
+            .work_cb = Nav_JobWork,
+            .cb_arg = job,
+            .priority = ASYNC_PRIO_NORMAL,
+        };
+
+        job->done = false;
+        job->work = Com_QueueAsyncWork(&work);
+    } else {
+        Nav_JobWork(job);
+    }
+
+done:
+    return job->serial * NAV_MAX_JOBS + i;
+}
+
+/*
+=================
+Nav_PollPath
+
+Returns 1 and fills in info if path is ready, which frees the handle.
+Returns 0 if path is still being searched for, -1 if handle is not valid
+(e.g. map has changed or result expired).
+=================
+*/
+int Nav_PollPath(int handle, PathInfo *info)
+{
+    nav_job_t *job = Nav_JobForHandle(handle);
+
+    if (!job)
+        return -1;
+
+    if (job->work) {
+        pthread_mutex_lock(&nav_jobs.lock);
+        bool done = job->done;
+        pthread_mutex_unlock(&nav_jobs.lock);
+
+        if (!done)
+            return 0;
+
+        job->work = 0;
+    }
+
+    if (job->searched && Nav_Cacheable(&job->path))
+        Nav_CacheStore(&job->path, job->ctx, job->num_points, job->generation);
+
+    *info = job->info;
+    job->serial = 0;
+    return 1;
+}
+
+void Nav_CancelPath(int handle)
+{
+    nav_job_t *job = Nav_JobForHandle(handle);
+
+    if (!job)
+        return;
+
+    Nav_FinishJob(job);
+    job->serial = 0;
+}
+
+static void Nav_Stats_f(void)
+{
+    if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset")) {
+        nav_data.searches = nav_data.cache_hits = nav_data.async_requests = 0;
+        return;
+    }
+
+    int pending = 0;
+
+    for (int i = 0; i < NAV_MAX_JOBS; i++)
+        if (nav_jobs.jobs[i].serial)
+            pending++;
+
+    Com_Printf("Searches: %u\n"
+               "Cache hits: %u\n"
+               "Async requests: %u (%d unclaimed)\n",
+               nav_data.searches, nav_data.cache_hits,
+               nav_data.async_requests, pending);
+}
+
+static bool Nav_NodeIsConditional(const nav_node_t *node)
+{
+    return node->flags & (NodeFlag_CheckDoorLinks | NodeFlag_CheckForHazard | NodeFlag_CheckHasFloor | NodeFlag_CheckInLiquid | NodeFlag_CheckInSolid);
+}
+
+// buckets node ids by origin into grid cells with a counting sort
+static bool Nav_BuildGrid(void)
+{
+    vec2_t mins = { 0, 0 }, maxs = { 0, 0 };
+
+    for (int i = 0; i < nav_data.num_nodes; i++) {
+        const float *origin = nav_data.nodes[i].origin;
+
+        for (int j = 0; j < 2; j++) {
+            if (!i || origin[j] < mins[j])
+                mins[j] = origin[j];
+            if (!i || origin[j] > maxs[j])
+                maxs[j] = origin[j];
+        }
+    }
+
+    Vector2Copy(mins, nav_data.grid_mins);
+
+    for (int i = 0; i < 2; i++)
+        nav_data.grid_size[i] = Q_clipf((maxs[i] - mins[i]) / NAV_GRID_CELL, 0, NAV_GRID_MAX - 1) + 1;
+
+    int32_t num_cells = nav_data.grid_size[0] * nav_data.grid_size[1];
+
+    if (!(nav_data.grid_cells = NAV_ALLOCZ(sizeof(int32_t) * (num_cells + 1))))
+        return false;
+    if (!(nav_data.grid_nodes = NAV_ALLOC(sizeof(int16_t) * max(nav_data.num_nodes, 1))))
+        return false;
+
+    // count nodes per cell and turn counts into end offsets, then fill
+    // in reverse so offsets become cell starts with ids in ascending order
+    for (int i = 0; i < nav_data.num_nodes; i++) {
+        int32_t cell[2];
+        Nav_GridCell(nav_data.nodes[i].origin, cell);
+        nav_data.grid_cells[cell[1] * nav_data.grid_size[0] + cell[0]]++;
+    }
+
+    for (int i = 1; i < num_cells; i++)
+        nav_data.grid_cells[i] += nav_data.grid_cells[i - 1];
+
+    nav_data.grid_cells[num_cells] = nav_data.num_nodes;
+
+    for (int i = nav_data.num_nodes - 1; i >= 0; i--) {
+        int32_t cell[2];
+        Nav_GridCell(nav_data.nodes[i].origin, cell);
+        nav_data.grid_nodes[--nav_data.grid_cells[cell[1] * nav_data.grid_size[0] + cell[0]]] = i;
+    }
+
+    return true;
+}
+
+static int32_t Nav_FindRegion(int32_t *parent, int32_t r)
+{
+    while (parent[r] != r)
+        r = parent[r] = parent[parent[r]];
+
+    return r;
+}
+
+// joins linked nodes in the same BSP area and cluster, then merges
+// linked regions within the same area while they stay small
+static bool Nav_BuildRegions(void)
+{
+    int32_t n = nav_data.num_nodes;
+
+    if (!n)
+        return true;
+
+    int32_t *area = Z_Malloc(sizeof(area[0]) * n);
+    int32_t *cluster = Z_Malloc(sizeof(cluster[0]) * n);
+    int32_t *parent = Z_Malloc(sizeof(parent[0]) * n);
+    int32_t *size = Z_Malloc(sizeof(size[0]) * n);
+
+    if (!(nav_data.node_region = NAV_ALLOC(sizeof(int32_t) * n)))
+        return false;
+
+    for (int i = 0; i < n; i++) {
+        // origins are on the floor
+        vec3_t origin;
+        VectorCopy(nav_data.nodes[i].origin, origin);
+        origin[2] += 24.0f;
+
+        const mleaf_t *leaf = CM_PointLeaf(&sv.cm, origin);
+        area[i] = leaf->area;
+        cluster[i] = leaf->cluster;
+        parent[i] = i;
+        size[i] = 1;
+    }
+
+    // first pass keeps clusters whole, second one is size limited
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < n; i++) {
+            const nav_node_t *node = &nav_data.nodes[i];
+
+            for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
+                int32_t t = link->target->id;
+
+                if (area[i] != area[t])
+                    continue;
+                if (!pass && cluster[i] != cluster[t])
+                    continue;
+
+                int32_t a = Nav_FindRegion(parent, i);
+                int32_t b = Nav_FindRegion(parent, t);
+
+                if (a == b || (pass && size[a] + size[b] > NAV_REGION_NODES))
+                    continue;
+
+                parent[b] = a;
+                size[a] += size[b];
+            }
+        }
+    }
+
+    // renumber regions densely, reusing size as remap table
+    for (int i = 0; i < n; i++)
+        size[i] = -1;
+
+    nav_data.num_regions = 0;
+
+    for (int i = 0; i < n; i++) {
+        int32_t r = Nav_FindRegion(parent, i);
+
+        if (size[r] == -1)
+            size[r] = nav_data.num_regions++;
+
+        nav_data.node_region[i] = size[r];
+    }
+
+    Z_Free(area);
+    Z_Free(cluster);
+    Z_Free(parent);
+    Z_Free(size);
+
+    return true;
+}
+
+// fills g_score with costs from node to nodes in its region using any
+// link; read them with Nav_GScore.
+static void Nav_RegionCosts(nav_ctx_t *ctx, int16_t from)
+{
+    int32_t region = nav_data.node_region[from];
+
+    Nav_ResetSearch(ctx);
+
+    Nav_GScore(ctx, from);
+    ctx->g_score[from] = 0;
+    Nav_PushOpenSet(ctx, &nav_data.nodes[from], 0);
+
+    while (ctx->num_open) {
+        int16_t current = Nav_PopOpenSet(ctx);
+        const nav_node_t *node = &nav_data.nodes[current];
+
+        for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
+            int16_t target = link->target->id;
+
+            if (nav_data.node_region[target] != region)
+                continue;
+
+            float g = ctx->g_score[current] + Nav_Weight(NULL, node, link);
+
+            if (g >= Nav_GScore(ctx, target))
+                continue;
+
+            ctx->g_score[target] = g;
+            Nav_PushOpenSet(ctx, link->target, g);
+        }
+    }
+}
+
+typedef struct {
+    int32_t             from_region, to_region;
+    nav_link_type_t     type;
+    const nav_link_t    *link;
+    vec3_t              mid;
+} nav_portal_link_t;
+
+static bool Nav_SamePortal(const nav_portal_link_t *a, const nav_portal_link_t *b)
+{
+    return a->from_region == b->from_region && a->to_region == b->to_region && a->type == b->type;
+}
+
+static int Nav_PortalLinkCmp(const void *p1, const void *p2)
+{
+    const nav_portal_link_t *a = p1;
+    const nav_portal_link_t *b = p2;
+
+    if (a->from_region != b->from_region)
+        return a->from_region - b->from_region;
+    if (a->to_region != b->to_region)
+        return a->to_region - b->to_region;
+    if (a->type != b->type)
+        return a->type - b->type;
+    return a->link - b->link;
+}
+
+// of links going between same two regions by same means, keeps the one
+// closest to middle of them all and a few more spread along the border.
+// region graph only picks which regions to search, but with a single
+// link per border it would often pick a roundabout sequence of them.
+static void Nav_PickPortalLinks(byte *picked)
+{
+    int32_t num_portal_links = 0;
+
+    for (int i = 0; i < nav_data.num_nodes; i++) {
+        const nav_node_t *node = &nav_data.nodes[i];
+
+        for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++)
+            if (nav_data.node_region[i] != nav_data.node_region[link->target->id])
+                num_portal_links++;
+    }
+
+    if (!num_portal_links)
+        return;
+
+    nav_portal_link_t *portal_links = Z_Malloc(sizeof(portal_links[0]) * num_portal_links);
+    nav_portal_link_t *p = portal_links;
+
+    for (int i = 0; i < nav_data.num_nodes; i++) {
+        const nav_node_t *node = &nav_data.nodes[i];
+
+        for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
+            if (nav_data.node_region[i] == nav_data.node_region[link->target->id])
+                continue;
+
+            p->from_region = nav_data.node_region[i];
+            p->to_region = nav_data.node_region[link->target->id];
+            p->type = link->type;
+            p->link = link;
+            LerpVector(node->origin, link->target->origin, 0.5f, p->mid);
+            p++;
+        }
+    }
+
+    qsort(portal_links, num_portal_links, sizeof(portal_links[0]), Nav_PortalLinkCmp);
+
+    for (int first = 0, last; first < num_portal_links; first = last) {
+        vec3_t center = { 0 };
+
+        for (last = first; last < num_portal_links && Nav_SamePortal(&portal_links[first], &portal_links[last]); last++)
+            VectorAdd(center, portal_links[last].mid, center);
+
+        VectorScale(center, 1.0f / (last - first), center);
+
+        int best = first;
+        float best_dist = INFINITY;
+
+        for (int i = first; i < last; i++) {
+            float dist = DistanceSquared(center, portal_links[i].mid);
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = i;
+            }
+        }
+
+        picked[portal_links[best].link - nav_data.links] = true;
+
+        // then ones farthest from those already picked, so that wide
+        // borders can be crossed where it's shortest
+        for (int k = 1; k < NAV_PORTAL_LINKS; k++) {
+            best = -1;
+            best_dist = NAV_PORTAL_SPACING * NAV_PORTAL_SPACING;
+
+            for (int i = first; i < last; i++) {
+                float dist = INFINITY;
+
+                for (int j = first; j < last; j++)
+                    if (picked[portal_links[j].link - nav_data.links])
+                        dist = min(dist, DistanceSquared(portal_links[i].mid, portal_links[j].mid));
+
+                if (dist > best_dist) {
+                    best_dist = dist;
+                    best = i;
+                }
+            }
+
+            if (best == -1)
+                break;
+
+            picked[portal_links[best].link - nav_data.links] = true;
+        }
+    }
+
+    Z_Free(portal_links);
+}
+
+// joins region entrances with picked links between regions and cheapest
+// routes within regions. done in two passes, counting edges first and
+// then filling them in.
+static bool Nav_BuildRegionGraph(void)
+{
+    int32_t n = nav_data.num_nodes;
+    nav_ctx_t *ctx = nav_data.ctx;
+
+    if (!(nav_data.edge_first = NAV_ALLOCZ(sizeof(int32_t) * (n + 1))))
+        return false;
+    if (!(nav_data.region_first = NAV_ALLOCZ(sizeof(int32_t) * (nav_data.num_regions + 1))))
+        return false;
+
+    if (!n)
+        return true;
+
+    byte *entrance = Z_Mallocz(n);
+    byte *picked = Z_Mallocz(max(nav_data.num_links, 1));
+    int32_t num_entrances = 0;
+
+    Nav_PickPortalLinks(picked);
+
+    for (int i = 0; i < n; i++) {
+        const nav_node_t *node = &nav_data.nodes[i];
+
+        for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
+            if (picked[link - nav_data.links])
+                entrance[i] = entrance[link->target->id] = true;
+        }
+    }
+
+    // entrance lists per region, same counting sort as grid
+    for (int i = 0; i < n; i++) {
+        if (entrance[i]) {
+            nav_data.region_first[nav_data.node_region[i]]++;
+            num_entrances++;
+        }
+    }
+
+    for (int i = 1; i < nav_data.num_regions; i++)
+        nav_data.region_first[i] += nav_data.region_first[i - 1];
+
+    nav_data.region_first[nav_data.num_regions] = num_entrances;
+
+    if (!(nav_data.region_entrances = NAV_ALLOC(sizeof(int16_t) * max(num_entrances, 1)))) {
+        Z_Free(picked);
+        Z_Free(entrance);
+        return false;
+    }
+
+    for (int i = n - 1; i >= 0; i--)
+        if (entrance[i])
+            nav_data.region_entrances[--nav_data.region_first[nav_data.node_region[i]]] = i;
+
+    for (int pass = 0; pass < 2; pass++) {
+        int32_t num_edges = 0;
+
+        for (int i = 0; i < n; i++) {
+            nav_data.edge_first[i] = num_edges;
+
+            if (!entrance[i])
+                continue;
+
+            const nav_node_t *node = &nav_data.nodes[i];
+            int32_t region = nav_data.node_region[i];
+
+            for (const nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
+                if (!picked[link - nav_data.links])
+                    continue;
+
+                if (pass) {
+                    nav_region_edge_t *edge = &nav_data.region_edges[num_edges];
+                    edge->link = link;
+                    edge->cost = Nav_Weight(NULL, node, link);
+                    edge->target = link->target->id;
+                }
+                num_edges++;
+            }
+
+            Nav_RegionCosts(ctx, i);
+
+            for (int j = nav_data.region_first[region]; j < nav_data.region_first[region + 1]; j++) {
+                int16_t e = nav_data.region_entrances[j];
+
+                if (e == i || Nav_GScore(ctx, e) == INFINITY)
+                    continue;
+
+                if (pass) {
+                    nav_region_edge_t *edge = &nav_data.region_edges[num_edges];
+                    edge->link = NULL;
+                    edge->cost = ctx->g_score[e];
+                    edge->target = e;
+                }
+                num_edges++;
+            }
+        }
+
+        nav_data.edge_first[n] = num_edges;
+
+        if (!pass && !(nav_data.region_edges = NAV_ALLOC(sizeof(nav_region_edge_t) * max(num_edges, 1)))) {
+            Z_Free(picked);
+            Z_Free(entrance);
+            return false;
+        }
+    }
+
+    Z_Free(picked);
+    Z_Free(entrance);
+    return true;
+}
+
+void Nav_Load(const char *map_name)
+{
+    Q_assert(!nav_data.loaded);
+
+    nav_data.loaded = true;
+
+    Q_snprintf(nav_data.filename, sizeof(nav_data.filename), "bots/navigation/%s.nav", map_name);
+
+    qhandle_t f;
+    int64_t l = FS_OpenFile(nav_data.filename, &f, FS_MODE_READ);
+
+    if (l < 0)
+        return;
+
+    int v;
+
+    NAV_VERIFY_READ(v);
+    NAV_VERIFY(v == NAV_MAGIC, "bad magic");
+
+    NAV_VERIFY_READ(v);
+    NAV_VERIFY((v <= NAV_VERSION_LATEST), va("bad version %i\n", v));
+
+    NAV_VERIFY_READ(nav_data.num_nodes);
+    NAV_VERIFY_READ(nav_data.num_links);
+    NAV_VERIFY_READ(nav_data.num_traversals);
+    NAV_VERIFY_READ(nav_data.heuristic);
+
+    NAV_VERIFY(nav_data.nodes = NAV_ALLOCZ(sizeof(nav_node_t) * nav_data.num_nodes), "out of memory");
     if (nav_data.num_links)
         NAV_VERIFY(nav_data.links = NAV_ALLOCZ(sizeof(nav_link_t) * nav_data.num_links), "out of memory");
     if (nav_data.num_traversals)
@@ -1020,22 +2455,18 @@ void Nav_Load(const char *map_name)
         }
     }
 
-    nav_data.node_link_bitmap_size = (nav_data.num_nodes + CHAR_BIT - 1) / CHAR_BIT;
-    NAV_VERIFY(nav_data.node_link_bitmap = NAV_ALLOCZ(nav_data.node_link_bitmap_size * nav_data.num_nodes), "out of memory");
-
-    for (int i = 0; i < nav_data.num_nodes; i++) {
-        nav_node_t *node = nav_data.nodes + i;
-        byte *bits = nav_data.node_link_bitmap + (nav_data.node_link_bitmap_size * i);
+    NAV_VERIFY(Nav_BuildGrid(), "out of memory");
+    NAV_VERIFY(Nav_BuildRegions(), "out of memory");
 
-        for (nav_link_t *link = node->links; link != node->links + node->num_links; link++) {
-            Q_SetBit(bits, link->target->id);
-        }
-    }
+    nav_data.ctx = Nav_AllocCtx();
 
-    Com_DPrintf("Bot navigation file (%s) loaded:\n %i nodes\n %i links\n %i traversals\n %i edicts\n",
-        nav_data.filename, nav_data.num_nodes, nav_data.num_links, nav_data.num_traversals, nav_data.num_edicts);
+    NAV_VERIFY(Nav_BuildRegionGraph(), "out of memory");
 
-    nav_data.ctx = Nav_AllocCtx();
+    Com_DPrintf("Bot navigation file (%s) loaded:\n %i nodes\n %i links\n %i traversals\n %i edicts\n %i regions\n %i region edges\n",
+        nav_data.filename, nav_data.num_nodes, nav_data.num_links, nav_data.num_traversals, nav_data.num_edicts,
+        nav_data.num_regions, nav_data.edge_first[nav_data.num_nodes]);
+    nav_data.cache = NAV_ALLOCZ(sizeof(nav_data.cache[0]) * NAV_CACHE_SIZE);
+    nav_data.cache_generation = 1;
 
     goto cleanup;
 
@@ -1051,6 +2482,9 @@ void Nav_Unload(void)
     if (!nav_data.loaded)
         return;
 
+    Nav_StopRecord();
+    Nav_ResetJobs();
+
     Z_FreeTags(TAG_NAV);
 
     memset(&nav_data, 0, sizeof(nav_data));
@@ -1188,7 +2622,6 @@ static void Nav_RenderLink(const nav_node_t *node, int node_id, const vec3_t nod
     if (link->edict && link->edict->game_edict)
         Nav_RenderLinkEdict(node_origin, e, link->edict);
             
-    const byte *target_bits = nav_data.node_link_bitmap + (nav_data.node_link_bitmap_size * link->target->id);
     bool link_disabled = ((node->flags | link->target->flags) & NodeFlag_Disabled);
     uint8_t link_alpha = link_disabled ? (alpha * 0.5f) : alpha;
             
@@ -1202,7 +2635,7 @@ static void Nav_RenderLink(const nav_node_t *node, int node_id, const vec3_t nod
     if (link->traversal)
         Nav_GetCurveControlPoint(node_origin, e, ctrl);
 
-    if (Q_IsBitSet(target_bits, node_id)) {
+    if (Nav_FindLink(link->target, node)) {
         // two-way link
         if (node_id < link->target->id)
             return;
@@ -1454,20 +2887,54 @@ void Nav_Frame(void)
         if (!nav_data.setup_entities)
             Nav_SetupEntities();
 
-    for (int i = 0; i < nav_data.num_conditional_nodes; i++)
-        Nav_UpdateConditionalNode(nav_data.conditional_nodes[i]);
+    // workers may be reading node flags
+    Nav_FinishJobs();
+
+    bool changed = false;
+
+    for (int i = 0; i < nav_data.num_conditional_nodes; i++) {
+        nav_node_t *node = nav_data.conditional_nodes[i];
+        nav_node_flags_t old_flags = node->flags;
+
+        Nav_UpdateConditionalNode(node);
+
+        if ((node->flags ^ old_flags) & NodeFlag_Disabled)
+            changed = true;
+    }
+
+    // drop cached routes that may go through changed nodes
+    if (changed)
+        nav_data.cache_generation++;
+
+    Nav_ExpireJobs();
 
 #if USE_REF
     Nav_Debug();
 #endif
 }
 
+static const cmdreg_t c_nav[] = {
+    { "nav_record", Nav_Record_f },
+    { "nav_bench", Nav_Bench_f },
+    { "nav_stats", Nav_Stats_f },
+
+    { NULL }
+};
+
 void Nav_Init(void)
 {
 #if USE_REF
     nav_debug = Cvar_Get("nav_debug", "0", 0);
     nav_debug_range = Cvar_Get("nav_debug_range", "512", 0);
 #endif
+    nav_cache_time = Cvar_Get("nav_cache_time", "1000", 0);
+    nav_async = Cvar_Get("nav_async", "1", 0);
+    nav_hierarchy = Cvar_Get("nav_hierarchy", "1", 0);
+
+    pthread_mutex_init(&nav_jobs.lock, NULL);
+    pthread_cond_init(&nav_jobs.cond, NULL);
+
+    Cmd_Register(c_nav);
 }
 
 void Nav_Shutdown(void)
@@ -531,6 +531,7 @@ static int read_level_file(void)
 
     len = MSG_ReadByte();
     CM_SetPortalStates(&sv.cm, MSG_ReadData(len), len);
+    SV_InvalidateAreaBits();
 
     Com_AbortFunc(NULL, NULL);
     FS_FreeFile(data);
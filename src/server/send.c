@@ -259,7 +259,8 @@ MULTICAST_PHS    send to clients potentially hearable from org
 void SV_Multicast(const vec3_t origin, multicast_t to, bool reliable)
 {
     client_t        *client;
-    visrow_t        mask;
+    visrow_t        temp;
+    const visrow_t  *vis = NULL;
     const mleaf_t   *leaf1 = NULL;
     int             flags = 0;
 
@@ -279,7 +280,7 @@ void SV_Multicast(const vec3_t origin, multicast_t to, bool reliable)
 
     if (to) {
         leaf1 = CM_PointLeaf(&sv.cm, origin);
-        BSP_ClusterVis(sv.cm.cache, &mask, leaf1->cluster, MULTICAST_PVS - to);
+        vis = SV_ClusterVis(&sv.cm, &temp, leaf1->cluster, MULTICAST_PVS - to);
     }
     if (reliable)
         flags |= MSG_RELIABLE;
@@ -300,7 +301,7 @@ void SV_Multicast(const vec3_t origin, multicast_t to, bool reliable)
                 continue;
             if (leaf2->cluster == -1)
                 continue;
-            if (!Q_IsBitSet(mask.b, leaf2->cluster))
+            if (!Q_IsBitSet(vis->b, leaf2->cluster))
                 continue;
         }
 
@@ -838,6 +839,39 @@ static void check_key_sync(const client_t *client)
 }
 #endif
 
+/*
+=======================
+send_client_frames
+
+Builds frames for a batch of clients (possibly in parallel), then
+writes and transmits them in order.
+=======================
+*/
+static void send_client_frames(client_t **clients, int count)
+{
+    client_t    *client;
+    int         i;
+
+    SV_BuildClientFrames(clients, count);
+
+    for (i = 0; i < count; i++) {
+        client = clients[i];
+
+        PROF_BEGIN(PROF_SV_WRITE_FRAME);
+        if (client->netchan.type == NETCHAN_NEW)
+            write_datagram_new(client);
+        else
+            write_datagram_old(client);
+        PROF_END();
+
+        // advance for next frame
+        client->framenum++;
+
+        // clear all unreliable messages still left
+        finish_frame(client);
+    }
+}
+
 /*
 =======================
 SV_SendClientMessages
@@ -849,7 +883,8 @@ Clients in earlier connection state are handled in SV_SendAsyncPackets.
 void SV_SendClientMessages(void)
 {
     client_t    *client;
-    int         cursize;
+    client_t    *batch[MAX_CLIENTS];
+    int         cursize, count = 0;
 
     // send a message to each connected client
     FOR_EACH_CLIENT(client) {
@@ -867,6 +902,9 @@ void SV_SendClientMessages(void)
         // if the reliable message overflowed,
         // drop the client (should never happen)
         if (client->netchan.message.overflowed) {
+            // dropping may run game code, so flush pending frames first
+            send_client_frames(batch, count);
+            count = 0;
             SZ_Clear(&client->netchan.message);
             SV_DropClient(client, "reliable message overflowed");
             goto finish;
@@ -884,13 +922,9 @@ void SV_SendClientMessages(void)
             goto advance;
         }
 
-        // build the new frame and write it
-        SV_BuildClientFrame(client);
-
-        if (client->netchan.type == NETCHAN_NEW)
-            write_datagram_new(client);
-        else
-            write_datagram_old(client);
+        // build the new frame and write it later
+        batch[count++] = client;
+        continue;
 
 advance:
         // advance for next frame
@@ -900,6 +934,8 @@ finish:
         // clear all unreliable messages still left
         finish_frame(client);
     }
+
+    send_client_frames(batch, count);
 }
 
 static void write_pending_download(client_t *client)
@@ -36,6 +36,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/net/chan.h"
 #include "common/net/net.h"
 #include "common/pmove.h"
+#include "common/prof.h"
 #include "common/prompt.h"
 #include "common/protocol.h"
 #include "common/q2proto_shared.h"
@@ -540,6 +541,8 @@ extern cvar_t       *sv_max_download_size;
 extern cvar_t       *sv_max_packet_entities;
 extern cvar_t       *sv_trunc_packet_entities;
 extern cvar_t       *sv_prioritize_entities;
+extern cvar_t       *sv_snapshot_threads;
+extern cvar_t       *sv_viscache;
 
 extern cvar_t       *sv_strafejump_hack;
 #if USE_PACKETDUP
@@ -724,6 +727,12 @@ void AC_Info_f(void);
 //
 // sv_user.c
 //
+typedef struct {
+    unsigned    sent;
+    unsigned    hits;
+    uint64_t    time;       // nanoseconds spent sending gamestates
+} gamestate_stats_t;
+
 void SV_New_f(void);
 void SV_Begin_f(void);
 void SV_ExecuteClientMessage(client_t *cl);
@@ -734,6 +743,9 @@ void SV_AlignKeyFrames(client_t *client);
 #define SV_AlignKeyFrames(client) (void)0
 #endif
 cvarban_t *SV_CheckInfoBans(const char *info, bool match_only);
+void SV_ClearGamestateCache(void);
+const gamestate_stats_t *SV_GetGamestateStats(void);
+void SV_ResetGamestateStats(void);
 
 //
 // sv_ccmds.c
@@ -765,7 +777,29 @@ static inline void SV_CheckEntityNumber(edict_t *ent, int e, const char *func)
 
 #define SV_CheckEntityNumber(ent, e) SV_CheckEntityNumber(ent, e, __func__)
 
-void SV_BuildClientFrame(client_t *client);
+typedef struct {
+    uint64_t    lookups;
+    uint64_t    hits;
+} vis_counter_t;
+
+typedef struct {
+    vis_counter_t   rows[3];    // PVS, PHS, PVS2
+    vis_counter_t   fatpvs;
+    vis_counter_t   areabits;
+} vis_stats_t;
+
+const visrow_t *SV_ClusterVis(const cm_t *cm, visrow_t *temp, int cluster, int vis);
+const visrow_t *SV_FatPVS(const cm_t *cm, visrow_t *temp, const vec3_t org);
+int SV_WriteAreaBits(const cm_t *cm, byte *buffer, int area);
+void SV_InvalidateAreaBits(void);
+void SV_ClearVisCache(void);
+void SV_EndVisCacheFrame(void);
+const vis_stats_t *SV_GetVisStats(void);
+void SV_ResetVisStats(void);
+
+void SV_BuildClientFrames(client_t **clients, int count);
+void SV_ShutdownFrameThreads(void);
+void SV_SnapshotBench_f(void);
 bool SV_WriteFrameToClient_Enhanced(client_t *client, unsigned maxsize);
 
 //
@@ -830,6 +864,22 @@ static inline void SV_SetClient_Ping(const client_t *client, int ping)
 // high level object sorting to reduce interaction tests
 //
 
+// per-thread state for world queries. queries from multiple threads are
+// safe as long as no entities are being linked or unlinked, functions
+// without context are for main thread only.
+typedef struct {
+    cm_trace_ctx_t      cm;
+    const vec_t         *mins, *maxs;
+    edict_t             **list;
+    size_t              count, maxcount;
+    int                 type;
+    BoxEdictsFilter_t   filter;
+    void                *filter_data;
+    bool                bail;
+} sv_area_ctx_t;
+
+void SV_InitAreaCtx(sv_area_ctx_t *ctx);
+
 void SV_ClearWorld(void);
 // called after the world model has been loaded, before linking any entities
 
@@ -845,6 +895,11 @@ void PF_LinkEdict(edict_t *ent);
 // sets ent->leafnums[] for pvs determination even if the entity
 // is not solid
 
+bool SV_MarkClusterEntities(const visrow_t *mask, uint32_t *bits);
+// sets bits for entities linked by the game into any cluster set in
+// the mask, returns false if cluster index is not available
+
+size_t SV_AreaEdictsCtx(sv_area_ctx_t *ctx, const vec3_t mins, const vec3_t maxs, edict_t **list, size_t maxcount, int areatype, BoxEdictsFilter_t filter, void *filter_data);
 size_t SV_AreaEdicts(const vec3_t mins, const vec3_t maxs, edict_t **list, size_t maxcount, int areatype, BoxEdictsFilter_t filter, void *filter_data);
 // fills in a table of edict pointers with edicts that have bounding boxes
 // that intersect the given area.  It is possible for a non-axial bmodel
@@ -858,10 +913,14 @@ size_t SV_AreaEdicts(const vec3_t mins, const vec3_t maxs, edict_t **list, size_
 //
 // functions that interact with everything appropriate
 //
+contents_t SV_PointContentsCtx(sv_area_ctx_t *ctx, const vec3_t p);
 contents_t SV_PointContents(const vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
 // Quake 2 extends this to also check entities, to allow moving liquids
 
+trace_t SV_TraceCtx(sv_area_ctx_t *ctx, const vec3_t start, const vec3_t mins,
+                    const vec3_t maxs, const vec3_t end,
+                    edict_t *passedict, contents_t contentmask);
 trace_t q_gameabi SV_Trace(const vec3_t start, const vec3_t mins,
                            const vec3_t maxs, const vec3_t end,
                            edict_t *passedict, contents_t contentmask);
@@ -875,6 +934,17 @@ trace_t q_gameabi SV_Trace(const vec3_t start, const vec3_t mins,
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+void SV_TraceBatch(trace_t *traces, const vec3_t *starts, const vec3_t *ends, int count,
+                   const vec3_t mins, const vec3_t maxs,
+                   edict_t *passedict, contents_t contentmask);
+// same as calling SV_Trace() for each start and end pair
+
+void SV_TraceBench_f(void);
+void SV_AreaTest_f(void);
+
+trace_t SV_ClipCtx(sv_area_ctx_t *ctx, const vec3_t start, const vec3_t mins,
+                   const vec3_t maxs, const vec3_t end,
+                   edict_t *clip, contents_t contentmask);
 trace_t q_gameabi SV_Clip(const vec3_t start, const vec3_t mins,
                           const vec3_t maxs, const vec3_t end,
                           edict_t *clip, contents_t contentmask);
@@ -32,6 +32,16 @@ sv_client and sv_player will be valid.
 
 static int      stringCmdCount;
 
+static void clear_baselines(void)
+{
+    for (int i = 0; i < SV_BASELINES_CHUNKS; i++) {
+        server_entity_packed_t *base = sv_client->baselines[i];
+        if (base) {
+            memset(base, 0, sizeof(*base) * SV_BASELINES_PER_CHUNK);
+        }
+    }
+}
+
 /*
 ================
 SV_CreateBaselines
@@ -48,12 +58,7 @@ static void SV_CreateBaselines(void)
     server_entity_packed_t *base, **chunk;
 
     // clear baselines from previous level
-    for (i = 0; i < SV_BASELINES_CHUNKS; i++) {
-        base = sv_client->baselines[i];
-        if (base) {
-            memset(base, 0, sizeof(*base) * SV_BASELINES_PER_CHUNK);
-        }
-    }
+    clear_baselines();
 
     for (i = 1; i < sv_client->ge->num_edicts; i++) {
         ent = EDICT_NUM2(sv_client->ge, i);
@@ -96,11 +101,200 @@ static void SV_CreateBaselines(void)
     }
 }
 
+/*
+============================================================
+
+GAMESTATE CACHE
+
+Clients with the same protocol, features and packet size get the same
+gamestate bytes, so after a map change it is built once per variant and
+replayed to everyone else. Baselines are snapshotted along with it and
+entries expire after a while to pick up entities that moved or spawned
+since. Any configstring change drops the whole cache.
+============================================================
+*/
+
+#define GAMESTATE_CACHE_SIZE    8
+#define GAMESTATE_CACHE_MSEC    3000
+
+typedef struct {
+    int                 protocol;
+    int                 version;
+    size_t              maxlen;
+    msgEsFlags_t        esFlags;
+    const cs_remap_t    *csr;
+    byte                features[sizeof(((q2proto_servercontext_t *)0)->features)];
+    unsigned            time;
+
+    server_entity_packed_t  *baselines;
+    int                 num_baselines;
+
+    byte                *data;      // messages, each prefixed by length
+    size_t              size;
+} gamestate_cache_t;
+
+static gamestate_cache_t    gamestate_cache[GAMESTATE_CACHE_SIZE];
+static gamestate_stats_t    gamestate_stats;
+
+static void free_gamestate(gamestate_cache_t *c)
+{
+    Z_Free(c->baselines);
+    Z_Free(c->data);
+    memset(c, 0, sizeof(*c));
+}
+
+/*
+==================
+SV_ClearGamestateCache
+==================
+*/
+void SV_ClearGamestateCache(void)
+{
+    for (int i = 0; i < GAMESTATE_CACHE_SIZE; i++) {
+        if (gamestate_cache[i].data) {
+            free_gamestate(&gamestate_cache[i]);
+        }
+    }
+}
+
+const gamestate_stats_t *SV_GetGamestateStats(void)
+{
+    return &gamestate_stats;
+}
+
+void SV_ResetGamestateStats(void)
+{
+    memset(&gamestate_stats, 0, sizeof(gamestate_stats));
+}
+
+static bool gamestate_expired(const gamestate_cache_t *c)
+{
+    return svs.realtime - c->time >= GAMESTATE_CACHE_MSEC;
+}
+
+static bool gamestate_matches(const gamestate_cache_t *c)
+{
+    return c->data && !gamestate_expired(c)
+        && c->protocol == sv_client->protocol
+        && c->version == sv_client->version
+        && c->maxlen == sv_client->io_data.max_msg_len
+        && c->esFlags == sv_client->esFlags
+        && c->csr == sv_client->csr
+        && !memcmp(c->features, &sv_client->q2proto_ctx.features, sizeof(c->features));
+}
+
+static gamestate_cache_t *find_gamestate(void)
+{
+    for (int i = 0; i < GAMESTATE_CACHE_SIZE; i++) {
+        if (gamestate_matches(&gamestate_cache[i])) {
+            return &gamestate_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// picks an empty, expired or else the oldest entry and fills in the key
+static gamestate_cache_t *alloc_gamestate(void)
+{
+    gamestate_cache_t *c, *best = &gamestate_cache[0];
+
+    for (c = gamestate_cache; c < gamestate_cache + GAMESTATE_CACHE_SIZE; c++) {
+        if (!c->data || gamestate_expired(c)) {
+            best = c;
+            break;
+        }
+        if ((int)(c->time - best->time) < 0) {
+            best = c;
+        }
+    }
+
+    if (best->data) {
+        free_gamestate(best);
+    }
+
+    best->protocol = sv_client->protocol;
+    best->version = sv_client->version;
+    best->maxlen = sv_client->io_data.max_msg_len;
+    best->esFlags = sv_client->esFlags;
+    best->csr = sv_client->csr;
+    memcpy(best->features, &sv_client->q2proto_ctx.features, sizeof(best->features));
+    best->time = svs.realtime;
+    return best;
+}
+
+static void save_baselines(gamestate_cache_t *c)
+{
+    const server_entity_packed_t *base;
+    int i, j, count = 0;
+
+    for (i = 0; i < SV_BASELINES_CHUNKS; i++) {
+        base = sv_client->baselines[i];
+        if (!base) {
+            continue;
+        }
+        for (j = 0; j < SV_BASELINES_PER_CHUNK; j++, base++) {
+            count += base->number != 0;
+        }
+    }
+
+    c->baselines = SV_Malloc(sizeof(c->baselines[0]) * max(count, 1));
+    c->num_baselines = 0;
+
+    for (i = 0; i < SV_BASELINES_CHUNKS; i++) {
+        base = sv_client->baselines[i];
+        if (!base) {
+            continue;
+        }
+        for (j = 0; j < SV_BASELINES_PER_CHUNK; j++, base++) {
+            if (base->number) {
+                c->baselines[c->num_baselines++] = *base;
+            }
+        }
+    }
+}
+
+static void load_baselines(const gamestate_cache_t *c)
+{
+    clear_baselines();
+
+    for (int i = 0; i < c->num_baselines; i++) {
+        const server_entity_packed_t *base = &c->baselines[i];
+        server_entity_packed_t **chunk = &sv_client->baselines[base->number >> SV_BASELINES_SHIFT];
+        if (*chunk == NULL) {
+            *chunk = SV_Mallocz(sizeof(**chunk) * SV_BASELINES_PER_CHUNK);
+        }
+        (*chunk)[base->number & SV_BASELINES_MASK] = *base;
+    }
+}
+
+static void save_message(gamestate_cache_t *c)
+{
+    uint32_t len = msg_write.cursize;
+
+    c->data = Z_Realloc(c->data, c->size + sizeof(len) + len);
+    memcpy(c->data + c->size, &len, sizeof(len));
+    memcpy(c->data + c->size + sizeof(len), msg_write.data, len);
+    c->size += sizeof(len) + len;
+}
+
+static void send_cached_gamestate(const gamestate_cache_t *c)
+{
+    const byte *p = c->data, *end = c->data + c->size;
+    uint32_t len;
+
+    while (p < end) {
+        memcpy(&len, p, sizeof(len));
+        SZ_Write(&msg_write, p + sizeof(len), len);
+        SV_ClientAddMessage(sv_client, MSG_GAMESTATE);
+        p += sizeof(len) + len;
+    }
+}
+
 // Data needed for write_gamestate. Too large for stack, so store statically.
 static q2proto_svc_configstring_t configstrings[MAX_CONFIGSTRINGS];
 static q2proto_svc_spawnbaseline_t spawnbaselines[MAX_EDICTS];
 
-static void write_gamestate(void)
+static q2proto_error_t write_gamestate(gamestate_cache_t *c)
 {
     msgEsFlags_t baseline_flags = sv_client->q2proto_ctx.features.has_beam_old_origin_fix ? MSG_ES_BEAMORIGIN : 0;
     q2proto_gamestate_t gamestate = {.num_configstrings = 0, .configstrings = configstrings, .num_spawnbaselines = 0, .spawnbaselines = spawnbaselines};
@@ -144,8 +338,56 @@ static void write_gamestate(void)
     int write_result;
     do {
         write_result = q2proto_server_write_gamestate(&sv_client->q2proto_ctx, deflate_args, (uintptr_t)&sv_client->io_data, &gamestate);
+        if (c && msg_write.cursize) {
+            save_message(c);
+        }
         SV_ClientAddMessage(sv_client, MSG_GAMESTATE);
     } while (write_result == Q2P_ERR_NOT_ENOUGH_PACKET_SPACE);
+
+    return write_result;
+}
+
+/*
+==================
+send_gamestate
+
+Creates baselines for this client and sends them with configstrings,
+reusing a cached gamestate if there is one.
+==================
+*/
+static void send_gamestate(void)
+{
+    gamestate_cache_t *c = NULL;
+    uint64_t start = Sys_Nanoseconds();
+    q2proto_error_t ret;
+
+    // MVD channels have their own configstrings and entities, and
+    // anything already in msg_write would end up in the cached data
+    bool cacheable = sv.state == ss_game && !msg_write.cursize;
+
+    gamestate_stats.sent++;
+
+    if (cacheable && (c = find_gamestate())) {
+        load_baselines(c);
+        send_cached_gamestate(c);
+        gamestate_stats.hits++;
+        gamestate_stats.time += Sys_Nanoseconds() - start;
+        return;
+    }
+
+    SV_CreateBaselines();
+
+    if (cacheable) {
+        c = alloc_gamestate();
+        save_baselines(c);
+    }
+
+    ret = write_gamestate(c);
+    if (c && (ret != Q2P_ERR_SUCCESS || !c->data)) {
+        free_gamestate(c);
+    }
+
+    gamestate_stats.time += Sys_Nanoseconds() - start;
 }
 
 static void stuff_cmds(const list_t *list)
@@ -243,9 +485,6 @@ void SV_New_f(void)
     // to make sure the protocol is right, and to set the gamedir
     //
 
-    // create baselines for this client
-    SV_CreateBaselines();
-
     q2proto_svc_message_t message = {.type = Q2P_SVC_SERVERDATA, .serverdata = {0}};
     q2proto_server_fill_serverdata(&sv_client->q2proto_ctx, &message.serverdata);
     message.serverdata.servercount = sv_client->spawncount;
@@ -300,8 +539,8 @@ void SV_New_f(void)
     if (sv.state == ss_pic || sv.state == ss_cinematic)
         return;
 
-    // send gamestate
-    write_gamestate();
+    // send baselines and gamestate
+    send_gamestate();
 
     // send next command
     SV_ClientCommand(sv_client, "precache %i\n", sv_client->spawncount);
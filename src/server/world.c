@@ -18,6 +18,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // world.c -- world query functions
 
 #include "server.h"
+#include "system/pthread.h"
 
 /*
 ===============================================================================
@@ -42,13 +43,16 @@ typedef struct areanode_s {
 static areanode_t   sv_areanodes[AREA_NODES];
 static int          sv_numareanodes;
 
-static const vec_t  *area_mins, *area_maxs;
-static edict_t      **area_list;
-static size_t       area_count, area_maxcount;
-static int          area_type;
-static BoxEdictsFilter_t area_filter;
-static void         *area_filter_data;
-static bool         area_bail;
+// context used by game and other single threaded callers
+static sv_area_ctx_t    sv_area;
+
+// cluster -> entity index used for culling client frames
+static list_t       sv_cluster_ents[MAX_MAP_CLUSTERS];
+static list_t       sv_cluster_links[MAX_EDICTS][MAX_ENT_CLUSTERS];
+static int          sv_num_cluster_links[MAX_EDICTS];
+static int          sv_numclusters;
+
+static void SV_IndexEntity(int entnum);
 
 /*
 ===============
@@ -106,6 +110,8 @@ void SV_ClearWorld(void)
     memset(sv_areanodes, 0, sizeof(sv_areanodes));
     sv_numareanodes = 0;
 
+    SV_InitAreaCtx(&sv_area);
+
     if (sv.cm.cache) {
         const mmodel_t *cm = &sv.cm.cache->models[0];
         SV_CreateAreaNode(0, cm->mins, cm->maxs);
@@ -116,6 +122,92 @@ void SV_ClearWorld(void)
         server_entity_t *sent = &sv.entities[i];
         sent->area.next = sent->area.prev = NULL;
     }
+
+    // rebuild cluster index from scratch
+    sv_numclusters = 0;
+    if (sv.cm.cache && sv.cm.cache->vis)
+        sv_numclusters = sv.cm.cache->vis->numclusters;
+
+    for (int i = 0; i < sv_numclusters; i++)
+        List_Init(&sv_cluster_ents[i]);
+
+    memset(sv_num_cluster_links, 0, sizeof(sv_num_cluster_links));
+    for (int i = 1; i < ge->max_edicts; i++)
+        SV_IndexEntity(i);
+}
+
+/*
+===============================================================================
+
+CLUSTER ENTITY INDEX
+
+Entities linked by the game are also added to per-cluster lists, so that
+frame building only has to visit entities touching clusters visible to
+the client instead of testing every entity. Index mirrors cluster list
+of server entity, which persists after unlinking.
+
+===============================================================================
+*/
+
+static void SV_UnindexEntity(int entnum)
+{
+    for (int i = 0; i < sv_num_cluster_links[entnum]; i++)
+        List_Remove(&sv_cluster_links[entnum][i]);
+
+    sv_num_cluster_links[entnum] = 0;
+}
+
+static void SV_IndexEntity(int entnum)
+{
+    const server_entity_t *sent = &sv.entities[entnum];
+
+    SV_UnindexEntity(entnum);
+
+    // entities marked by headnode are always considered
+    for (int i = 0; i < sent->num_clusters; i++) {
+        int cluster = sent->clusternums[i];
+        if (cluster < 0 || cluster >= sv_numclusters)
+            continue;
+        List_Append(&sv_cluster_ents[cluster],
+                    &sv_cluster_links[entnum][sv_num_cluster_links[entnum]++]);
+    }
+}
+
+/*
+===============
+SV_MarkClusterEntities
+
+Sets bits for all entities linked into any cluster set in the mask.
+Returns false if index is not available and all entities must be checked.
+Doesn't modify the index, so can be called from multiple threads while
+the game is not running.
+===============
+*/
+bool SV_MarkClusterEntities(const visrow_t *mask, uint32_t *bits)
+{
+    const list_t *head, *link;
+    int i, j, cluster, entnum;
+
+    if (!sv_numclusters)
+        return false;
+
+    for (i = 0; i < VIS_FAST_LONGS(sv.cm.cache->visrowsize); i++) {
+        size_t l = mask->l[i];
+        for (j = 0; l; j++, l >>= 1) {
+            if (!(l & 1))
+                continue;
+            cluster = i * sizeof(size_t) * 8 + j;
+            if (cluster >= sv_numclusters)
+                break;
+            head = &sv_cluster_ents[cluster];
+            LIST_FOR_EACH_ELEM(link, head) {
+                entnum = (link - &sv_cluster_links[0][0]) / MAX_ENT_CLUSTERS;
+                bits[entnum >> 5] |= 1U << (entnum & 31);
+            }
+        }
+    }
+
+    return true;
 }
 
 /*
@@ -316,6 +408,7 @@ void PF_LinkEdict(edict_t *ent)
     }
 
     SV_LinkEdict(&sv.cm, ent, sent);
+    SV_IndexEntity(entnum);
 
     // if first time, make sure old_origin is valid
     if (!ent->linkcount) {
@@ -361,22 +454,36 @@ void PF_LinkEdict(edict_t *ent)
 }
 
 
+/*
+====================
+SV_InitAreaCtx
+
+Each thread querying the world needs its own context. Queries from
+multiple threads are safe as long as no entities are being linked.
+====================
+*/
+void SV_InitAreaCtx(sv_area_ctx_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    CM_InitTraceCtx(&ctx->cm);
+}
+
 /*
 ====================
 SV_AreaEdicts_r
 
 ====================
 */
-static void SV_AreaEdicts_r(areanode_t *node)
+static void SV_AreaEdicts_r(sv_area_ctx_t *ctx, const areanode_t *node)
 {
-    list_t      *start;
+    const list_t    *start;
     server_entity_t *sent;
 
-    if (area_bail)
+    if (ctx->bail)
         return;
 
     // touch linked edicts
-    if (area_type == AREA_SOLID)
+    if (ctx->type == AREA_SOLID)
         start = &node->solid_edicts;
     else
         start = &node->trigger_edicts;
@@ -385,28 +492,28 @@ static void SV_AreaEdicts_r(areanode_t *node)
         edict_t *check = EDICT_NUM(sent - sv.entities);
         if (check->solid == SOLID_NOT)
             continue;        // deactivated
-        if (check->absmin[0] > area_maxs[0]
-            || check->absmin[1] > area_maxs[1]
-            || check->absmin[2] > area_maxs[2]
-            || check->absmax[0] < area_mins[0]
-            || check->absmax[1] < area_mins[1]
-            || check->absmax[2] < area_mins[2])
+        if (check->absmin[0] > ctx->maxs[0]
+            || check->absmin[1] > ctx->maxs[1]
+            || check->absmin[2] > ctx->maxs[2]
+            || check->absmax[0] < ctx->mins[0]
+            || check->absmax[1] < ctx->mins[1]
+            || check->absmax[2] < ctx->mins[2])
             continue;        // not touching
 
-        if (area_maxcount > 0 && area_count == area_maxcount) {
+        if (ctx->maxcount > 0 && ctx->count == ctx->maxcount) {
             Com_WPrintf("SV_AreaEdicts: MAXCOUNT\n");
             return;
         }
 
-        BoxEdictsResult_t filter_result = area_filter ? area_filter(check, area_filter_data) : BoxEdictsResult_Keep;
+        BoxEdictsResult_t filter_result = ctx->filter ? ctx->filter(check, ctx->filter_data) : BoxEdictsResult_Keep;
 
         if ((filter_result & ~BoxEdictsResult_End) == BoxEdictsResult_Keep) {
-            if (area_list)
-                area_list[area_count] = check;
-            area_count++;
+            if (ctx->list)
+                ctx->list[ctx->count] = check;
+            ctx->count++;
         }
         if ((filter_result & BoxEdictsResult_End) != 0) {
-            area_bail = true;
+            ctx->bail = true;
             return;
         }
     }
@@ -415,10 +522,10 @@ static void SV_AreaEdicts_r(areanode_t *node)
         return;        // terminal node
 
     // recurse down both sides
-    if (area_maxs[node->axis] > node->dist)
-        SV_AreaEdicts_r(node->children[0]);
-    if (area_mins[node->axis] < node->dist)
-        SV_AreaEdicts_r(node->children[1]);
+    if (ctx->maxs[node->axis] > node->dist)
+        SV_AreaEdicts_r(ctx, node->children[0]);
+    if (ctx->mins[node->axis] < node->dist)
+        SV_AreaEdicts_r(ctx, node->children[1]);
 }
 
 /*
@@ -426,23 +533,30 @@ static void SV_AreaEdicts_r(areanode_t *node)
 SV_AreaEdicts
 ================
 */
+size_t SV_AreaEdictsCtx(sv_area_ctx_t *ctx, const vec3_t mins, const vec3_t maxs,
+                        edict_t **list, size_t maxcount, int areatype,
+                        BoxEdictsFilter_t filter, void *filter_data)
+{
+    ctx->mins = mins;
+    ctx->maxs = maxs;
+    ctx->list = list;
+    ctx->count = 0;
+    ctx->maxcount = maxcount;
+    ctx->type = areatype;
+    ctx->filter = filter;
+    ctx->filter_data = filter_data;
+    ctx->bail = false;
+
+    SV_AreaEdicts_r(ctx, sv_areanodes);
+
+    return ctx->count;
+}
+
 size_t SV_AreaEdicts(const vec3_t mins, const vec3_t maxs,
                      edict_t **list, size_t maxcount, int areatype,
                      BoxEdictsFilter_t filter, void *filter_data)
 {
-    area_mins = mins;
-    area_maxs = maxs;
-    area_list = list;
-    area_count = 0;
-    area_maxcount = maxcount;
-    area_type = areatype;
-    area_filter = filter;
-    area_filter_data = filter_data;
-    area_bail = false;
-
-    SV_AreaEdicts_r(sv_areanodes);
-
-    return area_count;
+    return SV_AreaEdictsCtx(&sv_area, mins, maxs, list, maxcount, areatype, filter, filter_data);
 }
 
 
@@ -456,7 +570,7 @@ Returns a headnode that can be used for testing or clipping an
 object of mins/maxs size.
 ================
 */
-static const mnode_t *SV_HullForEntity(const edict_t *ent, bool triggers)
+static const mnode_t *SV_HullForEntity(sv_area_ctx_t *ctx, const edict_t *ent, bool triggers)
 {
     if (ent->solid == SOLID_BSP || (triggers && ent->solid == SOLID_TRIGGER)) {
         const bsp_t *bsp = sv.cm.cache;
@@ -477,7 +591,7 @@ static const mnode_t *SV_HullForEntity(const edict_t *ent, bool triggers)
     }
 
     // create a temp hull from bounding box sizes
-    return CM_HeadnodeForBox(ent->mins, ent->maxs);
+    return CM_HeadnodeForBoxCtx(&ctx->cm, ent->mins, ent->maxs);
 }
 
 /*
@@ -495,7 +609,7 @@ static const mnode_t *SV_WorldNodes(void)
 SV_PointContents
 =============
 */
-contents_t SV_PointContents(const vec3_t p)
+contents_t SV_PointContentsCtx(sv_area_ctx_t *ctx, const vec3_t p)
 {
     edict_t     *touch[MAX_EDICTS_OLD], *hit;
     int         i, num;
@@ -505,13 +619,13 @@ contents_t SV_PointContents(const vec3_t p)
     contents = CM_PointContents(p, SV_WorldNodes(), svs.csr.extended);
 
     // or in contents from all the other entities
-    num = SV_AreaEdicts(p, p, touch, q_countof(touch), AREA_SOLID, NULL, NULL);
+    num = SV_AreaEdictsCtx(ctx, p, p, touch, q_countof(touch), AREA_SOLID, NULL, NULL);
 
     for (i = 0; i < num; i++) {
         hit = touch[i];
 
         // might intersect, so do an exact clip
-        contents |= CM_TransformedPointContents(p, SV_HullForEntity(hit, false),
+        contents |= CM_TransformedPointContents(p, SV_HullForEntity(ctx, hit, false),
                                                 hit->s.origin, hit->s.angles,
                                                 svs.csr.extended);
     }
@@ -519,12 +633,17 @@ contents_t SV_PointContents(const vec3_t p)
     return contents;
 }
 
+contents_t SV_PointContents(const vec3_t p)
+{
+    return SV_PointContentsCtx(&sv_area, p);
+}
+
 /*
 ====================
 SV_ClipMoveToEntities
 ====================
 */
-static void SV_ClipMoveToEntities(trace_t *tr,
+static void SV_ClipMoveToEntities(sv_area_ctx_t *ctx, trace_t *tr,
                                   const vec3_t start, const vec3_t end,
                                   const vec3_t mins, const vec3_t maxs,
                                   edict_t *passedict, int contentmask)
@@ -545,7 +664,7 @@ static void SV_ClipMoveToEntities(trace_t *tr,
         }
     }
 
-    num = SV_AreaEdicts(boxmins, boxmaxs, touchlist, q_countof(touchlist), AREA_SOLID, NULL, NULL);
+    num = SV_AreaEdictsCtx(ctx, boxmins, boxmaxs, touchlist, q_countof(touchlist), AREA_SOLID, NULL, NULL);
 
     // be careful, it is possible to have an entity in this
     // list removed before we get to it (killtriggered)
@@ -579,7 +698,7 @@ static void SV_ClipMoveToEntities(trace_t *tr,
 
         // might intersect, so do an exact clip
         CM_TransformedBoxTrace(&trace, start, end, mins, maxs,
-                               SV_HullForEntity(touch, false), contentmask,
+                               SV_HullForEntity(ctx, touch, false), contentmask,
                                touch->s.origin, touch->s.angles,
                                svs.csr.extended);
 
@@ -595,9 +714,9 @@ Moves the given mins/maxs volume through the world from start to end.
 Passedict and edicts owned by passedict are explicitly not checked.
 ==================
 */
-trace_t q_gameabi SV_Trace(const vec3_t start, const vec3_t mins,
-                           const vec3_t maxs, const vec3_t end,
-                           edict_t *passedict, contents_t contentmask)
+trace_t SV_TraceCtx(sv_area_ctx_t *ctx, const vec3_t start, const vec3_t mins,
+                    const vec3_t maxs, const vec3_t end,
+                    edict_t *passedict, contents_t contentmask)
 {
     trace_t     trace;
 
@@ -613,10 +732,48 @@ trace_t q_gameabi SV_Trace(const vec3_t start, const vec3_t mins,
         return trace;   // blocked by the world
 
     // clip to other solid entities
-    SV_ClipMoveToEntities(&trace, start, end, mins, maxs, passedict, contentmask);
+    SV_ClipMoveToEntities(ctx, &trace, start, end, mins, maxs, passedict, contentmask);
     return trace;
 }
 
+trace_t q_gameabi SV_Trace(const vec3_t start, const vec3_t mins,
+                           const vec3_t maxs, const vec3_t end,
+                           edict_t *passedict, contents_t contentmask)
+{
+    return SV_TraceCtx(&sv_area, start, mins, maxs, end, passedict, contentmask);
+}
+
+/*
+==================
+SV_TraceBatch
+
+Like SV_Trace(), but world is traced by all boxes at once.
+==================
+*/
+void SV_TraceBatch(trace_t *traces, const vec3_t *starts, const vec3_t *ends, int count,
+                   const vec3_t mins, const vec3_t maxs,
+                   edict_t *passedict, contents_t contentmask)
+{
+    int i;
+
+    if (!mins)
+        mins = vec3_origin;
+    if (!maxs)
+        maxs = vec3_origin;
+
+    // clip to world
+    CM_BoxTraceBatch(traces, starts, ends, count, mins, maxs, SV_WorldNodes(), contentmask, svs.csr.extended);
+
+    for (i = 0; i < count; i++) {
+        traces[i].ent = ge->edicts;
+        if (traces[i].fraction == 0)
+            continue;   // blocked by the world
+
+        // clip to other solid entities
+        SV_ClipMoveToEntities(&sv_area, &traces[i], starts[i], ends[i], mins, maxs, passedict, contentmask);
+    }
+}
+
 /*
 ==================
 SV_Clip
@@ -625,9 +782,9 @@ Like SV_Trace(), but clip to specified entity only.
 Can be used to clip to SOLID_TRIGGER by its BSP tree.
 ==================
 */
-trace_t q_gameabi SV_Clip(const vec3_t start, const vec3_t mins,
-                          const vec3_t maxs, const vec3_t end,
-                          edict_t *clip, contents_t contentmask)
+trace_t SV_ClipCtx(sv_area_ctx_t *ctx, const vec3_t start, const vec3_t mins,
+                   const vec3_t maxs, const vec3_t end,
+                   edict_t *clip, contents_t contentmask)
 {
     trace_t     trace;
 
@@ -640,9 +797,266 @@ trace_t q_gameabi SV_Clip(const vec3_t start, const vec3_t mins,
         CM_BoxTrace(&trace, start, end, mins, maxs, SV_WorldNodes(), contentmask, svs.csr.extended);
     else
         CM_TransformedBoxTrace(&trace, start, end, mins, maxs,
-                               SV_HullForEntity(clip, true), contentmask,
+                               SV_HullForEntity(ctx, clip, true), contentmask,
                                clip->s.origin, clip->s.angles,
                                svs.csr.extended);
     trace.ent = clip;
     return trace;
 }
+
+trace_t q_gameabi SV_Clip(const vec3_t start, const vec3_t mins,
+                          const vec3_t maxs, const vec3_t end,
+                          edict_t *clip, contents_t contentmask)
+{
+    return SV_ClipCtx(&sv_area, start, mins, maxs, end, clip, contentmask);
+}
+
+/*
+==================
+SV_TraceBench_f
+
+Compares single and batched world traces for random rays in groups of
+16 sharing a start point and roughly the same direction, like pellets
+fired by hitscan weapons.
+==================
+*/
+void SV_TraceBench_f(void)
+{
+    static const vec3_t box_mins = { -16, -16, -16 };
+    static const vec3_t box_maxs = { 16, 16, 16 };
+    const mmodel_t *world;
+    trace_t     *single, *batch;
+    vec3_t      *starts, *ends, dir;
+    uint64_t    start, single_time, batch_time;
+    int         i, j, pass, count, mismatches;
+
+    if (!sv.cm.cache) {
+        Com_Printf("No map loaded.\n");
+        return;
+    }
+
+    count = 100000;
+    if (Cmd_Argc() > 1)
+        count = Q_clip(Q_atoi(Cmd_Argv(1)), 16, 10000000);
+
+    single = Z_Malloc(sizeof(single[0]) * count);
+    batch = Z_Malloc(sizeof(batch[0]) * count);
+    starts = Z_Malloc(sizeof(starts[0]) * count);
+    ends = Z_Malloc(sizeof(ends[0]) * count);
+
+    world = &sv.cm.cache->models[0];
+    for (i = 0; i < count; i++) {
+        if (i % 16 == 0) {
+            for (j = 0; j < 3; j++) {
+                starts[i][j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+                dir[j] = crand() * 2048;
+            }
+        } else {
+            VectorCopy(starts[i - 1], starts[i]);
+        }
+        for (j = 0; j < 3; j++)
+            ends[i][j] = starts[i][j] + dir[j] + crand() * 100;
+    }
+
+    Com_Printf("%d rays\n", count);
+    Com_Printf("hull  single(usec) batch(usec) ns/ray single/batch mismatches\n"
+               "----- ------------ ----------- ------------------- ----------\n");
+
+    for (pass = 0; pass < 2; pass++) {
+        const float *mins = pass ? box_mins : vec3_origin;
+        const float *maxs = pass ? box_maxs : vec3_origin;
+
+        start = Sys_Nanoseconds();
+        for (i = 0; i < count; i++)
+            CM_BoxTrace(&single[i], starts[i], ends[i], mins, maxs,
+                        SV_WorldNodes(), MASK_SOLID, svs.csr.extended);
+        single_time = Sys_Nanoseconds() - start;
+
+        start = Sys_Nanoseconds();
+        CM_BoxTraceBatch(batch, (const vec3_t *)starts, (const vec3_t *)ends, count,
+                         mins, maxs, SV_WorldNodes(), MASK_SOLID, svs.csr.extended);
+        batch_time = Sys_Nanoseconds() - start;
+
+        mismatches = 0;
+        for (i = 0; i < count; i++)
+            if (memcmp(&single[i], &batch[i], sizeof(single[0])))
+                mismatches++;
+
+        Com_Printf("%-5s %12.1f %11.1f %9.1f/%-9.1f %10d\n", pass ? "box" : "point",
+                   single_time * 1e-3, batch_time * 1e-3,
+                   (double)single_time / count, (double)batch_time / count, mismatches);
+    }
+
+    Z_Free(single);
+    Z_Free(batch);
+    Z_Free(starts);
+    Z_Free(ends);
+}
+
+// area queries, traces and point contents for one random box per ray
+typedef struct {
+    trace_t     trace;
+    contents_t  contents;
+    size_t      num_touch;
+    uint32_t    touch_hash;
+} areatest_result_t;
+
+typedef struct {
+    const vec3_t            *starts;
+    const vec3_t            *ends;
+    const areatest_result_t *expect;
+    int                     count;
+    int                     mismatches;
+    sv_area_ctx_t           ctx;
+} areatest_t;
+
+static const vec3_t areatest_mins = { -16, -16, -24 };
+static const vec3_t areatest_maxs = { 16, 16, 32 };
+
+// uses the main thread functions if ctx is NULL
+static void AreaTest_Query(sv_area_ctx_t *ctx, const vec3_t start, const vec3_t end,
+                           int kind, areatest_result_t *r)
+{
+    edict_t     *touch[MAX_EDICTS_OLD];
+    const float *mins = (kind & 1) ? areatest_mins : vec3_origin;
+    const float *maxs = (kind & 1) ? areatest_maxs : vec3_origin;
+    int         areatype = (kind & 2) ? AREA_TRIGGERS : AREA_SOLID;
+    vec3_t      absmins, absmaxs;
+    size_t      i;
+
+    for (i = 0; i < 3; i++) {
+        absmins[i] = min(start[i], end[i]) + mins[i];
+        absmaxs[i] = max(start[i], end[i]) + maxs[i];
+    }
+
+    if (ctx) {
+        r->num_touch = SV_AreaEdictsCtx(ctx, absmins, absmaxs, touch, q_countof(touch), areatype, NULL, NULL);
+        r->trace = SV_TraceCtx(ctx, start, mins, maxs, end, NULL, MASK_SHOT);
+        r->contents = SV_PointContentsCtx(ctx, end);
+    } else {
+        r->num_touch = SV_AreaEdicts(absmins, absmaxs, touch, q_countof(touch), areatype, NULL, NULL);
+        r->trace = SV_Trace(start, mins, maxs, end, NULL, MASK_SHOT);
+        r->contents = SV_PointContents(end);
+    }
+
+    r->touch_hash = 0;
+    for (i = 0; i < r->num_touch; i++)
+        r->touch_hash = r->touch_hash * 31 + NUM_FOR_EDICT(touch[i]);
+}
+
+static bool AreaTest_Compare(const areatest_result_t *a, const areatest_result_t *b)
+{
+    return a->num_touch == b->num_touch
+        && a->touch_hash == b->touch_hash
+        && a->contents == b->contents
+        && a->trace.allsolid == b->trace.allsolid
+        && a->trace.startsolid == b->trace.startsolid
+        && a->trace.fraction == b->trace.fraction
+        && VectorCompare(a->trace.endpos, b->trace.endpos)
+        && VectorCompare(a->trace.plane.normal, b->trace.plane.normal)
+        && a->trace.plane.dist == b->trace.plane.dist
+        && a->trace.surface == b->trace.surface
+        && a->trace.contents == b->trace.contents
+        && a->trace.ent == b->trace.ent;
+}
+
+static void *AreaTest_Thread(void *arg)
+{
+    areatest_t *t = arg;
+    areatest_result_t r;
+    int i;
+
+    for (i = 0; i < t->count; i++) {
+        AreaTest_Query(&t->ctx, t->starts[i], t->ends[i], i, &r);
+        if (!AreaTest_Compare(&r, &t->expect[i]))
+            t->mismatches++;
+    }
+
+    return NULL;
+}
+
+/*
+==================
+SV_AreaTest_f
+
+Runs area queries, traces and point contents checks against the current
+world from several threads using SV_*Ctx functions, and compares them
+with the main thread functions. Rays start near random entities so most
+of them have something to find.
+==================
+*/
+void SV_AreaTest_f(void)
+{
+    const mmodel_t      *world;
+    areatest_t          *tests;
+    areatest_result_t   *expect;
+    pthread_t           *threads;
+    vec3_t              *starts, *ends;
+    edict_t             *ent;
+    uint64_t            start, serial_time;
+    int                 i, j, numthreads, count, started, mismatches;
+
+    if (!sv.cm.cache || !ge) {
+        Com_Printf("No map loaded.\n");
+        return;
+    }
+
+    numthreads = 4;
+    if (Cmd_Argc() > 1)
+        numthreads = Q_clip(Q_atoi(Cmd_Argv(1)), 1, 64);
+
+    count = 100000;
+    if (Cmd_Argc() > 2)
+        count = Q_clip(Q_atoi(Cmd_Argv(2)), 1, 10000000);
+
+    starts = Z_Malloc(sizeof(starts[0]) * count);
+    ends = Z_Malloc(sizeof(ends[0]) * count);
+    expect = Z_Malloc(sizeof(expect[0]) * count);
+    tests = Z_Mallocz(sizeof(tests[0]) * numthreads);
+    threads = Z_Malloc(sizeof(threads[0]) * numthreads);
+
+    world = &sv.cm.cache->models[0];
+    for (i = 0; i < count; i++) {
+        ent = EDICT_NUM(Q_rand_uniform(ge->num_edicts));
+        for (j = 0; j < 3; j++) {
+            if (ent->inuse && ent->linked)
+                starts[i][j] = ent->s.origin[j] + crand() * 128;
+            else
+                starts[i][j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+            ends[i][j] = starts[i][j] + crand() * 512;
+        }
+    }
+
+    // reference run
+    start = Sys_Nanoseconds();
+    for (i = 0; i < count; i++)
+        AreaTest_Query(NULL, starts[i], ends[i], i, &expect[i]);
+    serial_time = Sys_Nanoseconds() - start;
+
+    start = Sys_Nanoseconds();
+    for (started = 0; started < numthreads; started++) {
+        tests[started].starts = (const vec3_t *)starts;
+        tests[started].ends = (const vec3_t *)ends;
+        tests[started].expect = expect;
+        tests[started].count = count;
+        SV_InitAreaCtx(&tests[started].ctx);
+        if (pthread_create(&threads[started], NULL, AreaTest_Thread, &tests[started]))
+            break;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    Com_Printf("%d queries: %.1f msec single threaded, %.1f msec on %d threads\n",
+               count, serial_time * 1e-6, (Sys_Nanoseconds() - start) * 1e-6, started);
+
+    mismatches = 0;
+    for (i = 0; i < started; i++)
+        mismatches += tests[i].mismatches;
+    Com_Printf("%d mismatches\n", mismatches);
+
+    Z_Free(starts);
+    Z_Free(ends);
+    Z_Free(expect);
+    Z_Free(tests);
+    Z_Free(threads);
+}
@@ -90,6 +90,13 @@ unsigned Sys_Milliseconds(void)
     return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
 }
 
+uint64_t Sys_Nanoseconds(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
 /*
 =================
 Sys_Quit
@@ -456,6 +463,33 @@ void Sys_ListFiles_r(listfiles_t *list, const char *path, int depth)
     closedir(dir);
 }
 
+/*
+=================
+Sys_MapFile
+
+Maps size bytes of open file read-only, returns NULL on failure.
+=================
+*/
+void *Sys_MapFile(FILE *fp, size_t size)
+{
+    void *base;
+
+    if (!size)
+        return NULL;
+
+    base = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    return base;
+}
+
+void Sys_UnmapFile(void *base, size_t size)
+{
+    if (base)
+        munmap(base, size);
+}
+
 /*
 ========================================================================
 
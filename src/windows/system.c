@@ -1042,6 +1042,17 @@ unsigned Sys_Milliseconds(void)
     return tm.QuadPart * 1000ULL / timer_freq.QuadPart;
 }
 
+uint64_t Sys_Nanoseconds(void)
+{
+    LARGE_INTEGER tm;
+    uint64_t sec, rem;
+
+    QueryPerformanceCounter(&tm);
+    sec = tm.QuadPart / timer_freq.QuadPart;
+    rem = tm.QuadPart % timer_freq.QuadPart;
+    return sec * 1000000000ULL + rem * 1000000000ULL / timer_freq.QuadPart;
+}
+
 void Sys_AddDefaultConfig(void)
 {
 }
@@ -1318,6 +1329,41 @@ void Sys_ListFiles_r(listfiles_t *list, const char *path, int depth)
     _findclose(handle);
 }
 
+/*
+=================
+Sys_MapFile
+
+Maps size bytes of open file read-only, returns NULL on failure.
+=================
+*/
+void *Sys_MapFile(FILE *fp, size_t size)
+{
+    HANDLE file, mapping;
+    void *base;
+
+    if (!size)
+        return NULL;
+
+    file = (HANDLE)_get_osfhandle(_fileno(fp));
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+        return NULL;
+
+    // view keeps the mapping object alive
+    base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);
+    return base;
+}
+
+void Sys_UnmapFile(void *base, size_t size)
+{
+    if (base)
+        UnmapViewOfFile(base);
+}
+
 /*
 ========================================================================
 